@@ -2,8 +2,21 @@
 [bits 16]
 
 ; Constants
-KERNEL_OFFSET equ 0x1000
+KERNEL_LOAD_SEG equ 0x1000      ; Kernel is staged at 0x10000 while in real mode
+KERNEL_STAGING equ 0x10000
+KERNEL_OFFSET equ 0x100000      ; ...and copied to 1MB once in protected mode
 STACK_BASE equ 0x9000
+KERNEL_STACK equ 0x90000
+
+; Number of kernel sectors, passed in by the Makefile from the size of kernel.bin
+%ifndef KERNEL_SECTORS
+%define KERNEL_SECTORS 128
+%endif
+
+; The staging area ends where the protected-mode stack starts (512KB)
+%if KERNEL_SECTORS > (KERNEL_STACK - KERNEL_STAGING) / 512
+%error "kernel.bin (with the initrd) is too large for the boot loader"
+%endif
 
 start:
     ; Set up segments and stack
@@ -28,16 +41,57 @@ start:
     int 0x13
     jc disk_error
 
-    ; Load kernel
-    mov bx, KERNEL_OFFSET
-    mov ah, 0x02           ; BIOS read sector function
-    mov al, 32             ; Number of sectors to read
-    mov ch, 0              ; Cylinder number
-    mov cl, 2              ; Sector number (1 is boot sector)
-    mov dh, 0              ; Head number
+    ; Query drive geometry so the kernel can be read with plain CHS calls
+    ; (works for both the floppy and the IDE disk image)
+    mov ah, 0x08
+    mov dl, [boot_drive]
+    xor di, di
+    int 0x13
+    jc disk_error
+    and cl, 0x3F
+    mov [sectors_per_track], cl
+    inc dh
+    mov [heads], dh
+
+    ; Load kernel one sector at a time, advancing the segment so the
+    ; image is not limited to a single track or 64KB window
+    mov ax, KERNEL_LOAD_SEG
+    mov es, ax
+    mov cx, KERNEL_SECTORS
+.load_sector:
+    push cx
+    mov ax, [lba]
+    xor dx, dx
+    movzx bx, byte [sectors_per_track]
+    div bx                 ; AX = track, DX = sector index
+    inc dx
+    mov cl, dl             ; Sector number (1-based)
+    xor dx, dx
+    movzx bx, byte [heads]
+    div bx                 ; AX = cylinder, DX = head
+    mov dh, dl             ; Head number
+    mov ch, al             ; Cylinder number (low 8 bits)
+    shl ah, 6
+    or cl, ah              ; Cylinder bits 8-9
     mov dl, [boot_drive]   ; Drive number
+    xor bx, bx
+    mov ax, 0x0201         ; BIOS read sector function, 1 sector
     int 0x13
     jc disk_error
+    mov ax, es
+    add ax, 0x20           ; Next 512 bytes
+    mov es, ax
+    inc word [lba]
+    pop cx
+    loop .load_sector
+    xor ax, ax
+    mov es, ax
+
+    ; Enable the A20 line (fast A20 gate) so the kernel can live at 1MB
+    in al, 0x92
+    or al, 0x02
+    and al, 0xFE
+    out 0x92, al
 
     ; Switch to protected mode
     cli                     ; 1. Disable interrupts
@@ -76,10 +130,17 @@ init_pm:
     mov fs, ax
     mov gs, ax
 
-    ; Set up stack
-    mov ebp, STACK_BASE
+    ; Set up stack below the EBDA, clear of the kernel image and its .bss
+    mov ebp, KERNEL_STACK
     mov esp, ebp
 
+    ; Copy the staged kernel to its link address
+    cld
+    mov esi, KERNEL_STAGING
+    mov edi, KERNEL_OFFSET
+    mov ecx, KERNEL_SECTORS * 128
+    rep movsd
+
     ; Clear screen
     mov edi, 0xb8000
     mov ecx, 2000
@@ -94,6 +155,9 @@ init_pm:
 
 ; Data
 boot_drive: db 0
+sectors_per_track: db 0
+heads: db 0
+lba: dw 1
 msg_loading: db 'Loading kernel...', 13, 10, 0
 msg_disk_error: db 'Disk error!', 13, 10, 0
 
@@ -0,0 +1,338 @@
+#include "ata.h"
+#include "block.h"
+#include "pci.h"
+#include "../include/kernel.h"
+#include "../kernel/interrupts.h"
+#include "../kernel/timer.h"
+
+#define ATA_CHANNELS 2
+#define ATA_DRIVES_PER_CHANNEL 2
+#define ATA_TIMEOUT 1000000
+#define ATA_IRQ_TIMEOUT_MS 2000
+
+// PCI class for IDE mass storage controllers
+#define PCI_CLASS_STORAGE 0x01
+#define PCI_SUBCLASS_IDE  0x01
+
+struct ata_channel {
+    uint16_t io;
+    uint16_t ctrl;
+    uint16_t bm;                  // Bus master base, 0 if none
+    int irq;
+    volatile int irq_fired;
+    volatile uint8_t bm_status;   // Latched by the IRQ handler
+    volatile uint8_t ata_status;
+    struct prd_entry* prdt;
+};
+
+struct ata_drive {
+    struct ata_channel* channel;
+    int slave;
+    int dma_capable;
+    struct block_device dev;
+};
+
+// PRD tables must be dword aligned and must not cross a 64KB boundary
+static struct prd_entry prd_tables[ATA_CHANNELS][ATA_PRD_ENTRIES] __attribute__((aligned(64)));
+
+static struct ata_channel channels[ATA_CHANNELS] = {
+    { ATA_PRIMARY_IO, ATA_PRIMARY_CTRL, 0, IRQ_ATA_PRIMARY, 0, 0, 0, NULL },
+    { ATA_SECONDARY_IO, ATA_SECONDARY_CTRL, 0, IRQ_ATA_SECONDARY, 0, 0, 0, NULL },
+};
+
+static struct ata_drive drives[ATA_CHANNELS * ATA_DRIVES_PER_CHANNEL];
+static int drive_count = 0;
+static int dma_enabled = 0;
+static int bus_master_found = 0;
+
+static const char* drive_names[] = { "hda", "hdb", "hdc", "hdd" };
+
+// Reading the alternate status register four times gives the 400ns settle delay
+static void ata_delay(struct ata_channel* ch) {
+    for (int i = 0; i < 4; i++) {
+        inb(ch->ctrl);
+    }
+}
+
+static int ata_wait_not_busy(struct ata_channel* ch) {
+    for (int i = 0; i < ATA_TIMEOUT; i++) {
+        if (!(inb(ch->io + ATA_REG_STATUS) & ATA_SR_BSY)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int ata_wait_drq(struct ata_channel* ch) {
+    for (int i = 0; i < ATA_TIMEOUT; i++) {
+        uint8_t status = inb(ch->io + ATA_REG_STATUS);
+        if (status & (ATA_SR_ERR | ATA_SR_DF)) {
+            return -1;
+        }
+        if (!(status & ATA_SR_BSY) && (status & ATA_SR_DRQ)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void ata_irq_handler(struct ata_channel* ch) {
+    if (ch->bm) {
+        ch->bm_status = inb(ch->bm + BM_REG_STATUS);
+        if (!(ch->bm_status & BM_STATUS_IRQ)) {
+            return;  // Not ours (shared or spurious)
+        }
+    }
+    // Reading the status register acknowledges the drive's interrupt
+    ch->ata_status = inb(ch->io + ATA_REG_STATUS);
+    if (ch->bm) {
+        outb(ch->bm + BM_REG_STATUS, BM_STATUS_IRQ | BM_STATUS_ERR);
+    }
+    ch->irq_fired = 1;
+}
+
+static int ata_irq_done(void* data) {
+    return ((struct ata_channel*)data)->irq_fired;
+}
+
+static void ata_primary_irq(struct interrupt_frame* frame) {
+    (void)frame;
+    ata_irq_handler(&channels[0]);
+}
+
+static void ata_secondary_irq(struct interrupt_frame* frame) {
+    (void)frame;
+    ata_irq_handler(&channels[1]);
+}
+
+// Select the drive and load the LBA28 task file
+static void ata_setup_task_file(struct ata_drive* drive, uint32_t lba, uint32_t count) {
+    struct ata_channel* ch = drive->channel;
+    outb(ch->io + ATA_REG_DRIVE, 0xE0 | (drive->slave << 4) | ((lba >> 24) & 0x0F));
+    ata_delay(ch);
+    outb(ch->io + ATA_REG_SECCOUNT, count == 256 ? 0 : count);
+    outb(ch->io + ATA_REG_LBA0, lba & 0xFF);
+    outb(ch->io + ATA_REG_LBA1, (lba >> 8) & 0xFF);
+    outb(ch->io + ATA_REG_LBA2, (lba >> 16) & 0xFF);
+}
+
+// Programmed I/O: every word goes through the CPU
+static int ata_pio_transfer(struct ata_drive* drive, uint32_t lba, uint32_t count, void* buffer, int write) {
+    struct ata_channel* ch = drive->channel;
+    uint16_t* words = (uint16_t*)buffer;
+
+    if (ata_wait_not_busy(ch) < 0) return -1;
+    ata_setup_task_file(drive, lba, count);
+    outb(ch->io + ATA_REG_COMMAND, write ? ATA_CMD_WRITE_PIO : ATA_CMD_READ_PIO);
+
+    for (uint32_t s = 0; s < count; s++) {
+        ata_delay(ch);
+        if (ata_wait_drq(ch) < 0) return -1;
+        if (write) {
+            outsw(ch->io + ATA_REG_DATA, words, 256);
+        } else {
+            insw(ch->io + ATA_REG_DATA, words, 256);
+        }
+        words += 256;
+    }
+
+    if (write) {
+        outb(ch->io + ATA_REG_COMMAND, ATA_CMD_FLUSH);
+        if (ata_wait_not_busy(ch) < 0) return -1;
+    }
+    return 0;
+}
+
+// Describe the buffer with PRD entries, splitting at 64KB boundaries
+static int ata_build_prdt(struct ata_channel* ch, void* buffer, uint32_t bytes) {
+    uint32_t address = (uint32_t)buffer;
+    int entries = 0;
+    while (bytes > 0) {
+        if (entries == ATA_PRD_ENTRIES) return -1;
+        uint32_t boundary = (address & 0xFFFF0000) + 0x10000;
+        uint32_t chunk = boundary - address;
+        if (chunk > bytes) chunk = bytes;
+        ch->prdt[entries].address = address;
+        ch->prdt[entries].byte_count = chunk & 0xFFFF;  // 0x10000 encodes as 0
+        ch->prdt[entries].flags = 0;
+        address += chunk;
+        bytes -= chunk;
+        entries++;
+    }
+    ch->prdt[entries - 1].flags = PRD_END_OF_TABLE;
+    return 0;
+}
+
+// Bus-master DMA: the controller moves the data and raises IRQ 14/15 when done
+static int ata_dma_transfer(struct ata_drive* drive, uint32_t lba, uint32_t count, void* buffer, int write) {
+    struct ata_channel* ch = drive->channel;
+    uint8_t direction = write ? 0 : BM_CMD_READ;
+
+    if (ata_build_prdt(ch, buffer, count * BLOCK_SECTOR_SIZE) < 0) return -1;
+    if (ata_wait_not_busy(ch) < 0) return -1;
+
+    outb(ch->bm + BM_REG_COMMAND, 0);
+    outl(ch->bm + BM_REG_PRDT, (uint32_t)ch->prdt);
+    outb(ch->bm + BM_REG_STATUS, BM_STATUS_IRQ | BM_STATUS_ERR);
+    outb(ch->bm + BM_REG_COMMAND, direction);
+
+    ch->irq_fired = 0;
+    ata_setup_task_file(drive, lba, count);
+    outb(ch->io + ATA_REG_COMMAND, write ? ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA);
+    outb(ch->bm + BM_REG_COMMAND, direction | BM_CMD_START);
+
+    // Sleep until the completion interrupt instead of spinning on the status
+    // port. If it never comes, look at the bus master once more in case
+    // only the interrupt was lost.
+    if (timer_wait(ata_irq_done, ch, ATA_IRQ_TIMEOUT_MS) < 0) {
+        uint32_t flags = interrupts_save();
+        ata_irq_handler(ch);
+        interrupts_restore(flags);
+    }
+    outb(ch->bm + BM_REG_COMMAND, 0);
+    if (!ch->irq_fired) {
+        print_string("Error: ATA DMA transfer timed out\n");
+        return -1;
+    }
+    if ((ch->bm_status & BM_STATUS_ERR) || (ch->ata_status & (ATA_SR_ERR | ATA_SR_DF))) {
+        return -1;
+    }
+    return 0;
+}
+
+static int ata_transfer(struct block_device* dev, uint32_t lba, uint32_t count, void* buffer, int write) {
+    struct ata_drive* drive = (struct ata_drive*)dev->driver_data;
+    uint8_t* bytes = (uint8_t*)buffer;
+
+    while (count > 0) {
+        uint32_t chunk = count > ATA_MAX_SECTORS ? ATA_MAX_SECTORS : count;
+        int result;
+        if (dma_enabled && drive->dma_capable && drive->channel->bm) {
+            result = ata_dma_transfer(drive, lba, chunk, bytes, write);
+        } else {
+            result = ata_pio_transfer(drive, lba, chunk, bytes, write);
+        }
+        if (result < 0) return -1;
+        lba += chunk;
+        count -= chunk;
+        bytes += chunk * BLOCK_SECTOR_SIZE;
+    }
+    return 0;
+}
+
+static int ata_read(struct block_device* dev, uint32_t lba, uint32_t count, void* buffer) {
+    return ata_transfer(dev, lba, count, buffer, 0);
+}
+
+static int ata_write(struct block_device* dev, uint32_t lba, uint32_t count, const void* buffer) {
+    return ata_transfer(dev, lba, count, (void*)buffer, 1);
+}
+
+// IDENTIFY a drive; returns the sector count or 0 if nothing usable is there
+static uint32_t ata_identify(struct ata_channel* ch, int slave, int* dma_capable) {
+    uint16_t identify[256];
+
+    outb(ch->io + ATA_REG_DRIVE, 0xA0 | (slave << 4));
+    ata_delay(ch);
+    outb(ch->io + ATA_REG_SECCOUNT, 0);
+    outb(ch->io + ATA_REG_LBA0, 0);
+    outb(ch->io + ATA_REG_LBA1, 0);
+    outb(ch->io + ATA_REG_LBA2, 0);
+    outb(ch->io + ATA_REG_COMMAND, ATA_CMD_IDENTIFY);
+    ata_delay(ch);
+
+    uint8_t status = inb(ch->io + ATA_REG_STATUS);
+    if (status == 0 || status == 0xFF) {
+        return 0;  // No drive
+    }
+    if (ata_wait_not_busy(ch) < 0) {
+        return 0;
+    }
+    // ATAPI and SATA devices report a signature here; they are not handled
+    if (inb(ch->io + ATA_REG_LBA1) != 0 || inb(ch->io + ATA_REG_LBA2) != 0) {
+        return 0;
+    }
+    if (ata_wait_drq(ch) < 0) {
+        return 0;
+    }
+    insw(ch->io + ATA_REG_DATA, identify, 256);
+
+    *dma_capable = (identify[49] & (1 << 8)) != 0;
+    return (uint32_t)identify[60] | ((uint32_t)identify[61] << 16);
+}
+
+// Locate the PIIX bus master interface through PCI config space
+static void ata_find_bus_master(void) {
+    struct pci_device* ide = pci_find_class(PCI_CLASS_STORAGE, PCI_SUBCLASS_IDE);
+    if (ide == NULL || !(ide->prog_if & 0x80)) {
+        return;
+    }
+    uint32_t bm = pci_bar(ide, 4);
+    if (bm == 0) {
+        return;
+    }
+    pci_enable_bus_master(ide);
+    channels[0].bm = bm;
+    channels[1].bm = bm + 8;
+    bus_master_found = 1;
+}
+
+void init_ata(void) {
+    drive_count = 0;
+    ata_find_bus_master();
+
+    for (int c = 0; c < ATA_CHANNELS; c++) {
+        channels[c].prdt = prd_tables[c];
+        channels[c].irq_fired = 0;
+        outb(channels[c].ctrl, 0);  // nIEN clear: the drive may raise interrupts
+    }
+    irq_register_handler(IRQ_ATA_PRIMARY, ata_primary_irq);
+    irq_register_handler(IRQ_ATA_SECONDARY, ata_secondary_irq);
+
+    for (int c = 0; c < ATA_CHANNELS; c++) {
+        for (int s = 0; s < ATA_DRIVES_PER_CHANNEL; s++) {
+            int dma_capable = 0;
+            uint32_t sectors = ata_identify(&channels[c], s, &dma_capable);
+            if (sectors == 0) {
+                continue;
+            }
+            struct ata_drive* drive = &drives[drive_count];
+            drive->channel = &channels[c];
+            drive->slave = s;
+            drive->dma_capable = dma_capable;
+            strcpy(drive->dev.name, drive_names[c * ATA_DRIVES_PER_CHANNEL + s]);
+            drive->dev.sector_count = sectors;
+            drive->dev.read = ata_read;
+            drive->dev.write = ata_write;
+            drive->dev.submit = NULL;
+            drive->dev.driver_data = drive;
+            drive_count++;
+        }
+    }
+
+    // Drain any interrupt left over from IDENTIFY before unmasking
+    for (int c = 0; c < ATA_CHANNELS; c++) {
+        inb(channels[c].io + ATA_REG_STATUS);
+        if (channels[c].bm) {
+            outb(channels[c].bm + BM_REG_STATUS, BM_STATUS_IRQ | BM_STATUS_ERR);
+        }
+    }
+    irq_unmask(IRQ_ATA_PRIMARY);
+    irq_unmask(IRQ_ATA_SECONDARY);
+
+    ata_set_dma(bus_master_found);
+    for (int i = 0; i < drive_count; i++) {
+        register_block_device(&drives[i].dev);
+    }
+}
+
+int ata_dma_available(void) {
+    return bus_master_found;
+}
+
+void ata_set_dma(int enabled) {
+    dma_enabled = enabled && bus_master_found;
+    for (int i = 0; i < drive_count; i++) {
+        drives[i].dev.driver = (dma_enabled && drives[i].dma_capable) ? "ata-dma" : "ata-pio";
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef ATA_H
+#define ATA_H
+
+#include <stdint.h>
+
+// Legacy channel resources
+#define ATA_PRIMARY_IO     0x1F0
+#define ATA_PRIMARY_CTRL   0x3F6
+#define ATA_SECONDARY_IO   0x170
+#define ATA_SECONDARY_CTRL 0x376
+
+// Task file registers (offsets from the I/O base)
+#define ATA_REG_DATA       0
+#define ATA_REG_ERROR      1
+#define ATA_REG_SECCOUNT   2
+#define ATA_REG_LBA0       3
+#define ATA_REG_LBA1       4
+#define ATA_REG_LBA2       5
+#define ATA_REG_DRIVE      6
+#define ATA_REG_STATUS     7
+#define ATA_REG_COMMAND    7
+
+// Status bits
+#define ATA_SR_ERR  0x01
+#define ATA_SR_DRQ  0x08
+#define ATA_SR_DF   0x20
+#define ATA_SR_BSY  0x80
+
+// Commands
+#define ATA_CMD_READ_PIO   0x20
+#define ATA_CMD_WRITE_PIO  0x30
+#define ATA_CMD_READ_DMA   0xC8
+#define ATA_CMD_WRITE_DMA  0xCA
+#define ATA_CMD_FLUSH      0xE7
+#define ATA_CMD_IDENTIFY   0xEC
+
+// Bus master IDE registers (offsets from BAR4, +8 for the secondary channel)
+#define BM_REG_COMMAND 0
+#define BM_REG_STATUS  2
+#define BM_REG_PRDT    4
+
+#define BM_CMD_START   0x01
+#define BM_CMD_READ    0x08  // Direction: device to memory
+#define BM_STATUS_ACTIVE 0x01
+#define BM_STATUS_ERR    0x02
+#define BM_STATUS_IRQ    0x04
+
+// Largest single command; 128 sectors is one full 64KB PRD region
+#define ATA_MAX_SECTORS 128
+#define ATA_PRD_ENTRIES 4
+#define PRD_END_OF_TABLE 0x8000
+
+// Physical region descriptor
+struct prd_entry {
+    uint32_t address;
+    uint16_t byte_count;  // 0 means 64KB
+    uint16_t flags;
+} __attribute__((packed));
+
+// Probe drives on both legacy channels and register them as block devices
+void init_ata(void);
+
+// Switch between bus-master DMA and PIO transfers (DMA needs a PIIX controller)
+int ata_dma_available(void);
+void ata_set_dma(int enabled);
+
+#endif
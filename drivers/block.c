@@ -0,0 +1,120 @@
+#include "block.h"
+#include "../include/kernel.h"
+#include "../kernel/trace.h"
+
+static struct block_device* block_devices[MAX_BLOCK_DEVICES];
+static int block_device_count = 0;
+
+// Add a device to the registry; the first one registered is the boot device
+int register_block_device(struct block_device* dev) {
+    if (block_device_count >= MAX_BLOCK_DEVICES) {
+        print_string("Error: Too many block devices\n");
+        return -1;
+    }
+    dev->reads = 0;
+    dev->writes = 0;
+    block_devices[block_device_count++] = dev;
+    return 0;
+}
+
+struct block_device* get_block_device(const char* name) {
+    for (int i = 0; i < block_device_count; i++) {
+        if (strcmp(block_devices[i]->name, name) == 0) {
+            return block_devices[i];
+        }
+    }
+    return NULL;
+}
+
+struct block_device* get_boot_block_device(void) {
+    return block_device_count > 0 ? block_devices[0] : NULL;
+}
+
+int block_read(struct block_device* dev, uint32_t lba, uint32_t count, void* buffer) {
+    if (dev == NULL || lba + count > dev->sector_count || lba + count < lba) {
+        return -1;
+    }
+    TRACE(TRACE_BLOCK_READ_BEGIN, lba, count);
+    int result = dev->read(dev, lba, count, buffer) < 0 ? -1 : 0;
+    TRACE(TRACE_BLOCK_READ_END, result, 0);
+    if (result == 0) {
+        dev->reads += count;
+    }
+    return result;
+}
+
+int block_write(struct block_device* dev, uint32_t lba, uint32_t count, const void* buffer) {
+    if (dev == NULL || lba + count > dev->sector_count || lba + count < lba) {
+        return -1;
+    }
+    TRACE(TRACE_BLOCK_WRITE_BEGIN, lba, count);
+    int result = dev->write(dev, lba, count, buffer) < 0 ? -1 : 0;
+    TRACE(TRACE_BLOCK_WRITE_END, result, 0);
+    if (result == 0) {
+        dev->writes += count;
+    }
+    return result;
+}
+
+// Run a batch of requests; drivers with a queue interface get it in one go
+int block_submit(struct block_device* dev, struct block_request* requests, int count) {
+    int result = 0;
+    if (dev == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        struct block_request* req = &requests[i];
+        req->status = 0;
+        if (req->lba + req->count > dev->sector_count || req->lba + req->count < req->lba) {
+            req->status = -1;
+            result = -1;
+        }
+    }
+    if (result < 0) {
+        return -1;
+    }
+
+    TRACE(TRACE_BLOCK_SUBMIT_BEGIN, count, count > 0 ? requests[0].lba : 0);
+    if (dev->submit) {
+        result = dev->submit(dev, requests, count);
+    } else {
+        for (int i = 0; i < count; i++) {
+            struct block_request* req = &requests[i];
+            if (req->write) {
+                req->status = dev->write(dev, req->lba, req->count, req->buffer);
+            } else {
+                req->status = dev->read(dev, req->lba, req->count, req->buffer);
+            }
+            if (req->status < 0) result = -1;
+        }
+    }
+    TRACE(TRACE_BLOCK_SUBMIT_END, result, 0);
+
+    for (int i = 0; i < count; i++) {
+        if (requests[i].status == 0) {
+            if (requests[i].write) dev->writes += requests[i].count;
+            else dev->reads += requests[i].count;
+        }
+    }
+    return result;
+}
+
+void list_block_devices(void) {
+    if (block_device_count == 0) {
+        print_string("No block devices.\n");
+        return;
+    }
+    for (int i = 0; i < block_device_count; i++) {
+        struct block_device* dev = block_devices[i];
+        print_string(dev->name);
+        print_string("  ");
+        print_int(dev->sector_count / 2);
+        print_string(" KB  driver: ");
+        print_string(dev->driver);
+        print_string("  read: ");
+        print_int(dev->reads);
+        print_string(" written: ");
+        print_int(dev->writes);
+        print_string(" sectors\n");
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#include <stdint.h>
+
+#define BLOCK_SECTOR_SIZE 512
+#define MAX_BLOCK_DEVICES 4
+#define BLOCK_NAME_LEN 8
+
+struct block_device;
+
+// One transfer in a batch handed to block_submit()
+struct block_request {
+    uint32_t lba;
+    uint32_t count;
+    void* buffer;
+    int write;
+    int status;                 // 0 on success, -1 on error (filled in on completion)
+};
+
+// Driver callbacks: transfer `count` sectors starting at `lba`; 0 on success, -1 on error
+typedef int (*block_read_t)(struct block_device* dev, uint32_t lba, uint32_t count, void* buffer);
+typedef int (*block_write_t)(struct block_device* dev, uint32_t lba, uint32_t count, const void* buffer);
+// Optional: queue a whole batch with a single device notification
+typedef int (*block_submit_t)(struct block_device* dev, struct block_request* requests, int count);
+
+// A registered storage device
+struct block_device {
+    char name[BLOCK_NAME_LEN];
+    const char* driver;         // Human readable driver/mode, e.g. "ata-dma"
+    uint32_t sector_count;
+    block_read_t read;
+    block_write_t write;
+    block_submit_t submit;      // NULL if the driver has no batched path
+    void* driver_data;
+    uint32_t reads;             // Sectors read through this device
+    uint32_t writes;            // Sectors written through this device
+};
+
+// Device registry
+int register_block_device(struct block_device* dev);
+struct block_device* get_block_device(const char* name);
+struct block_device* get_boot_block_device(void);
+void list_block_devices(void);
+
+// Transfers through the registry (bounds checked, statistics kept)
+int block_read(struct block_device* dev, uint32_t lba, uint32_t count, void* buffer);
+int block_write(struct block_device* dev, uint32_t lba, uint32_t count, const void* buffer);
+int block_submit(struct block_device* dev, struct block_request* requests, int count);
+
+#endif
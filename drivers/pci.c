@@ -0,0 +1,161 @@
+#include "pci.h"
+#include "../include/kernel.h"
+
+// Configuration mechanism #1 ports
+#define PCI_CONFIG_ADDRESS 0xCF8
+#define PCI_CONFIG_DATA    0xCFC
+
+#define PCI_MAX_BUS  256
+#define PCI_MAX_SLOT 32
+#define PCI_MAX_FUNC 8
+
+static struct pci_device pci_devices[PCI_MAX_DEVICES];
+static int pci_count = 0;
+
+static uint32_t pci_address(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset) {
+    return (uint32_t)0x80000000
+         | ((uint32_t)bus << 16)
+         | ((uint32_t)slot << 11)
+         | ((uint32_t)func << 8)
+         | (offset & 0xFC);
+}
+
+static uint32_t pci_read(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset) {
+    outl(PCI_CONFIG_ADDRESS, pci_address(bus, slot, func, offset));
+    return inl(PCI_CONFIG_DATA);
+}
+
+uint32_t pci_config_read32(struct pci_device* dev, uint8_t offset) {
+    return pci_read(dev->bus, dev->slot, dev->func, offset);
+}
+
+uint16_t pci_config_read16(struct pci_device* dev, uint8_t offset) {
+    return (pci_config_read32(dev, offset) >> ((offset & 2) * 8)) & 0xFFFF;
+}
+
+uint8_t pci_config_read8(struct pci_device* dev, uint8_t offset) {
+    return (pci_config_read32(dev, offset) >> ((offset & 3) * 8)) & 0xFF;
+}
+
+void pci_config_write32(struct pci_device* dev, uint8_t offset, uint32_t value) {
+    outl(PCI_CONFIG_ADDRESS, pci_address(dev->bus, dev->slot, dev->func, offset));
+    outl(PCI_CONFIG_DATA, value);
+}
+
+void pci_config_write16(struct pci_device* dev, uint8_t offset, uint16_t value) {
+    uint32_t old = pci_config_read32(dev, offset);
+    int shift = (offset & 2) * 8;
+    old &= ~((uint32_t)0xFFFF << shift);
+    old |= (uint32_t)value << shift;
+    pci_config_write32(dev, offset, old);
+}
+
+// Base address of a BAR with the type bits stripped
+uint32_t pci_bar(struct pci_device* dev, int bar) {
+    uint32_t value = pci_config_read32(dev, PCI_BAR0 + bar * 4);
+    if (value & 1) {
+        return value & 0xFFFFFFFC;  // I/O space
+    }
+    return value & 0xFFFFFFF0;      // Memory space
+}
+
+void pci_enable_bus_master(struct pci_device* dev) {
+    uint16_t command = pci_config_read16(dev, PCI_COMMAND);
+    command |= PCI_COMMAND_IO | PCI_COMMAND_MEMORY | PCI_COMMAND_BUS_MASTER;
+    pci_config_write16(dev, PCI_COMMAND, command);
+}
+
+static void pci_add_function(uint8_t bus, uint8_t slot, uint8_t func) {
+    if (pci_count >= PCI_MAX_DEVICES) {
+        return;
+    }
+    struct pci_device* dev = &pci_devices[pci_count];
+    dev->bus = bus;
+    dev->slot = slot;
+    dev->func = func;
+
+    uint32_t id = pci_config_read32(dev, PCI_VENDOR_ID);
+    dev->vendor_id = id & 0xFFFF;
+    dev->device_id = id >> 16;
+
+    uint32_t class_reg = pci_config_read32(dev, 0x08);
+    dev->class_code = class_reg >> 24;
+    dev->subclass = (class_reg >> 16) & 0xFF;
+    dev->prog_if = (class_reg >> 8) & 0xFF;
+    dev->irq = pci_config_read8(dev, PCI_INTERRUPT_LINE);
+    pci_count++;
+}
+
+// Brute-force scan of every bus/slot/function
+void init_pci(void) {
+    pci_count = 0;
+    for (int bus = 0; bus < PCI_MAX_BUS; bus++) {
+        for (int slot = 0; slot < PCI_MAX_SLOT; slot++) {
+            uint32_t id = pci_read(bus, slot, 0, PCI_VENDOR_ID);
+            if ((id & 0xFFFF) == 0xFFFF) {
+                continue;
+            }
+            uint8_t header = (pci_read(bus, slot, 0, 0x0C) >> 16) & 0xFF;
+            int functions = (header & 0x80) ? PCI_MAX_FUNC : 1;
+            for (int func = 0; func < functions; func++) {
+                id = pci_read(bus, slot, func, PCI_VENDOR_ID);
+                if ((id & 0xFFFF) != 0xFFFF) {
+                    pci_add_function(bus, slot, func);
+                }
+            }
+        }
+    }
+}
+
+int pci_device_count(void) {
+    return pci_count;
+}
+
+struct pci_device* pci_get_device(int index) {
+    if (index < 0 || index >= pci_count) {
+        return NULL;
+    }
+    return &pci_devices[index];
+}
+
+struct pci_device* pci_find_class(uint8_t class_code, uint8_t subclass) {
+    for (int i = 0; i < pci_count; i++) {
+        if (pci_devices[i].class_code == class_code && pci_devices[i].subclass == subclass) {
+            return &pci_devices[i];
+        }
+    }
+    return NULL;
+}
+
+struct pci_device* pci_find_device(uint16_t vendor_id, uint16_t device_id) {
+    for (int i = 0; i < pci_count; i++) {
+        if (pci_devices[i].vendor_id == vendor_id && pci_devices[i].device_id == device_id) {
+            return &pci_devices[i];
+        }
+    }
+    return NULL;
+}
+
+void list_pci_devices(void) {
+    if (pci_count == 0) {
+        print_string("No PCI devices.\n");
+        return;
+    }
+    for (int i = 0; i < pci_count; i++) {
+        struct pci_device* dev = &pci_devices[i];
+        print_int(dev->bus); print_char(':');
+        print_int(dev->slot); print_char('.');
+        print_int(dev->func);
+        print_string("  vendor ");
+        print_hex(dev->vendor_id);
+        print_string(" device ");
+        print_hex(dev->device_id);
+        print_string(" class ");
+        print_hex(dev->class_code);
+        print_char('/');
+        print_hex(dev->subclass);
+        print_string(" irq ");
+        print_int(dev->irq);
+        print_char('\n');
+    }
+}
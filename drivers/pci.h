@@ -0,0 +1,56 @@
+#ifndef PCI_H
+#define PCI_H
+
+#include <stdint.h>
+
+#define PCI_MAX_DEVICES 32
+
+// Standard configuration space offsets
+#define PCI_VENDOR_ID      0x00
+#define PCI_DEVICE_ID      0x02
+#define PCI_COMMAND        0x04
+#define PCI_STATUS         0x06
+#define PCI_PROG_IF        0x09
+#define PCI_SUBCLASS       0x0A
+#define PCI_CLASS          0x0B
+#define PCI_HEADER_TYPE    0x0E
+#define PCI_BAR0           0x10
+#define PCI_SUBSYSTEM_ID   0x2E
+#define PCI_INTERRUPT_LINE 0x3C
+
+// Command register bits
+#define PCI_COMMAND_IO          0x0001
+#define PCI_COMMAND_MEMORY      0x0002
+#define PCI_COMMAND_BUS_MASTER  0x0004
+
+// A function found during enumeration
+struct pci_device {
+    uint8_t bus;
+    uint8_t slot;
+    uint8_t func;
+    uint16_t vendor_id;
+    uint16_t device_id;
+    uint8_t class_code;
+    uint8_t subclass;
+    uint8_t prog_if;
+    uint8_t irq;
+};
+
+// Enumeration and lookup
+void init_pci(void);
+int pci_device_count(void);
+struct pci_device* pci_get_device(int index);
+struct pci_device* pci_find_class(uint8_t class_code, uint8_t subclass);
+struct pci_device* pci_find_device(uint16_t vendor_id, uint16_t device_id);
+void list_pci_devices(void);
+
+// Configuration space access
+uint32_t pci_config_read32(struct pci_device* dev, uint8_t offset);
+uint16_t pci_config_read16(struct pci_device* dev, uint8_t offset);
+uint8_t pci_config_read8(struct pci_device* dev, uint8_t offset);
+void pci_config_write32(struct pci_device* dev, uint8_t offset, uint32_t value);
+void pci_config_write16(struct pci_device* dev, uint8_t offset, uint16_t value);
+uint32_t pci_bar(struct pci_device* dev, int bar);
+void pci_enable_bus_master(struct pci_device* dev);
+
+#endif
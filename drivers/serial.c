@@ -0,0 +1,78 @@
+#include "serial.h"
+#include "../include/kernel.h"
+
+// 16550 registers, relative to the base port
+#define UART_DATA        0
+#define UART_IER         1
+#define UART_DIVISOR_LOW 0              // With DLAB set
+#define UART_DIVISOR_HIGH 1
+#define UART_FCR         2
+#define UART_LCR         3
+#define UART_MCR         4
+#define UART_LSR         5
+#define UART_SCRATCH     7
+
+#define LCR_DLAB         0x80
+#define LCR_8N1          0x03
+#define LSR_DATA_READY   0x01
+#define LSR_TX_EMPTY     0x20
+
+static int present = 0;
+
+void init_serial(void) {
+    // The scratch register exists on every 16450/16550; nothing answers
+    // when there is no UART at all
+    outb(SERIAL_COM1 + UART_SCRATCH, 0xA5);
+    if (inb(SERIAL_COM1 + UART_SCRATCH) != 0xA5) {
+        return;
+    }
+    outb(SERIAL_COM1 + UART_IER, 0x00);             // Polled, no interrupts
+    outb(SERIAL_COM1 + UART_LCR, LCR_DLAB);
+    outb(SERIAL_COM1 + UART_DIVISOR_LOW, 1);        // 115200 baud
+    outb(SERIAL_COM1 + UART_DIVISOR_HIGH, 0);
+    outb(SERIAL_COM1 + UART_LCR, LCR_8N1);
+    outb(SERIAL_COM1 + UART_FCR, 0xC7);             // Enable and clear FIFOs
+    outb(SERIAL_COM1 + UART_MCR, 0x03);             // DTR, RTS
+    present = 1;
+}
+
+int serial_present(void) {
+    return present;
+}
+
+void serial_write_char(char c) {
+    if (!present) {
+        return;
+    }
+    if (c == '\n') {
+        serial_write_char('\r');
+    }
+    while (!(inb(SERIAL_COM1 + UART_LSR) & LSR_TX_EMPTY)) {
+    }
+    outb(SERIAL_COM1 + UART_DATA, c);
+}
+
+void serial_write_string(const char* str) {
+    while (*str) {
+        serial_write_char(*str++);
+    }
+}
+
+void serial_write_int(int num) {
+    char str[12];
+    int_to_string(num, str);
+    serial_write_string(str);
+}
+
+int serial_received(void) {
+    return present && (inb(SERIAL_COM1 + UART_LSR) & LSR_DATA_READY);
+}
+
+// Terminals send CR for Enter and DEL for Backspace; map them to what the
+// keyboard produces
+char serial_read_char(void) {
+    char c = inb(SERIAL_COM1 + UART_DATA);
+    if (c == '\r') return '\n';
+    if (c == 0x7F) return '\b';
+    return c;
+}
@@ -0,0 +1,17 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+// COM1 at 115200 8N1, polled. Output is dropped when no UART answers, so
+// callers can log unconditionally. Input is read by getchar alongside the
+// keyboard, so the shell can be driven over the serial line.
+#define SERIAL_COM1 0x3F8
+
+void init_serial(void);
+int serial_present(void);
+void serial_write_char(char c);
+void serial_write_string(const char* str);
+void serial_write_int(int num);
+int serial_received(void);              // A byte is waiting
+char serial_read_char(void);
+
+#endif
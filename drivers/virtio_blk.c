@@ -0,0 +1,234 @@
+#include "virtio_blk.h"
+#include "block.h"
+#include "pci.h"
+#include "../include/kernel.h"
+#include "../kernel/interrupts.h"
+#include "../kernel/timer.h"
+
+#define VIRTIO_BLK_MAX_DEVICES 2
+#define VIRTIO_BLK_TIMEOUT_MS 2000
+
+// Bytes needed for a legacy split virtqueue of `n` entries
+#define VRING_ROUND(x) (((x) + VRING_ALIGN - 1) & ~(VRING_ALIGN - 1))
+#define VRING_SIZE(n) (VRING_ROUND(16 * (n) + 6 + 2 * (n)) + VRING_ROUND(6 + 8 * (n)))
+
+struct virtio_blk {
+    uint16_t io;
+    int irq;
+    uint16_t queue_size;
+    uint16_t last_used;
+    uint16_t target;                    // used->idx once the batch in flight is done
+    int failed;                         // Timed out; the ring can no longer be trusted
+    struct vring_desc* desc;
+    struct vring_avail* avail;
+    volatile struct vring_used* used;
+    struct virtio_blk_req_header headers[VIRTIO_BLK_MAX_BATCH];
+    volatile uint8_t status[VIRTIO_BLK_MAX_BATCH];
+    struct block_device dev;
+};
+
+static uint8_t vring_memory[VIRTIO_BLK_MAX_DEVICES][VRING_SIZE(VIRTIO_MAX_QUEUE_SIZE)] __attribute__((aligned(VRING_ALIGN)));
+static struct virtio_blk devices[VIRTIO_BLK_MAX_DEVICES];
+static int device_count = 0;
+
+static const char* device_names[] = { "vda", "vdb" };
+
+static void virtio_blk_irq(struct interrupt_frame* frame) {
+    (void)frame;
+    // Reading the ISR status acknowledges (deasserts) the interrupt
+    for (int i = 0; i < VIRTIO_BLK_MAX_DEVICES; i++) {
+        if (devices[i].io) {
+            inb(devices[i].io + VIRTIO_REG_ISR_STATUS);
+        }
+    }
+}
+
+static int virtio_blk_done(void* data) {
+    struct virtio_blk* vb = (struct virtio_blk*)data;
+    return vb->used->idx == vb->target;
+}
+
+// Queue up to VIRTIO_BLK_MAX_BATCH requests, ring the doorbell once and wait
+// for all of them to come back on the used ring
+static int virtio_blk_run_batch(struct virtio_blk* vb, struct block_request* requests, int count) {
+    uint16_t avail_idx = vb->avail->idx;
+
+    if (vb->failed) {
+        for (int i = 0; i < count; i++) requests[i].status = -1;
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        struct block_request* req = &requests[i];
+        int head = i * 3;
+
+        vb->headers[i].type = req->write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+        vb->headers[i].reserved = 0;
+        vb->headers[i].sector = req->lba;
+        vb->status[i] = 0xFF;
+
+        vb->desc[head].address = (uint32_t)&vb->headers[i];
+        vb->desc[head].length = sizeof(struct virtio_blk_req_header);
+        vb->desc[head].flags = VRING_DESC_F_NEXT;
+        vb->desc[head].next = head + 1;
+
+        vb->desc[head + 1].address = (uint32_t)req->buffer;
+        vb->desc[head + 1].length = req->count * BLOCK_SECTOR_SIZE;
+        vb->desc[head + 1].flags = VRING_DESC_F_NEXT | (req->write ? 0 : VRING_DESC_F_WRITE);
+        vb->desc[head + 1].next = head + 2;
+
+        vb->desc[head + 2].address = (uint32_t)&vb->status[i];
+        vb->desc[head + 2].length = 1;
+        vb->desc[head + 2].flags = VRING_DESC_F_WRITE;
+        vb->desc[head + 2].next = 0;
+
+        vb->avail->ring[(avail_idx + i) % vb->queue_size] = head;
+    }
+
+    // Descriptors must be visible before the index, and the index before the doorbell
+    __sync_synchronize();
+    vb->avail->idx = avail_idx + count;
+    __sync_synchronize();
+    outw(vb->io + VIRTIO_REG_QUEUE_NOTIFY, 0);
+
+    uint16_t target = vb->last_used + count;
+    vb->target = target;
+    // timer_wait polls used->idx once more after the deadline. Requests
+    // still out would complete into a later batch's slots, so the device
+    // is given up on.
+    if (timer_wait(virtio_blk_done, vb, VIRTIO_BLK_TIMEOUT_MS) < 0) {
+        vb->failed = 1;
+        outb(vb->io + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_FAILED);
+        print_string("Error: ");
+        print_string(vb->dev.name);
+        print_string(" timed out\n");
+        for (int i = 0; i < count; i++) requests[i].status = -1;
+        return -1;
+    }
+    __sync_synchronize();
+
+    int result = 0;
+    while (vb->last_used != target) {
+        const volatile struct vring_used_elem* elem = &vb->used->ring[vb->last_used % vb->queue_size];
+        int slot = elem->id / 3;
+        requests[slot].status = vb->status[slot] == VIRTIO_BLK_S_OK ? 0 : -1;
+        if (requests[slot].status < 0) result = -1;
+        vb->last_used++;
+    }
+    return result;
+}
+
+// Batched path: small requests share doorbells, oversized ones are split
+static int virtio_blk_submit(struct block_device* dev, struct block_request* requests, int count) {
+    struct virtio_blk* vb = (struct virtio_blk*)dev->driver_data;
+    struct block_request batch[VIRTIO_BLK_MAX_BATCH];
+    struct block_request* origin[VIRTIO_BLK_MAX_BATCH];
+    int max_batch = vb->queue_size / 3 < VIRTIO_BLK_MAX_BATCH ? vb->queue_size / 3 : VIRTIO_BLK_MAX_BATCH;
+    int pending = 0;
+    int result = 0;
+
+    for (int i = 0; i < count; i++) {
+        // Split the next request into device-sized pieces
+        uint32_t done = 0;
+        while (done < requests[i].count) {
+            uint32_t chunk = requests[i].count - done;
+            if (chunk > VIRTIO_BLK_MAX_SECTORS) chunk = VIRTIO_BLK_MAX_SECTORS;
+            batch[pending].lba = requests[i].lba + done;
+            batch[pending].count = chunk;
+            batch[pending].buffer = (uint8_t*)requests[i].buffer + done * BLOCK_SECTOR_SIZE;
+            batch[pending].write = requests[i].write;
+            origin[pending] = &requests[i];
+            requests[i].status = 0;
+            pending++;
+            done += chunk;
+            if (pending == max_batch) {
+                if (virtio_blk_run_batch(vb, batch, pending) < 0) result = -1;
+                for (int j = 0; j < pending; j++) {
+                    if (batch[j].status < 0) origin[j]->status = -1;
+                }
+                pending = 0;
+            }
+        }
+    }
+    if (pending > 0) {
+        if (virtio_blk_run_batch(vb, batch, pending) < 0) result = -1;
+        for (int j = 0; j < pending; j++) {
+            if (batch[j].status < 0) origin[j]->status = -1;
+        }
+    }
+    return result;
+}
+
+static int virtio_blk_read(struct block_device* dev, uint32_t lba, uint32_t count, void* buffer) {
+    struct block_request req = { lba, count, buffer, 0, 0 };
+    return virtio_blk_submit(dev, &req, 1);
+}
+
+static int virtio_blk_write(struct block_device* dev, uint32_t lba, uint32_t count, const void* buffer) {
+    struct block_request req = { lba, count, (void*)buffer, 1, 0 };
+    return virtio_blk_submit(dev, &req, 1);
+}
+
+// Legacy initialization sequence: reset, acknowledge, set up queue 0, go
+static int virtio_blk_setup(struct virtio_blk* vb, struct pci_device* pci, int index) {
+    vb->io = pci_bar(pci, 0);
+    vb->irq = pci->irq;
+    pci_enable_bus_master(pci);
+
+    outb(vb->io + VIRTIO_REG_DEVICE_STATUS, 0);
+    outb(vb->io + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+    outb(vb->io + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+
+    // No optional features are needed for plain reads and writes
+    inl(vb->io + VIRTIO_REG_DEVICE_FEATURES);
+    outl(vb->io + VIRTIO_REG_GUEST_FEATURES, 0);
+
+    outw(vb->io + VIRTIO_REG_QUEUE_SELECT, 0);
+    vb->queue_size = inw(vb->io + VIRTIO_REG_QUEUE_SIZE);
+    if (vb->queue_size == 0 || vb->queue_size > VIRTIO_MAX_QUEUE_SIZE) {
+        outb(vb->io + VIRTIO_REG_DEVICE_STATUS, VIRTIO_STATUS_FAILED);
+        return -1;
+    }
+
+    uint8_t* ring = vring_memory[index];
+    memset(ring, 0, VRING_SIZE(vb->queue_size));
+    vb->desc = (struct vring_desc*)ring;
+    vb->avail = (struct vring_avail*)(ring + 16 * vb->queue_size);
+    vb->used = (struct vring_used*)(ring + VRING_ROUND(16 * vb->queue_size + 6 + 2 * vb->queue_size));
+    vb->last_used = 0;
+    vb->failed = 0;
+    outl(vb->io + VIRTIO_REG_QUEUE_ADDRESS, (uint32_t)ring / VRING_ALIGN);
+
+    uint32_t capacity_low = inl(vb->io + VIRTIO_REG_CONFIG);
+    uint32_t capacity_high = inl(vb->io + VIRTIO_REG_CONFIG + 4);
+
+    strcpy(vb->dev.name, device_names[index]);
+    vb->dev.driver = "virtio-blk";
+    vb->dev.sector_count = capacity_high ? 0xFFFFFFFF : capacity_low;
+    vb->dev.read = virtio_blk_read;
+    vb->dev.write = virtio_blk_write;
+    vb->dev.submit = virtio_blk_submit;
+    vb->dev.driver_data = vb;
+
+    irq_register_handler(vb->irq, virtio_blk_irq);
+    irq_unmask(vb->irq);
+    outb(vb->io + VIRTIO_REG_DEVICE_STATUS,
+         VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+    return 0;
+}
+
+void init_virtio_blk(void) {
+    device_count = 0;
+    for (int i = 0; i < pci_device_count() && device_count < VIRTIO_BLK_MAX_DEVICES; i++) {
+        struct pci_device* pci = pci_get_device(i);
+        if (pci->vendor_id != VIRTIO_PCI_VENDOR || pci->device_id != VIRTIO_PCI_BLK_LEGACY) {
+            continue;
+        }
+        struct virtio_blk* vb = &devices[device_count];
+        if (virtio_blk_setup(vb, pci, device_count) < 0) {
+            vb->io = 0;
+            continue;
+        }
+        device_count++;
+        register_block_device(&vb->dev);
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef VIRTIO_BLK_H
+#define VIRTIO_BLK_H
+
+#include <stdint.h>
+
+// Transitional (legacy interface) virtio-blk PCI IDs
+#define VIRTIO_PCI_VENDOR    0x1AF4
+#define VIRTIO_PCI_BLK_LEGACY 0x1001
+
+// Legacy virtio PCI I/O registers (offsets from BAR0)
+#define VIRTIO_REG_DEVICE_FEATURES 0x00
+#define VIRTIO_REG_GUEST_FEATURES  0x04
+#define VIRTIO_REG_QUEUE_ADDRESS   0x08
+#define VIRTIO_REG_QUEUE_SIZE      0x0C
+#define VIRTIO_REG_QUEUE_SELECT    0x0E
+#define VIRTIO_REG_QUEUE_NOTIFY    0x10
+#define VIRTIO_REG_DEVICE_STATUS   0x12
+#define VIRTIO_REG_ISR_STATUS      0x13
+#define VIRTIO_REG_CONFIG          0x14
+
+// Device status bits
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x01
+#define VIRTIO_STATUS_DRIVER      0x02
+#define VIRTIO_STATUS_DRIVER_OK   0x04
+#define VIRTIO_STATUS_FAILED      0x80
+
+// Descriptor flags
+#define VRING_DESC_F_NEXT  1
+#define VRING_DESC_F_WRITE 2
+
+// Legacy virtqueues are laid out with a 4KB alignment between the rings
+#define VRING_ALIGN 4096
+#define VIRTIO_MAX_QUEUE_SIZE 1024
+
+// virtio-blk request types and status
+#define VIRTIO_BLK_T_IN    0
+#define VIRTIO_BLK_T_OUT   1
+#define VIRTIO_BLK_S_OK    0
+
+// Requests in flight per doorbell; each uses three descriptors
+#define VIRTIO_BLK_MAX_BATCH 32
+#define VIRTIO_BLK_MAX_SECTORS 256
+
+// Split virtqueue structures
+struct vring_desc {
+    uint64_t address;
+    uint32_t length;
+    uint16_t flags;
+    uint16_t next;
+} __attribute__((packed));
+
+struct vring_avail {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} __attribute__((packed));
+
+struct vring_used_elem {
+    uint32_t id;
+    uint32_t length;
+} __attribute__((packed));
+
+struct vring_used {
+    uint16_t flags;
+    uint16_t idx;
+    struct vring_used_elem ring[];
+} __attribute__((packed));
+
+// Request header placed in the first descriptor of every chain
+struct virtio_blk_req_header {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t sector;
+} __attribute__((packed));
+
+// Find virtio-blk functions on the PCI bus and register them as block devices
+void init_virtio_blk(void);
+
+#endif
@@ -0,0 +1,336 @@
+#include "agranfs.h"
+#include "bcache.h"
+#include "lfs.h"
+#include "../include/kernel.h"
+
+// Mounted state; inodes and the bitmap are small enough to keep in memory,
+// every change is also written to its block through the buffer cache
+static struct block_device* fs_dev = NULL;
+static struct agranfs_superblock sb;
+static struct agranfs_inode inodes[AGRANFS_INODES];
+static struct agranfs_dirent dirents[AGRANFS_INODES];
+static uint8_t bitmap[AGRANFS_MAX_BITMAP_BLOCKS * AGRANFS_BLOCK_SIZE];
+static int log_mode = 0;              // Log-structured image, handled by lfs.c
+
+static uint32_t block_lba(uint32_t block) {
+    return AGRANFS_START_LBA + block;
+}
+
+// Copy one metadata record into its block and mark it dirty
+static int store_record(uint32_t block, uint32_t offset, const void* record, uint32_t size) {
+    struct buffer* buf = bcache_read(fs_dev, block_lba(block));
+    if (buf == NULL) {
+        print_string("Error: Metadata write failed\n");
+        return -1;
+    }
+    memcpy(buf->data + offset, record, size);
+    bcache_mark_dirty(buf);
+    bcache_release(buf);
+    return 0;
+}
+
+static int store_superblock(void) {
+    return store_record(0, 0, &sb, sizeof(sb));
+}
+
+static int store_inode(int inode) {
+    return store_record(sb.inode_start + inode / AGRANFS_INODES_PER_BLOCK,
+                        (inode % AGRANFS_INODES_PER_BLOCK) * sizeof(struct agranfs_inode),
+                        &inodes[inode], sizeof(struct agranfs_inode));
+}
+
+static int store_dirent(int slot) {
+    return store_record(sb.dir_start + slot / AGRANFS_DIRENTS_PER_BLOCK,
+                        (slot % AGRANFS_DIRENTS_PER_BLOCK) * sizeof(struct agranfs_dirent),
+                        &dirents[slot], sizeof(struct agranfs_dirent));
+}
+
+static int store_bitmap_for(uint32_t block) {
+    uint32_t index = block / AGRANFS_BITS_PER_BLOCK;
+    return store_record(sb.bitmap_start + index, 0,
+                        bitmap + index * AGRANFS_BLOCK_SIZE, AGRANFS_BLOCK_SIZE);
+}
+
+static int block_in_use(uint32_t block) {
+    return bitmap[block / 8] & (1 << (block % 8));
+}
+
+static uint32_t alloc_block(void) {
+    for (uint32_t block = sb.data_start; block < sb.total_blocks; block++) {
+        if (!block_in_use(block)) {
+            bitmap[block / 8] |= 1 << (block % 8);
+            sb.free_blocks--;
+            store_bitmap_for(block);
+            return block;
+        }
+    }
+    return 0;
+}
+
+static void free_block(uint32_t block) {
+    if (block < sb.data_start || block >= sb.total_blocks || !block_in_use(block)) {
+        return;
+    }
+    bitmap[block / 8] &= ~(1 << (block % 8));
+    sb.free_blocks++;
+    store_bitmap_for(block);
+}
+
+// Load a block range straight into memory (metadata only, used at mount)
+static int load_blocks(uint32_t start, uint32_t count, void* dest, uint32_t max_bytes) {
+    uint8_t* out = (uint8_t*)dest;
+    for (uint32_t i = 0; i < count && (i + 1) * AGRANFS_BLOCK_SIZE <= max_bytes; i++) {
+        struct buffer* buf = bcache_read(fs_dev, block_lba(start + i));
+        if (buf == NULL) return -1;
+        memcpy(out + i * AGRANFS_BLOCK_SIZE, buf->data, AGRANFS_BLOCK_SIZE);
+        bcache_release(buf);
+    }
+    return 0;
+}
+
+// The regions follow each other in order inside the file system, and the
+// bitmap and tables are big enough for what is written into them later
+static int layout_valid(void) {
+    uint64_t bitmap_end = (uint64_t)sb.bitmap_start + sb.bitmap_blocks;
+    uint64_t inode_end = (uint64_t)sb.inode_start + sb.inode_blocks;
+    uint64_t dir_end = (uint64_t)sb.dir_start + sb.dir_blocks;
+    return sb.total_blocks <= (uint64_t)sb.bitmap_blocks * AGRANFS_BITS_PER_BLOCK &&
+           sb.inode_blocks * AGRANFS_INODES_PER_BLOCK >= AGRANFS_INODES &&
+           sb.dir_blocks * AGRANFS_DIRENTS_PER_BLOCK >= AGRANFS_INODES &&
+           sb.bitmap_start >= 1 && bitmap_end <= sb.inode_start &&
+           inode_end <= sb.dir_start && dir_end <= sb.data_start &&
+           sb.data_start <= sb.total_blocks;
+}
+
+// Mount reads the superblock, bitmap, inode table and directory; file data
+// is only touched when a file is read, so mount cost does not grow with data
+int agranfs_mount(struct block_device* dev) {
+    fs_dev = dev;
+    if (dev == NULL || dev->sector_count <= AGRANFS_START_LBA) {
+        fs_dev = NULL;
+        return -1;
+    }
+    if (load_blocks(0, 1, &sb, sizeof(sb)) < 0 || sb.magic != AGRANFS_MAGIC) {
+        fs_dev = NULL;
+        return -1;
+    }
+    if (sb.version == AGRANFS_VERSION && (sb.flags & AGRANFS_FLAG_LOG) &&
+        AGRANFS_START_LBA + sb.total_blocks <= dev->sector_count) {
+        log_mode = 1;
+        if (lfs_mount(dev, &sb) < 0) {
+            log_mode = 0;
+            fs_dev = NULL;
+            return -1;
+        }
+        return 0;
+    }
+    if (sb.version != AGRANFS_VERSION || sb.block_size != AGRANFS_BLOCK_SIZE ||
+        sb.inode_count > AGRANFS_INODES || sb.bitmap_blocks > AGRANFS_MAX_BITMAP_BLOCKS ||
+        AGRANFS_START_LBA + sb.total_blocks > dev->sector_count || !layout_valid()) {
+        print_string("Error: Unsupported AGRAN file system layout\n");
+        fs_dev = NULL;
+        return -1;
+    }
+
+    memset(inodes, 0, sizeof(inodes));
+    memset(dirents, 0, sizeof(dirents));
+    if (load_blocks(sb.bitmap_start, sb.bitmap_blocks, bitmap, sizeof(bitmap)) < 0 ||
+        load_blocks(sb.inode_start, sb.inode_blocks, inodes, sizeof(inodes)) < 0 ||
+        load_blocks(sb.dir_start, sb.dir_blocks, dirents, sizeof(dirents)) < 0) {
+        print_string("Error: Failed to read file system metadata\n");
+        fs_dev = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void agranfs_unmount(void) {
+    if (fs_dev) {
+        agranfs_sync();
+        bcache_invalidate(fs_dev);
+    }
+    fs_dev = NULL;
+    log_mode = 0;
+}
+
+int agranfs_is_mounted(void) {
+    return fs_dev != NULL;
+}
+
+// Directory iteration: 1 and the entry for a used slot, 0 for a free one,
+// -1 past the end of the directory
+int agranfs_dir_entry(int index, char* name, int* inode, uint32_t* size) {
+    if (log_mode) return lfs_dir_entry(index, name, inode, size);
+    if (fs_dev == NULL || index < 0 || index >= (int)sb.inode_count) {
+        return -1;
+    }
+    struct agranfs_dirent* entry = &dirents[index];
+    if (entry->inode == 0 || entry->inode > sb.inode_count) {
+        return 0;
+    }
+    strncpy(name, entry->name, AGRANFS_NAME_LEN - 1);
+    name[AGRANFS_NAME_LEN - 1] = '\0';
+    *inode = entry->inode - 1;
+    *size = inodes[entry->inode - 1].size;
+    return 1;
+}
+
+// Allocate an inode and a directory entry; returns the inode or -1
+int agranfs_create(const char* name) {
+    if (log_mode) return lfs_create(name);
+    if (fs_dev == NULL) return -1;
+    int inode = -1;
+    for (int i = 0; i < (int)sb.inode_count; i++) {
+        if (!(inodes[i].flags & AGRANFS_INODE_USED)) {
+            inode = i;
+            break;
+        }
+    }
+    int slot = -1;
+    for (int i = 0; i < (int)sb.inode_count; i++) {
+        if (dirents[i].inode == 0) {
+            slot = i;
+            break;
+        }
+    }
+    if (inode < 0 || slot < 0) {
+        return -1;
+    }
+
+    memset(&inodes[inode], 0, sizeof(struct agranfs_inode));
+    inodes[inode].flags = AGRANFS_INODE_USED;
+    memset(&dirents[slot], 0, sizeof(struct agranfs_dirent));
+    dirents[slot].inode = inode + 1;
+    strncpy(dirents[slot].name, name, AGRANFS_NAME_LEN - 1);
+
+    if (store_inode(inode) < 0 || store_dirent(slot) < 0) {
+        return -1;
+    }
+    return inode;
+}
+
+int agranfs_remove(int inode) {
+    if (log_mode) return lfs_remove(inode);
+    if (fs_dev == NULL || inode < 0 || inode >= (int)sb.inode_count) return -1;
+    for (int i = 0; i < AGRANFS_DIRECT_BLOCKS; i++) {
+        if (inodes[inode].blocks[i]) {
+            free_block(inodes[inode].blocks[i]);
+        }
+    }
+    memset(&inodes[inode], 0, sizeof(struct agranfs_inode));
+    store_inode(inode);
+    for (int i = 0; i < (int)sb.inode_count; i++) {
+        if (dirents[i].inode == (uint32_t)inode + 1) {
+            memset(&dirents[i], 0, sizeof(struct agranfs_dirent));
+            store_dirent(i);
+        }
+    }
+    store_superblock();
+    return 0;
+}
+
+// Read file data through the buffer cache; returns bytes read or -1
+int agranfs_read(int inode, char* buffer, uint32_t max_size) {
+    if (log_mode) return lfs_read(inode, buffer, max_size);
+    if (fs_dev == NULL || inode < 0 || inode >= (int)sb.inode_count) return -1;
+    struct agranfs_inode* node = &inodes[inode];
+    uint32_t size = node->size < max_size ? node->size : max_size;
+    uint32_t done = 0;
+    for (int i = 0; i < AGRANFS_DIRECT_BLOCKS && done < size; i++) {
+        uint32_t chunk = size - done;
+        if (chunk > AGRANFS_BLOCK_SIZE) chunk = AGRANFS_BLOCK_SIZE;
+        struct buffer* buf = bcache_read(fs_dev, block_lba(node->blocks[i]));
+        if (buf == NULL) return -1;
+        memcpy(buffer + done, buf->data, chunk);
+        bcache_release(buf);
+        done += chunk;
+    }
+    return (int)done;
+}
+
+// Replace the file contents, growing or shrinking its block list
+int agranfs_write(int inode, const char* data, uint32_t size) {
+    if (log_mode) return lfs_write(inode, data, size);
+    if (fs_dev == NULL || inode < 0 || inode >= (int)sb.inode_count) return -1;
+    if (size > AGRANFS_DIRECT_BLOCKS * AGRANFS_BLOCK_SIZE) {
+        size = AGRANFS_DIRECT_BLOCKS * AGRANFS_BLOCK_SIZE;
+    }
+    struct agranfs_inode* node = &inodes[inode];
+    uint32_t needed = (size + AGRANFS_BLOCK_SIZE - 1) / AGRANFS_BLOCK_SIZE;
+
+    for (uint32_t i = 0; i < AGRANFS_DIRECT_BLOCKS; i++) {
+        if (i >= needed && node->blocks[i]) {
+            free_block(node->blocks[i]);
+            node->blocks[i] = 0;
+        } else if (i < needed && node->blocks[i] == 0) {
+            node->blocks[i] = alloc_block();
+            if (node->blocks[i] == 0) {
+                print_string("Error: Disk full\n");
+                store_inode(inode);
+                store_superblock();
+                return -1;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < needed; i++) {
+        uint32_t offset = i * AGRANFS_BLOCK_SIZE;
+        uint32_t chunk = size - offset;
+        if (chunk > AGRANFS_BLOCK_SIZE) chunk = AGRANFS_BLOCK_SIZE;
+        struct buffer* buf = bcache_get(fs_dev, block_lba(node->blocks[i]));
+        if (buf == NULL) return -1;
+        memcpy(buf->data, data + offset, chunk);
+        if (chunk < AGRANFS_BLOCK_SIZE) {
+            memset(buf->data + chunk, 0, AGRANFS_BLOCK_SIZE - chunk);
+        }
+        bcache_mark_dirty(buf);
+        bcache_release(buf);
+    }
+
+    node->size = size;
+    if (store_inode(inode) < 0 || store_superblock() < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Push everything written so far to the disk
+int agranfs_sync(void) {
+    if (fs_dev == NULL) return 0;
+    int result = 0;
+    if (log_mode && lfs_sync() < 0) {
+        result = -1;
+    }
+    if (bcache_sync() < 0) {
+        result = -1;
+    }
+    return result;
+}
+
+void agranfs_print_info(void) {
+    if (fs_dev == NULL) {
+        print_string("File system: RAM only (no AGRAN FS found on disk)\n");
+        return;
+    }
+    if (log_mode) {
+        lfs_print_info();
+        return;
+    }
+    int used = 0;
+    for (int i = 0; i < (int)sb.inode_count; i++) {
+        if (inodes[i].flags & AGRANFS_INODE_USED) used++;
+    }
+    print_string("File system: AGRAN FS on ");
+    print_string(fs_dev->name);
+    print_string("\nBlocks: ");
+    print_int(sb.total_blocks - sb.free_blocks);
+    print_string(" used / ");
+    print_int(sb.total_blocks);
+    print_string(" total (");
+    print_int(AGRANFS_BLOCK_SIZE);
+    print_string(" bytes each)\nInodes: ");
+    print_int(used);
+    print_string(" used / ");
+    print_int(sb.inode_count);
+    print_char('\n');
+}
@@ -0,0 +1,133 @@
+#ifndef AGRANFS_H
+#define AGRANFS_H
+
+// On-disk layout of the AGRAN file system. This header is shared with the
+// host-side mkfs tool, so it must only depend on <stdint.h>.
+//
+//   block 0                      superblock
+//   bitmap_start ..              one bit per block of the file system
+//   inode_start ..               inode table
+//   dir_start ..                 root directory entries
+//   data_start ..                file data
+//
+// Log-structured images (AGRANFS_FLAG_LOG) replace everything after the
+// superblock with a checkpoint region and a log of fixed-size segments:
+//
+//   checkpoint_start ..          inode map, segment usage, log head
+//   segment_start ..             segments: a summary block, then data
+//                                blocks and packed inode blocks
+//
+// Blocks are one sector; block numbers are relative to AGRANFS_START_LBA.
+
+#include <stdint.h>
+
+#define AGRANFS_MAGIC 0x4E524741      // "AGRN"
+#define AGRANFS_VERSION 1
+#define AGRANFS_BLOCK_SIZE 512
+#define AGRANFS_START_LBA 2048        // 1MB into the disk, after the boot sector and kernel
+#define AGRANFS_NAME_LEN 32
+#define AGRANFS_DIRECT_BLOCKS 8
+#define AGRANFS_INODES 64
+#define AGRANFS_MAX_BITMAP_BLOCKS 16  // Enough for a 32MB file system
+
+#define AGRANFS_INODES_PER_BLOCK (AGRANFS_BLOCK_SIZE / sizeof(struct agranfs_inode))
+#define AGRANFS_DIRENTS_PER_BLOCK (AGRANFS_BLOCK_SIZE / sizeof(struct agranfs_dirent))
+#define AGRANFS_BITS_PER_BLOCK (AGRANFS_BLOCK_SIZE * 8)
+
+// Inode flags
+#define AGRANFS_INODE_USED 0x1
+
+// Superblock flags
+#define AGRANFS_FLAG_LOG 0x1
+
+// Log-structured layout
+#define AGRANFS_SEGMENT_BLOCKS 64        // 32KB segments, written in one request
+#define AGRANFS_MAX_SEGMENTS 1024
+#define AGRANFS_SUMMARY_INODE_BLOCK 0xFFFF
+#define AGRANFS_LOG_INODES_PER_BLOCK (AGRANFS_BLOCK_SIZE / sizeof(struct agranfs_log_inode))
+#define AGRANFS_CHECKPOINT_BLOCKS \
+    ((sizeof(struct agranfs_checkpoint) + AGRANFS_BLOCK_SIZE - 1) / AGRANFS_BLOCK_SIZE)
+
+// Inode map entries pack the block and the slot within a packed inode block
+#define AGRANFS_IMAP_ENTRY(block, slot) (((block) << 2) | (slot))
+#define AGRANFS_IMAP_BLOCK(entry) ((entry) >> 2)
+#define AGRANFS_IMAP_SLOT(entry) ((entry) & 3)
+
+struct agranfs_superblock {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t block_size;
+    uint32_t total_blocks;
+    uint32_t free_blocks;
+    uint32_t inode_count;
+    uint32_t bitmap_start;
+    uint32_t bitmap_blocks;
+    uint32_t inode_start;
+    uint32_t inode_blocks;
+    uint32_t dir_start;
+    uint32_t dir_blocks;
+    uint32_t data_start;
+    uint32_t flags;
+    uint32_t checkpoint_start;
+    uint32_t checkpoint_blocks;
+    uint32_t segment_start;
+    uint32_t segment_blocks;
+    uint32_t segment_count;
+    uint8_t reserved[AGRANFS_BLOCK_SIZE - 19 * 4];
+} __attribute__((packed));
+
+struct agranfs_inode {
+    uint32_t flags;
+    uint32_t size;
+    uint32_t blocks[AGRANFS_DIRECT_BLOCKS];
+    uint32_t reserved[6];
+} __attribute__((packed));
+
+// Directory entry; inode is the inode number plus one, 0 marks a free entry
+struct agranfs_dirent {
+    uint32_t inode;
+    char name[AGRANFS_NAME_LEN];
+    uint32_t reserved[7];
+} __attribute__((packed));
+
+// Log mode: inode record with its directory entry, packed four to a block
+struct agranfs_log_inode {
+    struct agranfs_inode inode;
+    struct agranfs_dirent entry;
+} __attribute__((packed));
+
+// Log mode: first block of every segment says what each block holds
+struct agranfs_summary_entry {
+    uint16_t inode;                  // AGRANFS_SUMMARY_INODE_BLOCK for inode blocks
+    uint16_t index;                  // File block index for data blocks
+} __attribute__((packed));
+
+struct agranfs_segment_summary {
+    uint32_t sequence;
+    uint32_t blocks;                 // Blocks in use, including the summary
+    struct agranfs_summary_entry entries[AGRANFS_SEGMENT_BLOCKS];
+} __attribute__((packed));
+
+// Log mode: written after every segment flush
+struct agranfs_checkpoint {
+    uint32_t sequence;
+    uint32_t head_segment;
+    uint32_t imap[AGRANFS_INODES];   // 0 means the inode is free
+    uint16_t segment_live[AGRANFS_MAX_SEGMENTS];  // Live records per segment
+} __attribute__((packed));
+
+// Kernel driver (fs/agranfs.c); inode numbers below are table indexes
+struct block_device;
+
+int agranfs_mount(struct block_device* dev);
+void agranfs_unmount(void);
+int agranfs_is_mounted(void);
+int agranfs_dir_entry(int index, char* name, int* inode, uint32_t* size);
+int agranfs_create(const char* name);
+int agranfs_remove(int inode);
+int agranfs_read(int inode, char* buffer, uint32_t max_size);
+int agranfs_write(int inode, const char* data, uint32_t size);
+int agranfs_sync(void);
+void agranfs_print_info(void);
+
+#endif
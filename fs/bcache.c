@@ -0,0 +1,335 @@
+#include "bcache.h"
+#include "../include/kernel.h"
+
+// Internal flag: block was prefetched and has not been asked for yet
+#define BUF_READAHEAD 0x4
+
+static struct buffer buffers[BCACHE_BUFFERS];
+static struct buffer* hash_table[BCACHE_HASH_BUCKETS];
+static struct buffer* lru_head = NULL;   // Most recently used
+static struct buffer* lru_tail = NULL;   // Least recently used
+static struct bcache_stats stats;
+static int dirty_count = 0;
+
+// Sequential access detector (one stream is enough for the shell workload)
+static struct block_device* seq_dev = NULL;
+static uint32_t seq_last_block = 0;
+static int seq_run = 0;
+
+static uint8_t readahead_buffer[BCACHE_READAHEAD * BCACHE_BLOCK_SIZE];
+static struct block_request sync_requests[BCACHE_BUFFERS];
+static struct buffer* sync_buffers[BCACHE_BUFFERS];
+
+static uint32_t bcache_hash(struct block_device* dev, uint32_t block) {
+    return (block ^ ((uint32_t)dev >> 4)) % BCACHE_HASH_BUCKETS;
+}
+
+static void lru_unlink(struct buffer* buf) {
+    if (buf->lru_prev) buf->lru_prev->lru_next = buf->lru_next;
+    else lru_head = buf->lru_next;
+    if (buf->lru_next) buf->lru_next->lru_prev = buf->lru_prev;
+    else lru_tail = buf->lru_prev;
+    buf->lru_prev = NULL;
+    buf->lru_next = NULL;
+}
+
+static void lru_push_front(struct buffer* buf) {
+    buf->lru_prev = NULL;
+    buf->lru_next = lru_head;
+    if (lru_head) lru_head->lru_prev = buf;
+    lru_head = buf;
+    if (lru_tail == NULL) lru_tail = buf;
+}
+
+static void hash_insert(struct buffer* buf) {
+    uint32_t bucket = bcache_hash(buf->dev, buf->block);
+    buf->hash_next = hash_table[bucket];
+    hash_table[bucket] = buf;
+}
+
+static void hash_remove(struct buffer* buf) {
+    struct buffer** link = &hash_table[bcache_hash(buf->dev, buf->block)];
+    while (*link) {
+        if (*link == buf) {
+            *link = buf->hash_next;
+            buf->hash_next = NULL;
+            return;
+        }
+        link = &(*link)->hash_next;
+    }
+}
+
+static struct buffer* hash_lookup(struct block_device* dev, uint32_t block) {
+    struct buffer* buf = hash_table[bcache_hash(dev, block)];
+    while (buf) {
+        if (buf->dev == dev && buf->block == block && (buf->flags & BUF_VALID)) {
+            return buf;
+        }
+        buf = buf->hash_next;
+    }
+    return NULL;
+}
+
+static int write_back(struct buffer* buf) {
+    if (block_write(buf->dev, buf->block, 1, buf->data) < 0) {
+        print_string("Error: Buffer cache write-back failed\n");
+        return -1;
+    }
+    buf->flags &= ~BUF_DIRTY;
+    dirty_count--;
+    stats.writebacks++;
+    return 0;
+}
+
+// Take the least recently used unreferenced buffer and rebind it to (dev, block)
+static struct buffer* bcache_alloc(struct block_device* dev, uint32_t block) {
+    struct buffer* buf = lru_tail;
+    while (buf && buf->refcount > 0) {
+        buf = buf->lru_prev;
+    }
+    if (buf == NULL) {
+        print_string("Error: Buffer cache exhausted\n");
+        return NULL;
+    }
+    if (buf->flags & BUF_DIRTY) {
+        if (write_back(buf) < 0) return NULL;
+    }
+    if (buf->flags & BUF_VALID) {
+        hash_remove(buf);
+        stats.evictions++;
+    }
+    buf->dev = dev;
+    buf->block = block;
+    buf->flags = 0;
+    hash_insert(buf);
+    lru_unlink(buf);
+    lru_push_front(buf);
+    return buf;
+}
+
+// Prefetch the uncached blocks following `block` with one device request
+static void bcache_readahead(struct block_device* dev, uint32_t block) {
+    uint32_t start = block + 1;
+    uint32_t count = 0;
+    while (count < BCACHE_READAHEAD && start + count < dev->sector_count
+           && hash_lookup(dev, start + count) == NULL) {
+        count++;
+    }
+    if (count == 0) {
+        return;
+    }
+    if (block_read(dev, start, count, readahead_buffer) < 0) {
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        struct buffer* buf = bcache_alloc(dev, start + i);
+        if (buf == NULL) return;
+        memcpy(buf->data, readahead_buffer + i * BCACHE_BLOCK_SIZE, BCACHE_BLOCK_SIZE);
+        buf->flags = BUF_VALID | BUF_READAHEAD;
+        stats.readahead_blocks++;
+    }
+}
+
+static void bcache_track_sequential(struct block_device* dev, uint32_t block) {
+    if (dev == seq_dev && block == seq_last_block + 1) {
+        seq_run++;
+    } else if (!(dev == seq_dev && block == seq_last_block)) {
+        seq_run = 0;
+    }
+    seq_dev = dev;
+    seq_last_block = block;
+    if (seq_run >= BCACHE_SEQ_THRESHOLD) {
+        bcache_readahead(dev, block);
+    }
+}
+
+void init_bcache(void) {
+    lru_head = NULL;
+    lru_tail = NULL;
+    for (int i = 0; i < BCACHE_HASH_BUCKETS; i++) {
+        hash_table[i] = NULL;
+    }
+    for (int i = 0; i < BCACHE_BUFFERS; i++) {
+        buffers[i].dev = NULL;
+        buffers[i].block = 0;
+        buffers[i].flags = 0;
+        buffers[i].refcount = 0;
+        buffers[i].hash_next = NULL;
+        lru_push_front(&buffers[i]);
+    }
+    memset(&stats, 0, sizeof(stats));
+    dirty_count = 0;
+    seq_dev = NULL;
+    seq_run = 0;
+}
+
+// Return a referenced buffer holding the block, reading it on a miss
+struct buffer* bcache_read(struct block_device* dev, uint32_t block) {
+    struct buffer* buf = hash_lookup(dev, block);
+    if (buf) {
+        stats.hits++;
+        if (buf->flags & BUF_READAHEAD) {
+            stats.readahead_hits++;
+            buf->flags &= ~BUF_READAHEAD;
+        }
+        lru_unlink(buf);
+        lru_push_front(buf);
+    } else {
+        stats.misses++;
+        buf = bcache_alloc(dev, block);
+        if (buf == NULL) return NULL;
+        if (block_read(dev, block, 1, buf->data) < 0) {
+            hash_remove(buf);
+            buf->dev = NULL;
+            return NULL;
+        }
+        buf->flags = BUF_VALID;
+    }
+    buf->refcount++;
+    bcache_track_sequential(dev, block);
+    return buf;
+}
+
+// Return a referenced buffer for a block the caller will overwrite entirely
+struct buffer* bcache_get(struct block_device* dev, uint32_t block) {
+    struct buffer* buf = hash_lookup(dev, block);
+    if (buf) {
+        lru_unlink(buf);
+        lru_push_front(buf);
+        buf->flags &= ~BUF_READAHEAD;
+    } else {
+        buf = bcache_alloc(dev, block);
+        if (buf == NULL) return NULL;
+        memset(buf->data, 0, BCACHE_BLOCK_SIZE);
+        buf->flags = BUF_VALID;
+    }
+    buf->refcount++;
+    return buf;
+}
+
+void bcache_mark_dirty(struct buffer* buf) {
+    if (!(buf->flags & BUF_DIRTY)) {
+        buf->flags |= BUF_DIRTY;
+        dirty_count++;
+    }
+}
+
+void bcache_release(struct buffer* buf) {
+    if (buf == NULL) return;
+    if (buf->refcount > 0) {
+        buf->refcount--;
+    }
+    if (dirty_count >= BCACHE_DIRTY_LIMIT) {
+        bcache_sync();
+    }
+}
+
+// Write every dirty buffer back, sorted by block so the device sees
+// ascending runs, and batched per device
+int bcache_sync(void) {
+    int count = 0;
+    int result = 0;
+    for (int i = 0; i < BCACHE_BUFFERS; i++) {
+        if (buffers[i].flags & BUF_DIRTY) {
+            sync_buffers[count++] = &buffers[i];
+        }
+    }
+    // Insertion sort by (device, block)
+    for (int i = 1; i < count; i++) {
+        struct buffer* key = sync_buffers[i];
+        int j = i - 1;
+        while (j >= 0 && (sync_buffers[j]->dev > key->dev ||
+               (sync_buffers[j]->dev == key->dev && sync_buffers[j]->block > key->block))) {
+            sync_buffers[j + 1] = sync_buffers[j];
+            j--;
+        }
+        sync_buffers[j + 1] = key;
+    }
+
+    int start = 0;
+    while (start < count) {
+        struct block_device* dev = sync_buffers[start]->dev;
+        int end = start;
+        while (end < count && sync_buffers[end]->dev == dev) {
+            sync_requests[end].lba = sync_buffers[end]->block;
+            sync_requests[end].count = 1;
+            sync_requests[end].buffer = sync_buffers[end]->data;
+            sync_requests[end].write = 1;
+            end++;
+        }
+        if (block_submit(dev, &sync_requests[start], end - start) < 0) {
+            result = -1;
+        }
+        for (int i = start; i < end; i++) {
+            if (sync_requests[i].status == 0) {
+                sync_buffers[i]->flags &= ~BUF_DIRTY;
+                dirty_count--;
+                stats.writebacks++;
+            }
+        }
+        start = end;
+    }
+    if (result < 0) {
+        print_string("Error: Buffer cache sync failed\n");
+    }
+    return result;
+}
+
+// Drop every cached block of a device (dirty ones are written first)
+void bcache_invalidate(struct block_device* dev) {
+    bcache_sync();
+    for (int i = 0; i < BCACHE_BUFFERS; i++) {
+        if (buffers[i].dev == dev && (buffers[i].flags & BUF_VALID)) {
+            hash_remove(&buffers[i]);
+            buffers[i].flags = 0;
+            buffers[i].dev = NULL;
+        }
+    }
+    if (seq_dev == dev) {
+        seq_dev = NULL;
+        seq_run = 0;
+    }
+}
+
+// Forget cached copies of a block range that was just written around the
+// cache; unreferenced only, dirty contents are discarded
+void bcache_drop(struct block_device* dev, uint32_t block, uint32_t count) {
+    for (int i = 0; i < BCACHE_BUFFERS; i++) {
+        struct buffer* buf = &buffers[i];
+        if (buf->dev == dev && (buf->flags & BUF_VALID) && buf->refcount == 0 &&
+            buf->block >= block && buf->block < block + count) {
+            if (buf->flags & BUF_DIRTY) {
+                dirty_count--;
+            }
+            hash_remove(buf);
+            buf->flags = 0;
+            buf->dev = NULL;
+        }
+    }
+}
+
+void bcache_get_stats(struct bcache_stats* out) {
+    *out = stats;
+}
+
+void bcache_print_stats(void) {
+    uint32_t lookups = stats.hits + stats.misses;
+    print_string("Buffer cache: ");
+    print_int(BCACHE_BUFFERS);
+    print_string(" buffers of ");
+    print_int(BCACHE_BLOCK_SIZE);
+    print_string(" bytes\n");
+    print_string("Hits:        "); print_int(stats.hits);
+    if (lookups > 0) {
+        print_string(" (");
+        print_int((int)(stats.hits * 100 / lookups));
+        print_string("%)");
+    }
+    print_char('\n');
+    print_string("Misses:      "); print_int(stats.misses); print_char('\n');
+    print_string("Evictions:   "); print_int(stats.evictions); print_char('\n');
+    print_string("Write-backs: "); print_int(stats.writebacks); print_char('\n');
+    print_string("Read-ahead:  "); print_int(stats.readahead_blocks);
+    print_string(" blocks, "); print_int(stats.readahead_hits); print_string(" used\n");
+    print_string("Dirty:       "); print_int(dirty_count); print_char('\n');
+}
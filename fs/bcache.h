@@ -0,0 +1,51 @@
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include <stdint.h>
+#include "../drivers/block.h"
+
+#define BCACHE_BLOCK_SIZE BLOCK_SECTOR_SIZE
+#define BCACHE_BUFFERS 256
+#define BCACHE_HASH_BUCKETS 64
+#define BCACHE_READAHEAD 8        // Blocks prefetched once a sequential run is seen
+#define BCACHE_SEQ_THRESHOLD 2    // Consecutive reads before read-ahead kicks in
+#define BCACHE_DIRTY_LIMIT 64     // Write back once this many buffers are dirty
+
+// Buffer flags
+#define BUF_VALID 0x1
+#define BUF_DIRTY 0x2
+
+// A cached block; data stays valid while the caller holds a reference
+struct buffer {
+    struct block_device* dev;
+    uint32_t block;
+    int flags;
+    int refcount;
+    struct buffer* hash_next;
+    struct buffer* lru_prev;      // Towards most recently used
+    struct buffer* lru_next;      // Towards least recently used
+    uint8_t data[BCACHE_BLOCK_SIZE];
+};
+
+struct bcache_stats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t writebacks;
+    uint32_t readahead_blocks;
+    uint32_t readahead_hits;
+};
+
+// Buffer cache interface
+void init_bcache(void);
+struct buffer* bcache_read(struct block_device* dev, uint32_t block);
+struct buffer* bcache_get(struct block_device* dev, uint32_t block);  // No read: caller overwrites
+void bcache_mark_dirty(struct buffer* buf);
+void bcache_release(struct buffer* buf);
+int bcache_sync(void);
+void bcache_invalidate(struct block_device* dev);
+void bcache_drop(struct block_device* dev, uint32_t block, uint32_t count);
+void bcache_get_stats(struct bcache_stats* stats);
+void bcache_print_stats(void);
+
+#endif
@@ -0,0 +1,361 @@
+#include "blockstore.h"
+#include "../kernel/lz4.h"
+#include "../kernel/crc32c.h"
+#include "../include/kernel.h"
+
+#define BLOCK_COMPRESSED 0x1
+#define BLOCK_INCOMPRESSIBLE 0x2        // LZ4 would not save a chunk
+#define BLOCK_CORRUPT 0x4               // Failed its checksum; left as it is
+
+struct store_block {
+    uint32_t hash;
+    uint32_t crc;                       // CRC-32C of the stored bytes
+    uint32_t last_use;                  // Access tick, for finding cold blocks
+    uint16_t refcount;                  // 0 marks a free descriptor
+    int16_t next;                       // Hash chain, or free list when unused
+    uint8_t flags;
+    uint8_t length;                     // Stored bytes (compressed size or 128)
+    int16_t chunks[STORE_BLOCK_CHUNKS];
+};
+
+struct cache_entry {
+    int16_t id;                         // STORE_NONE when empty
+    uint8_t data[STORE_BLOCK_SIZE];
+};
+
+static struct store_block blocks[STORE_BLOCKS];
+static int16_t buckets[STORE_HASH_BUCKETS];
+static int16_t free_list = STORE_NONE;
+
+static uint8_t chunk_data[STORE_CHUNKS][STORE_CHUNK_SIZE];
+static int16_t chunk_next[STORE_CHUNKS];
+static int16_t free_chunks = STORE_NONE;
+static int free_chunk_count = 0;
+
+static struct cache_entry cache[STORE_CACHE_BLOCKS];
+static int cache_clock = 0;
+
+static uint32_t tick = 0;
+static uint32_t dedup_hits = 0;
+static uint32_t cache_hits = 0;
+static uint32_t cache_misses = 0;
+static uint32_t checksum_errors = 0;
+
+// FNV-1a over 32-bit words, with a final mix so the low bits pick buckets well
+static uint32_t hash_block(const void* data) {
+    const uint32_t* words = (const uint32_t*)data;
+    uint32_t h = 0x811C9DC5;
+    for (uint32_t i = 0; i < STORE_BLOCK_SIZE / 4; i++) {
+        h = (h ^ words[i]) * 0x01000193;
+    }
+    h ^= h >> 16;
+    return h;
+}
+
+static int chunks_for(int length) {
+    return (length + STORE_CHUNK_SIZE - 1) / STORE_CHUNK_SIZE;
+}
+
+static int alloc_chunks(int16_t* out, int count) {
+    if (free_chunk_count < count) return -1;
+    for (int i = 0; i < count; i++) {
+        out[i] = free_chunks;
+        free_chunks = chunk_next[free_chunks];
+    }
+    free_chunk_count -= count;
+    return 0;
+}
+
+static void free_chunk(int16_t chunk) {
+    chunk_next[chunk] = free_chunks;
+    free_chunks = chunk;
+    free_chunk_count++;
+}
+
+// Copy `length` bytes in or out of a block's chunks
+static void scatter(struct store_block* block, const uint8_t* data, int length) {
+    for (int i = 0, done = 0; done < length; i++, done += STORE_CHUNK_SIZE) {
+        int n = length - done < STORE_CHUNK_SIZE ? length - done : STORE_CHUNK_SIZE;
+        memcpy(chunk_data[block->chunks[i]], data + done, n);
+    }
+}
+
+static void gather(const struct store_block* block, uint8_t* out) {
+    for (int i = 0, done = 0; done < block->length; i++, done += STORE_CHUNK_SIZE) {
+        int n = block->length - done < STORE_CHUNK_SIZE ? block->length - done : STORE_CHUNK_SIZE;
+        memcpy(out + done, chunk_data[block->chunks[i]], n);
+    }
+}
+
+static int verify(int id, const uint8_t* stored) {
+    if (crc32c(0, stored, blocks[id].length) == blocks[id].crc) {
+        return 0;
+    }
+    blocks[id].flags |= BLOCK_CORRUPT;
+    checksum_errors++;
+    print_string("Error: Checksum mismatch in file block ");
+    print_int(id);
+    print_char('\n');
+    return -1;
+}
+
+static void cache_drop(int id) {
+    for (int i = 0; i < STORE_CACHE_BLOCKS; i++) {
+        if (cache[i].id == id) cache[i].id = STORE_NONE;
+    }
+}
+
+// Compress a raw block into its first chunks and free the rest
+static int compress_block(int id) {
+    struct store_block* block = &blocks[id];
+    if (block->flags & (BLOCK_COMPRESSED | BLOCK_INCOMPRESSIBLE | BLOCK_CORRUPT)) return 0;
+    uint8_t raw[STORE_BLOCK_SIZE];
+    uint8_t packed[STORE_BLOCK_SIZE];
+    gather(block, raw);
+    if (verify(id, raw) < 0) return 0;
+    int length = lz4_compress(raw, STORE_BLOCK_SIZE, packed, STORE_BLOCK_SIZE);
+    int chunks = chunks_for(length);
+    if (length == 0 || chunks >= STORE_BLOCK_CHUNKS) {
+        block->flags |= BLOCK_INCOMPRESSIBLE;
+        return 0;
+    }
+    block->flags |= BLOCK_COMPRESSED;
+    block->length = length;
+    block->crc = crc32c(0, packed, length);
+    scatter(block, packed, length);
+    for (int i = chunks; i < STORE_BLOCK_CHUNKS; i++) {
+        free_chunk(block->chunks[i]);
+        block->chunks[i] = STORE_NONE;
+    }
+    return STORE_BLOCK_CHUNKS - chunks;
+}
+
+// Under memory pressure, compress the least recently used raw blocks.
+// A block that cannot be compressed (or turns out corrupt) is flagged, so
+// the next pass moves on to another.
+static void reclaim_chunks(int needed) {
+    while (free_chunk_count < needed) {
+        int coldest = STORE_NONE;
+        for (int i = 0; i < STORE_BLOCKS; i++) {
+            if (blocks[i].refcount == 0 ||
+                (blocks[i].flags & (BLOCK_COMPRESSED | BLOCK_INCOMPRESSIBLE | BLOCK_CORRUPT))) continue;
+            if (coldest == STORE_NONE || blocks[i].last_use < blocks[coldest].last_use) coldest = i;
+        }
+        if (coldest == STORE_NONE) return;
+        if (compress_block(coldest) == 0 && !(blocks[coldest].flags & (BLOCK_INCOMPRESSIBLE | BLOCK_CORRUPT))) {
+            return;                     // Nothing freed and nothing learned
+        }
+    }
+}
+
+void init_block_store(void) {
+    for (int i = 0; i < STORE_HASH_BUCKETS; i++) {
+        buckets[i] = STORE_NONE;
+    }
+    for (int i = 0; i < STORE_BLOCKS; i++) {
+        blocks[i].refcount = 0;
+        blocks[i].next = i + 1 < STORE_BLOCKS ? i + 1 : STORE_NONE;
+    }
+    free_list = 0;
+    free_chunks = STORE_NONE;
+    free_chunk_count = 0;
+    for (int i = STORE_CHUNKS - 1; i >= 0; i--) {
+        free_chunk(i);
+    }
+    for (int i = 0; i < STORE_CACHE_BLOCKS; i++) {
+        cache[i].id = STORE_NONE;
+    }
+    tick = 0;
+    dedup_hits = 0;
+    cache_hits = 0;
+    cache_misses = 0;
+    checksum_errors = 0;
+}
+
+// Return a referenced block holding `data` (STORE_BLOCK_SIZE bytes), sharing
+// an existing block when the contents match
+int store_put(const void* data, int compress) {
+    uint32_t hash = hash_block(data);
+    int bucket = hash % STORE_HASH_BUCKETS;
+    uint8_t existing[STORE_BLOCK_SIZE];
+    tick++;
+    for (int id = buckets[bucket]; id != STORE_NONE; id = blocks[id].next) {
+        if (blocks[id].hash != hash) continue;
+        if (store_read(id, existing) < 0) continue;
+        if (memcmp(existing, data, STORE_BLOCK_SIZE) == 0) {
+            blocks[id].refcount++;
+            blocks[id].last_use = tick;
+            dedup_hits++;
+            return id;
+        }
+    }
+    if (free_list == STORE_NONE) {
+        return STORE_NONE;
+    }
+
+    uint8_t packed[STORE_BLOCK_SIZE];
+    const uint8_t* stored = (const uint8_t*)data;
+    int length = STORE_BLOCK_SIZE;
+    int flags = 0;
+    if (compress) {
+        int packed_length = lz4_compress(data, STORE_BLOCK_SIZE, packed, STORE_BLOCK_SIZE);
+        if (packed_length > 0 && chunks_for(packed_length) < STORE_BLOCK_CHUNKS) {
+            stored = packed;
+            length = packed_length;
+            flags = BLOCK_COMPRESSED;
+        } else {
+            flags = BLOCK_INCOMPRESSIBLE;
+        }
+    }
+    int id = free_list;
+    struct store_block* block = &blocks[id];
+    reclaim_chunks(chunks_for(length));
+    if (alloc_chunks(block->chunks, chunks_for(length)) < 0) {
+        return STORE_NONE;
+    }
+    for (int i = chunks_for(length); i < STORE_BLOCK_CHUNKS; i++) {
+        block->chunks[i] = STORE_NONE;
+    }
+    free_list = block->next;
+    block->hash = hash;
+    block->refcount = 1;
+    block->flags = flags;
+    block->length = length;
+    block->last_use = tick;
+    block->crc = crc32c(0, stored, length);
+    scatter(block, stored, length);
+    block->next = buckets[bucket];
+    buckets[bucket] = id;
+    return id;
+}
+
+void store_release(int id) {
+    if (id < 0 || id >= STORE_BLOCKS || blocks[id].refcount == 0) {
+        return;
+    }
+    if (--blocks[id].refcount > 0) {
+        return;
+    }
+    int16_t* link = &buckets[blocks[id].hash % STORE_HASH_BUCKETS];
+    while (*link != STORE_NONE && *link != id) {
+        link = &blocks[*link].next;
+    }
+    if (*link == id) {
+        *link = blocks[id].next;
+    }
+    for (int i = 0; i < STORE_BLOCK_CHUNKS; i++) {
+        if (blocks[id].chunks[i] != STORE_NONE) free_chunk(blocks[id].chunks[i]);
+    }
+    cache_drop(id);
+    blocks[id].next = free_list;
+    free_list = id;
+}
+
+// Copy a block out, decoding compressed ones through the cache; a corrupt
+// block reads as zeros
+int store_read(int id, void* out) {
+    struct store_block* block = &blocks[id];
+    block->last_use = ++tick;
+    if (!(block->flags & BLOCK_COMPRESSED)) {
+        gather(block, out);
+        if (verify(id, out) < 0) {
+            memset(out, 0, STORE_BLOCK_SIZE);
+            return -1;
+        }
+        return 0;
+    }
+    for (int i = 0; i < STORE_CACHE_BLOCKS; i++) {
+        if (cache[i].id == id) {
+            memcpy(out, cache[i].data, STORE_BLOCK_SIZE);
+            cache_hits++;
+            return 0;
+        }
+    }
+    cache_misses++;
+    uint8_t packed[STORE_BLOCK_SIZE];
+    struct cache_entry* slot = &cache[cache_clock];
+    cache_clock = (cache_clock + 1) % STORE_CACHE_BLOCKS;
+    gather(block, packed);
+    if (verify(id, packed) < 0) {
+        memset(out, 0, STORE_BLOCK_SIZE);
+        return -1;
+    }
+    slot->id = STORE_NONE;
+    if (lz4_decompress(packed, block->length, slot->data, STORE_BLOCK_SIZE) != STORE_BLOCK_SIZE) {
+        block->flags |= BLOCK_CORRUPT;
+        checksum_errors++;
+        print_string("Error: Corrupt compressed block ");
+        print_int(id);
+        print_char('\n');
+        memset(out, 0, STORE_BLOCK_SIZE);
+        return -1;
+    }
+    slot->id = id;
+    memcpy(out, slot->data, STORE_BLOCK_SIZE);
+    return 1;
+}
+
+int store_compress(int id) {
+    if (id < 0 || id >= STORE_BLOCKS || blocks[id].refcount == 0) return 0;
+    return compress_block(id);
+}
+
+// Compress every block that has not been touched for STORE_COLD_AGE accesses
+int store_compress_cold(void) {
+    int freed = 0;
+    for (int i = 0; i < STORE_BLOCKS; i++) {
+        if (blocks[i].refcount > 0 && tick - blocks[i].last_use >= STORE_COLD_AGE) {
+            freed += compress_block(i);
+        }
+    }
+    return freed;
+}
+
+// Check every stored block against its checksum
+int store_scrub(uint32_t* blocks_checked, uint32_t* bytes_checked) {
+    uint8_t stored[STORE_BLOCK_SIZE];
+    int bad = 0;
+    *blocks_checked = 0;
+    *bytes_checked = 0;
+    for (int i = 0; i < STORE_BLOCKS; i++) {
+        if (blocks[i].refcount == 0) continue;
+        gather(&blocks[i], stored);
+        if (verify(i, stored) < 0) bad++;
+        (*blocks_checked)++;
+        *bytes_checked += blocks[i].length;
+    }
+    return bad;
+}
+
+void store_corrupt(int id, uint32_t bit, int reseal) {
+    if (id < 0 || id >= STORE_BLOCKS || blocks[id].refcount == 0) return;
+    bit %= blocks[id].length * 8;
+    chunk_data[blocks[id].chunks[bit / 8 / STORE_CHUNK_SIZE]][bit / 8 % STORE_CHUNK_SIZE] ^= 1 << (bit % 8);
+    if (reseal) {
+        uint8_t stored[STORE_BLOCK_SIZE];
+        gather(&blocks[id], stored);
+        blocks[id].crc = crc32c(0, stored, blocks[id].length);
+    }
+    cache_drop(id);
+}
+
+uint32_t store_physical_size(int id) {
+    if (id < 0 || id >= STORE_BLOCKS || blocks[id].refcount == 0) return 0;
+    return chunks_for(blocks[id].length) * STORE_CHUNK_SIZE;
+}
+
+void store_get_stats(struct store_stats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < STORE_BLOCKS; i++) {
+        if (blocks[i].refcount == 0) continue;
+        stats->used_blocks++;
+        stats->used_chunks += chunks_for(blocks[i].length);
+        stats->references += blocks[i].refcount;
+        if (blocks[i].refcount > 1) stats->shared_blocks++;
+        if (blocks[i].flags & BLOCK_COMPRESSED) stats->compressed_blocks++;
+    }
+    stats->dedup_hits = dedup_hits;
+    stats->cache_hits = cache_hits;
+    stats->cache_misses = cache_misses;
+    stats->checksum_errors = checksum_errors;
+}
@@ -0,0 +1,51 @@
+#ifndef BLOCKSTORE_H
+#define BLOCKSTORE_H
+
+#include <stdint.h>
+
+// Content-addressed store for file data held in RAM. Blocks are keyed by a
+// hash of their contents and reference counted, so identical blocks are
+// kept once; they are never changed in place (a write stores the new
+// contents and drops a reference to the old block).
+//
+// Physical memory is a pool of small chunks. A block takes four chunks
+// raw, or fewer once LZ4-compressed; blocks are compressed when written
+// for files in compressed mode, or when they go cold and chunks run short.
+// Reads of compressed blocks go through a small cache of decoded blocks.
+// Every block carries a CRC-32C of its stored bytes, checked on each read.
+#define STORE_BLOCK_SIZE 128
+#define STORE_CHUNK_SIZE 32
+#define STORE_BLOCK_CHUNKS (STORE_BLOCK_SIZE / STORE_CHUNK_SIZE)
+#define STORE_CHUNKS 512                // 16KB of physical file data
+#define STORE_BLOCKS 256                // Distinct blocks (descriptors)
+#define STORE_HASH_BUCKETS 64
+#define STORE_CACHE_BLOCKS 8
+#define STORE_COLD_AGE 256              // Store accesses before a block counts as cold
+#define STORE_NONE (-1)
+
+struct store_stats {
+    uint32_t used_blocks;               // Distinct blocks holding data
+    uint32_t used_chunks;               // Physical chunks behind them
+    uint32_t compressed_blocks;
+    uint32_t references;                // Sum of all reference counts
+    uint32_t shared_blocks;             // Blocks referenced more than once
+    uint32_t dedup_hits;                // Stores answered by an existing block
+    uint32_t cache_hits;                // Compressed reads served decoded
+    uint32_t cache_misses;
+    uint32_t checksum_errors;           // Corrupt blocks seen on reads
+};
+
+void init_block_store(void);
+int store_put(const void* data, int compress);   // Block id, or STORE_NONE when full
+void store_release(int id);
+int store_read(int id, void* out);      // 1 if decompressed, -1 if corrupt
+int store_compress(int id);             // Chunks freed
+int store_compress_cold(void);          // Chunks freed
+uint32_t store_physical_size(int id);   // Bytes of chunks used by the block
+// Flip a stored bit, for testing; with `reseal` the checksum is updated to
+// match, so only decoding a compressed block can catch it
+void store_corrupt(int id, uint32_t bit, int reseal);
+int store_scrub(uint32_t* blocks_checked, uint32_t* bytes_checked);  // Corrupt blocks
+void store_get_stats(struct store_stats* stats);
+
+#endif
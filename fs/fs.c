@@ -1,22 +1,222 @@
 #include "fs.h"
+#include "agranfs.h"
+#include "bcache.h"
+#include "initrd.h"
+#include "../kernel/clock.h"
+#include "../kernel/crc32c.h"
+#include "../kernel/rwlock.h"
+#include "../kernel/lockstat.h"
+#include "../kernel/trace.h"
+#include "../drivers/block.h"
 #include "../include/kernel.h"
 #include <stddef.h>
 
 // Define the files array
 struct File files[MAX_FILES];
 
+// Guards files[] and the block store behind it. Reading a file can still
+// change both (loading it from disk, filling the decoded block cache), so
+// only the calls that just look take it shared.
+static rwlock_t file_table_lock;
+static struct lock_stats file_table_stats;
+
+// Assembled contents handed out by get_file_data
+static char file_scratch[MAX_CONTENT];
+
+// File table entries are checksummed like data blocks, so a stray write
+// into files[] is caught on the next access
+static uint32_t file_checksum(const struct File* file) {
+    return crc32c(0, file, offsetof(struct File, checksum));
+}
+
+static void seal_file(struct File* file) {
+    file->checksum = file_checksum(file);
+}
+
+static int check_file(const struct File* file) {
+    if (file_checksum(file) == file->checksum) {
+        return 0;
+    }
+    print_string("Error: File table entry corrupted: ");
+    print_string(file->is_used ? file->name : "(free slot)");
+    print_char('\n');
+    return -1;
+}
+
+// Store new contents block by block; the old blocks are only dropped once
+// every new one is in, so a full store leaves the file unchanged
+static int store_contents(struct File* file, const char* data, int size) {
+    short fresh[FILE_BLOCKS];
+    uint8_t chunk[STORE_BLOCK_SIZE];
+    int used = (size + STORE_BLOCK_SIZE - 1) / STORE_BLOCK_SIZE;
+    for (int i = 0; i < FILE_BLOCKS; i++) {
+        fresh[i] = STORE_NONE;
+    }
+    for (int i = 0; i < used; i++) {
+        int length = size - i * STORE_BLOCK_SIZE;
+        if (length > STORE_BLOCK_SIZE) length = STORE_BLOCK_SIZE;
+        memset(chunk, 0, STORE_BLOCK_SIZE);
+        memcpy(chunk, data + i * STORE_BLOCK_SIZE, length);
+        fresh[i] = store_put(chunk, file->compressed);
+        if (fresh[i] == STORE_NONE) {
+            for (int j = 0; j < i; j++) {
+                store_release(fresh[j]);
+            }
+            print_string("Error: File store is full\n");
+            return -1;
+        }
+    }
+    for (int i = 0; i < FILE_BLOCKS; i++) {
+        store_release(file->blocks[i]);
+        file->blocks[i] = fresh[i];
+    }
+    file->size = size;
+    return 0;
+}
+
+static void release_contents(struct File* file) {
+    for (int i = 0; i < FILE_BLOCKS; i++) {
+        store_release(file->blocks[i]);
+        file->blocks[i] = STORE_NONE;
+    }
+    file->size = 0;
+}
+
+// Gather a file's blocks into one NUL-terminated buffer, timing the reads
+// that had to decompress; -1 if any block failed its checksum
+static int copy_contents(struct File* file, char* out) {
+    uint8_t block[STORE_BLOCK_SIZE];
+    int result = 0;
+    for (int done = 0, i = 0; done < file->size; i++) {
+        int length = file->size - done;
+        if (length > STORE_BLOCK_SIZE) length = STORE_BLOCK_SIZE;
+        uint64_t start = rdtsc();
+        int read = store_read(file->blocks[i], block);
+        if (read == 1) {
+            file->decode_cycles += rdtsc() - start;
+            file->decoded_bytes += STORE_BLOCK_SIZE;
+        } else if (read < 0) {
+            result = -1;
+        }
+        memcpy(out + done, block, length);
+        done += length;
+    }
+    out[file->size] = '\0';
+    return result;
+}
+
+// Register the files of the mounted disk; returns the next free slot
+static int add_disk_files(void) {
+    char name[AGRANFS_NAME_LEN];
+    int inode;
+    uint32_t size;
+    int slot = 0;
+    int found;
+    for (int i = 0; (found = agranfs_dir_entry(i, name, &inode, &size)) >= 0; i++) {
+        if (found == 0) continue;
+        if (slot >= MAX_FILES) {
+            print_string("Warning: Too many files on disk, some are hidden\n");
+            break;
+        }
+        strncpy(files[slot].name, name, MAX_FILENAME - 1);
+        files[slot].name[MAX_FILENAME - 1] = '\0';
+        files[slot].size = size < MAX_CONTENT - 1 ? (int)size : MAX_CONTENT - 1;
+        files[slot].inode = inode;
+        files[slot].is_used = 1;
+        seal_file(&files[slot]);
+        slot++;
+    }
+    return slot;
+}
+
+// Register the initrd files after the disk ones; their contents stay in the
+// archive, so this costs the same however large the files are. A file of
+// the same name on disk wins.
+static void add_initrd_files(int slot) {
+    const char* name;
+    const char* data;
+    uint32_t size;
+    for (int i = 0; initrd_entry(i, &name, &data, &size) > 0; i++) {
+        if (search_file(name)) continue;
+        if (slot >= MAX_FILES) {
+            print_string("Warning: Too many initrd files, some are hidden\n");
+            break;
+        }
+        strncpy(files[slot].name, name, MAX_FILENAME - 1);
+        files[slot].name[MAX_FILENAME - 1] = '\0';
+        files[slot].data = data;
+        files[slot].size = size;
+        files[slot].loaded = 1;
+        files[slot].is_used = 1;
+        seal_file(&files[slot]);
+        slot++;
+    }
+}
+
 // Initialize file system
 void init_fs(void) {
+    rwlock_init(&file_table_lock, &file_table_stats);
+    lockstat_register(&file_table_stats, "file_table", -1, LOCK_RW);
+    init_block_store();
+
     // Initialize all file slots as unused
     for (int i = 0; i < MAX_FILES; i++) {
         files[i].is_used = 0;
         files[i].name[0] = '\0';
-        files[i].content[0] = '\0';
+        for (int b = 0; b < FILE_BLOCKS; b++) {
+            files[i].blocks[b] = STORE_NONE;
+        }
+        files[i].size = 0;
+        files[i].inode = -1;
+        files[i].loaded = 0;
+        files[i].data = NULL;
+        files[i].compressed = 0;
+        files[i].decoded_bytes = 0;
+        files[i].decode_cycles = 0;
+        seal_file(&files[i]);
     }
+
+    // Mount the on-disk file system if the boot disk carries one; only the
+    // directory and inode metadata is read here
+    int slot = 0;
+    if (agranfs_mount(get_boot_block_device()) == 0) {
+        slot = add_disk_files();
+    }
+    add_initrd_files(slot);
+}
+
+// Pull a disk-backed file's data into the block store on first use
+static int load_file(struct File* file) {
+    if (file->loaded || file->inode < 0) {
+        return 0;
+    }
+    int n = agranfs_read(file->inode, file_scratch, MAX_CONTENT - 1);
+    if (n < 0) {
+        print_string("Error: Failed to read file from disk\n");
+        return -1;
+    }
+    if (store_contents(file, file_scratch, n) < 0) {
+        return -1;
+    }
+    file->loaded = 1;
+    seal_file(file);
+    return 0;
+}
+
+// Flush cached file system blocks (and the open log segment) to disk
+int sync_fs(void) {
+    int result = 0;
+    write_lock(&file_table_lock);
+    if (agranfs_is_mounted()) {
+        result = agranfs_sync();
+    }
+    write_unlock(&file_table_lock);
+    return result;
 }
 
 // Create a new file
 void create_file(const char* name) {
+    write_lock(&file_table_lock);
     // Find free slot
     int slot = -1;
     for (int i = 0; i < MAX_FILES; i++) {
@@ -27,6 +227,7 @@ void create_file(const char* name) {
     }
     
     if (slot == -1) {
+        write_unlock(&file_table_lock);
         print_string("Error: No free file slots\n");
         return;
     }
@@ -34,16 +235,37 @@ void create_file(const char* name) {
     // Check if file already exists
     for (int i = 0; i < MAX_FILES; i++) {
         if (files[i].is_used && strcmp(files[i].name, name) == 0) {
+            write_unlock(&file_table_lock);
             print_string("Error: File already exists\n");
             return;
         }
     }
     
+    // Give it an inode when running on disk
+    int inode = -1;
+    if (agranfs_is_mounted()) {
+        inode = agranfs_create(name);
+        if (inode < 0) {
+            write_unlock(&file_table_lock);
+            print_string("Error: No free inodes on disk\n");
+            return;
+        }
+    }
+
     // Initialize new file
     strncpy(files[slot].name, name, MAX_FILENAME - 1);
     files[slot].name[MAX_FILENAME - 1] = '\0';
-    files[slot].content[0] = '\0';
+    files[slot].size = 0;
+    files[slot].inode = inode;
+    files[slot].loaded = 1;
+    files[slot].data = NULL;
+    files[slot].compressed = 0;
+    files[slot].decoded_bytes = 0;
+    files[slot].decode_cycles = 0;
     files[slot].is_used = 1;
+    seal_file(&files[slot]);
+    TRACE(TRACE_FS_CREATE, slot, 0);
+    write_unlock(&file_table_lock);
     
     print_string("Created file: ");
     print_string(name);
@@ -52,47 +274,316 @@ void create_file(const char* name) {
 
 // Delete a file
 void delete_file(const char* name) {
+    write_lock(&file_table_lock);
     for (int i = 0; i < MAX_FILES; i++) {
         if (files[i].is_used && strcmp(files[i].name, name) == 0) {
+            // A corrupt entry may name blocks other files use; leave it for fsck
+            if (check_file(&files[i]) < 0) {
+                write_unlock(&file_table_lock);
+                return;
+            }
+            TRACE(TRACE_FS_DELETE, i, 0);
+            if (files[i].inode >= 0) {
+                agranfs_remove(files[i].inode);
+            }
+            release_contents(&files[i]);
+            files[i].compressed = 0;
+            files[i].decoded_bytes = 0;
+            files[i].decode_cycles = 0;
             files[i].is_used = 0;
             files[i].name[0] = '\0';
-            files[i].content[0] = '\0';
+            files[i].inode = -1;
+            files[i].data = NULL;
+            seal_file(&files[i]);
+            write_unlock(&file_table_lock);
             // No extra output to avoid prompt jump
             return;
         }
     }
+    write_unlock(&file_table_lock);
     // No extra output to avoid prompt jump
 }
 
 // Write content to a file
 int write_file(const char* name, const char* content) {
+    write_lock(&file_table_lock);
     for (int i = 0; i < MAX_FILES; i++) {
         if (files[i].is_used && strcmp(files[i].name, name) == 0) {
-            strncpy(files[i].content, content, MAX_CONTENT - 1);
-            files[i].content[MAX_CONTENT - 1] = '\0';
-            return 0;
+            if (check_file(&files[i]) < 0) {
+                write_unlock(&file_table_lock);
+                return -1;
+            }
+            int size = strlen(content);
+            if (size > MAX_CONTENT - 1) size = MAX_CONTENT - 1;
+            TRACE(TRACE_FS_WRITE_BEGIN, i, size);
+            int result = 0;
+            if (store_contents(&files[i], content, size) < 0) {
+                seal_file(&files[i]);
+                result = -1;
+            } else {
+                files[i].loaded = 1;
+                files[i].data = NULL;
+                seal_file(&files[i]);
+                if (files[i].inode >= 0 && agranfs_write(files[i].inode, content, size) < 0) {
+                    print_string("Error: Failed to write file to disk\n");
+                    result = -1;
+                }
+            }
+            TRACE(TRACE_FS_WRITE_END, result, 0);
+            write_unlock(&file_table_lock);
+            return result;
         }
     }
+    write_unlock(&file_table_lock);
     print_string("Error: File not found\n");
     return -1;
 }
 
 // Read content from a file
 int read_file(const char* name, char* buffer) {
+    write_lock(&file_table_lock);
     for (int i = 0; i < MAX_FILES; i++) {
         if (files[i].is_used && strcmp(files[i].name, name) == 0) {
-            strncpy(buffer, files[i].content, MAX_CONTENT - 1);
-            buffer[MAX_CONTENT - 1] = '\0';
-            return 0;
+            TRACE(TRACE_FS_READ_BEGIN, i, 0);
+            int result = -1;
+            if (check_file(&files[i]) == 0 && load_file(&files[i]) == 0) {
+                result = 0;
+                if (files[i].data) {
+                    strncpy(buffer, files[i].data, MAX_CONTENT - 1);
+                    buffer[MAX_CONTENT - 1] = '\0';
+                } else {
+                    result = copy_contents(&files[i], buffer);
+                }
+            }
+            TRACE(TRACE_FS_READ_END, result, 0);
+            write_unlock(&file_table_lock);
+            return result;
         }
     }
+    write_unlock(&file_table_lock);
     print_string("Error: File not found\n");
     return -1;
 }
 
+// Point at a file's contents: initrd files in place (at their full size),
+// others gathered into a scratch buffer valid until the next call.
+// Returns 0, or -1 if there is no such file or it fails its checksums.
+int get_file_data(const char* name, const char** data, int* size) {
+    write_lock(&file_table_lock);
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (files[i].is_used && strcmp(files[i].name, name) == 0) {
+            if (check_file(&files[i]) < 0 || load_file(&files[i]) < 0) {
+                write_unlock(&file_table_lock);
+                return -1;
+            }
+            if (files[i].data) {
+                *data = files[i].data;
+            } else {
+                if (copy_contents(&files[i], file_scratch) < 0) {
+                    write_unlock(&file_table_lock);
+                    return -1;
+                }
+                *data = file_scratch;
+            }
+            *size = files[i].size;
+            write_unlock(&file_table_lock);
+            return 0;
+        }
+    }
+    write_unlock(&file_table_lock);
+    return -1;
+}
+
+// Copy the name of the file in `slot`; -1 if the slot is free
+int get_file_name(int slot, char* name) {
+    int result = -1;
+    read_lock(&file_table_lock);
+    if (slot >= 0 && slot < MAX_FILES && files[slot].is_used) {
+        strcpy(name, files[slot].name);
+        result = 0;
+    }
+    read_unlock(&file_table_lock);
+    return result;
+}
+
+// Logical file sizes against the RAM the block store really uses
+void print_fs_usage(void) {
+    uint32_t logical = 0;
+    uint32_t archive = 0;
+    int count = 0;
+    read_lock(&file_table_lock);
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (!files[i].is_used) continue;
+        count++;
+        if (files[i].data) {
+            archive += files[i].size;
+        } else if (files[i].loaded) {
+            logical += files[i].size;
+        }
+    }
+    struct store_stats stats;
+    store_get_stats(&stats);
+    read_unlock(&file_table_lock);
+    uint32_t physical = stats.used_chunks * STORE_CHUNK_SIZE;
+
+    print_string("Files:    ");
+    print_int(count);
+    print_string("\nLogical:  ");
+    print_int(logical);
+    print_string(" bytes in RAM files, ");
+    print_int(archive);
+    print_string(" bytes in the initrd\nPhysical: ");
+    print_int(physical);
+    print_string(" bytes (");
+    print_int(stats.used_chunks);
+    print_string(" / ");
+    print_int(STORE_CHUNKS);
+    print_string(" chunks) in ");
+    print_int(stats.used_blocks);
+    print_string(" blocks, ");
+    print_int(stats.compressed_blocks);
+    print_string(" compressed\nShared:   ");
+    print_int(stats.shared_blocks);
+    print_string(" blocks, ");
+    print_int(stats.references - stats.used_blocks);
+    print_string(" duplicate blocks saved\n");
+    if (physical > 0) {
+        uint32_t ratio = logical * 100 / physical;
+        print_string("Ratio:    ");
+        print_int(ratio / 100);
+        print_char('.');
+        if (ratio % 100 < 10) print_char('0');
+        print_int(ratio % 100);
+        print_string("x\n");
+    }
+}
+
+// Switch a file to compressed mode and compress the blocks it has now;
+// returns the number of chunks freed, -1 if there is no such file, or
+// FS_CORRUPT_ENTRY if its entry fails its checksum
+int compress_file(const char* name) {
+    write_lock(&file_table_lock);
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (files[i].is_used && strcmp(files[i].name, name) == 0) {
+            if (check_file(&files[i]) < 0) {
+                write_unlock(&file_table_lock);
+                return FS_CORRUPT_ENTRY;
+            }
+            if (load_file(&files[i]) < 0) {
+                write_unlock(&file_table_lock);
+                return -1;
+            }
+            files[i].compressed = 1;
+            seal_file(&files[i]);
+            int freed = 0;
+            for (int b = 0; b < FILE_BLOCKS; b++) {
+                freed += store_compress(files[i].blocks[b]);
+            }
+            write_unlock(&file_table_lock);
+            return freed;
+        }
+    }
+    write_unlock(&file_table_lock);
+    return -1;
+}
+
+// Compress every block that has gone cold; returns the chunks freed
+int compress_cold_files(void) {
+    write_lock(&file_table_lock);
+    int freed = store_compress_cold();
+    write_unlock(&file_table_lock);
+    return freed;
+}
+
+// Per-file stored size, compression ratio and decompression throughput
+void print_fs_compression(void) {
+    print_string("File                 Size  Stored  Ratio  Decoded  KB/s\n");
+    read_lock(&file_table_lock);
+    for (int i = 0; i < MAX_FILES; i++) {
+        struct File* file = &files[i];
+        if (!file->is_used || file->data || !file->loaded) continue;
+        uint32_t stored = 0;
+        for (int b = 0; b < FILE_BLOCKS; b++) {
+            stored += store_physical_size(file->blocks[b]);
+        }
+        print_string(file->name);
+        for (int pad = strlen(file->name); pad < 20; pad++) print_char(' ');
+        print_int(file->size);
+        print_string("  ");
+        print_int(stored);
+        print_string("  ");
+        if (stored > 0) {
+            uint32_t ratio = file->size * 100 / stored;
+            print_int(ratio / 100);
+            print_char('.');
+            if (ratio % 100 < 10) print_char('0');
+            print_int(ratio % 100);
+        } else {
+            print_char('-');
+        }
+        print_string("  ");
+        print_int(file->decoded_bytes);
+        print_string("  ");
+        uint32_t rate = clock_kb_per_sec(file->decoded_bytes, file->decode_cycles);
+        if (rate > 0) {
+            print_int(rate);
+        } else {
+            print_char('-');
+        }
+        print_char('\n');
+    }
+    struct store_stats stats;
+    store_get_stats(&stats);
+    read_unlock(&file_table_lock);
+    print_string("Decoded block cache: ");
+    print_int(stats.cache_hits);
+    print_string(" hits, ");
+    print_int(stats.cache_misses);
+    print_string(" misses\n");
+}
+
+// Scrub the file table and every stored block; returns the number of errors
+int fsck_fs(void) {
+    uint64_t start = rdtsc();
+    int errors = 0;
+    read_lock(&file_table_lock);
+    for (int i = 0; i < MAX_FILES; i++) {
+        if (check_file(&files[i]) < 0) errors++;
+    }
+    uint32_t blocks_checked;
+    uint32_t bytes;
+    errors += store_scrub(&blocks_checked, &bytes);
+    read_unlock(&file_table_lock);
+    uint64_t cycles = rdtsc() - start;
+    bytes += MAX_FILES * offsetof(struct File, checksum);
+
+    print_string("Checked ");
+    print_int(MAX_FILES);
+    print_string(" file entries and ");
+    print_int(blocks_checked);
+    print_string(" blocks with ");
+    print_string(crc32c_method());
+    print_string("\n");
+    print_int(errors);
+    print_string(" errors, ");
+    print_int(bytes);
+    print_string(" bytes");
+    uint32_t rate = clock_kb_per_sec(bytes, cycles);
+    if (rate > 0) {
+        print_string(" in ");
+        print_int((int)clock_cycles_to_us(cycles));
+        print_string(" us (");
+        print_int(rate);
+        print_string(" KB/s)");
+    }
+    print_char('\n');
+    return errors;
+}
+
 // List all files
 void list_files(void) {
     int found = 0;
+    read_lock(&file_table_lock);
     for (int i = 0; i < MAX_FILES; i++) {
         if (files[i].is_used) {
             print_string(files[i].name);
@@ -100,6 +591,7 @@ void list_files(void) {
             found = 1;
         }
     }
+    read_unlock(&file_table_lock);
     if (!found) {
         print_string("No files.\n");
     }
@@ -107,10 +599,11 @@ void list_files(void) {
 
 // Search for a file by name
 int search_file(const char* name) {
-    for (int i = 0; i < MAX_FILES; i++) {
-        if (files[i].is_used && strcmp(files[i].name, name) == 0) {
-            return 1;
-        }
+    int found = 0;
+    read_lock(&file_table_lock);
+    for (int i = 0; i < MAX_FILES && !found; i++) {
+        found = files[i].is_used && strcmp(files[i].name, name) == 0;
     }
-    return 0;
+    read_unlock(&file_table_lock);
+    return found;
 }
\ No newline at end of file
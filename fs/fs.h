@@ -1,16 +1,26 @@
 #ifndef FS_H
 #define FS_H
 
-#define MAX_FILES 32
+#include "blockstore.h"
+
+#define MAX_FILES 64
 #define MAX_FILENAME 32
 #define MAX_CONTENT 512
+#define FILE_BLOCKS (MAX_CONTENT / STORE_BLOCK_SIZE)
 
-// Simple file structure
+// Simple file structure; contents live in the shared block store
 struct File {
     char name[MAX_FILENAME];
-    char content[MAX_CONTENT];
+    short blocks[FILE_BLOCKS];  // Block store ids, STORE_NONE past the end
     int size;
     int is_used;
+    int inode;       // On-disk inode, -1 for RAM-only files
+    int loaded;      // Content has been read from disk
+    const char* data; // Initrd contents referenced in place, NULL once written
+    int compressed;   // Store new blocks LZ4-compressed
+    uint32_t checksum;          // CRC-32C of every field above
+    uint32_t decoded_bytes;     // Bytes decompressed on reads, and the cycles
+    uint64_t decode_cycles;     // it took
 };
 
 // Simple directory structure (single directory for simplicity)
@@ -25,8 +35,17 @@ void create_file(const char* name);
 void delete_file(const char* name);
 int write_file(const char* name, const char* content);
 int read_file(const char* name, char* buffer);
+int get_file_data(const char* name, const char** data, int* size);
+int get_file_name(int slot, char* name);  // -1 if the slot is free
+void print_fs_usage(void);
+#define FS_CORRUPT_ENTRY -2            // The file's table entry failed its checksum
+int compress_file(const char* name);
+int compress_cold_files(void);
+void print_fs_compression(void);
+int fsck_fs(void);
 void list_files(void);
 int search_file(const char* name); // Returns 1 if found, 0 if not
+int sync_fs(void);
 
 extern struct File files[MAX_FILES];
 
@@ -0,0 +1,25 @@
+#include "initrd.h"
+#include "../include/kernel.h"
+
+// Archive placed in .rodata by objcopy (see the Makefile)
+extern const uint8_t _binary_initrd_img_start[];
+extern const uint8_t _binary_initrd_img_end[];
+
+// Entries point straight into the archive; nothing is copied
+int initrd_entry(int index, const char** name, const char** data, uint32_t* size) {
+    const struct initrd_header* header = (const struct initrd_header*)_binary_initrd_img_start;
+    uint32_t archive_size = _binary_initrd_img_end - _binary_initrd_img_start;
+    if (archive_size < sizeof(struct initrd_header) || header->magic != INITRD_MAGIC ||
+        index < 0 || (uint32_t)index >= header->count) {
+        return -1;
+    }
+    const struct initrd_entry* entry = (const struct initrd_entry*)(header + 1) + index;
+    if ((const uint8_t*)(entry + 1) > _binary_initrd_img_end ||
+        entry->offset + entry->size >= archive_size) {
+        return -1;
+    }
+    *name = entry->name;
+    *data = (const char*)_binary_initrd_img_start + entry->offset;
+    *size = entry->size;
+    return 1;
+}
@@ -0,0 +1,32 @@
+#ifndef INITRD_H
+#define INITRD_H
+
+// Archive format of the initrd linked into the kernel. This header is shared
+// with the host-side mkinitrd tool, so it must only depend on <stdint.h>.
+//
+//   header                       magic and entry count
+//   entries[count]               name, offset and size of every file
+//   file data                    each file NUL-terminated, 4-byte aligned
+//
+// Offsets are relative to the start of the archive.
+
+#include <stdint.h>
+
+#define INITRD_MAGIC 0x44524741       // "AGRD"
+#define INITRD_NAME_LEN 32
+
+struct initrd_header {
+    uint32_t magic;
+    uint32_t count;
+} __attribute__((packed));
+
+struct initrd_entry {
+    char name[INITRD_NAME_LEN];
+    uint32_t offset;
+    uint32_t size;                    // Without the terminating NUL
+} __attribute__((packed));
+
+// Kernel side (fs/initrd.c): 1 and the entry, -1 past the last one
+int initrd_entry(int index, const char** name, const char** data, uint32_t* size);
+
+#endif
@@ -0,0 +1,410 @@
+#include "lfs.h"
+#include "bcache.h"
+#include "../include/kernel.h"
+
+// Log-structured mode: every change (data blocks and inode records) is
+// appended to an in-memory segment, which goes to disk as one sequential
+// request when it fills up or on sync, followed by a checkpoint holding the
+// inode map and per-segment live counts. Live counts are in records: one
+// per data block and one per inode slot, so a segment is free at zero.
+
+static struct block_device* log_dev = NULL;
+static struct agranfs_superblock log_sb;
+static uint8_t checkpoint_raw[AGRANFS_CHECKPOINT_BLOCKS * AGRANFS_BLOCK_SIZE] __attribute__((aligned(4)));
+static struct agranfs_checkpoint* cp = (struct agranfs_checkpoint*)checkpoint_raw;
+static struct agranfs_log_inode log_inodes[AGRANFS_INODES];
+
+static uint8_t segment_buffer[AGRANFS_SEGMENT_BLOCKS * AGRANFS_BLOCK_SIZE] __attribute__((aligned(16)));
+static struct agranfs_segment_summary* summary = (struct agranfs_segment_summary*)segment_buffer;
+static uint32_t current_segment = 0;
+static uint32_t segment_fill = 0;       // Next free block in the current segment
+static int inode_block = -1;            // Packed inode block being filled, -1 if none
+static int inode_block_slots = 0;
+
+static uint8_t clean_buffer[AGRANFS_SEGMENT_BLOCKS * AGRANFS_BLOCK_SIZE] __attribute__((aligned(16)));
+static int cleaning = 0;
+
+static struct {
+    uint32_t writes;
+    uint32_t in_place;                  // Updates absorbed by the unflushed segment
+    uint32_t segments_written;
+    uint32_t cleaner_runs;
+    uint32_t records_moved;
+} lfs_stats;
+
+static uint32_t segment_base(uint32_t segment) {
+    return log_sb.segment_start + segment * log_sb.segment_blocks;
+}
+
+static uint32_t segment_of(uint32_t block) {
+    return (block - log_sb.segment_start) / log_sb.segment_blocks;
+}
+
+static int in_current_segment(uint32_t block) {
+    uint32_t base = segment_base(current_segment);
+    return block >= base && block < base + segment_fill;
+}
+
+static uint8_t* buffered_block(uint32_t block) {
+    return segment_buffer + (block - segment_base(current_segment)) * AGRANFS_BLOCK_SIZE;
+}
+
+static void kill_record(uint32_t block) {
+    if (block < log_sb.segment_start) return;
+    uint32_t segment = segment_of(block);
+    if (segment < log_sb.segment_count && cp->segment_live[segment] > 0) {
+        cp->segment_live[segment]--;
+    }
+}
+
+static int free_segment_count(void) {
+    int count = 0;
+    for (uint32_t s = 0; s < log_sb.segment_count; s++) {
+        if (cp->segment_live[s] == 0 && s != current_segment) count++;
+    }
+    return count;
+}
+
+// Keep the log moving forward: take the next free segment after the head
+static int pick_free_segment(uint32_t after) {
+    for (uint32_t i = 1; i <= log_sb.segment_count; i++) {
+        uint32_t s = (after + i) % log_sb.segment_count;
+        if (cp->segment_live[s] == 0) return (int)s;
+    }
+    return -1;
+}
+
+static void start_segment(uint32_t segment) {
+    current_segment = segment;
+    memset(segment_buffer, 0, sizeof(segment_buffer));
+    summary->sequence = cp->sequence + 1;
+    segment_fill = 1;                   // Block 0 is the summary
+    inode_block = -1;
+    inode_block_slots = 0;
+}
+
+static int write_checkpoint(void) {
+    cp->sequence++;
+    cp->head_segment = current_segment;
+    if (block_write(log_dev, AGRANFS_START_LBA + log_sb.checkpoint_start,
+                    log_sb.checkpoint_blocks, checkpoint_raw) < 0) {
+        print_string("Error: Checkpoint write failed\n");
+        return -1;
+    }
+    return 0;
+}
+
+// One sequential write for the whole segment, then the checkpoint
+static int flush_segment(void) {
+    if (segment_fill <= 1) {
+        return 0;
+    }
+    uint32_t lba = AGRANFS_START_LBA + segment_base(current_segment);
+    summary->blocks = segment_fill;
+    if (block_write(log_dev, lba, segment_fill, segment_buffer) < 0) {
+        print_string("Error: Segment write failed\n");
+        return -1;
+    }
+    bcache_drop(log_dev, lba, segment_fill);
+    lfs_stats.segments_written++;
+    if (write_checkpoint() < 0) {
+        return -1;
+    }
+
+    int next = pick_free_segment(current_segment);
+    if (next < 0) {
+        print_string("Error: Log is full\n");
+        return -1;
+    }
+    start_segment(next);
+    return 0;
+}
+
+// Append one block to the log; returns its block number, or 0 on failure
+static uint32_t append_block(const void* data, uint16_t inode, uint16_t index) {
+    while (segment_fill >= AGRANFS_SEGMENT_BLOCKS) {
+        if (flush_segment() < 0) return 0;
+    }
+    uint32_t slot = segment_fill++;
+    memcpy(segment_buffer + slot * AGRANFS_BLOCK_SIZE, data, AGRANFS_BLOCK_SIZE);
+    summary->entries[slot].inode = inode;
+    summary->entries[slot].index = index;
+    return segment_base(current_segment) + slot;
+}
+
+// Write an inode record, packing several per block while the segment is open
+static int write_inode_record(int inode) {
+    uint32_t entry = cp->imap[inode];
+    if (entry && in_current_segment(AGRANFS_IMAP_BLOCK(entry))) {
+        memcpy(buffered_block(AGRANFS_IMAP_BLOCK(entry)) + AGRANFS_IMAP_SLOT(entry) * sizeof(struct agranfs_log_inode),
+               &log_inodes[inode], sizeof(struct agranfs_log_inode));
+        lfs_stats.in_place++;
+        return 0;
+    }
+    if (inode_block < 0 || inode_block_slots == (int)AGRANFS_LOG_INODES_PER_BLOCK) {
+        static const uint8_t empty[AGRANFS_BLOCK_SIZE];
+        uint32_t block = append_block(empty, AGRANFS_SUMMARY_INODE_BLOCK, 0);
+        if (block == 0) return -1;
+        inode_block = block - segment_base(current_segment);
+        inode_block_slots = 0;
+    }
+    int slot = inode_block_slots++;
+    uint32_t block = segment_base(current_segment) + inode_block;
+    memcpy(segment_buffer + inode_block * AGRANFS_BLOCK_SIZE + slot * sizeof(struct agranfs_log_inode),
+           &log_inodes[inode], sizeof(struct agranfs_log_inode));
+    if (entry) {
+        kill_record(AGRANFS_IMAP_BLOCK(entry));
+    }
+    cp->imap[inode] = AGRANFS_IMAP_ENTRY(block, slot);
+    cp->segment_live[current_segment]++;
+    return 0;
+}
+
+// Run the cleaner once free space gets low; called at the end of every
+// operation so it never races with an update in progress
+static void maybe_clean(void) {
+    int free_segments = free_segment_count();
+    if (!cleaning && free_segments < LFS_CLEAN_LOW_WATER) {
+        lfs_clean(LFS_CLEAN_HIGH_WATER - free_segments);
+    }
+}
+
+int lfs_mount(struct block_device* dev, const struct agranfs_superblock* sb) {
+    log_sb = *sb;
+    if (log_sb.segment_blocks != AGRANFS_SEGMENT_BLOCKS || log_sb.segment_count == 0 ||
+        log_sb.segment_count > AGRANFS_MAX_SEGMENTS ||
+        log_sb.checkpoint_blocks != AGRANFS_CHECKPOINT_BLOCKS) {
+        print_string("Error: Unsupported log-structured layout\n");
+        return -1;
+    }
+    log_dev = dev;
+    if (block_read(dev, AGRANFS_START_LBA + log_sb.checkpoint_start,
+                   log_sb.checkpoint_blocks, checkpoint_raw) < 0) {
+        log_dev = NULL;
+        return -1;
+    }
+
+    // Only the inode records named by the inode map are read
+    memset(log_inodes, 0, sizeof(log_inodes));
+    for (int i = 0; i < AGRANFS_INODES; i++) {
+        uint32_t entry = cp->imap[i];
+        if (entry == 0) continue;
+        struct buffer* buf = bcache_read(dev, AGRANFS_START_LBA + AGRANFS_IMAP_BLOCK(entry));
+        if (buf == NULL) {
+            log_dev = NULL;
+            return -1;
+        }
+        memcpy(&log_inodes[i], buf->data + AGRANFS_IMAP_SLOT(entry) * sizeof(struct agranfs_log_inode),
+               sizeof(struct agranfs_log_inode));
+        bcache_release(buf);
+    }
+
+    int segment = pick_free_segment(cp->head_segment);
+    if (segment < 0) {
+        print_string("Error: Log is full\n");
+        log_dev = NULL;
+        return -1;
+    }
+    start_segment(segment);
+    memset(&lfs_stats, 0, sizeof(lfs_stats));
+    return 0;
+}
+
+int lfs_dir_entry(int index, char* name, int* inode, uint32_t* size) {
+    if (index < 0 || index >= AGRANFS_INODES) {
+        return -1;
+    }
+    if (cp->imap[index] == 0 || !(log_inodes[index].inode.flags & AGRANFS_INODE_USED)) {
+        return 0;
+    }
+    strncpy(name, log_inodes[index].entry.name, AGRANFS_NAME_LEN - 1);
+    name[AGRANFS_NAME_LEN - 1] = '\0';
+    *inode = index;
+    *size = log_inodes[index].inode.size;
+    return 1;
+}
+
+int lfs_create(const char* name) {
+    int inode = -1;
+    for (int i = 0; i < AGRANFS_INODES; i++) {
+        if (cp->imap[i] == 0) {
+            inode = i;
+            break;
+        }
+    }
+    if (inode < 0) return -1;
+
+    memset(&log_inodes[inode], 0, sizeof(struct agranfs_log_inode));
+    log_inodes[inode].inode.flags = AGRANFS_INODE_USED;
+    log_inodes[inode].entry.inode = inode + 1;
+    strncpy(log_inodes[inode].entry.name, name, AGRANFS_NAME_LEN - 1);
+    if (write_inode_record(inode) < 0) return -1;
+    maybe_clean();
+    return inode;
+}
+
+int lfs_remove(int inode) {
+    if (inode < 0 || inode >= AGRANFS_INODES || cp->imap[inode] == 0) return -1;
+    struct agranfs_inode* node = &log_inodes[inode].inode;
+    for (int i = 0; i < AGRANFS_DIRECT_BLOCKS; i++) {
+        if (node->blocks[i]) kill_record(node->blocks[i]);
+    }
+    kill_record(AGRANFS_IMAP_BLOCK(cp->imap[inode]));
+    cp->imap[inode] = 0;
+    memset(&log_inodes[inode], 0, sizeof(struct agranfs_log_inode));
+    maybe_clean();
+    return 0;
+}
+
+int lfs_read(int inode, char* buffer, uint32_t max_size) {
+    if (inode < 0 || inode >= AGRANFS_INODES || cp->imap[inode] == 0) return -1;
+    struct agranfs_inode* node = &log_inodes[inode].inode;
+    uint32_t size = node->size < max_size ? node->size : max_size;
+    uint32_t done = 0;
+    for (int i = 0; i < AGRANFS_DIRECT_BLOCKS && done < size; i++) {
+        uint32_t chunk = size - done;
+        if (chunk > AGRANFS_BLOCK_SIZE) chunk = AGRANFS_BLOCK_SIZE;
+        if (in_current_segment(node->blocks[i])) {
+            memcpy(buffer + done, buffered_block(node->blocks[i]), chunk);
+        } else {
+            struct buffer* buf = bcache_read(log_dev, AGRANFS_START_LBA + node->blocks[i]);
+            if (buf == NULL) return -1;
+            memcpy(buffer + done, buf->data, chunk);
+            bcache_release(buf);
+        }
+        done += chunk;
+    }
+    return (int)done;
+}
+
+// Blocks still in the open segment are rewritten in place; anything already
+// on disk gets a fresh copy at the log head and the old one becomes dead
+int lfs_write(int inode, const char* data, uint32_t size) {
+    if (inode < 0 || inode >= AGRANFS_INODES || cp->imap[inode] == 0) return -1;
+    if (size > AGRANFS_DIRECT_BLOCKS * AGRANFS_BLOCK_SIZE) {
+        size = AGRANFS_DIRECT_BLOCKS * AGRANFS_BLOCK_SIZE;
+    }
+    struct agranfs_inode* node = &log_inodes[inode].inode;
+    uint32_t needed = (size + AGRANFS_BLOCK_SIZE - 1) / AGRANFS_BLOCK_SIZE;
+    uint8_t block[AGRANFS_BLOCK_SIZE];
+
+    for (uint32_t i = 0; i < AGRANFS_DIRECT_BLOCKS; i++) {
+        uint32_t old = node->blocks[i];
+        if (i >= needed) {
+            if (old) {
+                kill_record(old);
+                node->blocks[i] = 0;
+            }
+            continue;
+        }
+        uint32_t chunk = size - i * AGRANFS_BLOCK_SIZE;
+        if (chunk > AGRANFS_BLOCK_SIZE) chunk = AGRANFS_BLOCK_SIZE;
+        memset(block, 0, AGRANFS_BLOCK_SIZE);
+        memcpy(block, data + i * AGRANFS_BLOCK_SIZE, chunk);
+
+        if (old && in_current_segment(old)) {
+            memcpy(buffered_block(old), block, AGRANFS_BLOCK_SIZE);
+            lfs_stats.in_place++;
+            continue;
+        }
+        uint32_t fresh = append_block(block, inode, i);
+        if (fresh == 0) return -1;
+        cp->segment_live[current_segment]++;
+        if (old) kill_record(old);
+        node->blocks[i] = fresh;
+    }
+
+    node->size = size;
+    lfs_stats.writes++;
+    if (write_inode_record(inode) < 0) return -1;
+    maybe_clean();
+    return 0;
+}
+
+int lfs_sync(void) {
+    return flush_segment();
+}
+
+// Greedy cleaner: take the segment with the fewest live records, copy the
+// live ones to the log head and mark the segment free
+int lfs_clean(int segments) {
+    int cleaned = 0;
+    cleaning = 1;
+    while (cleaned < segments) {
+        int victim = -1;
+        for (uint32_t s = 0; s < log_sb.segment_count; s++) {
+            if (s == current_segment || cp->segment_live[s] == 0) continue;
+            if (victim < 0 || cp->segment_live[s] < cp->segment_live[victim]) victim = s;
+        }
+        if (victim < 0) break;
+
+        uint32_t base = segment_base(victim);
+        if (block_read(log_dev, AGRANFS_START_LBA + base, AGRANFS_SEGMENT_BLOCKS, clean_buffer) < 0) {
+            break;
+        }
+        struct agranfs_segment_summary* victim_summary = (struct agranfs_segment_summary*)clean_buffer;
+        uint32_t blocks = victim_summary->blocks;
+        if (blocks > AGRANFS_SEGMENT_BLOCKS) blocks = AGRANFS_SEGMENT_BLOCKS;
+
+        for (uint32_t b = 1; b < blocks; b++) {
+            struct agranfs_summary_entry* e = &victim_summary->entries[b];
+            uint32_t address = base + b;
+            if (e->inode == AGRANFS_SUMMARY_INODE_BLOCK) {
+                for (int i = 0; i < AGRANFS_INODES; i++) {
+                    if (cp->imap[i] && AGRANFS_IMAP_BLOCK(cp->imap[i]) == address) {
+                        write_inode_record(i);
+                        lfs_stats.records_moved++;
+                    }
+                }
+            } else if (e->inode < AGRANFS_INODES && e->index < AGRANFS_DIRECT_BLOCKS &&
+                       cp->imap[e->inode] && log_inodes[e->inode].inode.blocks[e->index] == address) {
+                uint32_t fresh = append_block(clean_buffer + b * AGRANFS_BLOCK_SIZE, e->inode, e->index);
+                if (fresh == 0) break;
+                cp->segment_live[current_segment]++;
+                kill_record(address);
+                log_inodes[e->inode].inode.blocks[e->index] = fresh;
+                write_inode_record(e->inode);
+                lfs_stats.records_moved++;
+            }
+        }
+        // Everything live has moved, whatever the counters drifted to
+        cp->segment_live[victim] = 0;
+        bcache_drop(log_dev, AGRANFS_START_LBA + base, AGRANFS_SEGMENT_BLOCKS);
+        lfs_stats.cleaner_runs++;
+        cleaned++;
+    }
+    cleaning = 0;
+    return cleaned;
+}
+
+void lfs_print_info(void) {
+    int used = 0;
+    for (int i = 0; i < AGRANFS_INODES; i++) {
+        if (cp->imap[i]) used++;
+    }
+    print_string("File system: AGRAN FS (log-structured) on ");
+    print_string(log_dev->name);
+    print_string("\nSegments: ");
+    print_int(free_segment_count());
+    print_string(" free / ");
+    print_int(log_sb.segment_count);
+    print_string(" total (");
+    print_int(AGRANFS_SEGMENT_BLOCKS * AGRANFS_BLOCK_SIZE / 1024);
+    print_string(" KB each), head at ");
+    print_int(current_segment);
+    print_string("\nInodes: ");
+    print_int(used);
+    print_string(" used / ");
+    print_int(AGRANFS_INODES);
+    print_string("\nWrites: ");
+    print_int(lfs_stats.writes);
+    print_string(", absorbed in memory: ");
+    print_int(lfs_stats.in_place);
+    print_string(", segment writes: ");
+    print_int(lfs_stats.segments_written);
+    print_string("\nCleaner: ");
+    print_int(lfs_stats.cleaner_runs);
+    print_string(" segments cleaned, ");
+    print_int(lfs_stats.records_moved);
+    print_string(" records moved\n");
+}
@@ -0,0 +1,23 @@
+#ifndef LFS_H
+#define LFS_H
+
+#include <stdint.h>
+#include "agranfs.h"
+#include "../drivers/block.h"
+
+// Start cleaning when fewer segments than this are free, stop at the high mark
+#define LFS_CLEAN_LOW_WATER 4
+#define LFS_CLEAN_HIGH_WATER 8
+
+// Log-structured mode of the AGRAN file system (used by agranfs.c)
+int lfs_mount(struct block_device* dev, const struct agranfs_superblock* sb);
+int lfs_dir_entry(int index, char* name, int* inode, uint32_t* size);
+int lfs_create(const char* name);
+int lfs_remove(int inode);
+int lfs_read(int inode, char* buffer, uint32_t max_size);
+int lfs_write(int inode, const char* data, uint32_t size);
+int lfs_sync(void);
+int lfs_clean(int segments);
+void lfs_print_info(void);
+
+#endif
@@ -18,6 +18,30 @@ static inline void outb(uint16_t port, uint8_t val) {
 static inline void outw(uint16_t port, uint16_t val) {
     asm volatile ("outw %0, %1" : : "a"(val), "Nd"(port));
 }
+static inline uint16_t inw(uint16_t port) {
+    uint16_t ret;
+    asm volatile ("inw %1, %0" : "=a"(ret) : "Nd"(port));
+    return ret;
+}
+static inline uint32_t inl(uint16_t port) {
+    uint32_t ret;
+    asm volatile ("inl %1, %0" : "=a"(ret) : "Nd"(port));
+    return ret;
+}
+static inline void outl(uint16_t port, uint32_t val) {
+    asm volatile ("outl %0, %1" : : "a"(val), "Nd"(port));
+}
+// Repeated word transfers (ATA PIO data port)
+static inline void insw(uint16_t port, void* buf, uint32_t count) {
+    asm volatile ("cld; rep insw" : "+D"(buf), "+c"(count) : "d"(port) : "memory");
+}
+static inline void outsw(uint16_t port, const void* buf, uint32_t count) {
+    asm volatile ("cld; rep outsw" : "+S"(buf), "+c"(count) : "d"(port) : "memory");
+}
+// Short delay by writing to an unused port
+static inline void io_wait(void) {
+    outb(0x80, 0);
+}
 
 // Video functions
 void init_video(void);
@@ -25,12 +49,18 @@ void clear_screen(void);
 void print_char(char c);
 void print_string(const char* str);
 void print_int(int num);
+void print_uint64(uint64_t num);
+void print_hex(uint32_t num);
 void update_cursor(void);
 void scroll_up(void);
 void scroll_down(void);
 void set_cursor(int x, int y);
 int get_cursor_y(void); // Added function declaration
 void set_text_color(uint8_t color);
+
+// While an output sink is set, print_* output goes to it instead of the screen
+typedef void (*output_sink_t)(char c);
+output_sink_t set_output_sink(output_sink_t sink);  // Returns the previous sink
 uint8_t get_text_color(void);
 
 // Keyboard functions
@@ -38,12 +68,16 @@ char getchar(void);
 
 // String functions
 int strcmp(const char* s1, const char* s2);
+int strncmp(const char* s1, const char* s2, size_t n);
 size_t strlen(const char* str);
 char* strcpy(char* dest, const char* src);
 char* strncpy(char* dest, const char* src, size_t n);
+void* memset(void* s, int c, size_t n);
+void* memcpy(void* dest, const void* src, size_t n);
+int memcmp(const void* s1, const void* s2, size_t n);
 
 // System control functions
-void shutdown(void);
+void shutdown(int status);      // Status reaches the host through QEMU's isa-debug-exit
 void reboot(void);
 
 // Shell functions
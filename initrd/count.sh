@@ -0,0 +1,4 @@
+# Example script: source -t count.sh <count>
+repeat $1 i
+echo pass $i of $1
+end
@@ -0,0 +1,171 @@
+#include "acpi.h"
+#include "../include/kernel.h"
+
+// Where the BIOS leaves the RSDP: the first KB of the EBDA, whose segment
+// is stored at 0x40E, or the read-only BIOS area below 1MB
+#define EBDA_SEGMENT_POINTER 0x40E
+#define EBDA_SEARCH_SIZE 1024
+#define BIOS_AREA_START 0xE0000
+#define BIOS_AREA_END 0x100000
+#define RSDP_ALIGN 16
+
+#define RSDP_V1_SIZE 20
+#define MADT_PROCESSOR 0
+#define MADT_LAPIC_OVERRIDE 5
+#define MADT_PROCESSOR_ENABLED 0x1
+
+struct rsdp {
+    char signature[8];                  // "RSD PTR "
+    uint8_t checksum;                   // Over the first RSDP_V1_SIZE bytes
+    char oem_id[6];
+    uint8_t revision;                   // 2 and up add the XSDT
+    uint32_t rsdt_address;
+    uint32_t length;
+    uint64_t xsdt_address;
+    uint8_t extended_checksum;
+    uint8_t reserved[3];
+} __attribute__((packed));
+
+struct sdt_header {
+    char signature[4];
+    uint32_t length;                    // Including this header
+    uint8_t revision;
+    uint8_t checksum;
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed));
+
+struct madt {
+    struct sdt_header header;
+    uint32_t lapic_address;
+    uint32_t flags;
+} __attribute__((packed));
+
+struct madt_entry {
+    uint8_t type;
+    uint8_t length;
+} __attribute__((packed));
+
+struct madt_processor {
+    struct madt_entry entry;
+    uint8_t acpi_id;
+    uint8_t apic_id;
+    uint32_t flags;
+} __attribute__((packed));
+
+struct madt_lapic_override {
+    struct madt_entry entry;
+    uint16_t reserved;
+    uint64_t address;
+} __attribute__((packed));
+
+static int checksum_ok(const void* data, uint32_t length) {
+    const uint8_t* bytes = data;
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < length; i++) {
+        sum += bytes[i];
+    }
+    return sum == 0;
+}
+
+static const struct rsdp* scan_rsdp(uint32_t start, uint32_t end) {
+    for (uint32_t address = start; address + RSDP_V1_SIZE <= end; address += RSDP_ALIGN) {
+        const struct rsdp* rsdp = (const struct rsdp*)address;
+        if (memcmp(rsdp->signature, "RSD PTR ", 8) == 0 && checksum_ok(rsdp, RSDP_V1_SIZE)) {
+            return rsdp;
+        }
+    }
+    return NULL;
+}
+
+// GCC takes a constant address in the first page for a null pointer offset
+// and warns; the BIOS data area really is there
+static uint16_t read_bios_data(uint32_t address) {
+    const volatile uint16_t* pointer;
+    asm ("" : "=r"(pointer) : "0"(address));
+    return *pointer;
+}
+
+static const struct rsdp* find_rsdp(void) {
+    uint32_t ebda = (uint32_t)read_bios_data(EBDA_SEGMENT_POINTER) << 4;
+    const struct rsdp* rsdp = NULL;
+    if (ebda != 0 && ebda < BIOS_AREA_START) {
+        rsdp = scan_rsdp(ebda, ebda + EBDA_SEARCH_SIZE);
+    }
+    return rsdp ? rsdp : scan_rsdp(BIOS_AREA_START, BIOS_AREA_END);
+}
+
+static const struct sdt_header* valid_table(uint32_t address) {
+    const struct sdt_header* header = (const struct sdt_header*)address;
+    if (address == 0 || header->length < sizeof(*header) || !checksum_ok(header, header->length)) {
+        return NULL;
+    }
+    return header;
+}
+
+// Look `signature` up in the RSDT, or in the XSDT when there is one below 4GB
+static const struct sdt_header* find_table(const struct rsdp* rsdp, const char* signature) {
+    const struct sdt_header* root = NULL;
+    int entry_size = 4;
+    if (rsdp->revision >= 2 && rsdp->xsdt_address != 0 && (rsdp->xsdt_address >> 32) == 0) {
+        root = valid_table((uint32_t)rsdp->xsdt_address);
+        entry_size = 8;
+    }
+    if (root == NULL) {
+        root = valid_table(rsdp->rsdt_address);
+        entry_size = 4;
+    }
+    if (root == NULL) {
+        return NULL;
+    }
+    const uint8_t* entries = (const uint8_t*)(root + 1);
+    uint32_t count = (root->length - sizeof(*root)) / entry_size;
+    for (uint32_t i = 0; i < count; i++) {
+        // Tables above 4GB are out of reach without paging
+        const uint32_t* entry = (const uint32_t*)(entries + i * entry_size);
+        if (entry_size == 8 && entry[1] != 0) continue;
+        const struct sdt_header* table = valid_table(entry[0]);
+        if (table && memcmp(table->signature, signature, 4) == 0) {
+            return table;
+        }
+    }
+    return NULL;
+}
+
+int acpi_find_madt(struct madt_info* info) {
+    const struct rsdp* rsdp = find_rsdp();
+    if (rsdp == NULL) {
+        return -1;
+    }
+    const struct madt* madt = (const struct madt*)find_table(rsdp, "APIC");
+    if (madt == NULL || madt->header.length < sizeof(*madt)) {
+        return -1;
+    }
+
+    info->lapic_address = madt->lapic_address;
+    info->processor_count = 0;
+    const uint8_t* p = (const uint8_t*)(madt + 1);
+    const uint8_t* end = (const uint8_t*)madt + madt->header.length;
+    while (p + sizeof(struct madt_entry) <= end) {
+        const struct madt_entry* entry = (const struct madt_entry*)p;
+        if (entry->length < sizeof(*entry) || p + entry->length > end) {
+            break;
+        }
+        if (entry->type == MADT_PROCESSOR && entry->length >= sizeof(struct madt_processor)) {
+            const struct madt_processor* cpu = (const struct madt_processor*)entry;
+            if ((cpu->flags & MADT_PROCESSOR_ENABLED) && info->processor_count < ACPI_MAX_PROCESSORS) {
+                info->apic_ids[info->processor_count++] = cpu->apic_id;
+            }
+        } else if (entry->type == MADT_LAPIC_OVERRIDE && entry->length >= sizeof(struct madt_lapic_override)) {
+            const struct madt_lapic_override* override = (const struct madt_lapic_override*)entry;
+            if ((override->address >> 32) == 0) {
+                info->lapic_address = (uint32_t)override->address;
+            }
+        }
+        p += entry->length;
+    }
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef ACPI_H
+#define ACPI_H
+
+#include <stdint.h>
+
+#define ACPI_MAX_PROCESSORS 32
+
+// What the MADT ("APIC" table) says about the processors
+struct madt_info {
+    uint32_t lapic_address;
+    int processor_count;                // Enabled processors, up to ACPI_MAX_PROCESSORS
+    uint8_t apic_ids[ACPI_MAX_PROCESSORS];
+};
+
+// Find the RSDP in the BIOS areas and walk the RSDT/XSDT to the MADT.
+// Returns -1 when there is no ACPI, no MADT or a table fails its checksum.
+int acpi_find_madt(struct madt_info* info);
+
+#endif
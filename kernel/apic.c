@@ -0,0 +1,114 @@
+#include "apic.h"
+#include "interrupts.h"
+#include "clock.h"
+#include "../include/kernel.h"
+
+// Register offsets in the local APIC page
+#define LAPIC_ID            0x020
+#define LAPIC_TPR           0x080
+#define LAPIC_EOI           0x0B0
+#define LAPIC_SVR           0x0F0
+#define LAPIC_ICR_LOW       0x300
+#define LAPIC_ICR_HIGH      0x310
+#define LAPIC_LVT_TIMER     0x320
+#define LAPIC_TIMER_INITIAL 0x380
+#define LAPIC_TIMER_CURRENT 0x390
+#define LAPIC_TIMER_DIVIDE  0x3E0
+
+#define SVR_ENABLE          (1u << 8)
+#define ICR_FIXED           (0u << 8)
+#define ICR_INIT            (5u << 8)
+#define ICR_STARTUP         (6u << 8)
+#define ICR_PENDING         (1u << 12)
+#define ICR_ASSERT          (1u << 14)
+#define LVT_MASKED          (1u << 16)
+#define TIMER_DIVIDE_16     0x3
+
+#define ICR_TIMEOUT_US 1000
+#define CALIBRATE_US 10000
+
+static volatile uint32_t* lapic = (volatile uint32_t*)LAPIC_DEFAULT_BASE;
+static uint32_t timer_ticks_per_ms = 0;
+
+static uint32_t lapic_read(uint32_t reg) {
+    return lapic[reg / 4];
+}
+
+static void lapic_write(uint32_t reg, uint32_t value) {
+    lapic[reg / 4] = value;
+}
+
+void lapic_init(uint32_t base) {
+    lapic = (volatile uint32_t*)base;
+}
+
+void lapic_enable(void) {
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SVR, SVR_ENABLE | VECTOR_SPURIOUS);
+}
+
+uint8_t lapic_id(void) {
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+void lapic_eoi(void) {
+    lapic_write(LAPIC_EOI, 0);
+}
+
+static int send_ipi(uint8_t apic_id, uint32_t command) {
+    lapic_write(LAPIC_ICR_HIGH, (uint32_t)apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, command);    // Writing the low half sends it
+    for (int waited = 0; waited < ICR_TIMEOUT_US; waited += 10) {
+        if (!(lapic_read(LAPIC_ICR_LOW) & ICR_PENDING)) {
+            return 0;
+        }
+        clock_delay_us(10);
+    }
+    return -1;
+}
+
+int lapic_send_init(uint8_t apic_id) {
+    return send_ipi(apic_id, ICR_INIT | ICR_ASSERT);
+}
+
+int lapic_send_startup(uint8_t apic_id, uint32_t address) {
+    return send_ipi(apic_id, ICR_STARTUP | ICR_ASSERT | (address >> 12));
+}
+
+// May be called with interrupts on, so keep a handler on this CPU from
+// sending between our writes to the ICR
+int lapic_send_ipi(uint8_t apic_id, uint8_t vector) {
+    uint32_t flags = interrupts_save();
+    int result = send_ipi(apic_id, ICR_FIXED | ICR_ASSERT | vector);
+    interrupts_restore(flags);
+    return result;
+}
+
+// Let the timer count down from the top for CALIBRATE_US
+void lapic_timer_calibrate(void) {
+    lapic_write(LAPIC_TIMER_DIVIDE, TIMER_DIVIDE_16);
+    lapic_write(LAPIC_LVT_TIMER, LVT_MASKED);
+    lapic_write(LAPIC_TIMER_INITIAL, 0xFFFFFFFF);
+    clock_delay_us(CALIBRATE_US);
+    uint32_t elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CURRENT);
+    lapic_write(LAPIC_TIMER_INITIAL, 0);
+    timer_ticks_per_ms = elapsed / (CALIBRATE_US / 1000);
+}
+
+int lapic_timer_calibrated(void) {
+    return timer_ticks_per_ms != 0;
+}
+
+// Counts past 32 bits are cut short; the interrupt then comes early and
+// the caller sets the rest again
+void lapic_timer_oneshot(uint32_t us) {
+    uint64_t count = udiv64_32((uint64_t)us * timer_ticks_per_ms, 1000);
+    if (count > 0xFFFFFFFF) count = 0xFFFFFFFF;
+    lapic_write(LAPIC_TIMER_DIVIDE, TIMER_DIVIDE_16);
+    lapic_write(LAPIC_LVT_TIMER, VECTOR_APIC_TIMER);
+    lapic_write(LAPIC_TIMER_INITIAL, count ? (uint32_t)count : 1);
+}
+
+void lapic_timer_stop(void) {
+    lapic_write(LAPIC_TIMER_INITIAL, 0);
+}
@@ -0,0 +1,26 @@
+#ifndef APIC_H
+#define APIC_H
+
+#include <stdint.h>
+
+#define LAPIC_DEFAULT_BASE 0xFEE00000
+
+// Local APIC, reached through its MMIO page (there is no paging to map it)
+void lapic_init(uint32_t base);
+void lapic_enable(void);                // Software-enable this CPU's APIC
+uint8_t lapic_id(void);
+void lapic_eoi(void);
+
+// IPIs; 0 once the APIC has sent them, -1 if it timed out
+int lapic_send_init(uint8_t apic_id);
+int lapic_send_startup(uint8_t apic_id, uint32_t address);   // Page-aligned, below 1MB
+int lapic_send_ipi(uint8_t apic_id, uint8_t vector);
+
+// One-shot timer on VECTOR_APIC_TIMER. Every CPU's timer runs off the same
+// bus clock, so the boot CPU calibrates it once against the TSC.
+void lapic_timer_calibrate(void);
+int lapic_timer_calibrated(void);
+void lapic_timer_oneshot(uint32_t us);  // Replaces any deadline already set
+void lapic_timer_stop(void);
+
+#endif
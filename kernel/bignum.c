@@ -0,0 +1,664 @@
+#include "bignum.h"
+#include "../include/kernel.h"
+
+#define DECIMAL_CHUNK 1000000000        // 10^9, the most decimal digits in a limb
+#define DECIMAL_CHUNK_DIGITS 9
+#define DECIMAL_BASECASE_LIMBS 32       // Converted by repeated division by 10^9
+#define FACTORIAL_LEAF 16               // Factors multiplied one by one
+
+// Most limbs each algorithm takes for temporaries, on top of its result.
+// Operations reserve these before starting, so nothing below them checks.
+#define MUL_SCRATCH(an, bn) (4 * ((an) + (bn)) + 256)
+#define DIVIDE_SCRATCH(an, bn) (2 * (an) + 32 * (bn) + 512)
+#define DECIMAL_SCRATCH(n) (16 * (n) + 1024)
+
+void bignum_arena_init(struct bignum_arena* arena, uint32_t* limbs, uint32_t size) {
+    arena->limbs = limbs;
+    arena->size = size;
+    arena->used = 0;
+    arena->peak = 0;
+}
+
+void bignum_arena_release(struct bignum_arena* arena, uint32_t mark) {
+    arena->used = mark;
+}
+
+static int reserve(const struct bignum_arena* arena, uint32_t limbs) {
+    return arena->size - arena->used >= limbs ? 0 : BIGNUM_NO_MEMORY;
+}
+
+static uint32_t* take(struct bignum_arena* arena, uint32_t limbs) {
+    uint32_t* taken = arena->limbs + arena->used;
+    arena->used += limbs;
+    if (arena->used > arena->peak) {
+        arena->peak = arena->used;
+    }
+    return taken;
+}
+
+// Move r, the last thing taken, down to `mark`, giving back what lay between
+static void keep(struct bignum_arena* arena, uint32_t mark, struct bignum* r) {
+    uint32_t* to = arena->limbs + mark;
+    for (uint32_t i = 0; i < r->length; i++) {
+        to[i] = r->limbs[i];
+    }
+    r->limbs = to;
+    arena->used = mark + r->length;
+}
+
+static uint32_t trimmed(const uint32_t* a, uint32_t n) {
+    while (n > 0 && a[n - 1] == 0) n--;
+    return n;
+}
+
+static void finish(struct bignum* r, uint32_t* limbs, uint32_t length, int negative) {
+    r->limbs = limbs;
+    r->length = trimmed(limbs, length);
+    r->negative = r->length ? negative : 0;
+}
+
+// Limb arrays
+
+static int compare_n(const uint32_t* a, const uint32_t* b, uint32_t n) {
+    while (n-- > 0) {
+        if (a[n] != b[n]) return a[n] < b[n] ? -1 : 1;
+    }
+    return 0;
+}
+
+// n limbs of a against m limbs of b, m <= n
+static int compare(const uint32_t* a, uint32_t n, const uint32_t* b, uint32_t m) {
+    for (uint32_t i = n; i > m; i--) {
+        if (a[i - 1]) return 1;
+    }
+    return compare_n(a, b, m);
+}
+
+static uint32_t add_n(uint32_t* r, const uint32_t* a, const uint32_t* b, uint32_t n) {
+    uint32_t carry = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t sum = (uint64_t)a[i] + b[i] + carry;
+        r[i] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+    return carry;
+}
+
+// r = a + b for n limbs of a and m of b, m <= n; the carry out
+static uint32_t add(uint32_t* r, const uint32_t* a, uint32_t n, const uint32_t* b, uint32_t m) {
+    uint32_t carry = add_n(r, a, b, m);
+    for (uint32_t i = m; i < n; i++) {
+        uint32_t sum = a[i] + carry;
+        carry = sum < carry;
+        r[i] = sum;
+    }
+    return carry;
+}
+
+static uint32_t sub_n(uint32_t* r, const uint32_t* a, const uint32_t* b, uint32_t n) {
+    uint32_t borrow = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t difference = (uint64_t)a[i] - b[i] - borrow;
+        r[i] = (uint32_t)difference;
+        borrow = (difference >> 32) & 1;
+    }
+    return borrow;
+}
+
+static uint32_t sub(uint32_t* r, const uint32_t* a, uint32_t n, const uint32_t* b, uint32_t m) {
+    uint32_t borrow = sub_n(r, a, b, m);
+    for (uint32_t i = m; i < n; i++) {
+        uint32_t difference = a[i] - borrow;
+        borrow = a[i] < borrow;
+        r[i] = difference;
+    }
+    return borrow;
+}
+
+static uint32_t mul_1(uint32_t* r, const uint32_t* a, uint32_t n, uint32_t m) {
+    uint32_t carry = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t product = (uint64_t)a[i] * m + carry;
+        r[i] = (uint32_t)product;
+        carry = product >> 32;
+    }
+    return carry;
+}
+
+static uint32_t addmul_1(uint32_t* r, const uint32_t* a, uint32_t n, uint32_t m) {
+    uint32_t carry = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t product = (uint64_t)a[i] * m + r[i] + carry;
+        r[i] = (uint32_t)product;
+        carry = product >> 32;
+    }
+    return carry;
+}
+
+static uint32_t submul_1(uint32_t* r, const uint32_t* a, uint32_t n, uint32_t m) {
+    uint32_t borrow = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t product = (uint64_t)a[i] * m + borrow;
+        uint32_t low = (uint32_t)product;
+        borrow = (product >> 32) + (r[i] < low);
+        r[i] -= low;
+    }
+    return borrow;
+}
+
+// high:low / d, which the caller makes sure fits a limb (high < d)
+static inline uint32_t div_limb(uint32_t high, uint32_t low, uint32_t d, uint32_t* remainder) {
+    uint32_t quotient;
+    asm ("divl %4" : "=a"(quotient), "=d"(*remainder) : "a"(low), "d"(high), "rm"(d));
+    return quotient;
+}
+
+// q = a / d, the remainder returned; q may be a
+static uint32_t divrem_1(uint32_t* q, const uint32_t* a, uint32_t n, uint32_t d) {
+    uint32_t remainder = 0;
+    while (n-- > 0) {
+        q[n] = div_limb(remainder, a[n], d, &remainder);
+    }
+    return remainder;
+}
+
+// r = a << bits for 0 <= bits < 32, the bits shifted out returned
+static uint32_t shift_left(uint32_t* r, const uint32_t* a, uint32_t n, int bits) {
+    uint32_t out = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t limb = a[i];
+        r[i] = (limb << bits) | out;
+        out = bits ? limb >> (32 - bits) : 0;
+    }
+    return out;
+}
+
+// r = a >> bits for 0 <= bits < 32, dropping what falls off the bottom
+static void shift_right(uint32_t* r, const uint32_t* a, uint32_t n, int bits) {
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t above = i + 1 < n && bits ? a[i + 1] << (32 - bits) : 0;
+        r[i] = (a[i] >> bits) | above;
+    }
+}
+
+// Multiplication
+
+static void mul_basecase(uint32_t* r, const uint32_t* a, uint32_t n, const uint32_t* b, uint32_t m) {
+    r[n] = mul_1(r, a, n, b[0]);
+    for (uint32_t j = 1; j < m; j++) {
+        r[n + j] = addmul_1(r + j, a, n, b[j]);
+    }
+}
+
+// |x - y| into r[0..n) for n limbs of x and m <= n of y; 1 if x < y
+static int difference(uint32_t* r, const uint32_t* x, uint32_t n, const uint32_t* y, uint32_t m) {
+    if (compare(x, n, y, m) >= 0) {
+        sub(r, x, n, y, m);
+        return 0;
+    }
+    sub_n(r, y, x, m);                  // x < y, so x fits m limbs
+    memset(r + m, 0, (n - m) * sizeof(uint32_t));
+    return 1;
+}
+
+// r[0..2n) = a·b with a = a1·β^h + a0, b likewise, from three half-size
+// products: a0·b0, a1·b1 and (a1 - a0)(b1 - b0), whose difference from
+// the first two is the middle term. Taking the differences instead of
+// the sums keeps every operand h or n - h limbs long.
+static void mul_karatsuba(struct bignum_arena* arena, uint32_t* r, const uint32_t* a, const uint32_t* b,
+                          uint32_t n) {
+    if (n < BIGNUM_KARATSUBA_LIMBS) {
+        mul_basecase(r, a, n, b, n);
+        return;
+    }
+    uint32_t h = n / 2;
+    uint32_t hi = n - h;
+    uint32_t mark = arena->used;
+    uint32_t* da = take(arena, hi);
+    uint32_t* db = take(arena, hi);
+    uint32_t* middle = take(arena, 2 * hi);
+    int negative = difference(da, a + h, hi, a, h) ^ difference(db, b + h, hi, b, h);
+    mul_karatsuba(arena, middle, da, db, hi);
+    mul_karatsuba(arena, r, a, b, h);
+    mul_karatsuba(arena, r + 2 * h, a + h, b + h, hi);
+
+    uint32_t* sum = take(arena, 2 * hi + 1);
+    sum[2 * hi] = add(sum, r + 2 * h, 2 * hi, r, 2 * h);
+    if (negative) {
+        sum[2 * hi] += add_n(sum, sum, middle, 2 * hi);
+    } else {
+        sum[2 * hi] -= sub_n(sum, sum, middle, 2 * hi);
+    }
+    add(r + h, r + h, 2 * n - h, sum, 2 * hi + 1);
+    arena->used = mark;
+}
+
+// r[0..n+m) = a·b; r may not overlap either
+static void mul(struct bignum_arena* arena, uint32_t* r, const uint32_t* a, uint32_t n,
+                const uint32_t* b, uint32_t m) {
+    if (n < m) {
+        const uint32_t* swap = a;
+        a = b;
+        b = swap;
+        uint32_t length = n;
+        n = m;
+        m = length;
+    }
+    if (m < BIGNUM_KARATSUBA_LIMBS) {
+        mul_basecase(r, a, n, b, m);
+        return;
+    }
+    if (n == m) {
+        mul_karatsuba(arena, r, a, b, n);
+        return;
+    }
+    // Lopsided: m-limb pieces of a, each a balanced product
+    uint32_t mark = arena->used;
+    uint32_t* product = take(arena, 2 * m);
+    memset(r, 0, (n + m) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i += m) {
+        uint32_t piece = n - i < m ? n - i : m;
+        mul(arena, product, a + i, piece, b, m);
+        add(r + i, r + i, n + m - i, product, piece + m);
+    }
+    arena->used = mark;
+}
+
+// Division
+
+// a[0..n) by the normalized (top bit set) b[0..m), 2 <= m <= n: the low
+// n - m quotient limbs to q and the top one (0 or 1) returned. The
+// remainder is left in a[0..m) and the limbs above it zeroed.
+static uint32_t divrem_basecase(uint32_t* q, uint32_t* a, uint32_t n, const uint32_t* b, uint32_t m) {
+    uint32_t top = 0;
+    if (compare_n(a + n - m, b, m) >= 0) {
+        sub_n(a + n - m, a + n - m, b, m);
+        top = 1;
+    }
+    uint32_t d1 = b[m - 1];
+    uint32_t d0 = b[m - 2];
+    for (uint32_t j = n - m; j-- > 0;) {
+        uint32_t* window = a + j;       // m + 1 limbs, less than b·β
+        uint32_t n2 = window[m], n1 = window[m - 1], n0 = window[m - 2];
+        uint32_t qhat, rhat;
+        int refine = 1;
+        if (n2 >= d1) {                 // Then n2 == d1
+            qhat = 0xFFFFFFFF;
+            rhat = n1 + d1;
+            refine = rhat >= d1;        // A remainder over a limb passes the test anyway
+        } else {
+            qhat = div_limb(n2, n1, d1, &rhat);
+        }
+        // Two limbs of the divisor make qhat at most one too big
+        while (refine && (uint64_t)qhat * d0 > (((uint64_t)rhat << 32) | n0)) {
+            qhat--;
+            rhat += d1;
+            refine = rhat >= d1;
+        }
+        uint32_t borrow = submul_1(window, b, m, qhat);
+        uint32_t old = window[m];
+        window[m] = old - borrow;
+        if (old < borrow) {
+            qhat--;
+            window[m] += add_n(window, window, b, m);
+        }
+        q[j] = qhat;
+    }
+    return top;
+}
+
+static void divide_2n_1n(struct bignum_arena* arena, uint32_t* q, uint32_t* a, const uint32_t* b, uint32_t n);
+
+// a[0..3k) by the normalized b[0..2k), where a < b·β^k: k quotient limbs to
+// q, the remainder to a[0..2k). The top two thirds of a over the top half
+// of b gives a quotient at most two too big, which the rest corrects.
+static void divide_3n_2n(struct bignum_arena* arena, uint32_t* q, uint32_t* a, const uint32_t* b, uint32_t k) {
+    const uint32_t* b1 = b + k;
+    if (compare_n(a + 2 * k, b1, k) < 0) {
+        divide_2n_1n(arena, q, a + k, b1, k);
+    } else {
+        // The top of a equals b1: q = β^k - 1, leaving a2 + b1 in a[k..2k]
+        memset(q, 0xFF, k * sizeof(uint32_t));
+        memset(a + 2 * k, 0, k * sizeof(uint32_t));
+        a[2 * k] = add_n(a + k, a + k, b1, k);
+    }
+    uint32_t mark = arena->used;
+    uint32_t* product = take(arena, 2 * k);
+    mul(arena, product, q, k, b, k);
+    uint32_t negative = sub(a, a, 3 * k, product, 2 * k);
+    while (negative) {
+        uint32_t one = 1;
+        sub(q, q, k, &one, 1);
+        negative = !add(a, a, 3 * k, b, 2 * k);
+    }
+    arena->used = mark;
+}
+
+// a[0..2n) by the normalized b[0..n), where a < b·β^n: n quotient limbs to
+// q, the remainder to a[0..n). Halves until n is odd or small.
+static void divide_2n_1n(struct bignum_arena* arena, uint32_t* q, uint32_t* a, const uint32_t* b, uint32_t n) {
+    if (n % 2 || n < BIGNUM_DIVIDE_LIMBS) {
+        divrem_basecase(q, a, 2 * n, b, n);
+        return;
+    }
+    uint32_t k = n / 2;
+    divide_3n_2n(arena, q + k, a + k, b, k);
+    divide_3n_2n(arena, q, a, b, k);
+}
+
+// a[0..n) by b[0..m), n >= m >= 1, b's top limb non-zero: n - m + 1
+// quotient limbs to q and m remainder limbs to r
+static void divrem(struct bignum_arena* arena, uint32_t* q, uint32_t* r, const uint32_t* a, uint32_t n,
+                   const uint32_t* b, uint32_t m) {
+    if (m == 1) {
+        r[0] = divrem_1(q, a, n, b[0]);
+        return;
+    }
+    // Burnikel-Ziegler wants a divisor of j·2^k limbs with j under the
+    // threshold, so it halves evenly down to the base case: pad b with
+    // zero limbs below, and a to match, which leaves the quotient as it is
+    uint32_t blocks = 1;
+    while ((m + blocks - 1) / blocks >= BIGNUM_DIVIDE_LIMBS) {
+        blocks *= 2;
+    }
+    uint32_t size = (m + blocks - 1) / blocks * blocks;
+    uint32_t pad = size - m;
+    int bits = __builtin_clz(b[m - 1]);
+
+    uint32_t mark = arena->used;
+    uint32_t length = n + pad + 1;      // The top limb takes the shift and keeps a clear top bit
+    uint32_t count = (length + size - 1) / size;
+    if (count < 2) count = 2;
+    uint32_t* shifted_a = take(arena, count * size);
+    uint32_t* shifted_b = take(arena, size);
+    uint32_t* quotient = take(arena, (count - 1) * size);
+    memset(shifted_a, 0, count * size * sizeof(uint32_t));
+    memset(shifted_b, 0, pad * sizeof(uint32_t));
+    shifted_a[pad + n] = shift_left(shifted_a + pad, a, n, bits);
+    shift_left(shifted_b + pad, b, m, bits);
+
+    if (size < BIGNUM_DIVIDE_LIMBS) {
+        divrem_basecase(quotient, shifted_a, length, shifted_b, size);
+    } else {
+        // Long division in size-limb digits, each step a 2n/1n division
+        for (uint32_t i = count - 1; i-- > 0;) {
+            divide_2n_1n(arena, quotient + i * size, shifted_a + i * size, shifted_b, size);
+        }
+    }
+    memcpy(q, quotient, (n - m + 1) * sizeof(uint32_t));
+    shift_right(r, shifted_a + pad, m, bits);
+    arena->used = mark;
+}
+
+// Operations
+
+int bignum_from_int(struct bignum_arena* arena, struct bignum* r, int32_t value) {
+    if (reserve(arena, 1) < 0) return BIGNUM_NO_MEMORY;
+    uint32_t* limbs = take(arena, 1);
+    limbs[0] = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    finish(r, limbs, 1, value < 0);
+    return 0;
+}
+
+int bignum_copy(struct bignum_arena* arena, struct bignum* r, const struct bignum* a) {
+    if (reserve(arena, a->length) < 0) return BIGNUM_NO_MEMORY;
+    uint32_t* limbs = take(arena, a->length);
+    memcpy(limbs, a->limbs, a->length * sizeof(uint32_t));
+    finish(r, limbs, a->length, a->negative);
+    return 0;
+}
+
+static int compare_magnitude(const struct bignum* a, const struct bignum* b) {
+    if (a->length != b->length) return a->length < b->length ? -1 : 1;
+    return compare_n(a->limbs, b->limbs, a->length);
+}
+
+int bignum_compare(const struct bignum* a, const struct bignum* b) {
+    if (a->negative != b->negative) return a->negative ? -1 : 1;
+    int order = compare_magnitude(a, b);
+    return a->negative ? -order : order;
+}
+
+// a + b, by the signs given rather than theirs
+static int add_signed(struct bignum_arena* arena, struct bignum* r, const struct bignum* a, int a_negative,
+                      const struct bignum* b, int b_negative) {
+    if (compare_magnitude(a, b) < 0) {
+        const struct bignum* swap = a;
+        a = b;
+        b = swap;
+        int negative = a_negative;
+        a_negative = b_negative;
+        b_negative = negative;
+    }
+    if (reserve(arena, a->length + 1) < 0) return BIGNUM_NO_MEMORY;
+    uint32_t* limbs = take(arena, a->length + 1);
+    uint32_t length = a->length;
+    if (a_negative == b_negative) {
+        limbs[length] = add(limbs, a->limbs, length, b->limbs, b->length);
+        length++;
+    } else {
+        sub(limbs, a->limbs, length, b->limbs, b->length);
+    }
+    finish(r, limbs, length, a_negative);
+    return 0;
+}
+
+int bignum_add(struct bignum_arena* arena, struct bignum* r, const struct bignum* a, const struct bignum* b) {
+    return add_signed(arena, r, a, a->negative, b, b->negative);
+}
+
+int bignum_sub(struct bignum_arena* arena, struct bignum* r, const struct bignum* a, const struct bignum* b) {
+    return add_signed(arena, r, a, a->negative, b, !b->negative);
+}
+
+int bignum_mul(struct bignum_arena* arena, struct bignum* r, const struct bignum* a, const struct bignum* b) {
+    uint32_t n = a->length, m = b->length;
+    if (n == 0 || m == 0) {
+        return bignum_from_int(arena, r, 0);
+    }
+    if (reserve(arena, n + m + MUL_SCRATCH(n, m)) < 0) return BIGNUM_NO_MEMORY;
+    uint32_t* limbs = take(arena, n + m);
+    uint32_t mark = arena->used;
+    mul(arena, limbs, a->limbs, n, b->limbs, m);
+    arena->used = mark;
+    finish(r, limbs, n + m, a->negative != b->negative);
+    return 0;
+}
+
+int bignum_divmod(struct bignum_arena* arena, struct bignum* q, struct bignum* r,
+                  const struct bignum* a, const struct bignum* b) {
+    uint32_t n = a->length, m = b->length;
+    if (m == 0) return BIGNUM_DIVIDE_BY_ZERO;
+    int quotient_negative = a->negative != b->negative;
+    int remainder_negative = a->negative;
+    if (compare_magnitude(a, b) < 0) {
+        struct bignum remainder = *a;
+        if (r && bignum_copy(arena, &remainder, a) < 0) return BIGNUM_NO_MEMORY;
+        if (q && bignum_from_int(arena, q, 0) < 0) return BIGNUM_NO_MEMORY;
+        if (r) *r = remainder;
+        return 0;
+    }
+    if (reserve(arena, n + 1 + DIVIDE_SCRATCH(n, m)) < 0) return BIGNUM_NO_MEMORY;
+    uint32_t* quotient = take(arena, n - m + 1);
+    uint32_t* remainder = take(arena, m);
+    uint32_t mark = arena->used;
+    divrem(arena, quotient, remainder, a->limbs, n, b->limbs, m);
+    arena->used = mark;
+    if (q) finish(q, quotient, n - m + 1, quotient_negative);
+    if (r) finish(r, remainder, m, remainder_negative);
+    return 0;
+}
+
+uint32_t bignum_bits(const struct bignum* a) {
+    return a->length ? 32 * a->length - __builtin_clz(a->limbs[a->length - 1]) : 0;
+}
+
+int bignum_pow(struct bignum_arena* arena, struct bignum* r, const struct bignum* a, uint32_t exponent) {
+    // Read before r is written: it may be a
+    int negative = a->negative && (exponent & 1);
+    if (exponent == 0 || (a->length == 1 && a->limbs[0] == 1)) {
+        int result = bignum_from_int(arena, r, 1);
+        r->negative = negative;
+        return result;
+    }
+    if (a->length == 0) {
+        return bignum_from_int(arena, r, 0);
+    }
+    // Fail at once rather than after squaring for a while
+    uint64_t bits = (uint64_t)(bignum_bits(a) - 1) * exponent;
+    if (bits / 32 >= arena->size) return BIGNUM_NO_MEMORY;
+
+    // Square and multiply from the top bit down, keeping only the latest
+    // power where it started
+    uint32_t mark = arena->used;
+    struct bignum power;
+    if (bignum_copy(arena, &power, a) < 0) return BIGNUM_NO_MEMORY;
+    power.negative = 0;
+    for (int bit = 30 - __builtin_clz(exponent); bit >= 0; bit--) {
+        if (bignum_mul(arena, &power, &power, &power) < 0 ||
+            ((exponent >> bit & 1) && bignum_mul(arena, &power, &power, a) < 0)) {
+            arena->used = mark;
+            return BIGNUM_NO_MEMORY;
+        }
+        power.negative = 0;
+        keep(arena, mark, &power);
+    }
+    power.negative = power.length ? negative : 0;
+    *r = power;
+    return 0;
+}
+
+// The product of lo..hi as a tree of halves, so the big multiplications
+// are between numbers of about the same size, where Karatsuba pays
+static int product(struct bignum_arena* arena, struct bignum* r, uint32_t lo, uint32_t hi) {
+    uint32_t mark = arena->used;
+    if (hi - lo < FACTORIAL_LEAF) {
+        uint32_t count = hi - lo + 1;
+        if (reserve(arena, count + 1) < 0) return BIGNUM_NO_MEMORY;
+        uint32_t* limbs = take(arena, count + 1);
+        uint32_t length = 1;
+        limbs[0] = 1;
+        for (uint32_t i = lo; i <= hi; i++) {
+            uint32_t carry = mul_1(limbs, limbs, length, i);
+            if (carry) limbs[length++] = carry;
+        }
+        finish(r, limbs, length, 0);
+        return 0;
+    }
+    uint32_t mid = lo + (hi - lo) / 2;
+    struct bignum left, right;
+    if (product(arena, &left, lo, mid) < 0 || product(arena, &right, mid + 1, hi) < 0 ||
+        bignum_mul(arena, r, &left, &right) < 0) {
+        arena->used = mark;
+        return BIGNUM_NO_MEMORY;
+    }
+    keep(arena, mark, r);
+    return 0;
+}
+
+int bignum_factorial(struct bignum_arena* arena, struct bignum* r, uint32_t n) {
+    if (n < 2) {
+        return bignum_from_int(arena, r, 1);
+    }
+    // n! < n^n, so n·log2(n) bits; fail at once if that is plainly too big
+    uint64_t bits = (uint64_t)n * (32 - __builtin_clz(n));
+    if (bits / 32 >= arena->size) return BIGNUM_NO_MEMORY;
+    return product(arena, r, 2, n);
+}
+
+int bignum_to_int(const struct bignum* a, int32_t* value) {
+    if (a->length > 1) return -1;
+    uint32_t magnitude = a->length ? a->limbs[0] : 0;
+    if (magnitude > (a->negative ? 0x80000000u : 0x7FFFFFFFu)) return -1;
+    *value = a->negative ? (int32_t)(0u - magnitude) : (int32_t)magnitude;
+    return 0;
+}
+
+// Decimal output
+
+// Exactly `width` digits of x, zero-padded, width a multiple of 9
+static void decimal_basecase(struct bignum_arena* arena, const uint32_t* x, uint32_t n, char* out,
+                             uint32_t width) {
+    uint32_t mark = arena->used;
+    uint32_t* t = take(arena, n);
+    memcpy(t, x, n * sizeof(uint32_t));
+    n = trimmed(t, n);
+    for (uint32_t end = width; end > 0; end -= DECIMAL_CHUNK_DIGITS) {
+        uint32_t chunk = n ? divrem_1(t, t, n, DECIMAL_CHUNK) : 0;
+        n = trimmed(t, n);
+        for (int i = 1; i <= DECIMAL_CHUNK_DIGITS; i++) {
+            out[end - i] = '0' + chunk % 10;
+            chunk /= 10;
+        }
+    }
+    arena->used = mark;
+}
+
+// Exactly 9·2^(k+1) digits of x < powers[k]^2, zero-padded: the digits of
+// x / powers[k], then of the remainder
+static void decimal_split(struct bignum_arena* arena, const uint32_t* x, uint32_t n, char* out, int k,
+                          const struct bignum* powers) {
+    uint32_t width = DECIMAL_CHUNK_DIGITS << (k + 1);
+    n = trimmed(x, n);
+    if (k < 0 || n <= DECIMAL_BASECASE_LIMBS) {
+        decimal_basecase(arena, x, n, out, width);
+        return;
+    }
+    const struct bignum* power = &powers[k];
+    if (n < power->length) {
+        memset(out, '0', width / 2);
+        decimal_split(arena, x, n, out + width / 2, k - 1, powers);
+        return;
+    }
+    uint32_t mark = arena->used;
+    uint32_t* quotient = take(arena, n - power->length + 1);
+    uint32_t* remainder = take(arena, power->length);
+    divrem(arena, quotient, remainder, x, n, power->limbs, power->length);
+    decimal_split(arena, quotient, n - power->length + 1, out, k - 1, powers);
+    decimal_split(arena, remainder, power->length, out + width / 2, k - 1, powers);
+    arena->used = mark;
+}
+
+int bignum_to_decimal(struct bignum_arena* arena, const struct bignum* a, char** text) {
+    uint32_t n = a->length;
+    if (reserve(arena, DECIMAL_SCRATCH(n)) < 0) return BIGNUM_NO_MEMORY;
+    // 32 bits are under 9.7 digits, so n + n/8 + 1 chunks of 9 hold any
+    // n limbs; the split below pads to twice the digits at most
+    uint32_t chunks = n + n / 8 + 1;
+    uint32_t capacity = 2 * chunks * DECIMAL_CHUNK_DIGITS + 2;
+    uint32_t start = arena->used;
+    char* out = (char*)take(arena, (capacity + 3) / 4);
+    char* digits = out + 1;             // Room for a '-'
+    uint32_t width;
+
+    if (n <= DECIMAL_BASECASE_LIMBS) {
+        width = chunks * DECIMAL_CHUNK_DIGITS;
+        decimal_basecase(arena, a->limbs, n, digits, width);
+    } else {
+        // Powers 10^(9·2^k), each the square of the last, until the square
+        // of the last is sure to be above |a|
+        struct bignum powers[32];
+        int count = 1;
+        uint32_t mark = arena->used;
+        bignum_from_int(arena, &powers[0], DECIMAL_CHUNK);
+        while (2 * (powers[count - 1].length - 1) < n) {
+            bignum_mul(arena, &powers[count], &powers[count - 1], &powers[count - 1]);
+            count++;
+        }
+        width = DECIMAL_CHUNK_DIGITS << count;
+        decimal_split(arena, a->limbs, n, digits, count - 1, powers);
+        arena->used = mark;
+    }
+
+    uint32_t skip = 0;
+    while (skip + 1 < width && digits[skip] == '0') skip++;
+    uint32_t length = 0;
+    if (a->negative) out[length++] = '-';
+    for (uint32_t i = skip; i < width; i++) {
+        out[length++] = digits[i];
+    }
+    out[length] = '\0';
+    arena->used = start + (length + 1 + 3) / 4;
+    *text = out;
+    return 0;
+}
@@ -0,0 +1,60 @@
+#ifndef BIGNUM_H
+#define BIGNUM_H
+
+#include <stdint.h>
+
+// Arbitrary-precision integers: a sign and a magnitude in 32-bit limbs,
+// least significant first. Limbs come from an arena, a bump allocator
+// over the caller's buffer that is rolled back to a mark instead of
+// freeing, so a calculation's temporaries all go at once.
+//
+// Multiplication is schoolbook below BIGNUM_KARATSUBA_LIMBS and Karatsuba
+// above. Division is Knuth's algorithm D below BIGNUM_DIVIDE_LIMBS and
+// Burnikel-Ziegler recursive division above, which does the work in
+// Karatsuba multiplications. Decimal output splits the number by powers
+// 10^(9*2^k) and converts the halves in turn, so it runs at the speed of
+// division rather than in quadratic time.
+#define BIGNUM_KARATSUBA_LIMBS 32
+#define BIGNUM_DIVIDE_LIMBS 48
+
+// Results below zero. Each operation checks up front that the arena can
+// hold its result and temporaries, so a failed one leaves it as it was.
+#define BIGNUM_NO_MEMORY -1
+#define BIGNUM_DIVIDE_BY_ZERO -2
+
+struct bignum {
+    uint32_t* limbs;
+    uint32_t length;                    // No zero limbs on top, so 0 for zero
+    int negative;
+};
+
+struct bignum_arena {
+    uint32_t* limbs;
+    uint32_t size;
+    uint32_t used;                      // A mark to release back to
+    uint32_t peak;
+};
+
+void bignum_arena_init(struct bignum_arena* arena, uint32_t* limbs, uint32_t size);
+void bignum_arena_release(struct bignum_arena* arena, uint32_t mark);
+
+// Each result is new, taken from the arena; it may be one of the operands
+int bignum_from_int(struct bignum_arena* arena, struct bignum* r, int32_t value);
+int bignum_copy(struct bignum_arena* arena, struct bignum* r, const struct bignum* a);
+int bignum_add(struct bignum_arena* arena, struct bignum* r, const struct bignum* a, const struct bignum* b);
+int bignum_sub(struct bignum_arena* arena, struct bignum* r, const struct bignum* a, const struct bignum* b);
+int bignum_mul(struct bignum_arena* arena, struct bignum* r, const struct bignum* a, const struct bignum* b);
+// Truncating, as C's / and %; either q or r may be NULL
+int bignum_divmod(struct bignum_arena* arena, struct bignum* q, struct bignum* r,
+                  const struct bignum* a, const struct bignum* b);
+int bignum_pow(struct bignum_arena* arena, struct bignum* r, const struct bignum* a, uint32_t exponent);
+int bignum_factorial(struct bignum_arena* arena, struct bignum* r, uint32_t n);
+// NUL-terminated decimal, '-' first if negative, in the arena
+int bignum_to_decimal(struct bignum_arena* arena, const struct bignum* a, char** text);
+
+// 0 with the value if it fits 32 bits, -1 if not
+int bignum_to_int(const struct bignum* a, int32_t* value);
+int bignum_compare(const struct bignum* a, const struct bignum* b);
+uint32_t bignum_bits(const struct bignum* a);  // Of the magnitude
+
+#endif
@@ -0,0 +1,45 @@
+#include "calendar.h"
+
+#define SECONDS_PER_DAY 86400u
+#define EPOCH_WEEKDAY 4                 // 1970-01-01 was a Thursday
+
+// Days between 1970-01-01 and a date, counting years from March so the
+// leap day comes last (after Howard Hinnant's days_from_civil). Every
+// intermediate stays positive for years from 1970 on.
+static uint32_t days_from_civil(int year, int month, int day) {
+    if (month <= 2) year--;
+    uint32_t era = year / 400;
+    uint32_t year_of_era = year - era * 400;
+    uint32_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    uint32_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+uint32_t date_to_seconds(const struct date_time* date) {
+    uint32_t days = days_from_civil(date->year, date->month, date->day);
+    return days * SECONDS_PER_DAY + date->hour * 3600 + date->minute * 60 + date->second;
+}
+
+void seconds_to_date(uint32_t seconds, struct date_time* date) {
+    uint32_t days = seconds / SECONDS_PER_DAY;
+    uint32_t rest = seconds % SECONDS_PER_DAY;
+    date->hour = rest / 3600;
+    date->minute = rest / 60 % 60;
+    date->second = rest % 60;
+    date->weekday = (days + EPOCH_WEEKDAY) % 7;
+
+    uint32_t shifted = days + 719468;   // Days since 0000-03-01
+    uint32_t era = shifted / 146097;
+    uint32_t day_of_era = shifted - era * 146097;
+    uint32_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    uint32_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    uint32_t month_index = (5 * day_of_year + 2) / 153;    // From March
+    date->day = day_of_year - (153 * month_index + 2) / 5 + 1;
+    date->month = month_index < 10 ? month_index + 3 : month_index - 9;
+    date->year = year_of_era + era * 400 + (date->month <= 2);
+}
+
+const char* weekday_name(int weekday) {
+    static const char* names[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    return weekday >= 0 && weekday < 7 ? names[weekday] : "???";
+}
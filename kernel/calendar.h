@@ -0,0 +1,23 @@
+#ifndef CALENDAR_H
+#define CALENDAR_H
+
+#include <stdint.h>
+
+// Civil dates in the proleptic Gregorian calendar and Unix time. Seconds
+// are kept in 32 bits, which lasts until 2106 and keeps the arithmetic in
+// 32-bit division (there is no libgcc in the kernel).
+struct date_time {
+    int year;                           // Full year, e.g. 2026
+    int month;                          // 1-12
+    int day;                            // 1-31
+    int hour;
+    int minute;
+    int second;
+    int weekday;                        // 0 is Sunday; set by seconds_to_date
+};
+
+uint32_t date_to_seconds(const struct date_time* date);    // From 1970, not before
+void seconds_to_date(uint32_t seconds, struct date_time* date);
+const char* weekday_name(int weekday);  // "Sun" to "Sat"
+
+#endif
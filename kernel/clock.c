@@ -0,0 +1,138 @@
+#include "clock.h"
+#include "cpu.h"
+#include "rtc.h"
+#include "../include/kernel.h"
+
+// PIT channel 2 is gated through the keyboard controller's port B and can be
+// polled without interrupts, which makes it a good calibration reference
+#define PIT_CHANNEL2 0x42
+#define PIT_COMMAND 0x43
+#define PORT_B 0x61
+#define PORT_B_GATE2 0x01
+#define PORT_B_SPEAKER 0x02
+#define PORT_B_OUT2 0x20
+
+#define CALIBRATE_MS 10
+#define CALIBRATE_RUNS 3
+
+#define NS_PER_SECOND 1000000000u
+
+static uint32_t tsc_khz = 0;
+static uint64_t boot_cycles;
+// ns = cycles * ns_mult >> ns_shift, with the largest shift that keeps
+// ns_mult in 32 bits
+static uint32_t ns_mult;
+static int ns_shift;
+static uint32_t boot_seconds;          // Wall clock when monotonic time was 0
+
+uint64_t udiv64_32(uint64_t dividend, uint32_t divisor) {
+    uint32_t high = dividend >> 32;
+    uint32_t low = dividend;
+    uint32_t quotient_high = high / divisor;
+    uint32_t remainder = high % divisor;
+    uint32_t quotient_low;
+    asm ("divl %3" : "=a"(quotient_low), "=d"(remainder) : "a"(low), "rm"(divisor), "d"(remainder));
+    return ((uint64_t)quotient_high << 32) | quotient_low;
+}
+
+// Count TSC cycles while PIT channel 2 counts down CALIBRATE_MS in mode 0
+static uint64_t calibration_run(void) {
+    uint32_t latch = PIT_FREQUENCY / (1000 / CALIBRATE_MS);
+    outb(PORT_B, (inb(PORT_B) & ~PORT_B_SPEAKER) | PORT_B_GATE2);
+    outb(PIT_COMMAND, 0xB0);            // Channel 2, lobyte/hibyte, mode 0
+    outb(PIT_CHANNEL2, latch & 0xFF);
+    outb(PIT_CHANNEL2, latch >> 8);
+
+    uint64_t start = rdtsc();
+    while (!(inb(PORT_B) & PORT_B_OUT2)) {
+    }
+    return rdtsc() - start;
+}
+
+// The read may wait out an RTC update; that time counts as elapsed
+static void seed_wall_clock(void) {
+    struct date_time now;
+    if (rtc_read(&now) < 0) {
+        return;
+    }
+    uint32_t elapsed = (uint32_t)udiv64_32(clock_monotonic_ns(), NS_PER_SECOND);
+    boot_seconds = date_to_seconds(&now) - elapsed;
+}
+
+// Anything that stalls a run (an SMI, or the host under a VM) only makes it
+// look longer, so the shortest run is the best one
+void init_clock(void) {
+    if (!cpu_has(CPU_FEATURE_TSC)) {
+        return;
+    }
+    uint64_t cycles = calibration_run();
+    for (int i = 1; i < CALIBRATE_RUNS; i++) {
+        uint64_t run = calibration_run();
+        if (run < cycles) cycles = run;
+    }
+    tsc_khz = (uint32_t)udiv64_32(cycles, CALIBRATE_MS);
+    if (tsc_khz == 0) {
+        return;
+    }
+    ns_shift = 32;
+    while (udiv64_32((uint64_t)1000000 << ns_shift, tsc_khz) >> 32) {
+        ns_shift--;
+    }
+    ns_mult = (uint32_t)udiv64_32((uint64_t)1000000 << ns_shift, tsc_khz);
+    boot_cycles = rdtsc();
+    seed_wall_clock();
+}
+
+uint64_t clock_monotonic_ns(void) {
+    if (tsc_khz == 0) {
+        return 0;
+    }
+    uint64_t cycles = rdtsc() - boot_cycles;
+    uint64_t low = (uint64_t)(uint32_t)cycles * ns_mult;
+    uint64_t high = (uint64_t)(uint32_t)(cycles >> 32) * ns_mult;
+    return (low >> ns_shift) + (high << (32 - ns_shift));
+}
+
+uint32_t clock_realtime(void) {
+    if (tsc_khz == 0) {
+        struct date_time now;
+        return rtc_read(&now) == 0 ? date_to_seconds(&now) : 0;
+    }
+    if (boot_seconds == 0) {
+        return 0;
+    }
+    return boot_seconds + (uint32_t)udiv64_32(clock_monotonic_ns(), NS_PER_SECOND);
+}
+
+uint32_t clock_tsc_khz(void) {
+    return tsc_khz;
+}
+
+uint64_t clock_cycles_to_us(uint64_t cycles) {
+    if (tsc_khz < 1000) {
+        return 0;
+    }
+    return udiv64_32(cycles, tsc_khz / 1000);
+}
+
+void clock_delay_us(uint32_t us) {
+    uint64_t cycles = udiv64_32((uint64_t)us * tsc_khz, 1000);
+    uint64_t start = rdtsc();
+    while (rdtsc() - start < cycles) {
+        asm volatile ("pause");
+    }
+}
+
+// Throughput of `bytes` handled in `cycles`, in KB (1000 bytes) per second
+uint32_t clock_kb_per_sec(uint32_t bytes, uint64_t cycles) {
+    if (tsc_khz == 0 || cycles == 0) {
+        return 0;
+    }
+    // bytes * cycles-per-ms / cycles = bytes per ms = KB/s
+    uint64_t rate = (uint64_t)bytes * tsc_khz;
+    while (cycles >> 32) {
+        cycles >>= 1;
+        rate >>= 1;
+    }
+    return (uint32_t)udiv64_32(rate, (uint32_t)cycles);
+}
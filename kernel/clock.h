@@ -0,0 +1,32 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+#define PIT_FREQUENCY 1193182
+
+static inline uint64_t rdtsc(void) {
+    uint32_t low, high;
+    asm volatile ("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+// Cycle counter calibrated against the PIT at boot
+void init_clock(void);
+uint32_t clock_tsc_khz(void);               // 0 when there is no usable TSC
+uint64_t clock_cycles_to_us(uint64_t cycles);
+void clock_delay_us(uint32_t us);           // Busy-waits; no delay without a TSC
+uint32_t clock_kb_per_sec(uint32_t bytes, uint64_t cycles);  // 0 when unknown
+
+// Nanoseconds since init_clock: a TSC read, two multiplies and shifts, no
+// port I/O or division. 0 without a TSC.
+uint64_t clock_monotonic_ns(void);
+// Wall clock in Unix seconds, in whatever zone the RTC keeps (UTC under
+// QEMU): read from the RTC once at boot and carried on by the TSC, or read
+// from the RTC every time without one. 0 if the RTC never settled.
+uint32_t clock_realtime(void);
+
+// 64-bit by 32-bit division (there is no libgcc in the kernel)
+uint64_t udiv64_32(uint64_t dividend, uint32_t divisor);
+
+#endif
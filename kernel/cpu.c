@@ -0,0 +1,80 @@
+#include "cpu.h"
+#include "../include/kernel.h"
+
+#define CR0_MP (1u << 1)
+#define CR0_EM (1u << 2)
+#define CR4_OSFXSR (1u << 9)
+#define CR4_OSXMMEXCPT (1u << 10)
+#define EFLAGS_ID (1u << 21)
+
+static uint64_t features = 0;
+static char vendor[13] = "unknown";
+
+// CPUID exists when the ID flag in EFLAGS can be toggled
+static int cpuid_supported(void) {
+    uint32_t before, after;
+    asm volatile ("pushfl\n\t"
+                  "popl %0\n\t"
+                  "movl %0, %1\n\t"
+                  "xorl %2, %1\n\t"
+                  "pushl %1\n\t"
+                  "popfl\n\t"
+                  "pushfl\n\t"
+                  "popl %1\n\t"
+                  "pushl %0\n\t"
+                  "popfl"
+                  : "=&r"(before), "=&r"(after) : "i"(EFLAGS_ID));
+    return ((before ^ after) & EFLAGS_ID) != 0;
+}
+
+// SSE instructions fault until the OS says it saves their state
+static void enable_sse(void) {
+    uint32_t cr0, cr4;
+    asm volatile ("mov %%cr0, %0" : "=r"(cr0));
+    cr0 &= ~CR0_EM;
+    cr0 |= CR0_MP;
+    asm volatile ("mov %0, %%cr0" : : "r"(cr0));
+    asm volatile ("mov %%cr4, %0" : "=r"(cr4));
+    cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+    asm volatile ("mov %0, %%cr4" : : "r"(cr4));
+}
+
+void init_cpu(void) {
+    if (!cpuid_supported()) {
+        return;
+    }
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(0, &eax, &ebx, &ecx, &edx);
+    memcpy(vendor, &ebx, 4);
+    memcpy(vendor + 4, &edx, 4);
+    memcpy(vendor + 8, &ecx, 4);
+    vendor[12] = '\0';
+    if (eax >= 1) {
+        cpuid(1, &eax, &ebx, &ecx, &edx);
+        features = edx | ((uint64_t)ecx << 32);
+    }
+    if (cpu_has(CPU_FEATURE_FXSR) && cpu_has(CPU_FEATURE_SSE)) {
+        enable_sse();
+    } else {
+        features &= ~(uint64_t)(CPU_FEATURE_SSE | CPU_FEATURE_SSE2) & ~CPU_FEATURE_SSE42;
+    }
+}
+
+// Features were detected on the boot CPU; the others only need SSE turned on
+void init_cpu_ap(void) {
+    if (cpu_has(CPU_FEATURE_SSE)) {
+        enable_sse();
+    }
+}
+
+uint64_t cpu_features(void) {
+    return features;
+}
+
+int cpu_has(uint64_t feature) {
+    return (features & feature) == feature;
+}
+
+const char* cpu_vendor(void) {
+    return vendor;
+}
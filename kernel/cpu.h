@@ -0,0 +1,27 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+
+// CPUID leaf 1 feature bits (EDX)
+#define CPU_FEATURE_TSC   (1u << 4)
+#define CPU_FEATURE_APIC  (1u << 9)
+#define CPU_FEATURE_FXSR  (1u << 24)
+#define CPU_FEATURE_SSE   (1u << 25)
+#define CPU_FEATURE_SSE2  (1u << 26)
+
+// CPUID leaf 1 feature bits (ECX), kept above bit 32 in cpu_features()
+#define CPU_FEATURE_SSE42 (1ull << (32 + 20))
+
+static inline void cpuid(uint32_t leaf, uint32_t* eax, uint32_t* ebx, uint32_t* ecx, uint32_t* edx) {
+    asm volatile ("cpuid" : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx) : "a"(leaf), "c"(0));
+}
+
+// Detect the CPU and turn on SSE when it is there
+void init_cpu(void);
+void init_cpu_ap(void);                 // The same setup on an application processor
+uint64_t cpu_features(void);
+int cpu_has(uint64_t feature);
+const char* cpu_vendor(void);
+
+#endif
@@ -0,0 +1,74 @@
+#include "crc32c.h"
+#include "cpu.h"
+#include "../include/kernel.h"
+
+#define CRC32C_POLY 0x82F63B78          // Reflected Castagnoli polynomial
+
+static uint32_t table[8][256];
+static int use_sse42 = 0;
+
+static uint32_t read32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// SSE4.2 has a crc32 instruction for exactly this polynomial
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const uint8_t* p, uint32_t size) {
+    while (size >= 4) {
+        crc = __builtin_ia32_crc32si(crc, read32(p));
+        p += 4;
+        size -= 4;
+    }
+    while (size--) {
+        crc = __builtin_ia32_crc32qi(crc, *p++);
+    }
+    return crc;
+}
+
+// Slicing-by-8: eight table lookups retire eight bytes per iteration
+static uint32_t crc32c_sliced(uint32_t crc, const uint8_t* p, uint32_t size) {
+    while (size >= 8) {
+        uint32_t low = crc ^ read32(p);
+        uint32_t high = read32(p + 4);
+        crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^
+              table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+              table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^
+              table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+        p += 8;
+        size -= 8;
+    }
+    while (size--) {
+        crc = table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+void init_crc32c(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (crc & 1 ? CRC32C_POLY : 0);
+        }
+        table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+        }
+    }
+    use_sse42 = cpu_has(CPU_FEATURE_SSE42);
+}
+
+uint32_t crc32c(uint32_t crc, const void* data, uint32_t size) {
+    crc = ~crc;
+    if (use_sse42) {
+        crc = crc32c_sse42(crc, data, size);
+    } else {
+        crc = crc32c_sliced(crc, data, size);
+    }
+    return ~crc;
+}
+
+const char* crc32c_method(void) {
+    return use_sse42 ? "SSE4.2 crc32" : "slicing-by-8";
+}
@@ -0,0 +1,11 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stdint.h>
+
+// CRC-32C (Castagnoli). Pass 0 to start, or a previous result to continue.
+void init_crc32c(void);
+uint32_t crc32c(uint32_t crc, const void* data, uint32_t size);
+const char* crc32c_method(void);
+
+#endif
@@ -0,0 +1,203 @@
+#include "../include/kernel.h"
+#include "interrupts.h"
+#include "ksyms.h"
+#include "apic.h"
+
+// 8259 PIC ports
+#define PIC1_COMMAND 0x20
+#define PIC1_DATA    0x21
+#define PIC2_COMMAND 0xA0
+#define PIC2_DATA    0xA1
+#define PIC_EOI      0x20
+
+// Kernel code segment selector, the same in the bootloader's GDT and every CPU's
+#define KERNEL_CODE_SELECTOR 0x08
+#define IDT_GATE_INTERRUPT 0x8E
+
+#define IDT_ENTRIES 256
+#define STUB_COUNT (LOCAL_VECTOR_BASE + LOCAL_VECTOR_COUNT)
+
+struct idt_entry {
+    uint16_t offset_low;
+    uint16_t selector;
+    uint8_t zero;
+    uint8_t type_attr;
+    uint16_t offset_high;
+} __attribute__((packed));
+
+struct idt_pointer {
+    uint16_t limit;
+    uint32_t base;
+} __attribute__((packed));
+
+static struct idt_entry idt[IDT_ENTRIES];
+static irq_handler_t irq_handlers[IRQ_COUNT];
+static irq_handler_t vector_handlers[LOCAL_VECTOR_COUNT];
+
+// Entry stubs: exceptions 8, 10-14, 17, 21, 29 and 30 push an error code,
+// every other vector pushes a dummy 0 so the frame layout is uniform.
+void interrupt_dispatch(struct interrupt_frame* frame);
+extern uint32_t isr_stub_table[STUB_COUNT];
+
+asm(
+    ".text\n"
+    ".irp n, 0,1,2,3,4,5,6,7,9,15,16,18,19,20,22,23,24,25,26,27,28,31,"
+    "32,33,34,35,36,37,38,39,40,41,42,43,44,45,46,47,"
+    "48,49,50,51,52,53,54,55,56,57,58,59,60,61,62,63\n"
+    "isr_stub_\\n:\n"
+    "    pushl $0\n"
+    "    pushl $\\n\n"
+    "    jmp interrupt_common\n"
+    ".endr\n"
+    ".irp n, 8,10,11,12,13,14,17,21,29,30\n"
+    "isr_stub_\\n:\n"
+    "    pushl $\\n\n"
+    "    jmp interrupt_common\n"
+    ".endr\n"
+    "interrupt_common:\n"
+    "    pusha\n"
+    "    pushl %ds\n"
+    "    pushl %es\n"
+    "    pushl %fs\n"
+    "    pushl %gs\n"
+    "    movw $0x10, %ax\n"
+    "    movw %ax, %ds\n"
+    "    movw %ax, %es\n"
+    "    cld\n"
+    "    pushl %esp\n"
+    "    call interrupt_dispatch\n"
+    "    addl $4, %esp\n"
+    "    popl %gs\n"
+    "    popl %fs\n"
+    "    popl %es\n"
+    "    popl %ds\n"
+    "    popa\n"
+    "    addl $8, %esp\n"
+    "    iret\n"
+    ".section .rodata\n"
+    ".align 4\n"
+    ".global isr_stub_table\n"
+    "isr_stub_table:\n"
+    ".irp n, 0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,"
+    "24,25,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40,41,42,43,44,45,46,47,"
+    "48,49,50,51,52,53,54,55,56,57,58,59,60,61,62,63\n"
+    "    .long isr_stub_\\n\n"
+    ".endr\n"
+    ".text\n"
+);
+
+static void idt_set_gate(int vector, uint32_t handler) {
+    idt[vector].offset_low = handler & 0xFFFF;
+    idt[vector].selector = KERNEL_CODE_SELECTOR;
+    idt[vector].zero = 0;
+    idt[vector].type_attr = IDT_GATE_INTERRUPT;
+    idt[vector].offset_high = (handler >> 16) & 0xFFFF;
+}
+
+// Move IRQ 0-15 to vectors 32-47 so they don't collide with CPU exceptions
+static void pic_remap(void) {
+    outb(PIC1_COMMAND, 0x11); io_wait();   // ICW1: init, expect ICW4
+    outb(PIC2_COMMAND, 0x11); io_wait();
+    outb(PIC1_DATA, IRQ_BASE); io_wait();  // ICW2: vector offsets
+    outb(PIC2_DATA, IRQ_BASE + 8); io_wait();
+    outb(PIC1_DATA, 0x04); io_wait();      // ICW3: slave on IRQ2
+    outb(PIC2_DATA, 0x02); io_wait();
+    outb(PIC1_DATA, 0x01); io_wait();      // ICW4: 8086 mode
+    outb(PIC2_DATA, 0x01); io_wait();
+
+    // Mask everything except the cascade line; drivers unmask what they use
+    outb(PIC1_DATA, 0xFB);
+    outb(PIC2_DATA, 0xFF);
+}
+
+static void pic_send_eoi(int irq) {
+    if (irq >= 8) {
+        outb(PIC2_COMMAND, PIC_EOI);
+    }
+    outb(PIC1_COMMAND, PIC_EOI);
+}
+
+void irq_unmask(int irq) {
+    if (irq < 0 || irq >= IRQ_COUNT) return;
+    uint16_t port = irq < 8 ? PIC1_DATA : PIC2_DATA;
+    outb(port, inb(port) & ~(1 << (irq % 8)));
+}
+
+void irq_mask(int irq) {
+    if (irq < 0 || irq >= IRQ_COUNT) return;
+    uint16_t port = irq < 8 ? PIC1_DATA : PIC2_DATA;
+    outb(port, inb(port) | (1 << (irq % 8)));
+}
+
+void irq_register_handler(int irq, irq_handler_t handler) {
+    if (irq < 0 || irq >= IRQ_COUNT) return;
+    irq_handlers[irq] = handler;
+}
+
+void vector_register_handler(int vector, irq_handler_t handler) {
+    if (vector < LOCAL_VECTOR_BASE || vector >= LOCAL_VECTOR_BASE + LOCAL_VECTOR_COUNT) return;
+    vector_handlers[vector - LOCAL_VECTOR_BASE] = handler;
+}
+
+// Common C entry point for every vector
+void interrupt_dispatch(struct interrupt_frame* frame) {
+    if (frame->int_no < IRQ_BASE) {
+        print_string("\nCPU exception ");
+        print_int(frame->int_no);
+        print_string(" at ");
+        ksym_print(frame->eip);
+        print_string(", error code ");
+        print_int((int)frame->err_code);
+        print_string("\nSystem halted.\n");
+        while (1) { asm volatile("cli; hlt"); }
+    }
+
+    if (frame->int_no >= LOCAL_VECTOR_BASE) {
+        // Spurious interrupts are not in service and take no EOI
+        if (frame->int_no == VECTOR_SPURIOUS) return;
+        irq_handler_t handler = vector_handlers[frame->int_no - LOCAL_VECTOR_BASE];
+        if (handler) {
+            handler(frame);
+        }
+        lapic_eoi();
+        return;
+    }
+
+    int irq = frame->int_no - IRQ_BASE;
+    if (irq_handlers[irq]) {
+        irq_handlers[irq](frame);
+    }
+    pic_send_eoi(irq);
+}
+
+// Every CPU shares the one IDT
+void load_idt(void) {
+    struct idt_pointer idtp;
+    idtp.limit = sizeof(idt) - 1;
+    idtp.base = (uint32_t)idt;
+    asm volatile ("lidt %0" : : "m"(idtp));
+}
+
+// Initialize the IDT and PIC, then enable interrupts
+void init_interrupts(void) {
+    for (int i = 0; i < IDT_ENTRIES; i++) {
+        idt[i].offset_low = 0;
+        idt[i].selector = 0;
+        idt[i].zero = 0;
+        idt[i].type_attr = 0;
+        idt[i].offset_high = 0;
+    }
+    for (int i = 0; i < STUB_COUNT; i++) {
+        idt_set_gate(i, isr_stub_table[i]);
+    }
+    for (int i = 0; i < IRQ_COUNT; i++) {
+        irq_handlers[i] = NULL;
+    }
+    for (int i = 0; i < LOCAL_VECTOR_COUNT; i++) {
+        vector_handlers[i] = NULL;
+    }
+
+    pic_remap();
+    load_idt();
+    interrupts_enable();
+}
@@ -0,0 +1,59 @@
+#ifndef INTERRUPTS_H
+#define INTERRUPTS_H
+
+#include <stdint.h>
+
+// PIC vector offsets (IRQ 0-15 are remapped above the CPU exceptions)
+#define IRQ_BASE 32
+#define IRQ_COUNT 16
+
+// Legacy IRQ lines used by the kernel
+#define IRQ_TIMER 0
+#define IRQ_KEYBOARD 1
+#define IRQ_ATA_PRIMARY 14
+#define IRQ_ATA_SECONDARY 15
+
+// Vectors above the PIC's are raised by the local APIC
+#define LOCAL_VECTOR_BASE (IRQ_BASE + IRQ_COUNT)
+#define LOCAL_VECTOR_COUNT 16
+#define VECTOR_APIC_TIMER LOCAL_VECTOR_BASE
+#define VECTOR_WAKEUP (LOCAL_VECTOR_BASE + 1)      // IPI to an idle CPU with work queued
+#define VECTOR_PROFILE (LOCAL_VECTOR_BASE + 2)     // IPI to take a profiler sample
+#define VECTOR_SPURIOUS (LOCAL_VECTOR_BASE + 15)   // Low four bits set, as older APICs need
+
+// Register state pushed by the interrupt entry stubs
+struct interrupt_frame {
+    uint32_t gs, fs, es, ds;
+    uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax;
+    uint32_t int_no, err_code;
+    uint32_t eip, cs, eflags;
+};
+
+typedef void (*irq_handler_t)(struct interrupt_frame* frame);
+
+// Interrupt setup
+void init_interrupts(void);
+void irq_register_handler(int irq, irq_handler_t handler);
+void irq_unmask(int irq);
+void irq_mask(int irq);
+void vector_register_handler(int vector, irq_handler_t handler);  // Local APIC vectors
+void load_idt(void);                    // On each application processor
+
+static inline void interrupts_enable(void) {
+    asm volatile ("sti");
+}
+static inline void interrupts_disable(void) {
+    asm volatile ("cli");
+}
+
+// Disable interrupts, returning the flags for interrupts_restore
+static inline uint32_t interrupts_save(void) {
+    uint32_t flags;
+    asm volatile ("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+static inline void interrupts_restore(uint32_t flags) {
+    asm volatile ("push %0; popf" :: "r"(flags) : "memory", "cc");
+}
+
+#endif
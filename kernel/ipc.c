@@ -0,0 +1,148 @@
+#include "ipc.h"
+#include "page.h"
+#include "spinlock.h"
+#include "lockstat.h"
+#include "../include/kernel.h"
+
+// head and tail run freely and are reduced modulo IPC_QUEUE_SIZE, as in
+// struct pipe, so queued = head - tail across wrap
+struct ipc_port {
+    spinlock_t lock;
+    int open;
+    struct ipc_message queue[IPC_QUEUE_SIZE];
+    uint32_t head;                      // Next slot to fill
+    uint32_t tail;                      // Next slot to take
+    struct lock_stats stats;
+};
+
+static struct ipc_port ports[IPC_MAX_PORTS];
+static spinlock_t ports_lock = SPINLOCK_INIT;   // Opening and closing ports
+
+static struct ipc_port* get_port(int port) {
+    if (port < 0 || port >= IPC_MAX_PORTS || !ports[port].open) {
+        return NULL;
+    }
+    return &ports[port];
+}
+
+int ipc_port_create(void) {
+    int id = IPC_NO_PORT;
+    uint32_t flags = spin_lock_irqsave(&ports_lock);
+    for (int i = 0; i < IPC_MAX_PORTS; i++) {
+        if (!ports[i].open) {
+            id = i;
+            break;
+        }
+    }
+    if (id != IPC_NO_PORT) {
+        struct ipc_port* port = &ports[id];
+        spin_lock_init(&port->lock, &port->stats);
+        lockstat_register(&port->stats, "ipc_port", id, LOCK_SPIN);
+        port->head = 0;
+        port->tail = 0;
+        port->open = 1;
+    }
+    spin_unlock_irqrestore(&ports_lock, flags);
+    return id;
+}
+
+void ipc_port_destroy(int id) {
+    struct ipc_port* port = get_port(id);
+    if (port == NULL) {
+        return;
+    }
+    uint32_t flags = spin_lock_irqsave(&ports_lock);
+    spin_lock(&port->lock);
+    port->open = 0;
+    while (port->tail != port->head) {
+        struct ipc_message* msg = &port->queue[port->tail++ & (IPC_QUEUE_SIZE - 1)];
+        if (msg->page != PAGE_NONE) {
+            page_free(msg->page, PAGE_OWNER_IN_TRANSIT);
+        }
+    }
+    spin_unlock(&port->lock);
+    spin_unlock_irqrestore(&ports_lock, flags);
+}
+
+// Wait, with the port unlocked meanwhile, until it has room to send into
+// or a message to receive; returns 0 with the lock held, or an error with
+// it dropped
+static int wait_for(struct ipc_port* port, int sending, int flags, uint32_t* irq) {
+    while (1) {
+        if (!port->open) {
+            spin_unlock_irqrestore(&port->lock, *irq);
+            return IPC_NO_PORT;
+        }
+        uint32_t queued = port->head - port->tail;
+        if (sending ? queued < IPC_QUEUE_SIZE : queued > 0) {
+            return 0;
+        }
+        spin_unlock_irqrestore(&port->lock, *irq);
+        if (flags & IPC_NONBLOCK) {
+            return IPC_AGAIN;
+        }
+        asm volatile ("pause");
+        *irq = spin_lock_irqsave(&port->lock);
+    }
+}
+
+int ipc_send(int id, const struct ipc_message* msg, int flags) {
+    struct ipc_port* port = get_port(id);
+    if (port == NULL) {
+        return IPC_NO_PORT;
+    }
+    if (msg->size > (msg->page == PAGE_NONE ? IPC_INLINE_SIZE : PAGE_SIZE)) {
+        return IPC_TOO_BIG;
+    }
+    uint32_t irq = spin_lock_irqsave(&port->lock);
+    int result = wait_for(port, 1, flags, &irq);
+    if (result < 0) {
+        return result;
+    }
+    if (msg->page != PAGE_NONE && page_transfer(msg->page, msg->sender, PAGE_OWNER_IN_TRANSIT) < 0) {
+        spin_unlock_irqrestore(&port->lock, irq);
+        return IPC_NOT_OWNER;
+    }
+    // Only the header and the inline bytes in use are copied
+    struct ipc_message* slot = &port->queue[port->head & (IPC_QUEUE_SIZE - 1)];
+    slot->sender = msg->sender;
+    slot->tag = msg->tag;
+    slot->size = msg->size;
+    slot->page = msg->page;
+    if (msg->page == PAGE_NONE) {
+        memcpy(slot->data, msg->data, msg->size);
+    }
+    port->head++;
+    spin_unlock_irqrestore(&port->lock, irq);
+    return 0;
+}
+
+int ipc_receive(int id, struct ipc_message* msg, int receiver, int flags) {
+    struct ipc_port* port = get_port(id);
+    if (port == NULL) {
+        return IPC_NO_PORT;
+    }
+    uint32_t irq = spin_lock_irqsave(&port->lock);
+    int result = wait_for(port, 0, flags, &irq);
+    if (result < 0) {
+        return result;
+    }
+    struct ipc_message* slot = &port->queue[port->tail & (IPC_QUEUE_SIZE - 1)];
+    msg->sender = slot->sender;
+    msg->tag = slot->tag;
+    msg->size = slot->size;
+    msg->page = slot->page;
+    if (slot->page == PAGE_NONE) {
+        memcpy(msg->data, slot->data, slot->size);
+    } else {
+        page_transfer(slot->page, PAGE_OWNER_IN_TRANSIT, receiver);
+    }
+    port->tail++;
+    spin_unlock_irqrestore(&port->lock, irq);
+    return 0;
+}
+
+int ipc_queued(int id) {
+    struct ipc_port* port = get_port(id);
+    return port ? (int)(port->head - port->tail) : 0;
+}
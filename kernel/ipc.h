@@ -0,0 +1,41 @@
+#ifndef IPC_H
+#define IPC_H
+
+#include <stdint.h>
+
+// Message ports: bounded FIFO queues of fixed-size messages. Small
+// payloads travel inline and are copied in and out; bigger ones travel as
+// a page from the page pool, which the sender must own and the receiver
+// owns afterwards (and frees), so the payload itself is never copied.
+//
+// Sending to a full port and receiving from an empty one wait until the
+// other side, on another CPU, makes room or sends; IPC_NONBLOCK returns
+// IPC_AGAIN instead, and is what interrupt handlers must use.
+#define IPC_MAX_PORTS 16
+#define IPC_QUEUE_SIZE 16               // Messages per port, a power of two
+#define IPC_INLINE_SIZE 52              // Keeps a message at 64 bytes
+#define IPC_KERNEL -1                   // Sender or receiver id for kernel code
+
+#define IPC_NONBLOCK 0x1
+
+// Results below zero
+#define IPC_NO_PORT -1
+#define IPC_AGAIN -2                    // Full or empty, with IPC_NONBLOCK
+#define IPC_TOO_BIG -3
+#define IPC_NOT_OWNER -4                // The sender does not own the page
+
+struct ipc_message {
+    int sender;                         // pid or IPC_KERNEL
+    uint32_t tag;                       // Free for the protocol
+    uint16_t size;                      // Inline bytes, or bytes used in the page
+    int16_t page;                       // Page passed along, PAGE_NONE if inline
+    uint8_t data[IPC_INLINE_SIZE];
+};
+
+int ipc_port_create(void);              // Port id, or IPC_NO_PORT when all are in use
+void ipc_port_destroy(int port);        // Frees the pages still queued
+int ipc_send(int port, const struct ipc_message* msg, int flags);
+int ipc_receive(int port, struct ipc_message* msg, int receiver, int flags);
+int ipc_queued(int port);
+
+#endif
@@ -4,6 +4,20 @@
 #include "../process/process.h"
 #include "../shell/shell.h"
 #include "../fs/fs.h"
+#include "interrupts.h"
+#include "cpu.h"
+#include "smp.h"
+#include "spinlock.h"
+#include "lockstat.h"
+#include "clock.h"
+#include "crc32c.h"
+#include "page.h"
+#include "timer.h"
+#include "../drivers/pci.h"
+#include "../drivers/serial.h"
+#include "../drivers/ata.h"
+#include "../drivers/virtio_blk.h"
+#include "../fs/bcache.h"
 #include <stddef.h>
 
 // Video memory constants
@@ -19,9 +33,14 @@ static int cursor_x = 0;
 static int cursor_y = 0;
 static int shift_pressed = 0;  // Track shift key state
 static uint8_t current_text_color = VGA_WHITE_ON_BLACK; // 0x07, white on black
+static output_sink_t output_sinks[MAX_CPUS];  // Set while a CPU's output is redirected
+static struct lock_stats console_stats;
+static spinlock_t console_lock = SPINLOCK_INIT_STATS(&console_stats);   // The screen and cursor
 
 // Function declarations (only for static functions)
 static void display_boot_logo(void);
+static void put_char(char c);
+static void clear_screen_locked(void);
 
 // Keyboard ports
 #define KEYBOARD_DATA_PORT 0x60
@@ -30,6 +49,9 @@ static void display_boot_logo(void);
 // QEMU/Bochs shutdown ports
 #define QEMU_SHUTDOWN_PORT 0x604
 #define BOCHS_SHUTDOWN_PORT 0x8900
+// QEMU's isa-debug-exit device (-device isa-debug-exit,iobase=0xf4,iosize=0x04)
+// exits with status (value << 1) | 1
+#define QEMU_DEBUG_EXIT_PORT 0xF4
 
 // Keyboard scancodes
 #define SCANCODE_PAGE_UP 0x49
@@ -92,8 +114,20 @@ static void scroll_screen() {
     }
 }
 
+output_sink_t set_output_sink(output_sink_t sink) {
+    output_sink_t previous = output_sinks[cpu_id()];
+    output_sinks[cpu_id()] = sink;
+    return previous;
+}
+
 // Print string to screen
 void print_string(const char* str) {
+    output_sink_t sink = output_sinks[cpu_id()];
+    if (sink) {
+        while (*str) sink(*str++);
+        return;
+    }
+    uint32_t flags = spin_lock_irqsave(&console_lock);
     for(int i = 0; str[i] != '\0'; i++) {
         if(str[i] == '\n') {
             cursor_x = 0;
@@ -106,7 +140,10 @@ void print_string(const char* str) {
             continue;
         }
         if(str[i] == '\b') {
-            backspace();
+            // What backspace() does, without taking the lock again
+            put_char('\b');
+            put_char(' ');
+            put_char('\b');
             continue;
         }
         if(cursor_x >= VGA_WIDTH) {
@@ -122,11 +159,15 @@ void print_string(const char* str) {
         cursor_x++;
         update_cursor();
     }
+    spin_unlock_irqrestore(&console_lock, flags);
 }
 
 char getchar(void) {
     static int extended = 0;
     while(1) {
+        if(serial_received()) {
+            return serial_read_char();
+        }
         if((inb(KEYBOARD_STATUS_PORT) & 1) != 0) {
             uint8_t scancode = inb(KEYBOARD_DATA_PORT);
             if(scancode == SCANCODE_EXTENDED) {
@@ -194,6 +235,15 @@ int strcmp(const char* s1, const char* s2) {
     return *(const unsigned char*)s1 - *(const unsigned char*)s2;
 }
 
+int strncmp(const char* s1, const char* s2, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (s1[i] != s2[i] || s1[i] == '\0') {
+            return (unsigned char)s1[i] - (unsigned char)s2[i];
+        }
+    }
+    return 0;
+}
+
 char* strcpy(char* dest, const char* src) {
     char* d = dest;
     while ((*d++ = *src++) != '\0');
@@ -217,6 +267,12 @@ size_t strlen(const char* str) {
     return len;
 }
 
+// Boot logo animation timing
+#define BOOT_CHAR_DELAY_MS 5
+#define BOOT_LINE_DELAY_MS 20
+#define BOOT_DOT_DELAY_MS 300
+#define BOOT_FINAL_DELAY_MS 500
+
 static void display_boot_logo(void) {
     clear_screen();
     
@@ -242,12 +298,10 @@ static void display_boot_logo(void) {
         for(int j = 0; line[j] != '\0'; j++) {
             char str[2] = {line[j], '\0'};
             print_string(str);
-            // Increased character delay
-            for(volatile int k = 0; k < 5000000; k++) {}
+            timer_sleep_ms(BOOT_CHAR_DELAY_MS);
         }
         
-        // Increased delay between lines
-        for(volatile int j = 0; j < 20000000; j++) {}
+        timer_sleep_ms(BOOT_LINE_DELAY_MS);
     }
     
     // Add loading dots animation
@@ -256,22 +310,42 @@ static void display_boot_logo(void) {
     
     // Animate three dots with increased delay
     for(int dots = 0; dots < 3; dots++) {
-        for(volatile int i = 0; i < 50000000; i++) {}  // Increased delay before each dot
+        timer_sleep_ms(BOOT_DOT_DELAY_MS);
         print_string(".");
     }
     
     // Final delay showing complete logo
-    for(volatile int i = 0; i < 80000000; i++) {}  // Increased final delay
+    timer_sleep_ms(BOOT_FINAL_DELAY_MS);
 }
 
+// Linker script symbols bounding the uninitialized data
+extern char __bss_start[];
+extern char __bss_end[];
+
 // Kernel entry point
 void __attribute__((section(".text.boot"))) kmain(void) {
+    // The bootloader only copies the file image, so zero .bss ourselves
+    memset(__bss_start, 0, __bss_end - __bss_start);
+    init_boot_cpu();   // Per-CPU segment before anything asks for cpu_id()
+
     // Initialize hardware
     init_screen();
+    init_serial();     // COM1 for machine-readable output
+    init_cpu();        // Detect CPU features and enable SSE
+    init_clock();      // Calibrate the TSC against the PIT
+    init_crc32c();     // Pick the CRC-32C implementation
     init_keyboard();
+    init_interrupts();
+    init_pci();
+    init_ata();
+    init_virtio_blk();
     
     // Initialize subsystems
     init_scheduler();  // Initialize process scheduler
+    init_pages();      // Page pool for IPC payloads
+    init_smp();        // Start the other CPUs once their run queues exist
+    init_timers();     // Deadline timer for the boot CPU's timers
+    init_bcache();     // Initialize block buffer cache
     init_fs();        // Initialize file system
     
     // Display boot logo
@@ -290,8 +364,9 @@ void __attribute__((section(".text.boot"))) kmain(void) {
     }
 }
 
-void shutdown(void) {
+void shutdown(int status) {
     asm volatile("cli"); // Disable interrupts
+    outb(QEMU_DEBUG_EXIT_PORT, (uint8_t)status);
     outw(QEMU_SHUTDOWN_PORT, 0x2000);
     outw(BOCHS_SHUTDOWN_PORT, 0x8900);
     print_string("Failed to shutdown. System halted.\n");
@@ -309,11 +384,23 @@ void reboot(void) {
 
 // Video functions
 void print_char(char c) {
+    output_sink_t sink = output_sinks[cpu_id()];
+    if (sink) {
+        sink(c);
+        return;
+    }
+    uint32_t flags = spin_lock_irqsave(&console_lock);
+    put_char(c);
+    spin_unlock_irqrestore(&console_lock, flags);
+}
+
+// print_char to the screen, with console_lock held
+static void put_char(char c) {
     if (c == '\n') {
         cursor_x = 0;
         cursor_y++;
         if (cursor_y >= VGA_HEIGHT) {
-            clear_screen();
+            clear_screen_locked();
             cursor_y = VGA_HEIGHT - 1;
         }
         update_cursor();
@@ -339,7 +426,7 @@ void print_char(char c) {
         cursor_x = 0;
         cursor_y++;
         if (cursor_y >= VGA_HEIGHT) {
-            clear_screen();
+            clear_screen_locked();
             cursor_y = VGA_HEIGHT - 1;
         }
     }
@@ -372,7 +459,39 @@ void print_int(int num) {
     }
 }
 
+void print_uint64(uint64_t num) {
+    char str[24];
+    int i = 0;
+    do {
+        uint64_t quotient = udiv64_32(num, 10);
+        str[i++] = '0' + (num - quotient * 10);
+        num = quotient;
+    } while (num > 0);
+    while (i > 0) {
+        print_char(str[--i]);
+    }
+}
+
+void print_hex(uint32_t num) {
+    const char* digits = "0123456789ABCDEF";
+    print_string("0x");
+    int started = 0;
+    for (int shift = 28; shift >= 0; shift -= 4) {
+        int digit = (num >> shift) & 0xF;
+        if (digit || started || shift == 0) {
+            print_char(digits[digit]);
+            started = 1;
+        }
+    }
+}
+
 void clear_screen(void) {
+    uint32_t flags = spin_lock_irqsave(&console_lock);
+    clear_screen_locked();
+    spin_unlock_irqrestore(&console_lock, flags);
+}
+
+static void clear_screen_locked(void) {
     for(int i = 0; i < VGA_WIDTH * VGA_HEIGHT; i++) {
         video_memory[i] = (uint16_t)' ' | (uint16_t)VGA_WHITE_ON_BLACK << 8;
     }
@@ -453,6 +572,7 @@ int string_to_int(const char* str) {
 
 // Initialize screen
 void init_screen(void) {
+    lockstat_register(&console_stats, "console", -1, LOCK_SPIN);
     clear_screen();
     cursor_x = 0;
     cursor_y = 0;
@@ -475,6 +595,24 @@ void* memset(void* s, int c, size_t n) {
     return s;
 }
 
+void* memcpy(void* dest, const void* src, size_t n) {
+    unsigned char* d = dest;
+    const unsigned char* s = src;
+    while (n--) {
+        *d++ = *s++;
+    }
+    return dest;
+}
+
+int memcmp(const void* s1, const void* s2, size_t n) {
+    const unsigned char* a = s1;
+    const unsigned char* b = s2;
+    for (size_t i = 0; i < n; i++) {
+        if (a[i] != b[i]) return a[i] - b[i];
+    }
+    return 0;
+}
+
 void set_cursor(int x, int y) {
     if (x < 0) x = 0;
     if (x >= VGA_WIDTH) x = VGA_WIDTH - 1;
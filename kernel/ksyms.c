@@ -0,0 +1,38 @@
+#include "ksyms.h"
+#include "../include/kernel.h"
+
+// End of code, set in linker.ld; .rodata follows, which is not in any function
+extern char __text_end[];
+
+int ksym_find(uint32_t address) {
+    if (ksym_count == 0 || address < ksyms[0].address || address >= (uint32_t)__text_end) {
+        return -1;
+    }
+    // Last symbol at or below the address
+    uint32_t low = 0;
+    uint32_t high = ksym_count;
+    while (high - low > 1) {
+        uint32_t mid = (low + high) / 2;
+        if (ksyms[mid].address <= address) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return (int)low;
+}
+
+const char* ksym_name(int index) {
+    return &ksym_names[ksyms[index].name];
+}
+
+void ksym_print(uint32_t address) {
+    int index = ksym_find(address);
+    if (index < 0) {
+        print_hex(address);
+        return;
+    }
+    print_string(ksym_name(index));
+    print_string("+");
+    print_hex(address - ksyms[index].address);
+}
@@ -0,0 +1,23 @@
+#ifndef KSYMS_H
+#define KSYMS_H
+
+#include <stdint.h>
+
+// The kernel's own code symbols, generated at build time by tools/mksyms
+// from nm of the linked kernel and linked back into it
+struct ksym {
+    uint32_t address;
+    uint32_t name;                      // Offset into ksym_names
+};
+
+extern const struct ksym ksyms[];
+extern const uint32_t ksym_count;
+extern const char ksym_names[];
+
+// Index of the function containing `address`, or -1
+int ksym_find(uint32_t address);
+const char* ksym_name(int index);
+// Print "name+0xoffset", or the bare address when it is not in a function
+void ksym_print(uint32_t address);
+
+#endif
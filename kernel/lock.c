@@ -0,0 +1,181 @@
+#include "spinlock.h"
+#include "rwlock.h"
+#include "lockstat.h"
+#include "clock.h"
+#include "../include/kernel.h"
+
+// The contended halves of the locks, where the waits are timed, and the
+// registry of lock statistics behind the lockstat command
+
+#define NAME_WIDTH 18
+#define COLUMN_WIDTH 11
+
+int lockstat_enabled = 0;
+static struct lock_stats* registered;
+// Guards the registry and the wait totals, which are 64-bit; never tracked
+static spinlock_t stats_lock = SPINLOCK_INIT;
+
+static uint64_t wait_start(struct lock_stats* stats) {
+    return lockstat_enabled && stats ? rdtsc() : 0;
+}
+
+static void wait_end(struct lock_stats* stats, uint64_t start) {
+    if (start != 0) {
+        lockstat_contended(stats, rdtsc() - start);
+    }
+}
+
+void spin_lock_contended(spinlock_t* lock, uint16_t ticket) {
+    uint64_t start = wait_start(lock->stats);
+    while (__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) != ticket) {
+        asm volatile ("pause");
+    }
+    wait_end(lock->stats, start);
+}
+
+void read_lock_contended(rwlock_t* rw) {
+    uint64_t start = wait_start(rw->stats);
+    uint32_t state = __atomic_load_n(&rw->state, __ATOMIC_RELAXED);
+    while ((state & RW_WRITER) ||
+           !__atomic_compare_exchange_n(&rw->state, &state, state + 1, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        asm volatile ("pause");
+        state = __atomic_load_n(&rw->state, __ATOMIC_RELAXED);
+    }
+    wait_end(rw->stats, start);
+}
+
+// Claim RW_WRITER once no other writer has it, which keeps new readers out,
+// then wait for the readers already inside to leave
+void write_lock_contended(rwlock_t* rw) {
+    uint64_t start = wait_start(rw->stats);
+    spin_lock(&rw->writers);
+    uint32_t state = __atomic_load_n(&rw->state, __ATOMIC_RELAXED);
+    while ((state & RW_WRITER) ||
+           !__atomic_compare_exchange_n(&rw->state, &state, state | RW_WRITER, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        asm volatile ("pause");
+        state = __atomic_load_n(&rw->state, __ATOMIC_RELAXED);
+    }
+    while (__atomic_load_n(&rw->state, __ATOMIC_ACQUIRE) != RW_WRITER) {
+        asm volatile ("pause");
+    }
+    spin_unlock(&rw->writers);
+    wait_end(rw->stats, start);
+}
+
+static void clear_stats(struct lock_stats* stats) {
+    stats->acquisitions = 0;
+    stats->contended = 0;
+    stats->wait_cycles = 0;
+    stats->max_wait_cycles = 0;
+}
+
+void lockstat_register(struct lock_stats* stats, const char* name, int instance, const char* kind) {
+    uint32_t flags = spin_lock_irqsave(&stats_lock);
+    stats->name = name;
+    stats->instance = instance;
+    stats->kind = kind;
+    clear_stats(stats);
+    struct lock_stats* s = registered;
+    while (s != NULL && s != stats) {
+        s = s->next;
+    }
+    if (s == NULL) {
+        // Keep them in registration order
+        struct lock_stats** tail = &registered;
+        while (*tail != NULL) {
+            tail = &(*tail)->next;
+        }
+        stats->next = NULL;
+        *tail = stats;
+    }
+    spin_unlock_irqrestore(&stats_lock, flags);
+}
+
+void lockstat_contended(struct lock_stats* stats, uint64_t wait_cycles) {
+    uint32_t flags = spin_lock_irqsave(&stats_lock);
+    stats->contended++;
+    stats->wait_cycles += wait_cycles;
+    if (wait_cycles > stats->max_wait_cycles) {
+        stats->max_wait_cycles = wait_cycles;
+    }
+    spin_unlock_irqrestore(&stats_lock, flags);
+}
+
+void lockstat_reset(void) {
+    uint32_t flags = spin_lock_irqsave(&stats_lock);
+    for (struct lock_stats* stats = registered; stats != NULL; stats = stats->next) {
+        clear_stats(stats);
+    }
+    spin_unlock_irqrestore(&stats_lock, flags);
+}
+
+static void print_right(const char* text, int width) {
+    for (int i = strlen(text); i < width; i++) {
+        print_char(' ');
+    }
+    print_string(text);
+}
+
+static void print_column(uint32_t value) {
+    char str[12];
+    int_to_string((int)value, str);
+    print_right(str, COLUMN_WIDTH);
+}
+
+static void print_name(const struct lock_stats* stats) {
+    char name[NAME_WIDTH + 1];
+    int length = 0;
+    for (const char* c = stats->name; *c && length < NAME_WIDTH - 3; c++) {
+        name[length++] = *c;
+    }
+    if (stats->instance >= 0) {
+        name[length++] = '/';
+        int_to_string(stats->instance, name + length);
+        length = strlen(name);
+    }
+    name[length] = '\0';
+    print_string(name);
+    for (int i = length; i < NAME_WIDTH; i++) {
+        print_char(' ');
+    }
+}
+
+// Locks that have not been taken since the last reset are left out. Copies
+// are printed so the console lock is never taken under stats_lock.
+void lockstat_display(void) {
+    print_string(lockstat_enabled ? "Lock statistics (on)\n" : "Lock statistics (off: lockstat on to collect)\n");
+    print_string("lock");
+    for (int i = 4; i < NAME_WIDTH; i++) {
+        print_char(' ');
+    }
+    print_right("kind", 6);
+    print_right("acquired", COLUMN_WIDTH);
+    print_right("contended", COLUMN_WIDTH);
+    print_right("wait us", COLUMN_WIDTH);
+    print_right("max us", COLUMN_WIDTH);
+    print_char('\n');
+
+    int shown = 0;
+    struct lock_stats* next = registered;
+    while (next != NULL) {
+        uint32_t flags = spin_lock_irqsave(&stats_lock);
+        struct lock_stats copy = *next;
+        spin_unlock_irqrestore(&stats_lock, flags);
+        next = copy.next;
+        if (copy.acquisitions == 0) continue;
+        shown++;
+
+        print_name(&copy);
+        print_right(copy.kind, 6);
+        print_column(copy.acquisitions);
+        print_column(copy.contended);
+        print_column((uint32_t)clock_cycles_to_us(copy.wait_cycles));
+        print_column((uint32_t)clock_cycles_to_us(copy.max_wait_cycles));
+        print_char('\n');
+    }
+    if (shown == 0) {
+        print_string("No lock activity recorded\n");
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef LOCKSTAT_H
+#define LOCKSTAT_H
+
+#include <stdint.h>
+
+// Contention statistics for the locks worth watching. A lock points at its
+// lock_stats (or at nothing) and init code registers them by name; while
+// 'lockstat on' is off the only cost is one predicted branch per
+// acquisition. Waits are counted in TSC cycles from the first failed try
+// until the lock is held.
+#define LOCK_SPIN "spin"
+#define LOCK_RW "rw"
+#define LOCK_SEMAPHORE "sem"
+#define LOCK_MUTEX "mutex"
+
+struct lock_stats {
+    const char* name;
+    int instance;                       // CPU or slot for per-object locks, -1 if only one
+    const char* kind;                   // LOCK_SPIN and so on
+    uint32_t acquisitions;
+    uint32_t contended;                 // Acquisitions that had to wait
+    uint64_t wait_cycles;
+    uint64_t max_wait_cycles;
+    struct lock_stats* next;            // Registry
+};
+
+extern int lockstat_enabled;
+
+// Registering the same stats again only clears them
+void lockstat_register(struct lock_stats* stats, const char* name, int instance, const char* kind);
+void lockstat_contended(struct lock_stats* stats, uint64_t wait_cycles);
+void lockstat_reset(void);
+void lockstat_display(void);
+
+// Several readers can count at once, so the count is atomic
+#define LOCKSTAT_ACQUIRED(stats) do { \
+    if (__builtin_expect(lockstat_enabled, 0) && (stats)) { \
+        __atomic_fetch_add(&(stats)->acquisitions, 1, __ATOMIC_RELAXED); \
+    } \
+} while (0)
+
+#endif
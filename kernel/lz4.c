@@ -0,0 +1,128 @@
+#include "lz4.h"
+#include "../include/kernel.h"
+
+#define MIN_MATCH 4
+#define LAST_LITERALS 5                 // The format ends with at least 5 literals
+#define MF_LIMIT 12                     // No match may start in the last 12 bytes
+#define MAX_OFFSET 65535
+#define HASH_LOG 10
+
+static uint16_t hash_table[1 << HASH_LOG];
+
+static uint32_t read32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t hash4(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_LOG);
+}
+
+// Write a length continuation (runs of 255 then the remainder)
+static int put_length(uint8_t* dst, int op, int capacity, int length) {
+    while (length >= 255) {
+        if (op >= capacity) return -1;
+        dst[op++] = 255;
+        length -= 255;
+    }
+    if (op >= capacity) return -1;
+    dst[op++] = length;
+    return op;
+}
+
+// Emit literals [anchor, anchor + literals) and, if match_length > 0, a match
+static int put_sequence(uint8_t* dst, int op, int capacity, const uint8_t* literals_src,
+                        int literals, int offset, int match_length) {
+    if (op >= capacity) return -1;
+    int token_pos = op++;
+    int token = (literals >= 15 ? 15 : literals) << 4;
+    if (literals >= 15 && (op = put_length(dst, op, capacity, literals - 15)) < 0) return -1;
+    if (op + literals > capacity) return -1;
+    memcpy(dst + op, literals_src, literals);
+    op += literals;
+    if (match_length > 0) {
+        if (op + 2 > capacity) return -1;
+        dst[op++] = offset & 0xFF;
+        dst[op++] = offset >> 8;
+        int extra = match_length - MIN_MATCH;
+        token |= extra >= 15 ? 15 : extra;
+        if (extra >= 15 && (op = put_length(dst, op, capacity, extra - 15)) < 0) return -1;
+    }
+    dst[token_pos] = token;
+    return op;
+}
+
+// Greedy single-pass compressor with a small hash table of recent positions
+int lz4_compress(const uint8_t* src, int size, uint8_t* dst, int capacity) {
+    int op = 0;
+    int anchor = 0;
+    int ip = 0;
+    memset(hash_table, 0, sizeof(hash_table));
+
+    while (ip < size - MF_LIMIT) {
+        uint32_t sequence = read32(src + ip);
+        uint32_t h = hash4(sequence);
+        int ref = hash_table[h];
+        hash_table[h] = ip;
+        if (ref >= ip || ip - ref > MAX_OFFSET || read32(src + ref) != sequence) {
+            ip++;
+            continue;
+        }
+        int length = MIN_MATCH;
+        while (ip + length < size - LAST_LITERALS && src[ref + length] == src[ip + length]) {
+            length++;
+        }
+        op = put_sequence(dst, op, capacity, src + anchor, ip - anchor, ip - ref, length);
+        if (op < 0) return 0;
+        ip += length;
+        anchor = ip;
+    }
+    op = put_sequence(dst, op, capacity, src + anchor, size - anchor, 0, 0);
+    return op < 0 ? 0 : op;
+}
+
+// Read a length continuation; -1 if it runs past the input
+static int get_length(const uint8_t* src, int size, int* ip) {
+    int length = 0;
+    uint8_t byte;
+    do {
+        if (*ip >= size) return -1;
+        byte = src[(*ip)++];
+        length += byte;
+    } while (byte == 255);
+    return length;
+}
+
+int lz4_decompress(const uint8_t* src, int size, uint8_t* dst, int capacity) {
+    int ip = 0;
+    int op = 0;
+    while (ip < size) {
+        int token = src[ip++];
+        int literals = token >> 4;
+        if (literals == 15) {
+            int extra = get_length(src, size, &ip);
+            if (extra < 0) return -1;
+            literals += extra;
+        }
+        if (ip + literals > size || op + literals > capacity) return -1;
+        memcpy(dst + op, src + ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == size) break;          // Last sequence has no match
+
+        if (ip + 2 > size) return -1;
+        int offset = src[ip] | (src[ip + 1] << 8);
+        ip += 2;
+        int length = (token & 15) + MIN_MATCH;
+        if ((token & 15) == 15) {
+            int extra = get_length(src, size, &ip);
+            if (extra < 0) return -1;
+            length += extra;
+        }
+        if (offset == 0 || offset > op || op + length > capacity) return -1;
+        // Byte copy: the match may overlap the bytes it produces
+        for (int i = 0; i < length; i++, op++) {
+            dst[op] = dst[op - offset];
+        }
+    }
+    return op;
+}
@@ -0,0 +1,12 @@
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <stdint.h>
+
+// LZ4 block format (no frame header); sizes are in bytes. Both return the
+// output size, compress returns 0 when the result does not fit in `capacity`
+// and decompress returns -1 on malformed input.
+int lz4_compress(const uint8_t* src, int size, uint8_t* dst, int capacity);
+int lz4_decompress(const uint8_t* src, int size, uint8_t* dst, int capacity);
+
+#endif
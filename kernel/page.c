@@ -0,0 +1,69 @@
+#include "page.h"
+#include "spinlock.h"
+#include "../include/kernel.h"
+
+static uint8_t pool[PAGE_POOL_PAGES][PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+static int owners[PAGE_POOL_PAGES];
+static int free_pages[PAGE_POOL_PAGES];         // Stack of free page numbers
+static int free_count;
+static spinlock_t page_lock = SPINLOCK_INIT;    // Owners and the free stack
+
+void init_pages(void) {
+    for (int i = 0; i < PAGE_POOL_PAGES; i++) {
+        owners[i] = PAGE_OWNER_FREE;
+        free_pages[i] = PAGE_POOL_PAGES - 1 - i;
+    }
+    free_count = PAGE_POOL_PAGES;
+}
+
+int page_alloc(int owner) {
+    int page = PAGE_NONE;
+    uint32_t flags = spin_lock_irqsave(&page_lock);
+    if (free_count > 0) {
+        page = free_pages[--free_count];
+        owners[page] = owner;
+    }
+    spin_unlock_irqrestore(&page_lock, flags);
+    return page;
+}
+
+int page_free(int page, int owner) {
+    int result = -1;
+    uint32_t flags = spin_lock_irqsave(&page_lock);
+    if (page >= 0 && page < PAGE_POOL_PAGES && owners[page] == owner) {
+        owners[page] = PAGE_OWNER_FREE;
+        free_pages[free_count++] = page;
+        result = 0;
+    }
+    spin_unlock_irqrestore(&page_lock, flags);
+    return result;
+}
+
+int page_transfer(int page, int from, int to) {
+    int result = -1;
+    uint32_t flags = spin_lock_irqsave(&page_lock);
+    if (page >= 0 && page < PAGE_POOL_PAGES && owners[page] == from) {
+        owners[page] = to;
+        result = 0;
+    }
+    spin_unlock_irqrestore(&page_lock, flags);
+    return result;
+}
+
+void* page_address(int page) {
+    if (page < 0 || page >= PAGE_POOL_PAGES) {
+        return NULL;
+    }
+    return pool[page];
+}
+
+int page_owner(int page) {
+    if (page < 0 || page >= PAGE_POOL_PAGES) {
+        return PAGE_OWNER_FREE;
+    }
+    return owners[page];
+}
+
+int pages_free(void) {
+    return free_count;
+}
@@ -0,0 +1,26 @@
+#ifndef PAGE_H
+#define PAGE_H
+
+#include <stdint.h>
+
+// Pool of whole pages for payloads too big to copy around. Each page has
+// one owner at a time, a pid or PAGE_OWNER_KERNEL; handing it on changes
+// the owner and nothing else, so the data is never copied. There is no
+// paging yet, so ownership is bookkeeping that the IPC layer checks.
+#define PAGE_SIZE 4096
+#define PAGE_POOL_PAGES 64
+#define PAGE_NONE -1
+
+#define PAGE_OWNER_KERNEL -1
+#define PAGE_OWNER_FREE -2
+#define PAGE_OWNER_IN_TRANSIT -3        // Queued in a message
+
+void init_pages(void);
+int page_alloc(int owner);                      // Page number, or PAGE_NONE
+int page_free(int page, int owner);             // -1 if `owner` does not own it
+int page_transfer(int page, int from, int to);  // -1 if `from` does not own it
+void* page_address(int page);
+int page_owner(int page);
+int pages_free(void);
+
+#endif
@@ -0,0 +1,34 @@
+#include "pipe.h"
+
+void pipe_init(struct pipe* pipe) {
+    pipe->head = 0;
+    pipe->tail = 0;
+    pipe->dropped = 0;
+}
+
+int pipe_used(const struct pipe* pipe) {
+    return pipe->head - pipe->tail;
+}
+
+int pipe_write(struct pipe* pipe, const char* data, int size) {
+    int space = PIPE_SIZE - pipe_used(pipe);
+    if (size > space) {
+        pipe->dropped += size - space;
+        size = space;
+    }
+    for (int i = 0; i < size; i++) {
+        pipe->data[pipe->head++ & (PIPE_SIZE - 1)] = data[i];
+    }
+    return size;
+}
+
+int pipe_read(struct pipe* pipe, char* out, int size) {
+    int used = pipe_used(pipe);
+    if (size > used) {
+        size = used;
+    }
+    for (int i = 0; i < size; i++) {
+        out[i] = pipe->data[pipe->tail++ & (PIPE_SIZE - 1)];
+    }
+    return size;
+}
@@ -0,0 +1,23 @@
+#ifndef PIPE_H
+#define PIPE_H
+
+#include <stdint.h>
+
+// Bounded byte ring connecting two pipeline stages. head and tail run freely
+// and are reduced modulo PIPE_SIZE, so used = head - tail even across wrap.
+// Writes never block: bytes that do not fit are counted in `dropped`.
+#define PIPE_SIZE 4096                  // Power of two
+
+struct pipe {
+    char data[PIPE_SIZE];
+    uint32_t head;                      // Next byte to write
+    uint32_t tail;                      // Next byte to read
+    uint32_t dropped;
+};
+
+void pipe_init(struct pipe* pipe);
+int pipe_write(struct pipe* pipe, const char* data, int size);   // Bytes written
+int pipe_read(struct pipe* pipe, char* out, int size);           // Bytes read
+int pipe_used(const struct pipe* pipe);
+
+#endif
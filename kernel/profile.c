@@ -0,0 +1,155 @@
+#include "profile.h"
+#include "ksyms.h"
+#include "interrupts.h"
+#include "clock.h"
+#include "smp.h"
+#include "timer.h"
+#include "../include/kernel.h"
+
+#define PIT_CHANNEL0 0x40
+#define PIT_COMMAND 0x43
+#define PIT_MODE_RATE 0x34              // Channel 0, lobyte/hibyte, mode 2
+
+struct profile_buffer {
+    uint32_t counts[PROFILE_MAX_SYMBOLS];
+    uint32_t unknown;                   // Samples outside the symbol table
+    uint32_t total;
+};
+
+static struct profile_buffer buffers[MAX_CPUS];
+static uint32_t merged[PROFILE_MAX_SYMBOLS];
+static int running = 0;
+static uint64_t start_cycles;
+static uint64_t elapsed_cycles;
+static int drives_timers = 0;           // The PIT was the boot CPU's deadline timer
+
+// One sample on this CPU, from the PIT or the boot CPU's IPI
+static void profile_sample(struct interrupt_frame* frame) {
+    struct profile_buffer* buffer = &buffers[cpu_id()];
+    int index = ksym_find(frame->eip);
+    if (index >= 0 && index < PROFILE_MAX_SYMBOLS) {
+        buffer->counts[index]++;
+    } else {
+        buffer->unknown++;
+    }
+    buffer->total++;
+}
+
+static void profile_tick(struct interrupt_frame* frame) {
+    profile_sample(frame);
+    smp_send_others(VECTOR_PROFILE);
+    if (drives_timers) {
+        timer_interrupt();
+    }
+}
+
+int profile_start(void) {
+    if (running) {
+        return -1;
+    }
+    memset(buffers, 0, sizeof(buffers));
+    elapsed_cycles = 0;
+    drives_timers = timer_pit_borrow();
+    uint32_t divisor = PIT_FREQUENCY / PROFILE_HZ;
+    outb(PIT_COMMAND, PIT_MODE_RATE);
+    outb(PIT_CHANNEL0, divisor & 0xFF);
+    outb(PIT_CHANNEL0, divisor >> 8);
+    vector_register_handler(VECTOR_PROFILE, profile_sample);
+    irq_register_handler(IRQ_TIMER, profile_tick);
+    start_cycles = rdtsc();
+    running = 1;
+    irq_unmask(IRQ_TIMER);
+    return 0;
+}
+
+int profile_stop(void) {
+    if (!running) {
+        return -1;
+    }
+    irq_mask(IRQ_TIMER);
+    irq_register_handler(IRQ_TIMER, NULL);
+    vector_register_handler(VECTOR_PROFILE, NULL);
+    elapsed_cycles = rdtsc() - start_cycles;
+    running = 0;
+    if (drives_timers) {
+        drives_timers = 0;
+        timer_pit_return();
+    }
+    return 0;
+}
+
+// Share of the total, printed as a percentage with one decimal
+static void print_share(uint32_t count, uint32_t total) {
+    uint32_t permille = (uint32_t)udiv64_32((uint64_t)count * 1000, total);
+    if (permille < 1000) print_char(' ');
+    if (permille < 100) print_char(' ');
+    print_int(permille / 10);
+    print_char('.');
+    print_int(permille % 10);
+    print_string("%  ");
+}
+
+static void print_count(uint32_t count) {
+    char str[12];
+    int_to_string((int)count, str);
+    for (int i = strlen(str); i < 8; i++) {
+        print_char(' ');
+    }
+    print_string(str);
+    print_string("  ");
+}
+
+void profile_report(int top) {
+    uint32_t total = 0;
+    uint32_t unknown = 0;
+    memset(merged, 0, sizeof(merged));
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        for (int i = 0; i < PROFILE_MAX_SYMBOLS; i++) {
+            merged[i] += buffers[cpu].counts[i];
+        }
+        unknown += buffers[cpu].unknown;
+        total += buffers[cpu].total;
+    }
+    if (total == 0) {
+        print_string("No samples (prof start, run something, prof stop)\n");
+        return;
+    }
+    uint64_t cycles = running ? rdtsc() - start_cycles : elapsed_cycles;
+    print_int(total);
+    print_string(" samples in ");
+    print_int((int)udiv64_32(clock_cycles_to_us(cycles), 1000));
+    print_string(" ms at ");
+    print_int(PROFILE_HZ);
+    print_string(" Hz");
+    if (smp_cpu_count() > 1) {
+        print_string(" on ");
+        print_int(smp_cpu_count());
+        print_string(" CPUs (");
+        for (int cpu = 0; cpu < smp_cpu_count(); cpu++) {
+            if (cpu) print_string(", ");
+            print_int(buffers[cpu].total);
+        }
+        print_string(")");
+    }
+    print_string(running ? " (still running)\n" : "\n");
+    print_string(" Samples   Share  Function\n");
+
+    // Pick the largest remaining count each time
+    for (int shown = 0; shown < top; shown++) {
+        int best = -1;
+        for (uint32_t i = 0; i < ksym_count && i < PROFILE_MAX_SYMBOLS; i++) {
+            if (merged[i] && (best < 0 || merged[i] > merged[best])) best = i;
+        }
+        if (best < 0) break;
+        print_count(merged[best]);
+        print_share(merged[best], total);
+        print_string(ksym_name(best));
+        print_char('\n');
+        merged[best] = 0;
+    }
+    if (unknown) {
+        print_count(unknown);
+        print_share(unknown, total);
+        print_string("(unknown)\n");
+    }
+}
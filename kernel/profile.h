@@ -0,0 +1,17 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// Sampling profiler: while running, the PIT interrupts PROFILE_HZ times a
+// second and each tick counts the function the CPU was in, looked up in
+// the kernel's symbol table. The boot CPU passes each tick on to the other
+// CPUs as an IPI, so each samples itself. Code running with interrupts off
+// is charged to wherever they come back on.
+#define PROFILE_HZ 1000
+#define PROFILE_MAX_SYMBOLS 1024        // Functions beyond this count as unknown
+#define PROFILE_DEFAULT_TOP 15
+
+int profile_start(void);                // -1 if already running
+int profile_stop(void);                 // -1 if not running
+void profile_report(int top);
+
+#endif
@@ -0,0 +1,91 @@
+#include "rtc.h"
+#include "../include/kernel.h"
+
+#define CMOS_ADDRESS 0x70
+#define CMOS_DATA 0x71
+
+// Registers
+#define RTC_SECONDS 0x00
+#define RTC_MINUTES 0x02
+#define RTC_HOURS 0x04
+#define RTC_DAY 0x07
+#define RTC_MONTH 0x08
+#define RTC_YEAR 0x09
+#define RTC_STATUS_A 0x0A
+#define RTC_STATUS_B 0x0B
+
+#define STATUS_A_UPDATING 0x80
+#define STATUS_B_24_HOUR 0x02
+#define STATUS_B_BINARY 0x04
+#define HOUR_PM 0x80                    // In 12-hour mode
+
+#define RTC_FIELDS 6
+#define UPDATE_POLLS 100000             // The update takes under 2ms
+#define READ_TRIES 5
+
+static const uint8_t field_registers[RTC_FIELDS] = {
+    RTC_SECONDS, RTC_MINUTES, RTC_HOURS, RTC_DAY, RTC_MONTH, RTC_YEAR
+};
+
+static uint8_t read_cmos(uint8_t reg) {
+    outb(CMOS_ADDRESS, reg);
+    return inb(CMOS_DATA);
+}
+
+static int bcd_to_bin(uint8_t value) {
+    return (value & 0x0F) + (value >> 4) * 10;
+}
+
+// Wait out an update in progress, then read every field
+static int read_fields(uint8_t fields[RTC_FIELDS]) {
+    int polls = 0;
+    while (read_cmos(RTC_STATUS_A) & STATUS_A_UPDATING) {
+        if (++polls == UPDATE_POLLS) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < RTC_FIELDS; i++) {
+        fields[i] = read_cmos(field_registers[i]);
+    }
+    return 0;
+}
+
+int rtc_read(struct date_time* date) {
+    uint8_t fields[RTC_FIELDS];
+    uint8_t again[RTC_FIELDS];
+    if (read_fields(fields) < 0) {
+        return -1;
+    }
+    int tries = 0;
+    while (1) {
+        if (read_fields(again) < 0) {
+            return -1;
+        }
+        if (memcmp(fields, again, RTC_FIELDS) == 0) {
+            break;
+        }
+        if (++tries == READ_TRIES) {
+            return -1;
+        }
+        memcpy(fields, again, RTC_FIELDS);
+    }
+
+    uint8_t status = read_cmos(RTC_STATUS_B);
+    int pm = !(status & STATUS_B_24_HOUR) && (fields[2] & HOUR_PM);
+    fields[2] &= ~HOUR_PM;
+    int values[RTC_FIELDS];
+    for (int i = 0; i < RTC_FIELDS; i++) {
+        values[i] = (status & STATUS_B_BINARY) ? fields[i] : bcd_to_bin(fields[i]);
+    }
+    if (!(status & STATUS_B_24_HOUR)) {
+        values[2] = values[2] % 12 + (pm ? 12 : 0);     // 12 AM is 0:00
+    }
+    date->second = values[0];
+    date->minute = values[1];
+    date->hour = values[2];
+    date->day = values[3];
+    date->month = values[4];
+    date->year = values[5] + (values[5] < 70 ? 2000 : 1900);
+    seconds_to_date(date_to_seconds(date), date);       // Fills in the weekday
+    return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef RTC_H
+#define RTC_H
+
+#include "calendar.h"
+
+// The CMOS real-time clock. It updates its registers once a second, and a
+// read that straddles the update can mix two seconds, so rtc_read waits
+// for the update-in-progress flag to clear and reads until two passes
+// agree. Two-digit years from 70 on are 19xx, the rest 20xx.
+int rtc_read(struct date_time* date);   // -1 if the RTC never settled
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef RWLOCK_H
+#define RWLOCK_H
+
+#include <stdint.h>
+#include "spinlock.h"
+#include "lockstat.h"
+
+// Reader-writer lock for data that is looked at far more often than it is
+// changed. Readers share it; a writer has it alone. A waiting writer sets
+// RW_WRITER straight away, which holds back new readers so a steady stream
+// of them cannot starve it. Neither side disables interrupts, so handlers
+// must not take one.
+#define RW_WRITER 0x80000000u
+
+typedef struct {
+    volatile uint32_t state;            // Readers inside, plus RW_WRITER
+    spinlock_t writers;                 // Contended writers take turns in ticket order
+    struct lock_stats* stats;           // NULL when not tracked
+} rwlock_t;
+
+void read_lock_contended(rwlock_t* rw);
+void write_lock_contended(rwlock_t* rw);
+
+static inline void rwlock_init(rwlock_t* rw, struct lock_stats* stats) {
+    rw->state = 0;
+    spin_lock_init(&rw->writers, 0);
+    rw->stats = stats;
+}
+
+static inline void read_lock(rwlock_t* rw) {
+    uint32_t state = __atomic_load_n(&rw->state, __ATOMIC_RELAXED);
+    if (__builtin_expect((state & RW_WRITER) ||
+                         !__atomic_compare_exchange_n(&rw->state, &state, state + 1, 0,
+                                                      __ATOMIC_ACQUIRE, __ATOMIC_RELAXED), 0)) {
+        read_lock_contended(rw);
+    }
+    LOCKSTAT_ACQUIRED(rw->stats);
+}
+
+static inline void read_unlock(rwlock_t* rw) {
+    __atomic_fetch_sub(&rw->state, 1, __ATOMIC_RELEASE);
+}
+
+static inline void write_lock(rwlock_t* rw) {
+    uint32_t idle = 0;
+    if (__builtin_expect(!__atomic_compare_exchange_n(&rw->state, &idle, RW_WRITER, 0,
+                                                      __ATOMIC_ACQUIRE, __ATOMIC_RELAXED), 0)) {
+        write_lock_contended(rw);
+    }
+    LOCKSTAT_ACQUIRED(rw->stats);
+}
+
+// Readers never get in while RW_WRITER is set, so the writer leaves it empty
+static inline void write_unlock(rwlock_t* rw) {
+    __atomic_store_n(&rw->state, 0, __ATOMIC_RELEASE);
+}
+
+#endif
@@ -0,0 +1,93 @@
+#include "search.h"
+#include "cpu.h"
+#include "../include/kernel.h"
+
+typedef char v16qi __attribute__((vector_size(16)));
+
+// Compare 16 bytes against the needle and turn the result into a bit mask
+__attribute__((target("sse2")))
+static const char* memchr_sse2(const char* data, char c, uint32_t size) {
+    v16qi needle = c - (v16qi){0};
+    uint32_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        v16qi chunk;
+        __builtin_memcpy(&chunk, data + i, 16);
+        int mask = __builtin_ia32_pmovmskb128((v16qi)(chunk == needle));
+        if (mask) {
+            return data + i + __builtin_ctz(mask);
+        }
+    }
+    for (; i < size; i++) {
+        if (data[i] == c) return data + i;
+    }
+    return NULL;
+}
+
+const char* search_memchr(const char* data, char c, uint32_t size) {
+    if (cpu_has(CPU_FEATURE_SSE2)) {
+        return memchr_sse2(data, c, size);
+    }
+    for (uint32_t i = 0; i < size; i++) {
+        if (data[i] == c) return data + i;
+    }
+    return NULL;
+}
+
+int search_compile(struct search_pattern* pattern, const char* text) {
+    uint32_t length = strlen(text);
+    if (length == 0 || length >= SEARCH_MAX_PATTERN) {
+        return -1;
+    }
+    memcpy(pattern->text, text, length + 1);
+    pattern->length = length;
+    for (int i = 0; i < 256; i++) {
+        pattern->skip[i] = length;
+    }
+    for (uint32_t i = 0; i + 1 < length; i++) {
+        pattern->skip[(uint8_t)text[i]] = length - 1 - i;
+    }
+    return 0;
+}
+
+static int matches_at(const char* data, const char* text, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        if (data[i] != text[i]) return 0;
+    }
+    return 1;
+}
+
+// Short patterns: let memchr skip to candidates for the first byte
+static const char* find_short(const struct search_pattern* pattern, const char* data, uint32_t size) {
+    uint32_t length = pattern->length;
+    const char* end = data + size;
+    const char* p = data;
+    while ((uint32_t)(end - p) >= length) {
+        p = search_memchr(p, pattern->text[0], (end - p) - length + 1);
+        if (p == NULL) return NULL;
+        if (matches_at(p + 1, pattern->text + 1, length - 1)) return p;
+        p++;
+    }
+    return NULL;
+}
+
+// Boyer-Moore-Horspool: compare from the window end, shift by the skip table
+static const char* find_bmh(const struct search_pattern* pattern, const char* data, uint32_t size) {
+    uint32_t length = pattern->length;
+    char last = pattern->text[length - 1];
+    uint32_t pos = 0;
+    while (pos + length <= size) {
+        char c = data[pos + length - 1];
+        if (c == last && matches_at(data + pos, pattern->text, length - 1)) {
+            return data + pos;
+        }
+        pos += pattern->skip[(uint8_t)c];
+    }
+    return NULL;
+}
+
+const char* search_find(const struct search_pattern* pattern, const char* data, uint32_t size) {
+    if (pattern->length < SEARCH_BMH_MIN) {
+        return find_short(pattern, data, size);
+    }
+    return find_bmh(pattern, data, size);
+}
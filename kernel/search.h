@@ -0,0 +1,24 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdint.h>
+
+// Patterns shorter than this use the first-byte filter, longer ones
+// Boyer-Moore-Horspool
+#define SEARCH_BMH_MIN 4
+#define SEARCH_MAX_PATTERN 64
+
+struct search_pattern {
+    char text[SEARCH_MAX_PATTERN];
+    uint32_t length;
+    uint8_t skip[256];                 // BMH shift for the byte under the window end
+};
+
+// Substring search over raw memory
+int search_compile(struct search_pattern* pattern, const char* text);
+const char* search_find(const struct search_pattern* pattern, const char* data, uint32_t size);
+
+// First occurrence of a byte, 16 bytes at a time when SSE2 is available
+const char* search_memchr(const char* data, char c, uint32_t size);
+
+#endif
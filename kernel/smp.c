@@ -0,0 +1,343 @@
+#include "smp.h"
+#include "acpi.h"
+#include "apic.h"
+#include "cpu.h"
+#include "clock.h"
+#include "interrupts.h"
+#include "timer.h"
+#include "../process/process.h"
+#include "../include/kernel.h"
+
+// Each CPU's GDT: the bootloader's flat code and data segments at the same
+// selectors, then the CPU's TSS and a data segment over its struct cpu
+#define GDT_KERNEL_CODE 0x08
+#define GDT_KERNEL_DATA 0x10
+#define GDT_TSS 0x18
+#define GDT_CPU_DATA 0x20
+#define GDT_ENTRIES 5
+
+#define GDT_ACCESS_CODE 0x9A            // Present, ring 0, executable, readable
+#define GDT_ACCESS_DATA 0x92            // Present, ring 0, writable
+#define GDT_ACCESS_TSS 0x89             // Present, ring 0, available 32-bit TSS
+#define GDT_FLAGS_FLAT 0xC              // 4KB granularity, 32-bit
+#define GDT_FLAGS_BYTES 0x4             // Byte granularity, 32-bit
+
+#define BOOT_STACK_TOP 0x90000          // Set up by the bootloader
+#define AP_STACK_SIZE 16384
+
+// Startup timing from the MultiProcessor Specification's universal algorithm
+#define INIT_DELAY_US 10000
+#define STARTUP_DELAY_US 200
+#define ONLINE_TIMEOUT_MS 200
+
+struct gdt_entry {
+    uint16_t limit_low;
+    uint16_t base_low;
+    uint8_t base_middle;
+    uint8_t access;
+    uint8_t limit_high_flags;
+    uint8_t base_high;
+} __attribute__((packed));
+
+struct gdt_pointer {
+    uint16_t limit;
+    uint32_t base;
+} __attribute__((packed));
+
+// Nothing runs in ring 3 yet; the TSS only records the ring 0 stack
+struct tss {
+    uint32_t prev_task;
+    uint32_t esp0, ss0, esp1, ss1, esp2, ss2;
+    uint32_t cr3, eip, eflags;
+    uint32_t eax, ecx, edx, ebx, esp, ebp, esi, edi;
+    uint32_t es, cs, ss, ds, fs, gs, ldt;
+    uint16_t trap;
+    uint16_t iomap_base;
+} __attribute__((packed));
+
+struct cpu {
+    int id;                             // First: cpu_id() reads it through %gs
+    uint8_t apic_id;
+    volatile int online;
+    volatile uint32_t ticks;            // Scheduler ticks taken
+    volatile int idle;                  // Not ticking until smp_wake
+    struct timer tick;
+    struct gdt_entry gdt[GDT_ENTRIES];
+    struct tss tss;
+};
+
+static struct cpu cpus[MAX_CPUS];
+static uint8_t ap_stacks[MAX_CPUS][AP_STACK_SIZE] __attribute__((aligned(16)));
+static int cpu_count = 1;
+static int processors_found = 1;        // Enabled processors in the MADT
+static struct cpu* volatile starting_cpu;
+
+#define STRINGIFY(x) #x
+#define TO_STRING(x) STRINGIFY(x)
+
+// Real-mode entry for the APs, copied to SMP_TRAMPOLINE_BASE. It runs from
+// that copy with %cs = base >> 4, so it addresses its data absolutely: load
+// the GDT that start_ap patched in, switch to protected mode, and call the
+// patched entry point on the patched stack.
+extern char smp_trampoline_start[], smp_trampoline_end[];
+extern char smp_trampoline_gdtr[], smp_trampoline_stack[], smp_trampoline_entry[];
+
+asm(
+    ".text\n"
+    ".set TRAMPOLINE_BASE, " TO_STRING(SMP_TRAMPOLINE_BASE) "\n"
+    ".code16\n"
+    ".global smp_trampoline_start\n"
+    "smp_trampoline_start:\n"
+    "    cli\n"
+    "    cld\n"
+    "    xorw %ax, %ax\n"
+    "    movw %ax, %ds\n"
+    "    lgdtl TRAMPOLINE_BASE + (smp_trampoline_gdtr - smp_trampoline_start)\n"
+    "    movl %cr0, %eax\n"
+    "    orl $1, %eax\n"
+    "    movl %eax, %cr0\n"
+    "    ljmpl $" TO_STRING(GDT_KERNEL_CODE) ", $TRAMPOLINE_BASE + (smp_trampoline_32 - smp_trampoline_start)\n"
+    ".code32\n"
+    "smp_trampoline_32:\n"
+    "    movw $" TO_STRING(GDT_KERNEL_DATA) ", %ax\n"
+    "    movw %ax, %ds\n"
+    "    movw %ax, %es\n"
+    "    movw %ax, %ss\n"
+    "    movl TRAMPOLINE_BASE + (smp_trampoline_stack - smp_trampoline_start), %esp\n"
+    "    call *TRAMPOLINE_BASE + (smp_trampoline_entry - smp_trampoline_start)\n"
+    "1:  hlt\n"
+    "    jmp 1b\n"
+    ".align 4\n"
+    ".global smp_trampoline_gdtr, smp_trampoline_stack, smp_trampoline_entry, smp_trampoline_end\n"
+    "smp_trampoline_gdtr:\n"
+    "    .word 0\n"
+    "    .long 0\n"
+    ".align 4\n"
+    "smp_trampoline_stack:\n"
+    "    .long 0\n"
+    "smp_trampoline_entry:\n"
+    "    .long 0\n"
+    "smp_trampoline_end:\n"
+    ".text\n"
+);
+
+// Where a trampoline label ends up in the copy
+static void* trampoline_address(char* label) {
+    return (void*)(SMP_TRAMPOLINE_BASE + (label - smp_trampoline_start));
+}
+
+static void set_gdt_entry(struct gdt_entry* entry, uint32_t base, uint32_t limit,
+                          uint8_t access, uint8_t flags) {
+    entry->limit_low = limit & 0xFFFF;
+    entry->base_low = base & 0xFFFF;
+    entry->base_middle = (base >> 16) & 0xFF;
+    entry->access = access;
+    entry->limit_high_flags = ((limit >> 16) & 0x0F) | (flags << 4);
+    entry->base_high = (base >> 24) & 0xFF;
+}
+
+static void setup_cpu(struct cpu* cpu, int id, uint8_t apic_id, uint32_t stack_top) {
+    memset(cpu, 0, sizeof(*cpu));
+    cpu->id = id;
+    cpu->apic_id = apic_id;
+    cpu->tss.esp0 = stack_top;
+    cpu->tss.ss0 = GDT_KERNEL_DATA;
+    cpu->tss.iomap_base = sizeof(cpu->tss);      // No I/O permission bitmap
+    set_gdt_entry(&cpu->gdt[GDT_KERNEL_CODE / 8], 0, 0xFFFFF, GDT_ACCESS_CODE, GDT_FLAGS_FLAT);
+    set_gdt_entry(&cpu->gdt[GDT_KERNEL_DATA / 8], 0, 0xFFFFF, GDT_ACCESS_DATA, GDT_FLAGS_FLAT);
+    set_gdt_entry(&cpu->gdt[GDT_TSS / 8], (uint32_t)&cpu->tss, sizeof(cpu->tss) - 1,
+                  GDT_ACCESS_TSS, GDT_FLAGS_BYTES);
+    set_gdt_entry(&cpu->gdt[GDT_CPU_DATA / 8], (uint32_t)cpu, sizeof(*cpu) - 1,
+                  GDT_ACCESS_DATA, GDT_FLAGS_BYTES);
+}
+
+// Switch to the CPU's GDT and reload every segment register, then its TSS
+static void load_cpu_tables(struct cpu* cpu) {
+    struct gdt_pointer gdtp;
+    gdtp.limit = sizeof(cpu->gdt) - 1;
+    gdtp.base = (uint32_t)cpu->gdt;
+    asm volatile ("lgdt %0\n\t"
+                  "ljmp %1, $1f\n"
+                  "1:\n\t"
+                  "movw %w2, %%ds\n\t"
+                  "movw %w2, %%es\n\t"
+                  "movw %w2, %%fs\n\t"
+                  "movw %w2, %%ss\n\t"
+                  "movw %w3, %%gs\n\t"
+                  "ltr %w4"
+                  : : "m"(gdtp), "i"(GDT_KERNEL_CODE), "r"(GDT_KERNEL_DATA),
+                      "r"(GDT_CPU_DATA), "r"(GDT_TSS)
+                  : "memory");
+}
+
+void init_boot_cpu(void) {
+    setup_cpu(&cpus[0], 0, 0, BOOT_STACK_TOP);
+    cpus[0].online = 1;
+    load_cpu_tables(&cpus[0]);
+}
+
+// Raise the scheduler tick on the first idle CPU, so it can steal from
+// a queue that has more than it runs
+static void wake_idle_cpu(void) {
+    for (int i = 1; i < cpu_count; i++) {
+        if (cpus[i].idle) {
+            smp_wake(i);
+            return;
+        }
+    }
+}
+
+// A CPU ticks only while it has something to run. The idle flag goes up
+// before the second look at the run queue, and smp_wake queues its work
+// before it looks at the flag, so work queued meanwhile is either seen
+// here or brings the wakeup IPI.
+static void scheduler_timer(struct timer* timer, void* data) {
+    struct cpu* cpu = data;
+    cpu->ticks++;
+    scheduler_tick();
+    int load = scheduler_load(cpu->id);
+    if (load > 1) {
+        wake_idle_cpu();
+    }
+    if (load > 0) {
+        return;
+    }
+    __atomic_store_n(&cpu->idle, 1, __ATOMIC_SEQ_CST);
+    if (scheduler_load(cpu->id) > 0) {
+        cpu->idle = 0;
+        return;
+    }
+    timer_cancel(timer);
+}
+
+static void wakeup(struct interrupt_frame* frame) {
+    (void)frame;
+    struct cpu* cpu = &cpus[cpu_id()];
+    if (cpu->idle) {
+        cpu->idle = 0;
+        timer_add_periodic(&cpu->tick, 1000 / SMP_TICK_HZ);
+    }
+}
+
+// First C code on an AP, on the stack start_ap gave it
+static void __attribute__((noreturn)) ap_main(void) {
+    struct cpu* cpu = starting_cpu;
+    load_cpu_tables(cpu);
+    load_idt();
+    init_cpu_ap();
+    lapic_enable();
+    init_timers();
+    timer_init(&cpu->tick, scheduler_timer, cpu);
+    cpu->idle = 1;                      // Until there is work for it
+    cpu->online = 1;
+    interrupts_enable();
+    while (1) {
+        asm volatile ("hlt");
+    }
+}
+
+// INIT, then up to two STARTUPs, and wait for the AP to report in
+static int start_ap(int id, uint8_t apic_id) {
+    struct cpu* cpu = &cpus[id];
+    setup_cpu(cpu, id, apic_id, (uint32_t)(ap_stacks[id] + AP_STACK_SIZE));
+
+    struct gdt_pointer* gdtp = trampoline_address(smp_trampoline_gdtr);
+    gdtp->limit = sizeof(cpu->gdt) - 1;
+    gdtp->base = (uint32_t)cpu->gdt;
+    *(uint32_t*)trampoline_address(smp_trampoline_stack) = cpu->tss.esp0;
+    *(uint32_t*)trampoline_address(smp_trampoline_entry) = (uint32_t)ap_main;
+    starting_cpu = cpu;
+
+    if (lapic_send_init(apic_id) < 0) {
+        return -1;
+    }
+    clock_delay_us(INIT_DELAY_US);
+    for (int i = 0; i < 2 && !cpu->online; i++) {
+        if (lapic_send_startup(apic_id, SMP_TRAMPOLINE_BASE) < 0) {
+            return -1;
+        }
+        clock_delay_us(STARTUP_DELAY_US);
+    }
+    for (int waited = 0; !cpu->online && waited < ONLINE_TIMEOUT_MS; waited++) {
+        clock_delay_us(1000);
+    }
+    return cpu->online ? 0 : -1;
+}
+
+void init_smp(void) {
+    struct madt_info madt;
+    // The startup delays are timed with the TSC
+    if (!cpu_has(CPU_FEATURE_APIC) || clock_tsc_khz() == 0 || acpi_find_madt(&madt) < 0) {
+        return;
+    }
+    lapic_init(madt.lapic_address);
+    lapic_enable();
+    cpus[0].apic_id = lapic_id();
+    processors_found = madt.processor_count;
+    lapic_timer_calibrate();            // The boot CPU's timers use it too
+    if (madt.processor_count < 2) {
+        return;
+    }
+
+    vector_register_handler(VECTOR_WAKEUP, wakeup);
+    memcpy((void*)SMP_TRAMPOLINE_BASE, smp_trampoline_start, smp_trampoline_end - smp_trampoline_start);
+
+    // One at a time: they share the trampoline, so stop at the first one
+    // that does not come up rather than risk it waking under the next
+    for (int i = 0; i < madt.processor_count && cpu_count < MAX_CPUS; i++) {
+        if (madt.apic_ids[i] == cpus[0].apic_id) continue;
+        if (start_ap(cpu_count, madt.apic_ids[i]) < 0) {
+            print_string("Error: CPU with APIC ID ");
+            print_int(madt.apic_ids[i]);
+            print_string(" did not start\n");
+            break;
+        }
+        cpu_count++;
+    }
+}
+
+int smp_cpu_count(void) {
+    return cpu_count;
+}
+
+void smp_wake(int cpu) {
+    if (cpu <= 0 || cpu >= cpu_count || cpu == cpu_id()) {
+        return;
+    }
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);    // The queued work before the flag
+    if (cpus[cpu].idle) {
+        lapic_send_ipi(cpus[cpu].apic_id, VECTOR_WAKEUP);
+    }
+}
+
+void smp_send_others(uint8_t vector) {
+    int self = cpu_id();
+    for (int i = 0; i < cpu_count; i++) {
+        if (i != self) {
+            lapic_send_ipi(cpus[i].apic_id, vector);
+        }
+    }
+}
+
+void smp_display(void) {
+    print_int(cpu_count);
+    print_string(" of ");
+    print_int(processors_found);
+    print_string(" CPUs online\n");
+    for (int i = 0; i < cpu_count; i++) {
+        print_string("CPU ");
+        print_int(i);
+        print_string(" (APIC ID ");
+        print_int(cpus[i].apic_id);
+        print_string("): ");
+        if (i == 0) {
+            print_string("boot CPU");
+        } else {
+            print_int(cpus[i].ticks);
+            print_string(cpus[i].idle ? " ticks, idle" : " ticks");
+        }
+        print_string(", ");
+        print_int(scheduler_load(i));
+        print_string(" processes queued\n");
+    }
+}
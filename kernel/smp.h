@@ -0,0 +1,30 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdint.h>
+
+// Per-CPU data is sized for MAX_CPUS. CPU 0 is the boot CPU, which runs the
+// shell; the application processors listed in the ACPI MADT are started by
+// init_smp and run the scheduler from a periodic timer while they have
+// work, and sleep untouched while they have none.
+#define MAX_CPUS 8
+#define SMP_TICK_HZ 100                 // Scheduler ticks per second on each AP
+#define SMP_TRAMPOLINE_BASE 0x8000      // Real-mode entry page for the APs (below 1MB)
+
+// Each CPU's %gs segment starts at its struct cpu, whose first field is the id
+static inline int cpu_id(void) {
+    int id;
+    asm ("movl %%gs:0, %0" : "=r"(id));
+    return id;
+}
+
+// Load CPU 0's GDT, TSS and %gs; must run before anything calls cpu_id()
+void init_boot_cpu(void);
+// Find the other CPUs through ACPI and start them
+void init_smp(void);
+int smp_cpu_count(void);                // CPUs 0 to count - 1 are running
+void smp_wake(int cpu);                 // Work was queued for it; restart its tick if idle
+void smp_send_others(uint8_t vector);   // IPI every other running CPU
+void smp_display(void);
+
+#endif
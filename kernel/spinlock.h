@@ -0,0 +1,53 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <stdint.h>
+#include "interrupts.h"
+#include "lockstat.h"
+
+// Ticket spinlock: each arrival takes the next ticket and waits for the
+// owner count to reach it, so CPUs get the lock in the order they asked.
+// Interrupt handlers take the same locks as the code they interrupt, so the
+// irqsave variants keep interrupts off while held; plain spin_lock is for
+// locks no handler takes, or for nesting inside one taken that way.
+typedef struct {
+    volatile uint16_t next;             // Ticket for the next arrival
+    volatile uint16_t owner;            // Ticket now holding the lock
+    struct lock_stats* stats;           // NULL when not tracked
+} spinlock_t;
+
+#define SPINLOCK_INIT { 0, 0, 0 }
+#define SPINLOCK_INIT_STATS(stats) { 0, 0, (stats) }
+
+void spin_lock_contended(spinlock_t* lock, uint16_t ticket);
+
+static inline void spin_lock_init(spinlock_t* lock, struct lock_stats* stats) {
+    lock->next = 0;
+    lock->owner = 0;
+    lock->stats = stats;
+}
+
+static inline void spin_lock(spinlock_t* lock) {
+    uint16_t ticket = __atomic_fetch_add(&lock->next, 1, __ATOMIC_RELAXED);
+    if (__builtin_expect(__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) != ticket, 0)) {
+        spin_lock_contended(lock, ticket);
+    }
+    LOCKSTAT_ACQUIRED(lock->stats);
+}
+
+static inline void spin_unlock(spinlock_t* lock) {
+    __atomic_store_n(&lock->owner, (uint16_t)(lock->owner + 1), __ATOMIC_RELEASE);
+}
+
+static inline uint32_t spin_lock_irqsave(spinlock_t* lock) {
+    uint32_t flags = interrupts_save();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags) {
+    spin_unlock(lock);
+    interrupts_restore(flags);
+}
+
+#endif
@@ -0,0 +1,307 @@
+#include "timer.h"
+#include "apic.h"
+#include "clock.h"
+#include "interrupts.h"
+#include "smp.h"
+#include "spinlock.h"
+#include "lockstat.h"
+#include "../include/kernel.h"
+
+#define PIT_CHANNEL0 0x40
+#define PIT_COMMAND 0x43
+#define PIT_MODE_ONESHOT 0x30           // Channel 0, lobyte/hibyte, mode 0
+#define PIT_MAX_COUNT 0xFFFF            // About 55 ms; longer waits take several
+
+#define EFLAGS_IF 0x200
+#define MAX_DEADLINE_US 0xFFFFFFFF
+
+enum { DEVICE_NONE, DEVICE_LAPIC, DEVICE_PIT };
+static const char* device_names[] = { "none", "local APIC", "PIT" };
+
+enum { TIMER_IDLE, TIMER_PENDING, TIMER_RUNNING };
+
+struct timer_cpu {
+    spinlock_t lock;
+    struct wheel wheel;
+    int device;
+    uint64_t deadline;                  // Tick the device is set for, WHEEL_NEVER if none
+    uint32_t interrupts;                // Deadlines reached
+    uint32_t expired;                   // Callbacks run
+    struct lock_stats stats;
+};
+
+static struct timer_cpu timer_cpus[MAX_CPUS];
+static int pit_borrowed = 0;
+
+// The TSC rate in kHz is its cycles per tick
+uint64_t timer_now(void) {
+    uint32_t khz = clock_tsc_khz();
+    return khz ? udiv64_32(rdtsc(), khz) : 0;
+}
+
+static void pit_oneshot(uint32_t us) {
+    uint64_t count = udiv64_32((uint64_t)us * PIT_FREQUENCY, 1000000);
+    if (count > PIT_MAX_COUNT) count = PIT_MAX_COUNT;
+    if (count == 0) count = 1;
+    outb(PIT_COMMAND, PIT_MODE_ONESHOT);
+    outb(PIT_CHANNEL0, count & 0xFF);
+    outb(PIT_CHANNEL0, count >> 8);
+}
+
+// Set the device for the first thing due on the wheel; tc->lock is held
+static void set_deadline(struct timer_cpu* tc) {
+    uint64_t next = wheel_next(&tc->wheel);
+    tc->deadline = next;
+    if (tc->device == DEVICE_PIT && pit_borrowed) {
+        return;
+    }
+    if (next == WHEEL_NEVER) {
+        if (tc->device == DEVICE_LAPIC) {
+            lapic_timer_stop();
+        }
+        return;                         // A PIT count still running ends harmlessly
+    }
+    uint64_t at = next * clock_tsc_khz();
+    uint64_t now = rdtsc();
+    uint64_t us = at > now ? clock_cycles_to_us(at - now) : 0;
+    if (us > MAX_DEADLINE_US) us = MAX_DEADLINE_US;
+    if (us == 0) us = 1;
+    if (tc->device == DEVICE_LAPIC) {
+        lapic_timer_oneshot((uint32_t)us);
+    } else if (tc->device == DEVICE_PIT) {
+        pit_oneshot((uint32_t)us);
+    }
+}
+
+static void deadline_reached(struct interrupt_frame* frame) {
+    (void)frame;
+    timer_interrupt();
+}
+
+void init_timers(void) {
+    int cpu = cpu_id();
+    struct timer_cpu* tc = &timer_cpus[cpu];
+    spin_lock_init(&tc->lock, &tc->stats);
+    lockstat_register(&tc->stats, "timer_wheel", cpu, LOCK_SPIN);
+    wheel_init(&tc->wheel, timer_now());
+    tc->deadline = WHEEL_NEVER;
+    tc->device = DEVICE_NONE;
+    if (clock_tsc_khz() == 0) {
+        return;
+    }
+    if (lapic_timer_calibrated()) {
+        tc->device = DEVICE_LAPIC;
+        vector_register_handler(VECTOR_APIC_TIMER, deadline_reached);
+    } else if (cpu == 0) {
+        tc->device = DEVICE_PIT;
+        irq_register_handler(IRQ_TIMER, deadline_reached);
+        irq_unmask(IRQ_TIMER);
+    }
+}
+
+void timer_init(struct timer* timer, timer_callback_t callback, void* data) {
+    memset(&timer->entry, 0, sizeof(timer->entry));
+    timer->callback = callback;
+    timer->data = data;
+    timer->period = 0;
+    timer->cpu = -1;
+    timer->state = TIMER_IDLE;
+}
+
+static void add_timer(struct timer* timer, uint32_t ms, uint32_t period) {
+    timer_cancel(timer);
+    int cpu = cpu_id();
+    struct timer_cpu* tc = &timer_cpus[cpu];
+    uint32_t flags = spin_lock_irqsave(&tc->lock);
+    // A tick more, as the current one may be nearly over
+    timer->entry.expires = timer_now() + ms + 1;
+    timer->period = period;
+    timer->cpu = cpu;
+    timer->state = TIMER_PENDING;
+    wheel_add(&tc->wheel, &timer->entry);
+    if (timer->entry.expires < tc->deadline) {
+        set_deadline(tc);
+    }
+    spin_unlock_irqrestore(&tc->lock, flags);
+}
+
+void timer_add(struct timer* timer, uint32_t ms) {
+    add_timer(timer, ms, 0);
+}
+
+void timer_add_periodic(struct timer* timer, uint32_t period_ms) {
+    add_timer(timer, period_ms, period_ms ? period_ms : 1);
+}
+
+int timer_cancel(struct timer* timer) {
+    while (1) {
+        int cpu = timer->cpu;
+        if (cpu < 0) {
+            return 0;
+        }
+        struct timer_cpu* tc = &timer_cpus[cpu];
+        uint32_t flags = spin_lock_irqsave(&tc->lock);
+        if (timer->cpu != cpu) {
+            spin_unlock_irqrestore(&tc->lock, flags);
+            continue;                   // Moved meanwhile
+        }
+        int was_pending = timer->state == TIMER_PENDING;
+        if (was_pending) {
+            wheel_remove(&tc->wheel, &timer->entry);
+        }
+        timer->state = TIMER_IDLE;      // A running one is not put back
+        timer->cpu = -1;
+        spin_unlock_irqrestore(&tc->lock, flags);
+        return was_pending;
+    }
+}
+
+int timer_pending(const struct timer* timer) {
+    return timer->state == TIMER_PENDING;
+}
+
+void timer_interrupt(void) {
+    int cpu = cpu_id();
+    struct timer_cpu* tc = &timer_cpus[cpu];
+    uint32_t flags = spin_lock_irqsave(&tc->lock);
+    tc->interrupts++;
+    uint64_t now = timer_now();
+    struct wheel_entry* entry;
+    while ((entry = wheel_expire(&tc->wheel, now)) != NULL) {
+        struct timer* timer = (struct timer*)entry;
+        timer->state = TIMER_RUNNING;
+        tc->expired++;
+        spin_unlock_irqrestore(&tc->lock, flags);
+        timer->callback(timer, timer->data);
+        flags = spin_lock_irqsave(&tc->lock);
+        // Unless the callback cancelled or re-added it
+        if (timer->state != TIMER_RUNNING || timer->cpu != cpu) {
+            continue;
+        }
+        if (timer->period) {
+            timer->entry.expires += timer->period;
+            if (timer->entry.expires <= now) {
+                timer->entry.expires = now + timer->period;   // Behind: skip the runs missed
+            }
+            timer->state = TIMER_PENDING;
+            wheel_add(&tc->wheel, &timer->entry);
+        } else {
+            timer->state = TIMER_IDLE;
+            timer->cpu = -1;
+        }
+    }
+    set_deadline(tc);
+    spin_unlock_irqrestore(&tc->lock, flags);
+}
+
+static void wake_sleeper(struct timer* timer, void* data) {
+    (void)timer;
+    *(volatile int*)data = 1;
+}
+
+void timer_sleep_ms(uint32_t ms) {
+    struct timer_cpu* tc = &timer_cpus[cpu_id()];
+    uint32_t flags = interrupts_save();
+    if (tc->device == DEVICE_NONE || !(flags & EFLAGS_IF)) {
+        interrupts_restore(flags);
+        clock_delay_us(ms * 1000);
+        return;
+    }
+    volatile int done = 0;
+    struct timer timer;
+    timer_init(&timer, wake_sleeper, (void*)&done);
+    timer_add(&timer, ms);
+    // sti holds interrupts off for one more instruction, so one that
+    // comes after the check still ends the hlt
+    while (!done) {
+        asm volatile ("sti; hlt; cli" ::: "memory");
+    }
+    interrupts_restore(flags);
+}
+
+int timer_wait(int (*done)(void* data), void* data, uint32_t ms) {
+    struct timer_cpu* tc = &timer_cpus[cpu_id()];
+    uint32_t flags = interrupts_save();
+    int halt = tc->device != DEVICE_NONE;
+    uint64_t deadline = timer_now() + ms;
+    volatile int woken = 0;
+    struct timer timer;
+    // The timer's interrupt is what ends the last hlt
+    if (halt) {
+        timer_init(&timer, wake_sleeper, (void*)&woken);
+        timer_add(&timer, ms);
+    }
+    int result = 0;
+    while (!done(data)) {
+        if (woken || timer_now() >= deadline) {
+            result = -1;
+            break;
+        }
+        if (halt) {
+            asm volatile ("sti; hlt; cli" ::: "memory");
+        } else {
+            asm volatile ("sti; pause; cli" ::: "memory");
+        }
+    }
+    if (halt) timer_cancel(&timer);
+    interrupts_restore(flags);
+    return result;
+}
+
+int timer_pit_borrow(void) {
+    if (timer_cpus[0].device != DEVICE_PIT) {
+        return 0;
+    }
+    pit_borrowed = 1;
+    return 1;
+}
+
+void timer_pit_return(void) {
+    struct timer_cpu* tc = &timer_cpus[0];
+    if (tc->device != DEVICE_PIT) {
+        return;
+    }
+    uint32_t flags = spin_lock_irqsave(&tc->lock);
+    pit_borrowed = 0;
+    irq_register_handler(IRQ_TIMER, deadline_reached);
+    irq_unmask(IRQ_TIMER);
+    set_deadline(tc);
+    spin_unlock_irqrestore(&tc->lock, flags);
+}
+
+void timer_display(void) {
+    if (clock_tsc_khz() == 0) {
+        print_string("Error: No TSC, so timers do not run\n");
+        return;
+    }
+    uint64_t now = timer_now();
+    for (int cpu = 0; cpu < smp_cpu_count(); cpu++) {
+        struct timer_cpu* tc = &timer_cpus[cpu];
+        uint32_t flags = spin_lock_irqsave(&tc->lock);
+        uint32_t pending = tc->wheel.count;
+        uint64_t deadline = tc->deadline;
+        uint32_t interrupts = tc->interrupts;
+        uint32_t expired = tc->expired;
+        spin_unlock_irqrestore(&tc->lock, flags);
+
+        print_string("CPU ");
+        print_int(cpu);
+        print_string(" (");
+        print_string(device_names[tc->device]);
+        print_string("): ");
+        print_int(pending);
+        print_string(" pending, ");
+        if (deadline == WHEEL_NEVER) {
+            print_string("no deadline");
+        } else {
+            print_string("deadline in ");
+            print_uint64(deadline > now ? deadline - now : 0);
+            print_string(" ms");
+        }
+        print_string(", ");
+        print_uint64(interrupts);
+        print_string(" interrupts, ");
+        print_uint64(expired);
+        print_string(" run\n");
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include "wheel.h"
+
+// Kernel timers: one-shot or periodic callbacks with millisecond ticks,
+// kept in a timing wheel per CPU. Nothing ticks periodically: each CPU's
+// local APIC timer, or the PIT on a boot CPU without one, is set for the
+// first thing due on its wheel and nothing else, so an idle CPU with no
+// timers pending is not woken at all.
+//
+// A timer runs on the CPU that added it, in interrupt context and with no
+// locks held; it may add or cancel timers, itself included. Time comes
+// from the TSC, so without one timers never run.
+#define TIMER_HZ 1000
+
+struct timer;
+typedef void (*timer_callback_t)(struct timer* timer, void* data);
+
+struct timer {
+    struct wheel_entry entry;           // First, so a wheel entry is its timer
+    timer_callback_t callback;
+    void* data;
+    uint32_t period;                    // Ticks between runs, 0 for one-shot
+    volatile int cpu;                   // Wheel it is on or running from, -1 if neither
+    volatile int state;
+};
+
+// Set up this CPU's wheel and deadline timer; each CPU calls it once
+void init_timers(void);
+void timer_init(struct timer* timer, timer_callback_t callback, void* data);
+// Run once, or every period, from `ms` from now on; re-adding one that is
+// pending moves it
+void timer_add(struct timer* timer, uint32_t ms);
+void timer_add_periodic(struct timer* timer, uint32_t period_ms);
+// 1 if it was pending. A callback already running on another CPU is not
+// waited for, but a periodic timer cancelled from it does not come back.
+int timer_cancel(struct timer* timer);
+int timer_pending(const struct timer* timer);
+uint64_t timer_now(void);               // Ticks since the TSC started
+
+// Halt until `ms` have passed; busy-waits instead when interrupts are off
+void timer_sleep_ms(uint32_t ms);
+// Halt with interrupts on until done(data) or `ms` pass, then restore the
+// caller's flags; 0 if done, -1 on timeout. For waits on a device's
+// interrupt, which may never come. Before init_timers it polls instead of
+// halting; the deadline is kept by the TSC either way, so without one it
+// never times out.
+int timer_wait(int (*done)(void* data), void* data, uint32_t ms);
+
+// The profiler drives the PIT at its own rate while it runs. Returns 1 if
+// the PIT is this CPU's deadline timer, and the profiler's ticks must then
+// call timer_interrupt in its place until timer_pit_return.
+int timer_pit_borrow(void);
+void timer_pit_return(void);
+void timer_interrupt(void);             // Run what is due, set the next deadline
+
+void timer_display(void);
+
+#endif
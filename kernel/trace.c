@@ -0,0 +1,140 @@
+#include "trace.h"
+#include "smp.h"
+#include "interrupts.h"
+#include "clock.h"
+#include "../drivers/serial.h"
+#include "../include/kernel.h"
+
+struct trace_ring {
+    struct trace_record records[TRACE_RING_SIZE];
+    uint32_t head;                      // Records written since the ring was cleared
+};
+
+#define TRACE_EVENT_INFO(id, name, phase) { name, phase },
+static const struct {
+    const char* name;
+    char phase;
+} events[] = { TRACE_EVENTS(TRACE_EVENT_INFO) };
+#undef TRACE_EVENT_INFO
+
+int trace_enabled = 0;
+static struct trace_ring rings[MAX_CPUS];
+
+void trace_write(int event, uint32_t arg0, uint32_t arg1) {
+    // Interrupt handlers trace too; claim the slot with them held off
+    uint32_t flags = interrupts_save();
+    struct trace_ring* ring = &rings[cpu_id()];
+    struct trace_record* record = &ring->records[ring->head++ & (TRACE_RING_SIZE - 1)];
+    record->tsc = rdtsc();
+    record->cpu = cpu_id();
+    record->event = event;
+    record->args[0] = arg0;
+    record->args[1] = arg1;
+    interrupts_restore(flags);
+}
+
+void trace_start(void) {
+    trace_enabled = 0;
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        rings[cpu].head = 0;
+    }
+    trace_enabled = 1;
+}
+
+void trace_stop(void) {
+    trace_enabled = 0;
+}
+
+static uint32_t ring_count(const struct trace_ring* ring) {
+    return ring->head < TRACE_RING_SIZE ? ring->head : TRACE_RING_SIZE;
+}
+
+void trace_status(void) {
+    print_string(trace_enabled ? "Tracing is on\n" : "Tracing is off\n");
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        print_string("CPU ");
+        print_int(cpu);
+        print_string(": ");
+        print_int(ring_count(&rings[cpu]));
+        print_string(" records");
+        if (rings[cpu].head > TRACE_RING_SIZE) {
+            print_string(", ");
+            print_int(rings[cpu].head - TRACE_RING_SIZE);
+            print_string(" overwritten");
+        }
+        print_char('\n');
+    }
+}
+
+static void serial_write_hex(uint32_t value, int digits) {
+    for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4) {
+        serial_write_char("0123456789abcdef"[(value >> shift) & 0xF]);
+    }
+}
+
+// Format on COM1:
+//   # trace begin tsc_khz=<khz> cpus=<n> records=<n>
+//   # event <id> <phase> <name>        For every event id
+//   <tsc> <cpu> <event> <arg0> <arg1>  Oldest first; tsc (16 digits) and
+//                                      the args (8) in hex, cpu and event
+//                                      in decimal
+//   # trace end
+void trace_dump(void) {
+    int was_enabled = trace_enabled;
+    trace_enabled = 0;
+
+    uint32_t total = 0;
+    uint32_t next[MAX_CPUS];            // Position of each ring's oldest unsent record
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        total += ring_count(&rings[cpu]);
+        next[cpu] = rings[cpu].head - ring_count(&rings[cpu]);
+    }
+    serial_write_string("# trace begin tsc_khz=");
+    serial_write_int(clock_tsc_khz());
+    serial_write_string(" cpus=");
+    serial_write_int(MAX_CPUS);
+    serial_write_string(" records=");
+    serial_write_int(total);
+    serial_write_char('\n');
+    for (int i = 0; i < TRACE_EVENT_COUNT; i++) {
+        serial_write_string("# event ");
+        serial_write_int(i);
+        serial_write_char(' ');
+        serial_write_char(events[i].phase);
+        serial_write_char(' ');
+        serial_write_string(events[i].name);
+        serial_write_char('\n');
+    }
+
+    // Merge the per-CPU rings by timestamp
+    for (uint32_t sent = 0; sent < total; sent++) {
+        const struct trace_record* oldest = NULL;
+        int oldest_cpu = 0;
+        for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+            if (next[cpu] == rings[cpu].head) continue;
+            const struct trace_record* record = &rings[cpu].records[next[cpu] & (TRACE_RING_SIZE - 1)];
+            if (oldest == NULL || record->tsc < oldest->tsc) {
+                oldest = record;
+                oldest_cpu = cpu;
+            }
+        }
+        next[oldest_cpu]++;
+        serial_write_hex(oldest->tsc >> 32, 8);
+        serial_write_hex((uint32_t)oldest->tsc, 8);
+        serial_write_char(' ');
+        serial_write_int(oldest->cpu);
+        serial_write_char(' ');
+        serial_write_int(oldest->event);
+        serial_write_char(' ');
+        serial_write_hex(oldest->args[0], 8);
+        serial_write_char(' ');
+        serial_write_hex(oldest->args[1], 8);
+        serial_write_char('\n');
+    }
+    serial_write_string("# trace end\n");
+
+    print_string("Sent ");
+    print_int(total);
+    print_string(" records to COM1\n");
+    trace_enabled = was_enabled;
+}
@@ -0,0 +1,64 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// Static tracepoints. Each writes a fixed-size record (TSC, CPU, event, two
+// arguments) into its CPU's ring, overwriting the oldest once the ring is
+// full. While tracing is off a tracepoint is one predicted branch.
+//
+// Events are declared once as EVENT(id, name, phase); the phase is 'B' or
+// 'E' for the start and end of a span, 'i' for an instant. 'trace dump'
+// sends the table and the records over COM1, and tools/trace2json turns
+// them into Chrome trace-event JSON.
+#define TRACE_EVENTS(EVENT) \
+    EVENT(TRACE_SCHED_SWITCH, "sched_switch", 'i')          /* previous pid or -1, next pid */ \
+    EVENT(TRACE_PROCESS_CREATE, "process_create", 'i')      /* pid, burst time */ \
+    EVENT(TRACE_PROCESS_EXIT, "process_exit", 'i')          /* pid */ \
+    EVENT(TRACE_PROCESS_KILL, "process_kill", 'i')          /* pid */ \
+    EVENT(TRACE_PROCESS_STEAL, "process_steal", 'i')        /* pid, CPU it was taken from */ \
+    EVENT(TRACE_COMMAND_BEGIN, "command", 'B')              /* index in COMMAND_LIST, argc */ \
+    EVENT(TRACE_COMMAND_END, "command", 'E') \
+    EVENT(TRACE_FS_CREATE, "fs_create", 'i')                /* file slot */ \
+    EVENT(TRACE_FS_DELETE, "fs_delete", 'i')                /* file slot */ \
+    EVENT(TRACE_FS_READ_BEGIN, "fs_read", 'B')              /* file slot */ \
+    EVENT(TRACE_FS_READ_END, "fs_read", 'E')                /* result */ \
+    EVENT(TRACE_FS_WRITE_BEGIN, "fs_write", 'B')            /* file slot, bytes */ \
+    EVENT(TRACE_FS_WRITE_END, "fs_write", 'E')              /* result */ \
+    EVENT(TRACE_BLOCK_READ_BEGIN, "block_read", 'B')        /* lba, sectors */ \
+    EVENT(TRACE_BLOCK_READ_END, "block_read", 'E')          /* result */ \
+    EVENT(TRACE_BLOCK_WRITE_BEGIN, "block_write", 'B')      /* lba, sectors */ \
+    EVENT(TRACE_BLOCK_WRITE_END, "block_write", 'E')        /* result */ \
+    EVENT(TRACE_BLOCK_SUBMIT_BEGIN, "block_submit", 'B')    /* requests, first lba */ \
+    EVENT(TRACE_BLOCK_SUBMIT_END, "block_submit", 'E')      /* result */
+
+#define TRACE_EVENT_ID(id, name, phase) id,
+enum trace_event { TRACE_EVENTS(TRACE_EVENT_ID) TRACE_EVENT_COUNT };
+#undef TRACE_EVENT_ID
+
+#define TRACE_RING_SIZE 4096            // Records per CPU, a power of two
+
+struct trace_record {
+    uint64_t tsc;
+    uint8_t cpu;
+    uint8_t reserved;
+    uint16_t event;
+    uint32_t args[2];
+};
+
+extern int trace_enabled;
+
+void trace_write(int event, uint32_t arg0, uint32_t arg1);
+
+#define TRACE(event, arg0, arg1) do { \
+    if (__builtin_expect(trace_enabled, 0)) { \
+        trace_write((event), (uint32_t)(arg0), (uint32_t)(arg1)); \
+    } \
+} while (0)
+
+void trace_start(void);                 // Clears the rings
+void trace_stop(void);
+void trace_status(void);
+void trace_dump(void);                  // Records in time order, over COM1
+
+#endif
@@ -0,0 +1,129 @@
+#include "wheel.h"
+#include "../include/kernel.h"
+
+#define SLOT_MASK (WHEEL_SLOTS - 1)
+#define LEVEL_SHIFT(level) ((level) * WHEEL_BITS)
+#define MAX_DELTA ((1ull << LEVEL_SHIFT(WHEEL_LEVELS)) - 1)
+
+// Lowest set bit of a non-zero mask, in 32-bit halves (there is no libgcc)
+static inline int lowest_bit(uint64_t bits) {
+    uint32_t low = bits;
+    return low ? __builtin_ctz(low) : 32 + __builtin_ctz((uint32_t)(bits >> 32));
+}
+
+// Slots from `index` on, wrapping, become bits from 0 on
+static inline uint64_t rotate_right(uint64_t bits, int index) {
+    return index ? (bits >> index) | (bits << (WHEEL_SLOTS - index)) : bits;
+}
+
+void wheel_init(struct wheel* wheel, uint64_t now) {
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now = now;
+}
+
+void wheel_add(struct wheel* wheel, struct wheel_entry* entry) {
+    uint64_t expires = entry->expires < wheel->now ? wheel->now : entry->expires;
+    uint64_t delta = expires - wheel->now;
+    if (delta > MAX_DELTA) {
+        // Parked in the top level; it is placed again when that slot cascades
+        delta = MAX_DELTA;
+        expires = wheel->now + MAX_DELTA;
+    }
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= (1ull << LEVEL_SHIFT(level + 1))) {
+        level++;
+    }
+    int index = (expires >> LEVEL_SHIFT(level)) & SLOT_MASK;
+    struct wheel_entry** head = &wheel->slots[level][index];
+    entry->next = *head;
+    if (entry->next) {
+        entry->next->prev = &entry->next;
+    }
+    entry->prev = head;
+    *head = entry;
+    entry->slot = level * WHEEL_SLOTS + index;
+    wheel->occupied[level] |= 1ull << index;
+    wheel->count++;
+}
+
+void wheel_remove(struct wheel* wheel, struct wheel_entry* entry) {
+    *entry->prev = entry->next;
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    }
+    int level = entry->slot / WHEEL_SLOTS;
+    int index = entry->slot % WHEEL_SLOTS;
+    if (wheel->slots[level][index] == NULL) {
+        wheel->occupied[level] &= ~(1ull << index);
+    }
+    entry->next = NULL;
+    entry->prev = NULL;
+    wheel->count--;
+}
+
+// wheel->now has just reached a multiple of WHEEL_SLOTS: empty the slots
+// of the levels above that cover the ticks starting here into lower ones
+static void cascade(struct wheel* wheel) {
+    for (int level = 1; level < WHEEL_LEVELS; level++) {
+        int index = (wheel->now >> LEVEL_SHIFT(level)) & SLOT_MASK;
+        struct wheel_entry* entry = wheel->slots[level][index];
+        wheel->slots[level][index] = NULL;
+        wheel->occupied[level] &= ~(1ull << index);
+        while (entry) {
+            struct wheel_entry* next = entry->next;
+            wheel->count--;
+            wheel_add(wheel, entry);
+            entry = next;
+        }
+        if (index != 0) {
+            break;
+        }
+    }
+}
+
+struct wheel_entry* wheel_expire(struct wheel* wheel, uint64_t now) {
+    while (wheel->now <= now) {
+        int index = wheel->now & SLOT_MASK;
+        struct wheel_entry* entry = wheel->slots[0][index];
+        if (entry) {
+            wheel_remove(wheel, entry);
+            return entry;
+        }
+        // Jump to the next occupied slot before the end of this round, or
+        // to the end of the round, but not past `now`
+        uint64_t later = index == SLOT_MASK ? 0 : wheel->occupied[0] >> (index + 1);
+        uint64_t next = wheel->now - index +
+                        (later ? index + 1 + lowest_bit(later) : WHEEL_SLOTS);
+        wheel->now = next <= now ? next : now + 1;
+        if ((wheel->now & SLOT_MASK) == 0) {
+            cascade(wheel);
+        }
+    }
+    return NULL;
+}
+
+uint64_t wheel_next(const struct wheel* wheel) {
+    if (wheel->count == 0) {
+        return WHEEL_NEVER;
+    }
+    uint64_t next = WHEEL_NEVER;
+    if (wheel->occupied[0]) {
+        int index = wheel->now & SLOT_MASK;
+        next = wheel->now + lowest_bit(rotate_right(wheel->occupied[0], index));
+    }
+    // A slot further up cascades when the tick it covers starts. The
+    // current one has cascaded already, so what it holds is a round away.
+    for (int level = 1; level < WHEEL_LEVELS; level++) {
+        if (!wheel->occupied[level]) {
+            continue;
+        }
+        uint64_t block = wheel->now >> LEVEL_SHIFT(level);
+        int index = block & SLOT_MASK;
+        int distance = lowest_bit(rotate_right(wheel->occupied[level], index));
+        uint64_t cascade_at = (block + (distance ? distance : WHEEL_SLOTS)) << LEVEL_SHIFT(level);
+        if (cascade_at < next) {
+            next = cascade_at;
+        }
+    }
+    return next;
+}
@@ -0,0 +1,47 @@
+#ifndef WHEEL_H
+#define WHEEL_H
+
+#include <stdint.h>
+
+// Hierarchical timing wheel (Varghese and Lauck). Level 0 has a slot per
+// tick for the next WHEEL_SLOTS ticks, and each level above covers
+// WHEEL_SLOTS times the span of the one below, so an entry goes straight
+// into one slot's list and adding or removing it is O(1). Entries further
+// out are moved down a level ("cascaded") as the wheel reaches their slot,
+// so each one is moved at most WHEEL_LEVELS - 1 times. A bitmap of
+// occupied slots per level lets the wheel skip empty ticks, and tells how
+// long it can be left alone.
+//
+// The wheel has no lock and no clock of its own: the caller serializes
+// access and says what tick it is.
+#define WHEEL_LEVELS 4
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)       // 64, one bit each in a uint64_t
+#define WHEEL_NEVER 0xFFFFFFFFFFFFFFFFull
+
+struct wheel_entry {
+    struct wheel_entry* next;
+    struct wheel_entry** prev;      // The pointer to this entry, in a slot or an entry
+    uint64_t expires;               // Tick it is due at
+    uint16_t slot;                  // level * WHEEL_SLOTS + index, while queued
+};
+
+struct wheel {
+    uint64_t now;                   // Next tick to process
+    uint32_t count;                 // Entries queued
+    uint64_t occupied[WHEEL_LEVELS];
+    struct wheel_entry* slots[WHEEL_LEVELS][WHEEL_SLOTS];
+};
+
+void wheel_init(struct wheel* wheel, uint64_t now);
+// Queue `entry` for entry->expires; ticks already processed mean the next one
+void wheel_add(struct wheel* wheel, struct wheel_entry* entry);
+void wheel_remove(struct wheel* wheel, struct wheel_entry* entry);
+// Advance to tick `now` and take off one entry that is due by then, or
+// return NULL once none are left
+struct wheel_entry* wheel_expire(struct wheel* wheel, uint64_t now);
+// Tick by which something may be due: the first expiry, or earlier when
+// the first thing to do is cascade; WHEEL_NEVER when the wheel is empty
+uint64_t wheel_next(const struct wheel* wheel);
+
+#endif
@@ -1,11 +1,28 @@
 #include "process.h"
+#include "sync.h"
 #include "../include/kernel.h"
+#include "../kernel/smp.h"
+#include "../kernel/spinlock.h"
+#include "../kernel/lockstat.h"
+#include "../kernel/trace.h"
+
+// Each CPU schedules its own run queue. The boot CPU runs the shell, so its
+// queue only moves when the shell calls schedule(); the other CPUs call
+// scheduler_tick() from their timers and steal work when they run dry,
+// and are woken with smp_wake() when work is queued for them.
+struct run_queue {
+    spinlock_t lock;
+    Queue ready;
+    Process* current;
+    struct lock_stats stats;
+};
 
 // Global variables
 static Process processes[MAX_PROCESSES];
 static int next_pid = 0;
-static Queue ready_queue;
-static Process* current_process = NULL;
+static struct run_queue run_queues[MAX_CPUS];
+static spinlock_t table_lock;               // Claiming free process slots
+static struct lock_stats table_stats;
 
 // Initialize the scheduler
 void init_scheduler() {
@@ -17,17 +34,74 @@ void init_scheduler() {
         processes[i].time_quantum = 0;
         processes[i].burst_time = 0;
         processes[i].time_remaining = 0;
+        processes[i].cpu = 0;
+        processes[i].lock = NULL;
+        processes[i].holds_lock = 0;
+        processes[i].next_waiter = NULL;
     }
     
-    // Initialize ready queue
-    queue_init(&ready_queue);
-    current_process = NULL;
+    // Initialize the run queues
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        spin_lock_init(&run_queues[cpu].lock, &run_queues[cpu].stats);
+        lockstat_register(&run_queues[cpu].stats, "run_queue", cpu, LOCK_SPIN);
+        queue_init(&run_queues[cpu].ready);
+        run_queues[cpu].current = NULL;
+    }
+    spin_lock_init(&table_lock, &table_stats);
+    lockstat_register(&table_stats, "process_table", -1, LOCK_SPIN);
     next_pid = 0;
 }
 
+static int queue_load(const struct run_queue* rq) {
+    return rq->ready.size + (rq->current != NULL);
+}
+
+int scheduler_load(int cpu) {
+    if (cpu < 0 || cpu >= MAX_CPUS) {
+        return 0;
+    }
+    return queue_load(&run_queues[cpu]);
+}
+
+// New processes go to the least loaded application processor, or to the
+// boot CPU when it is the only one
+static int pick_cpu(void) {
+    int best = 0;
+    for (int cpu = 1; cpu < smp_cpu_count(); cpu++) {
+        if (best == 0 || queue_load(&run_queues[cpu]) < queue_load(&run_queues[best])) {
+            best = cpu;
+        }
+    }
+    return best;
+}
+
 // Create a new process
 int create_process(const char* name, int burst_time) {
+    return create_process_with_lock(name, burst_time, NULL);
+}
+
+static int create_on(const char* name, int burst_time, struct mutex* lock, int cpu);
+
+// Create a process that must hold `lock` to run
+int create_process_with_lock(const char* name, int burst_time, struct mutex* lock) {
+    return create_on(name, burst_time, lock, pick_cpu());
+}
+
+// Create a process on a given CPU's run queue, for measurements that must
+// run there. An idle CPU may still steal it.
+int create_process_on_cpu(const char* name, int burst_time, int cpu) {
+    if (cpu < 0 || cpu >= smp_cpu_count()) {
+        return -1;
+    }
+    return create_on(name, burst_time, NULL, cpu);
+}
+
+static int create_on(const char* name, int burst_time, struct mutex* lock, int cpu) {
+    struct run_queue* rq = &run_queues[cpu];
+    uint32_t flags = spin_lock_irqsave(&rq->lock);
+
     // Find a free process slot
+    spin_lock(&table_lock);
     int pid = -1;
     for (int i = 0; i < MAX_PROCESSES; i++) {
         if (!is_process_alive(i)) {
@@ -37,6 +111,8 @@ int create_process(const char* name, int burst_time) {
     }
 
     if (pid == -1) {
+        spin_unlock(&table_lock);
+        spin_unlock_irqrestore(&rq->lock, flags);
         return -1; // No free slots
     }
 
@@ -49,16 +125,56 @@ int create_process(const char* name, int burst_time) {
     new_process->time_quantum = burst_time;
     new_process->burst_time = burst_time;
     new_process->time_remaining = burst_time;
+    new_process->cpu = cpu;
+    new_process->lock = lock;
+    new_process->holds_lock = 0;
+    new_process->next_waiter = NULL;
+    spin_unlock(&table_lock);
+    TRACE(TRACE_PROCESS_CREATE, pid, burst_time);
 
     // Add to ready queue
-    queue_push(&ready_queue, new_process);
+    queue_push(&rq->ready, new_process);
+    spin_unlock_irqrestore(&rq->lock, flags);
     
-    // Run one scheduling cycle to start it
-    schedule();
+    // Run one scheduling cycle to start it if it is ours to run
+    if (cpu == cpu_id()) {
+        schedule();
+    } else {
+        smp_wake(cpu);
+    }
 
     return pid;
 }
 
+// Lock the run queue `proc` is on, taking it off any wait list. It can be
+// stolen while we wait, and until it has its lock it can be handed it and
+// moved to the waker's queue; going through the wait list settles which.
+static struct run_queue* lock_process_queue(Process* proc, uint32_t* flags) {
+    while (1) {
+        int cpu = proc->cpu;
+        struct run_queue* rq = &run_queues[cpu];
+        *flags = spin_lock_irqsave(&rq->lock);
+        if (proc->cpu == cpu &&
+            (proc->lock == NULL || mutex_cancel(proc->lock, proc) || proc->cpu == cpu)) {
+            return rq;
+        }
+        spin_unlock_irqrestore(&rq->lock, *flags);
+    }
+}
+
+// Pass the lock of a process that is ending to its first waiter, which
+// joins the same queue; rq->lock is held
+static void release_lock(struct run_queue* rq, Process* p) {
+    if (p->lock == NULL || !p->holds_lock) {
+        return;
+    }
+    p->holds_lock = 0;
+    Process* next = mutex_unlock(p->lock, rq - run_queues);
+    if (next != NULL) {
+        queue_push(&rq->ready, next);
+    }
+}
+
 // Kill a process
 void kill_process(int pid) {
     if (pid < 0 || pid >= MAX_PROCESSES) {
@@ -66,17 +182,31 @@ void kill_process(int pid) {
     }
     
     Process* proc = &processes[pid];
+    uint32_t flags;
+    struct run_queue* rq = lock_process_queue(proc, &flags);
     if (proc->state == TERMINATED) {
+        spin_unlock_irqrestore(&rq->lock, flags);
         return;  // Process already terminated
     }
     
     // Mark process as terminated
+    TRACE(TRACE_PROCESS_KILL, pid, 0);
     proc->state = TERMINATED;
     proc->time_remaining = 0;
+    int was_current = rq->current == proc;
+    if (was_current) {
+        rq->current = NULL;
+    } else {
+        queue_remove(&rq->ready, proc);
+    }
+    release_lock(rq, proc);
+    spin_unlock_irqrestore(&rq->lock, flags);
     
-    // If this is the current process, schedule next one
-    if (current_process && current_process->pid == pid) {
-        current_process = NULL;
+    // If this is the current process, schedule next one; another CPU may
+    // have been handed a lock waiter to run
+    if (rq != &run_queues[cpu_id()]) {
+        smp_wake(rq - run_queues);
+    } else if (was_current) {
         schedule();
     }
 }
@@ -100,83 +230,166 @@ int get_running_process_count() {
     return count;
 }
 
+// One line of scheduler output, printed whole so other CPUs' lines don't
+// interleave with it
+static void report(const char* what, const char* name, int cpu) {
+    char line[80];
+    strcpy(line, what);
+    strcpy(line + strlen(line), name);
+    if (smp_cpu_count() > 1) {
+        strcpy(line + strlen(line), " (CPU ");
+        int_to_string(cpu, line + strlen(line));
+        strcpy(line + strlen(line), ")");
+    }
+    strcpy(line + strlen(line), "\n");
+    print_string(line);
+}
+
 // Schedule the next process
 void schedule() {
+    int cpu = cpu_id();
+    struct run_queue* rq = &run_queues[cpu];
+    char terminated[32] = "";               // Reported once the lock is dropped
+    char running[32] = "";
+    int previous = -1;
+    uint32_t flags = spin_lock_irqsave(&rq->lock);
     // Check if current process is done
-    if (current_process != NULL) {
-        if (current_process->time_remaining <= 0) {
-            current_process->state = TERMINATED;
-            print_string("Process terminated: ");
-            print_string(current_process->name);
-            print_char('\n');
-            current_process = NULL;
-        } else if (current_process->time_quantum <= 0) {
+    if (rq->current != NULL) {
+        Process* current = rq->current;
+        previous = current->pid;
+        if (current->time_remaining <= 0) {
+            TRACE(TRACE_PROCESS_EXIT, current->pid, 0);
+            current->state = TERMINATED;
+            strcpy(terminated, current->name);
+            rq->current = NULL;
+            release_lock(rq, current);
+        } else if (current->time_quantum <= 0) {
             // Reset quantum and put back in queue
-            current_process->time_quantum = DEFAULT_QUANTUM;
-            current_process->state = READY;
-            queue_push(&ready_queue, current_process);
-            current_process = NULL;
+            current->time_quantum = DEFAULT_QUANTUM;
+            current->state = READY;
+            queue_push(&rq->ready, current);
+            rq->current = NULL;
         } else {
-            current_process->time_quantum--;
-            current_process->time_remaining--;
+            current->time_quantum--;
+            current->time_remaining--;
+            spin_unlock_irqrestore(&rq->lock, flags);
             return;  // Continue running current process
         }
     }
     
     // Get next process from ready queue
-    if (!queue_is_empty(&ready_queue)) {
-        current_process = queue_pop(&ready_queue);
-        current_process->state = RUNNING;
-        
-        print_string("Running process: ");
-        print_string(current_process->name);
-        print_char('\n');
+    while (rq->current == NULL && !queue_is_empty(&rq->ready)) {
+        Process* next = queue_pop(&rq->ready);
+        if (next->state == TERMINATED) continue;
+        // Until it has its lock it waits off the queue
+        if (next->lock && !next->holds_lock && !mutex_lock(next->lock, next)) continue;
+        next->state = RUNNING;
+        rq->current = next;
+        TRACE(TRACE_SCHED_SWITCH, previous, next->pid);
+        strcpy(running, next->name);
+    }
+    spin_unlock_irqrestore(&rq->lock, flags);
+
+    if (terminated[0]) {
+        report("Process terminated: ", terminated, cpu);
+    }
+    if (running[0]) {
+        report("Running process: ", running, cpu);
     }
 }
 
+// Move one waiting process from the busiest other queue to this CPU's.
+// Both queue locks are held for the move, the lower CPU's first.
+static void steal_work(int cpu) {
+    int victim = -1;
+    for (int i = 0; i < smp_cpu_count(); i++) {
+        if (i != cpu && run_queues[i].ready.size > 0 &&
+            (victim < 0 || run_queues[i].ready.size > run_queues[victim].ready.size)) {
+            victim = i;
+        }
+    }
+    if (victim < 0) {
+        return;
+    }
+    struct run_queue* first = &run_queues[cpu < victim ? cpu : victim];
+    struct run_queue* second = &run_queues[cpu < victim ? victim : cpu];
+    uint32_t flags = spin_lock_irqsave(&first->lock);
+    spin_lock(&second->lock);
+    Process* p = queue_pop(&run_queues[victim].ready);
+    if (p != NULL) {
+        p->cpu = cpu;
+        queue_push(&run_queues[cpu].ready, p);
+        TRACE(TRACE_PROCESS_STEAL, p->pid, victim);
+    }
+    spin_unlock(&second->lock);
+    spin_unlock_irqrestore(&first->lock, flags);
+}
+
+// Timer tick on an application processor: take work if idle, then run
+// one scheduling cycle
+void scheduler_tick(void) {
+    int cpu = cpu_id();
+    if (cpu >= smp_cpu_count()) {
+        return;  // Still starting up
+    }
+    if (scheduler_load(cpu) == 0) {
+        steal_work(cpu);
+    }
+    schedule();
+}
+
+static void print_process(const Process* p) {
+    print_string("PID: ");
+    print_int(p->pid);
+    print_string(" Name: ");
+    print_string(p->name);
+    print_string(" State: ");
+    
+    switch(p->state) {
+        case RUNNING:
+            print_string("RUNNING");
+            break;
+        case READY:
+            print_string("READY");
+            break;
+        case WAITING:
+            print_string("WAITING");
+            break;
+        default:
+            print_string("UNKNOWN");
+            break;
+    }
+    
+    print_string(" Time Remaining: ");
+    print_int(p->time_remaining);
+    if (smp_cpu_count() > 1) {
+        print_string(" CPU: ");
+        print_int(p->cpu);
+    }
+    if (p->state == WAITING && p->lock != NULL) {
+        print_string(" Waiting for: ");
+        print_string(p->lock->sem.stats.name);
+        print_string(" (PID ");
+        print_int(p->lock->owner);
+        print_char(')');
+    }
+    print_char('\n');
+}
+
 // Display all processes
 void display_processes() {
     int found = 0;
     print_string("=== Active Processes ===\n");
     
-    // First show running process if any
-    if (current_process != NULL) {
-        print_string("PID: ");
-        print_int(current_process->pid);
-        print_string(" Name: ");
-        print_string(current_process->name);
-        print_string(" State: RUNNING");
-        print_string(" Time Remaining: ");
-        print_int(current_process->time_remaining);
-        print_char('\n');
-        found = 1;
-    }
-    
-    // Then show other processes
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        Process* p = &processes[i];
-        if (p->pid != -1 && p != current_process && p->state != TERMINATED) {
-            print_string("PID: ");
-            print_int(p->pid);
-            print_string(" Name: ");
-            print_string(p->name);
-            print_string(" State: ");
-            
-            switch(p->state) {
-                case READY:
-                    print_string("READY");
-                    break;
-                case WAITING:
-                    print_string("WAITING");
-                    break;
-                default:
-                    print_string("UNKNOWN");
-                    break;
+    // Running processes first, then the others; a copy is printed so the
+    // other CPUs can go on scheduling meanwhile
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < MAX_PROCESSES; i++) {
+            Process p = processes[i];
+            if (p.pid == -1 || p.state == TERMINATED || (p.state == RUNNING) != (pass == 0)) {
+                continue;
             }
-            
-            print_string(" Time Remaining: ");
-            print_int(p->time_remaining);
-            print_char('\n');
+            print_process(&p);
             found = 1;
         }
     }
@@ -213,6 +426,17 @@ Process* queue_pop(Queue* q) {
     return p;
 }
 
+// Drop `p` from the queue, keeping the others in order
+void queue_remove(Queue* q, Process* p) {
+    int size = q->size;
+    for (int i = 0; i < size; i++) {
+        Process* item = queue_pop(q);
+        if (item != p) {
+            queue_push(q, item);
+        }
+    }
+}
+
 int queue_is_empty(Queue* q) {
     return q->size == 0;
 } 
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef PROCESS_H
 #define PROCESS_H
 
+#include <stdint.h>
+
 #define MAX_PROCESSES 32
 #define DEFAULT_QUANTUM 5
 
@@ -12,14 +14,21 @@ typedef enum {
     TERMINATED
 } ProcessState;
 
+struct mutex;
+
 // Process structure
-typedef struct {
+typedef struct Process {
     int pid;                    // Process ID
     char name[32];           // Process name
     ProcessState state;    // Current state
     int time_quantum;          // Time slice
     int burst_time;           // Total execution time needed
     int time_remaining;       // Time left to execute
+    int cpu;                  // Run queue it is on, guarded by that queue's lock
+    struct mutex* lock;       // Held from its first run until it ends, or NULL
+    int holds_lock;
+    uint64_t wait_start;      // TSC when it began waiting for the lock
+    struct Process* next_waiter;
 } Process;
 
 // Process queue
@@ -33,16 +42,21 @@ typedef struct {
 // Process management functions
 void init_scheduler(void);
 int create_process(const char* name, int burst_time);
+int create_process_with_lock(const char* name, int burst_time, struct mutex* lock);
+int create_process_on_cpu(const char* name, int burst_time, int cpu);
 void kill_process(int pid);
 void schedule(void);
 void display_processes(void);
 int is_process_alive(int pid);
 int get_running_process_count(void);
+void scheduler_tick(void);                  // From an application processor's timer
+int scheduler_load(int cpu);                // Running and ready processes on a CPU
 
 // Queue operations
 void queue_init(Queue* q);
 void queue_push(Queue* q, Process* p);
 Process* queue_pop(Queue* q);
+void queue_remove(Queue* q, Process* p);
 int queue_is_empty(Queue* q);
 
 #endif 
\ No newline at end of file
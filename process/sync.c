@@ -0,0 +1,105 @@
+#include "sync.h"
+#include "../kernel/clock.h"
+#include "../include/kernel.h"
+
+void sem_init(struct semaphore* sem, int count, const char* name, const char* kind) {
+    spin_lock_init(&sem->lock, NULL);
+    sem->count = count;
+    sem->head = NULL;
+    sem->tail = NULL;
+    lockstat_register(&sem->stats, name, -1, kind);
+}
+
+int sem_down(struct semaphore* sem, Process* p) {
+    uint32_t flags = spin_lock_irqsave(&sem->lock);
+    int acquired = sem->count > 0;
+    if (acquired) {
+        sem->count--;
+        p->holds_lock = 1;
+        LOCKSTAT_ACQUIRED(&sem->stats);
+    } else {
+        p->state = WAITING;
+        p->wait_start = lockstat_enabled ? rdtsc() : 0;
+        p->next_waiter = NULL;
+        if (sem->tail) {
+            sem->tail->next_waiter = p;
+        } else {
+            sem->head = p;
+        }
+        sem->tail = p;
+    }
+    spin_unlock_irqrestore(&sem->lock, flags);
+    return acquired;
+}
+
+Process* sem_up(struct semaphore* sem, int cpu) {
+    uint32_t flags = spin_lock_irqsave(&sem->lock);
+    Process* next = sem->head;
+    if (next == NULL) {
+        sem->count++;
+    } else {
+        sem->head = next->next_waiter;
+        if (sem->head == NULL) {
+            sem->tail = NULL;
+        }
+        next->next_waiter = NULL;
+        next->holds_lock = 1;
+        next->state = READY;
+        next->cpu = cpu;
+        LOCKSTAT_ACQUIRED(&sem->stats);
+        if (lockstat_enabled && next->wait_start != 0) {
+            lockstat_contended(&sem->stats, rdtsc() - next->wait_start);
+        }
+    }
+    spin_unlock_irqrestore(&sem->lock, flags);
+    return next;
+}
+
+int sem_cancel(struct semaphore* sem, Process* p) {
+    uint32_t flags = spin_lock_irqsave(&sem->lock);
+    Process* previous = NULL;
+    Process* waiter = sem->head;
+    while (waiter != NULL && waiter != p) {
+        previous = waiter;
+        waiter = waiter->next_waiter;
+    }
+    if (waiter != NULL) {
+        if (previous) {
+            previous->next_waiter = p->next_waiter;
+        } else {
+            sem->head = p->next_waiter;
+        }
+        if (sem->tail == p) {
+            sem->tail = previous;
+        }
+        p->next_waiter = NULL;
+    }
+    spin_unlock_irqrestore(&sem->lock, flags);
+    return waiter != NULL;
+}
+
+void mutex_init(struct mutex* mutex, const char* name) {
+    sem_init(&mutex->sem, 1, name, LOCK_MUTEX);
+    mutex->owner = -1;
+}
+
+int mutex_lock(struct mutex* mutex, Process* p) {
+    if (!sem_down(&mutex->sem, p)) {
+        return 0;
+    }
+    mutex->owner = p->pid;
+    return 1;
+}
+
+Process* mutex_unlock(struct mutex* mutex, int cpu) {
+    mutex->owner = -1;
+    Process* next = sem_up(&mutex->sem, cpu);
+    if (next) {
+        mutex->owner = next->pid;
+    }
+    return next;
+}
+
+int mutex_cancel(struct mutex* mutex, Process* p) {
+    return sem_cancel(&mutex->sem, p);
+}
@@ -0,0 +1,43 @@
+#ifndef SYNC_H
+#define SYNC_H
+
+#include "process.h"
+#include "../kernel/spinlock.h"
+#include "../kernel/lockstat.h"
+
+// Sleeping locks for processes. A process that cannot have one is marked
+// WAITING and kept on the lock's list instead of a run queue. Releasing
+// hands the permit straight to the first waiter, which comes back READY
+// and already holding it, so waiters are served in arrival order.
+//
+// The scheduler calls these with the run queue lock of the process (or of
+// the queue the woken one is to join) held, and takes the semaphore's own
+// lock inside it. Nothing outside a process can sleep on them.
+struct semaphore {
+    spinlock_t lock;
+    int count;                          // Free permits
+    Process* head;                      // Waiters, oldest first
+    Process* tail;
+    struct lock_stats stats;
+};
+
+struct mutex {
+    struct semaphore sem;
+    int owner;                          // pid, -1 when free
+};
+
+void sem_init(struct semaphore* sem, int count, const char* name, const char* kind);
+// 1 when `p` has a permit, 0 when it now waits for one
+int sem_down(struct semaphore* sem, Process* p);
+// Return a permit; the waiter handed it has been made READY on `cpu` and
+// must be queued there, NULL when nobody was waiting
+Process* sem_up(struct semaphore* sem, int cpu);
+// Take `p` off the wait list; 0 if it was not on it
+int sem_cancel(struct semaphore* sem, Process* p);
+
+void mutex_init(struct mutex* mutex, const char* name);
+int mutex_lock(struct mutex* mutex, Process* p);
+Process* mutex_unlock(struct mutex* mutex, int cpu);
+int mutex_cancel(struct mutex* mutex, Process* p);
+
+#endif
@@ -0,0 +1,698 @@
+#include "calc.h"
+#include "../include/kernel.h"
+
+// Bytecode: an opcode byte, and for OP_CONST and OP_LOAD an operand byte
+// (the constant's index, the variable's slot). Binary operators pop the
+// right operand, then replace the left one with the result.
+enum {
+    OP_END,
+    OP_CONST,
+    OP_LOAD,
+    OP_NEG,
+    OP_NOT,
+    OP_FACTORIAL,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_SHL,
+    OP_SHR,
+    OP_AND,
+    OP_XOR,
+    OP_OR,
+    OP_POWER
+};
+
+enum { TOKEN_END, TOKEN_NUMBER, TOKEN_BIG_NUMBER, TOKEN_NAME, TOKEN_OPERATOR };
+
+#define SYMBOL_POWER 'P'                // The token for **
+
+struct token {
+    int type;
+    int32_t value;                      // TOKEN_NUMBER
+    const char* start;                  // TOKEN_NAME and TOKEN_BIG_NUMBER
+    int length;
+    char symbol;                        // TOKEN_OPERATOR; '<' and '>' for << and >>
+};
+
+struct binary_operator {
+    char symbol;
+    uint8_t precedence;
+    uint8_t opcode;
+};
+
+static const struct binary_operator binary_operators[] = {
+    { '|', 1, OP_OR },
+    { '^', 2, OP_XOR },
+    { '&', 3, OP_AND },
+    { '<', 4, OP_SHL },
+    { '>', 4, OP_SHR },
+    { '+', 5, OP_ADD },
+    { '-', 5, OP_SUB },
+    { '*', 6, OP_MUL },
+    { '/', 6, OP_DIV },
+    { '%', 6, OP_MOD },
+    { SYMBOL_POWER, 8, OP_POWER },      // Groups to the right
+};
+
+#define BINARY_OPERATOR_COUNT ((int)(sizeof(binary_operators) / sizeof(binary_operators[0])))
+#define PREFIX_PRECEDENCE 7             // Below **, so -2**2 is -4; postfix ! is above all
+#define MAX_NESTING 32                  // Parentheses and prefixes, bounding the recursion
+
+// What the compiler knows of each value on the VM stack: where its code
+// starts, and whether that code is a lone OP_CONST it can fold
+struct stack_value {
+    uint8_t start;
+    uint8_t constant;
+};
+
+struct compiler {
+    const char* cursor;
+    struct token token;
+    struct calc_program* program;
+    struct stack_value stack[CALC_MAX_STACK];
+    int depth;
+    int nesting;
+    const char* error;
+};
+
+struct calc_variable {
+    char name[CALC_NAME_LENGTH];
+    int32_t value;
+    int defined;
+    int big;                            // The value is big_value, in stored_limbs
+    struct bignum big_value;
+};
+
+struct cache_entry {
+    char source[CALC_MAX_SOURCE];
+    struct calc_program program;
+};
+
+static struct calc_variable variables[CALC_MAX_VARIABLES];
+static int variable_count = 0;
+static struct cache_entry cache[CALC_CACHE_SIZE];
+static uint32_t cache_hits = 0;
+static uint32_t cache_misses = 0;
+static char error_text[48];
+
+// A bignum run's values, all given back when the next one starts, and the
+// big variables' values, packed together when one changes
+static uint32_t scratch_limbs[CALC_SCRATCH_LIMBS];
+static struct bignum_arena scratch = { scratch_limbs, CALC_SCRATCH_LIMBS, 0, 0 };
+static uint32_t stored_limbs[CALC_STORED_LIMBS];
+static struct bignum_arena stored = { stored_limbs, CALC_STORED_LIMBS, 0, 0 };
+
+static int power(int32_t base, int32_t exponent, int32_t* result) {
+    if (exponent < 0) return CALC_BAD_EXPONENT;
+    int32_t value = 1;
+    while (1) {
+        if ((exponent & 1) && __builtin_mul_overflow(value, base, &value)) return CALC_OVERFLOW;
+        exponent >>= 1;
+        if (exponent == 0) break;
+        if (__builtin_mul_overflow(base, base, &base)) return CALC_OVERFLOW;
+    }
+    *result = value;
+    return 0;
+}
+
+// Shared by the VM and constant folding, so both agree on every edge case
+static inline int apply_binary(int opcode, int32_t a, int32_t b, int32_t* result) {
+    switch (opcode) {
+    case OP_ADD: return __builtin_add_overflow(a, b, result) ? CALC_OVERFLOW : 0;
+    case OP_SUB: return __builtin_sub_overflow(a, b, result) ? CALC_OVERFLOW : 0;
+    case OP_MUL: return __builtin_mul_overflow(a, b, result) ? CALC_OVERFLOW : 0;
+    case OP_DIV:
+    case OP_MOD:
+        if (b == 0) return CALC_DIVIDE_BY_ZERO;
+        if (b == -1) {                  // INT32_MIN / -1 would trap
+            if (opcode == OP_DIV) return __builtin_sub_overflow(0, a, result) ? CALC_OVERFLOW : 0;
+            *result = 0;
+        } else {
+            *result = opcode == OP_DIV ? a / b : a % b;
+        }
+        return 0;
+    case OP_SHL:
+    case OP_SHR:
+        if (b < 0 || b > 31) return CALC_BAD_SHIFT;
+        *result = opcode == OP_SHL ? (int32_t)((uint32_t)a << b) : a >> b;
+        return 0;
+    case OP_AND: *result = a & b; return 0;
+    case OP_XOR: *result = a ^ b; return 0;
+    case OP_OR: *result = a | b; return 0;
+    default: return power(a, b, result);
+    }
+}
+
+static inline int apply_unary(int opcode, int32_t a, int32_t* result) {
+    switch (opcode) {
+    case OP_NEG: return __builtin_sub_overflow(0, a, result) ? CALC_OVERFLOW : 0;
+    case OP_NOT: *result = ~a; return 0;
+    default:
+        if (a < 0) return CALC_BAD_FACTORIAL;
+        if (a > 12) return CALC_OVERFLOW;   // 13! is over 2^31
+        *result = 1;
+        for (int32_t i = 2; i <= a; i++) *result *= i;
+        return 0;
+    }
+}
+
+int calc_run(const struct calc_program* program, int32_t* result) {
+    int32_t stack[CALC_MAX_STACK];
+    int top = -1;
+    const uint8_t* pc = program->code;
+    while (1) {
+        int opcode = *pc++;
+        switch (opcode) {
+        case OP_END:
+            *result = stack[0];
+            if (program->target >= 0) {
+                calc_set_variable(program->target, stack[0]);
+            }
+            return 0;
+        case OP_CONST:
+            stack[++top] = program->constants[*pc++];
+            break;
+        case OP_LOAD: {
+            const struct calc_variable* variable = &variables[*pc++];
+            if (variable->big) return CALC_OVERFLOW;
+            stack[++top] = variable->value;
+            break;
+        }
+        case OP_NEG:
+        case OP_NOT:
+        case OP_FACTORIAL: {
+            int error = apply_unary(opcode, stack[top], &stack[top]);
+            if (error) return error;
+            break;
+        }
+        default: {
+            int32_t right = stack[top--];
+            int error = apply_binary(opcode, stack[top], right, &stack[top]);
+            if (error) return error;
+            break;
+        }
+        }
+    }
+}
+
+// Bignum runs
+
+static int big_error(int error) {
+    if (error == BIGNUM_DIVIDE_BY_ZERO) return CALC_DIVIDE_BY_ZERO;
+    return error ? CALC_TOO_BIG : 0;
+}
+
+// The bitwise operators and shifts stay 32-bit, so take 32-bit operands
+static int apply_binary_big(int opcode, struct bignum* a, const struct bignum* b) {
+    int32_t x, y, small;
+    switch (opcode) {
+    case OP_ADD: return big_error(bignum_add(&scratch, a, a, b));
+    case OP_SUB: return big_error(bignum_sub(&scratch, a, a, b));
+    case OP_MUL: return big_error(bignum_mul(&scratch, a, a, b));
+    case OP_DIV: return big_error(bignum_divmod(&scratch, a, NULL, a, b));
+    case OP_MOD: return big_error(bignum_divmod(&scratch, NULL, a, a, b));
+    case OP_POWER:
+        if (b->negative) return CALC_BAD_EXPONENT;
+        if (bignum_to_int(b, &y) < 0) return CALC_TOO_BIG;
+        return big_error(bignum_pow(&scratch, a, a, y));
+    default: {
+        if (bignum_to_int(a, &x) < 0 || bignum_to_int(b, &y) < 0) return CALC_NOT_32_BIT;
+        int error = apply_binary(opcode, x, y, &small);
+        return error ? error : big_error(bignum_from_int(&scratch, a, small));
+    }
+    }
+}
+
+static int apply_unary_big(int opcode, struct bignum* a) {
+    int32_t x;
+    switch (opcode) {
+    case OP_NEG:
+        a->negative = a->length && !a->negative;
+        return 0;
+    case OP_NOT:
+        if (bignum_to_int(a, &x) < 0) return CALC_NOT_32_BIT;
+        return big_error(bignum_from_int(&scratch, a, ~x));
+    default:
+        if (a->negative) return CALC_BAD_FACTORIAL;
+        if (bignum_to_int(a, &x) < 0) return CALC_TOO_BIG;
+        return big_error(bignum_factorial(&scratch, a, x));
+    }
+}
+
+int calc_run_big(const struct calc_program* program, const struct bignum** result) {
+    static struct bignum stack[CALC_MAX_STACK];
+    int top = -1;
+    const uint8_t* pc = program->code;
+    bignum_arena_release(&scratch, 0);
+    while (1) {
+        int opcode = *pc++;
+        int error;
+        switch (opcode) {
+        case OP_END:
+            if (program->target >= 0 && (error = calc_set_variable_big(program->target, &stack[0])) < 0) {
+                return error;
+            }
+            *result = &stack[0];
+            return 0;
+        case OP_CONST:
+            error = big_error(bignum_from_int(&scratch, &stack[++top], program->constants[*pc++]));
+            break;
+        case OP_LOAD: {
+            // Copied, as storing a variable may move the others
+            const struct calc_variable* variable = &variables[*pc++];
+            top++;
+            if (variable->big) {
+                error = big_error(bignum_copy(&scratch, &stack[top], &variable->big_value));
+            } else {
+                error = big_error(bignum_from_int(&scratch, &stack[top], variable->value));
+            }
+            break;
+        }
+        case OP_NEG:
+        case OP_NOT:
+        case OP_FACTORIAL:
+            error = apply_unary_big(opcode, &stack[top]);
+            break;
+        default:
+            top--;
+            error = apply_binary_big(opcode, &stack[top], &stack[top + 1]);
+            break;
+        }
+        if (error) return error;
+    }
+}
+
+const char* calc_decimal(const struct bignum* value) {
+    char* text;
+    return bignum_to_decimal(&scratch, value, &text) < 0 ? NULL : text;
+}
+
+const char* calc_run_error(int result) {
+    switch (result) {
+    case CALC_DIVIDE_BY_ZERO: return "Division by zero";
+    case CALC_BAD_SHIFT: return "Shift count must be 0 to 31";
+    case CALC_OVERFLOW: return "Overflow";
+    case CALC_BAD_EXPONENT: return "Negative exponent";
+    case CALC_BAD_FACTORIAL: return "Factorial of a negative number";
+    case CALC_NOT_32_BIT: return "Bitwise operators and shifts take 32-bit values";
+    case CALC_TOO_BIG: return "Number too big for the calculator's memory";
+    default: return "Unknown error";
+    }
+}
+
+int calc_variable(const char* name) {
+    for (int i = 0; i < variable_count; i++) {
+        if (strcmp(variables[i].name, name) == 0) {
+            return i;
+        }
+    }
+    if (variable_count == CALC_MAX_VARIABLES || strlen(name) >= CALC_NAME_LENGTH) {
+        return -1;
+    }
+    struct calc_variable* variable = &variables[variable_count];
+    strcpy(variable->name, name);
+    variable->value = 0;
+    variable->defined = 0;
+    return variable_count++;
+}
+
+void calc_set_variable(int slot, int32_t value) {
+    if (slot < 0 || slot >= variable_count) {
+        return;
+    }
+    variables[slot].value = value;
+    variables[slot].defined = 1;
+    variables[slot].big = 0;
+}
+
+// Move the big variables' limbs down to the bottom of stored, in address
+// order so none is overwritten before it moves
+static void pack_stored(void) {
+    uint32_t used = 0;
+    while (1) {
+        struct calc_variable* lowest = NULL;
+        for (int i = 0; i < variable_count; i++) {
+            struct calc_variable* variable = &variables[i];
+            if (variable->big && variable->big_value.limbs >= stored_limbs + used &&
+                (lowest == NULL || variable->big_value.limbs < lowest->big_value.limbs)) {
+                lowest = variable;
+            }
+        }
+        if (lowest == NULL) break;
+        uint32_t* to = stored_limbs + used;
+        for (uint32_t i = 0; i < lowest->big_value.length; i++) {
+            to[i] = lowest->big_value.limbs[i];
+        }
+        lowest->big_value.limbs = to;
+        used += lowest->big_value.length;
+    }
+    bignum_arena_release(&stored, used);
+}
+
+int calc_set_variable_big(int slot, const struct bignum* value) {
+    int32_t small;
+    if (bignum_to_int(value, &small) == 0) {
+        calc_set_variable(slot, small);
+        return 0;
+    }
+    if (slot < 0 || slot >= variable_count) {
+        return 0;
+    }
+    uint32_t others = 0;
+    for (int i = 0; i < variable_count; i++) {
+        if (i != slot && variables[i].big) others += variables[i].big_value.length;
+    }
+    if (others + value->length > CALC_STORED_LIMBS) return CALC_TOO_BIG;
+    variables[slot].big = 0;
+    pack_stored();
+    bignum_copy(&stored, &variables[slot].big_value, value);
+    variables[slot].defined = 1;
+    variables[slot].big = 1;
+    return 0;
+}
+
+const char* calc_variable_name(int slot) {
+    return slot >= 0 && slot < variable_count ? variables[slot].name : "";
+}
+
+void calc_cache_stats(uint32_t* hits, uint32_t* misses) {
+    *hits = cache_hits;
+    *misses = cache_misses;
+}
+
+// Compiler
+
+static int fail(struct compiler* c, const char* error) {
+    if (c->error == NULL) {
+        c->error = error;
+    }
+    return -1;
+}
+
+static int is_name_char(char ch, int first) {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_' ||
+           (!first && ch >= '0' && ch <= '9');
+}
+
+static int digit_value(char ch, int base) {
+    int digit = -1;
+    if (ch >= '0' && ch <= '9') digit = ch - '0';
+    else if (ch >= 'a' && ch <= 'f') digit = ch - 'a' + 10;
+    else if (ch >= 'A' && ch <= 'F') digit = ch - 'A' + 10;
+    return digit < base ? digit : -1;
+}
+
+// Decimal, or hex up to 0xFFFFFFFF as a bit pattern
+static int read_number(struct compiler* c) {
+    const char* p = c->cursor;
+    int base = 10;
+    uint32_t limit = 0x7FFFFFFF;
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        base = 16;
+        limit = 0xFFFFFFFF;
+        p += 2;
+        if (digit_value(*p, base) < 0) return fail(c, "hex number without digits");
+    }
+    uint32_t value = 0;
+    int digit, big = 0;
+    while ((digit = digit_value(*p, base)) >= 0) {
+        if (value > (limit - digit) / base) {
+            if (base == 16) return fail(c, "hex number over 32 bits");
+            big = 1;
+        }
+        value = value * base + digit;
+        p++;
+    }
+    if (is_name_char(*p, 0)) return fail(c, "bad digit in number");
+    c->token.type = big ? TOKEN_BIG_NUMBER : TOKEN_NUMBER;
+    c->token.value = (int32_t)value;
+    c->token.start = c->cursor;
+    c->token.length = p - c->cursor;
+    c->cursor = p;
+    return 0;
+}
+
+static int is_operator_char(char ch) {
+    for (const char* p = "+-*/%&|^~!()="; *p; p++) {
+        if (*p == ch) return 1;
+    }
+    return 0;
+}
+
+static int next_token(struct compiler* c) {
+    while (*c->cursor == ' ' || *c->cursor == '\t') c->cursor++;
+    char ch = *c->cursor;
+    if (ch == '\0') {
+        c->token.type = TOKEN_END;
+        return 0;
+    }
+    if (ch >= '0' && ch <= '9') {
+        return read_number(c);
+    }
+    if (is_name_char(ch, 1)) {
+        c->token.type = TOKEN_NAME;
+        c->token.start = c->cursor;
+        while (is_name_char(*c->cursor, 0)) c->cursor++;
+        c->token.length = c->cursor - c->token.start;
+        return 0;
+    }
+    if ((ch == '<' || ch == '>' || ch == '*') && c->cursor[1] == ch) {
+        c->cursor += 2;
+        if (ch == '*') ch = SYMBOL_POWER;
+    } else if (is_operator_char(ch)) {
+        c->cursor++;
+    } else {
+        strcpy(error_text, "unexpected '?'");
+        error_text[12] = ch;
+        return fail(c, error_text);
+    }
+    c->token.type = TOKEN_OPERATOR;
+    c->token.symbol = ch;
+    return 0;
+}
+
+static int emit(struct compiler* c, uint8_t byte) {
+    if (c->program->length == CALC_MAX_CODE) return fail(c, "expression too long");
+    c->program->code[c->program->length++] = byte;
+    return 0;
+}
+
+static int push_value(struct compiler* c, int constant) {
+    if (c->depth == CALC_MAX_STACK) return fail(c, "expression too deep");
+    c->stack[c->depth].start = c->program->length;
+    c->stack[c->depth].constant = constant;
+    c->depth++;
+    return 0;
+}
+
+static int emit_constant(struct compiler* c, int32_t value) {
+    struct calc_program* program = c->program;
+    if (program->constant_count == CALC_MAX_CONSTANTS) return fail(c, "too many numbers");
+    if (push_value(c, 1) < 0) return -1;
+    program->constants[program->constant_count] = value;
+    if (emit(c, OP_CONST) < 0 || emit(c, program->constant_count) < 0) return -1;
+    program->constant_count++;
+    return 0;
+}
+
+static int emit_load(struct compiler* c, const char* name, int length) {
+    char buffer[CALC_NAME_LENGTH];
+    if (length >= CALC_NAME_LENGTH) return fail(c, "name too long");
+    memcpy(buffer, name, length);
+    buffer[length] = '\0';
+    int slot = calc_variable(buffer);
+    if (slot < 0) return fail(c, "too many variables");
+    if (!variables[slot].defined) {
+        strcpy(error_text, "unknown variable ");
+        strcpy(error_text + 17, buffer);
+        return fail(c, error_text);
+    }
+    if (push_value(c, 0) < 0) return -1;
+    return emit(c, OP_LOAD) < 0 ? -1 : emit(c, slot);
+}
+
+// A constant operand is folded in place, unless that would fail
+static int emit_unary(struct compiler* c, uint8_t opcode) {
+    struct stack_value* value = &c->stack[c->depth - 1];
+    if (value->constant) {
+        int32_t* constant = &c->program->constants[c->program->code[value->start + 1]];
+        int32_t folded;
+        if (apply_unary(opcode, *constant, &folded) == 0) {
+            *constant = folded;
+            return 0;
+        }
+    }
+    value->constant = 0;
+    return emit(c, opcode);
+}
+
+// Two constant operands are the last two constants and the last four
+// bytes of code, and fold into the first, unless that would fail; then
+// the error is left for the run to report
+static int emit_binary(struct compiler* c, uint8_t opcode) {
+    struct calc_program* program = c->program;
+    struct stack_value* left = &c->stack[c->depth - 2];
+    struct stack_value* right = &c->stack[c->depth - 1];
+    c->depth--;
+    if (left->constant && right->constant) {
+        int32_t* a = &program->constants[program->code[left->start + 1]];
+        int32_t b = program->constants[program->code[right->start + 1]];
+        int32_t folded;
+        if (apply_binary(opcode, *a, b, &folded) == 0) {
+            *a = folded;
+            program->constant_count--;
+            program->length = right->start;
+            return 0;
+        }
+    }
+    left->constant = 0;
+    return emit(c, opcode);
+}
+
+// A decimal literal over 32 bits becomes arithmetic on its 9-digit
+// pieces, which overflows when run and so is done in bignums
+static int emit_big_number(struct compiler* c, const char* digits, int length) {
+    int piece = length % 9 ? length % 9 : 9;
+    for (int start = 0; start < length; start += piece, piece = 9) {
+        int32_t value = 0;
+        for (int i = start; i < start + piece; i++) {
+            value = value * 10 + (digits[i] - '0');
+        }
+        if (start == 0) {
+            if (emit_constant(c, value) < 0) return -1;
+        } else if (emit_constant(c, 1000000000) < 0 || emit_binary(c, OP_MUL) < 0 ||
+                   emit_constant(c, value) < 0 || emit_binary(c, OP_ADD) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static const struct binary_operator* find_binary(const struct token* token) {
+    if (token->type != TOKEN_OPERATOR) return NULL;
+    for (int i = 0; i < BINARY_OPERATOR_COUNT; i++) {
+        if (binary_operators[i].symbol == token->symbol) {
+            return &binary_operators[i];
+        }
+    }
+    return NULL;
+}
+
+static int parse_expression(struct compiler* c, int min_precedence);
+
+static int parse_prefix(struct compiler* c) {
+    struct token token = c->token;
+    if (token.type == TOKEN_END) return fail(c, "missing operand");
+    if (next_token(c) < 0) return -1;
+    if (token.type == TOKEN_NUMBER) return emit_constant(c, token.value);
+    if (token.type == TOKEN_BIG_NUMBER) return emit_big_number(c, token.start, token.length);
+    if (token.type == TOKEN_NAME) return emit_load(c, token.start, token.length);
+
+    if (++c->nesting > MAX_NESTING) return fail(c, "nested too deeply");
+    int result;
+    if (token.symbol == '(') {
+        result = parse_expression(c, 0);
+        if (result == 0 && !(c->token.type == TOKEN_OPERATOR && c->token.symbol == ')')) {
+            result = fail(c, "missing ')'");
+        }
+        if (result == 0) result = next_token(c);
+    } else if (token.symbol == '-' || token.symbol == '~') {
+        result = parse_expression(c, PREFIX_PRECEDENCE);
+        if (result == 0) result = emit_unary(c, token.symbol == '-' ? OP_NEG : OP_NOT);
+    } else if (token.symbol == '+') {
+        result = parse_expression(c, PREFIX_PRECEDENCE);
+    } else {
+        strcpy(error_text, token.symbol == SYMBOL_POWER ? "unexpected '**'" : "unexpected '?'");
+        if (token.symbol != SYMBOL_POWER) error_text[12] = token.symbol;
+        result = fail(c, error_text);
+    }
+    c->nesting--;
+    return result;
+}
+
+// Pratt parsing: an operand, then every operator that binds at least as
+// tightly as min_precedence, each with a right side of the operators
+// binding tighter still (so they group to the left; ** takes its own
+// precedence again, so it groups to the right)
+static int parse_expression(struct compiler* c, int min_precedence) {
+    if (parse_prefix(c) < 0) return -1;
+    while (1) {
+        if (c->token.type == TOKEN_OPERATOR && c->token.symbol == '!') {
+            if (next_token(c) < 0 || emit_unary(c, OP_FACTORIAL) < 0) return -1;
+            continue;
+        }
+        const struct binary_operator* op = find_binary(&c->token);
+        if (op == NULL || op->precedence < min_precedence) {
+            return 0;
+        }
+        int right_precedence = op->opcode == OP_POWER ? op->precedence : op->precedence + 1;
+        if (next_token(c) < 0 || parse_expression(c, right_precedence) < 0) return -1;
+        if (emit_binary(c, op->opcode) < 0) return -1;
+    }
+}
+
+// `name = expression` or an expression
+static int compile_line(struct compiler* c, const char* source) {
+    c->cursor = source;
+    c->program->target = -1;
+    if (next_token(c) < 0) return -1;
+    if (c->token.type == TOKEN_NAME) {
+        const char* after = c->cursor;
+        while (*after == ' ' || *after == '\t') after++;
+        if (*after == '=') {
+            char name[CALC_NAME_LENGTH];
+            if (c->token.length >= CALC_NAME_LENGTH) return fail(c, "name too long");
+            memcpy(name, c->token.start, c->token.length);
+            name[c->token.length] = '\0';
+            int slot = calc_variable(name);
+            if (slot < 0) return fail(c, "too many variables");
+            c->program->target = slot;
+            c->cursor = after + 1;
+            if (next_token(c) < 0) return -1;
+        }
+    }
+    if (parse_expression(c, 0) < 0) return -1;
+    if (c->token.type != TOKEN_END) {
+        if (c->token.type == TOKEN_OPERATOR && c->token.symbol == ')') return fail(c, "unmatched ')'");
+        return fail(c, "missing operator");
+    }
+    return emit(c, OP_END);
+}
+
+static uint32_t hash_source(const char* source) {
+    uint32_t hash = 2166136261u;
+    while (*source) {
+        hash = (hash ^ (uint8_t)*source++) * 16777619u;
+    }
+    return hash ^ (hash >> 16);
+}
+
+const struct calc_program* calc_compile(const char* source, const char** error) {
+    if (strlen(source) >= CALC_MAX_SOURCE) {
+        *error = "line too long";
+        return NULL;
+    }
+    struct cache_entry* entry = &cache[hash_source(source) & (CALC_CACHE_SIZE - 1)];
+    if (entry->program.length > 0 && strcmp(entry->source, source) == 0) {
+        cache_hits++;
+        return &entry->program;
+    }
+    cache_misses++;
+
+    static struct calc_program program;
+    struct compiler c;
+    memset(&c, 0, sizeof(c));
+    memset(&program, 0, sizeof(program));
+    c.program = &program;
+    if (compile_line(&c, source) < 0) {
+        *error = c.error;
+        return NULL;
+    }
+    // Only lines that compile are kept, so an unknown variable is looked
+    // up again once it has a value
+    strcpy(entry->source, source);
+    entry->program = program;
+    return &entry->program;
+}
@@ -0,0 +1,66 @@
+#ifndef CALC_H
+#define CALC_H
+
+#include <stdint.h>
+#include "../kernel/bignum.h"
+
+// Calculator expressions, compiled once into stack bytecode and run on a
+// small VM. A line is an expression or `name = expression`, over integers
+// (decimal, or 0x hex up to 32 bits), variables, parentheses and, from
+// lowest to highest precedence:
+//
+//   |   ^   &   << >>   + -   * / %   unary - + ~   **   postfix !
+//
+// Binary operators group to the left but ** groups to the right. Lines
+// run in 32-bit integers, and when a result overflows (or a variable or
+// literal is over 32 bits) the line runs again in bignums; the bitwise
+// operators and shifts stay 32-bit. Variables are compiled to slots, so
+// a compiled line stays valid as their values change; compiled lines are
+// cached by their source text.
+#define CALC_MAX_SOURCE 128
+#define CALC_MAX_CODE 128               // Bytes of bytecode per line
+#define CALC_MAX_CONSTANTS 32
+#define CALC_MAX_STACK 32
+#define CALC_MAX_VARIABLES 32
+#define CALC_NAME_LENGTH 16
+#define CALC_CACHE_SIZE 64              // Compiled lines kept, a power of two
+#define CALC_SCRATCH_LIMBS 262144       // For a bignum run and its output, 1 MB
+#define CALC_STORED_LIMBS 32768         // For big variables
+
+// calc_run and calc_run_big results below zero
+#define CALC_DIVIDE_BY_ZERO -1
+#define CALC_BAD_SHIFT -2               // Shift count outside 0-31
+#define CALC_OVERFLOW -3                // Not a 32-bit result: use calc_run_big
+#define CALC_BAD_EXPONENT -4
+#define CALC_BAD_FACTORIAL -5
+#define CALC_NOT_32_BIT -6              // A bitwise operator or shift on a bignum
+#define CALC_TOO_BIG -7                 // Out of bignum memory
+
+struct calc_program {
+    uint8_t code[CALC_MAX_CODE];
+    int32_t constants[CALC_MAX_CONSTANTS];
+    uint8_t length;
+    uint8_t constant_count;
+    int8_t target;                      // Variable assigned to, or -1
+};
+
+// The compiled line, from the cache if it was compiled before; NULL with
+// `error` set if it does not compile
+const struct calc_program* calc_compile(const char* source, const char** error);
+// 0 with the value in `result` (and in the target variable, if any)
+int calc_run(const struct calc_program* program, int32_t* result);
+// The same in bignums; the result lasts until the next bignum run
+int calc_run_big(const struct calc_program* program, const struct bignum** result);
+const char* calc_run_error(int result);
+// A bignum result in decimal, or NULL if that does not fit in memory
+const char* calc_decimal(const struct bignum* value);
+
+// Variable slots, created on first use; -1 when all are taken
+int calc_variable(const char* name);
+void calc_set_variable(int slot, int32_t value);
+int calc_set_variable_big(int slot, const struct bignum* value);  // 0 or CALC_TOO_BIG
+const char* calc_variable_name(int slot);
+
+void calc_cache_stats(uint32_t* hits, uint32_t* misses);
+
+#endif
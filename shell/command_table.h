@@ -0,0 +1,80 @@
+#ifndef COMMAND_TABLE_H
+#define COMMAND_TABLE_H
+
+#include <stdint.h>
+
+// Every shell builtin, declared once as COMMAND(name, handler, category, help).
+// The dispatcher, help and tab completion in commands.c expand this list, and
+// so does tools/mkcmdhash.c, which generates the perfect hash over the names.
+enum command_category {
+    CATEGORY_FILESYSTEM,
+    CATEGORY_PROCESS,
+    CATEGORY_SYSTEM,
+    CATEGORY_MATH,
+    CATEGORY_DATE,
+    CATEGORY_SCRIPT,
+    CATEGORY_COUNT
+};
+
+#define COMMAND_LIST(COMMAND) \
+    COMMAND("ls", cmd_ls, CATEGORY_FILESYSTEM, "List all files in system") \
+    COMMAND("create", cmd_create, CATEGORY_FILESYSTEM, "Create a new file (create filename)") \
+    COMMAND("write", cmd_write, CATEGORY_FILESYSTEM, "Write text to file (write filename text)") \
+    COMMAND("read", cmd_read, CATEGORY_FILESYSTEM, "Read file contents (read filename)") \
+    COMMAND("delete", cmd_delete, CATEGORY_FILESYSTEM, "Delete a file (delete filename)") \
+    COMMAND("search", cmd_search, CATEGORY_FILESYSTEM, "Search for a file by name (search filename)") \
+    COMMAND("grep", cmd_grep, CATEGORY_FILESYSTEM, "Search file contents or piped input (grep pattern [files])") \
+    COMMAND("sync", cmd_sync, CATEGORY_FILESYSTEM, "Write dirty cached blocks back to disk") \
+    COMMAND("fsinfo", cmd_fsinfo, CATEGORY_FILESYSTEM, "Show the mounted file system and free space") \
+    COMMAND("cachestat", cmd_cachestat, CATEGORY_FILESYSTEM, "Show buffer cache hits, misses and evictions") \
+    COMMAND("dfstat", cmd_dfstat, CATEGORY_FILESYSTEM, "Show logical vs physical bytes of file data") \
+    COMMAND("compress", cmd_compress, CATEGORY_FILESYSTEM, "LZ4-compress a file, or all cold blocks (compress [file])") \
+    COMMAND("zstat", cmd_zstat, CATEGORY_FILESYSTEM, "Show per-file compression ratio and decode speed") \
+    COMMAND("fsck", cmd_fsck, CATEGORY_FILESYSTEM, "Verify file table and block checksums") \
+    COMMAND("ps", cmd_ps, CATEGORY_PROCESS, "Show all running processes") \
+    COMMAND("run", cmd_run, CATEGORY_PROCESS, "Start a new process (run processname)") \
+    COMMAND("kill", cmd_kill, CATEGORY_PROCESS, "Stop a process (kill pid)") \
+    COMMAND("demo", cmd_demo, CATEGORY_PROCESS, "Run process scheduling demo") \
+    COMMAND("lockdemo", cmd_lockdemo, CATEGORY_PROCESS, "Run processes that take turns holding one mutex (lockdemo [processes])") \
+    COMMAND("help", cmd_help, CATEGORY_SYSTEM, "Show help (help [category|command])") \
+    COMMAND("clear", cmd_clear, CATEGORY_SYSTEM, "Clear screen") \
+    COMMAND("echo", cmd_echo, CATEGORY_SYSTEM, "Echo the arguments") \
+    COMMAND("info", cmd_info, CATEGORY_SYSTEM, "Show system information") \
+    COMMAND("version", cmd_version, CATEGORY_SYSTEM, "Show OS version") \
+    COMMAND("history", cmd_history, CATEGORY_SYSTEM, "Show command history") \
+    COMMAND("shutdown", cmd_shutdown, CATEGORY_SYSTEM, "Shutdown the system (shutdown [status], the exit status under QEMU)") \
+    COMMAND("reboot", cmd_reboot, CATEGORY_SYSTEM, "Reboot the system") \
+    COMMAND("font", cmd_font, CATEGORY_SYSTEM, "Change text color (font red/green/yellow/blue/magenta/cyan/white)") \
+    COMMAND("lsblk", cmd_lsblk, CATEGORY_SYSTEM, "List block devices and their driver mode") \
+    COMMAND("lspci", cmd_lspci, CATEGORY_SYSTEM, "List PCI devices") \
+    COMMAND("cpus", cmd_cpus, CATEGORY_SYSTEM, "List the CPUs and their run queues") \
+    COMMAND("lockstat", cmd_lockstat, CATEGORY_SYSTEM, "Show lock contention statistics (lockstat [on|off|reset])") \
+    COMMAND("timers", cmd_timers, CATEGORY_SYSTEM, "Show each CPU's pending timers and next deadline") \
+    COMMAND("prof", cmd_prof, CATEGORY_SYSTEM, "Sample where the kernel spends its time (prof start|stop|report [n])") \
+    COMMAND("trace", cmd_trace, CATEGORY_SYSTEM, "Record kernel events, dump them on COM1 (trace [start|stop|dump])") \
+    COMMAND("kbench", cmd_kbench, CATEGORY_SYSTEM, "Run microbenchmarks, CSV on COM1 (kbench [-l] [-n rounds] [names])") \
+    COMMAND("ipcbench", cmd_ipcbench, CATEGORY_SYSTEM, "Time IPC messages, small and page-sized (ipcbench [messages])") \
+    COMMAND("calculator", cmd_calculator, CATEGORY_MATH, "Evaluate an expression, or enter calculator mode for | and >> (calculator [expr | -bench var from to expr])") \
+    COMMAND("date", cmd_date, CATEGORY_DATE, "Show current date") \
+    COMMAND("time", cmd_time, CATEGORY_DATE, "Show current time, or time a command (time [command])") \
+    COMMAND("uptime", cmd_uptime, CATEGORY_DATE, "Show how long the system has been running") \
+    COMMAND("source", cmd_source, CATEGORY_SCRIPT, "Run a script file (source [-t] file [args], -t times each line)") \
+    COMMAND("set", cmd_set, CATEGORY_SCRIPT, "Set a variable, or list them (set [name value])") \
+    COMMAND("unset", cmd_unset, CATEGORY_SCRIPT, "Remove a variable (unset name)") \
+    COMMAND("sleep", cmd_sleep, CATEGORY_SCRIPT, "Pause, with the CPU halted (sleep ms)")
+
+// Seeded FNV-1a; mkcmdhash searches for a seed that sends every name to its
+// own slot. The final mix folds the high bits into the low ones, which are
+// the ones used to pick a slot.
+static inline uint32_t command_hash(const char* name, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    while (*name) {
+        hash = (hash ^ (uint8_t)*name++) * 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    return hash;
+}
+
+#endif
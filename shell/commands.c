@@ -1,128 +1,237 @@
 #include "../include/kernel.h"
 #include "../fs/fs.h"
 #include "../process/process.h"
+#include "../process/sync.h"
 #include "../kernel/screen.h"
 #include "../kernel/keyboard.h"
 #include "commands.h"
+#include "command_table.h"
+#include "command_hash.h"
 #include "math_commands.h"
 #include "shell.h"
+#include "../drivers/block.h"
+#include "../drivers/pci.h"
+#include "../fs/bcache.h"
+#include "../fs/agranfs.h"
+#include "../kernel/clock.h"
+#include "../kernel/calendar.h"
+#include "../kernel/search.h"
+#include "../kernel/pipe.h"
+#include "../kernel/profile.h"
+#include "../kernel/trace.h"
+#include "../kernel/smp.h"
+#include "../kernel/lockstat.h"
+#include "../kernel/timer.h"
+#include "script.h"
+#include "kbench.h"
 #include <stddef.h>
 
-#define MAX_ARGS 16
-#define MAX_CONTENT 1024
+#define MAX_STAGES 4
 
-// RTC CMOS ports
-#define CMOS_ADDRESS 0x70
-#define CMOS_DATA    0x71
+// A command line: up to MAX_STAGES commands joined by '|', the last of
+// which may have its output sent to a file with '>' or appended with '>>'
+struct pipeline {
+    char words[MAX_CONTENT * 2];        // Arguments, copied out of the line
+    int stages;
+    int argc[MAX_STAGES];
+    char* argv[MAX_STAGES][MAX_ARGS];
+    const char* redirect;               // NULL when output goes to the screen
+    int append;
+};
 
-// Helper to read a byte from CMOS
-static uint8_t read_cmos(uint8_t reg) {
-    outb(CMOS_ADDRESS, reg);
-    return inb(CMOS_DATA);
+static int is_operator(char c) {
+    return c == '|' || c == '>';
 }
 
-// Convert BCD to binary
-static int bcd_to_bin(uint8_t val) {
-    return (val & 0x0F) + ((val >> 4) * 10);
+// Split a command line into stages and arguments. Operators need no spaces
+// around them, so words are copied out rather than terminated in place.
+// Returns the number of stages, 0 for an empty line, -1 on a syntax error.
+static int parse_command(const char* command, struct pipeline* line) {
+    char* out = line->words;
+    char* const out_end = line->words + sizeof(line->words) - 1;
+    const char* p = command;
+
+    line->stages = 1;
+    line->argc[0] = 0;
+    line->redirect = NULL;
+    line->append = 0;
+    while (1) {
+        while (*p == ' ') p++;
+        if (*p == '\0') break;
+
+        if (line->redirect) {
+            print_string("Error: Redirection must end the command\n");
+            return -1;
+        }
+        if (*p == '|') {
+            p++;
+            if (line->argc[line->stages - 1] == 0) {
+                print_string("Error: Missing command before |\n");
+                return -1;
+            }
+            if (line->stages == MAX_STAGES) {
+                print_string("Error: Too many pipeline stages\n");
+                return -1;
+            }
+            line->argc[line->stages++] = 0;
+            continue;
+        }
+        if (*p == '>') {
+            p++;
+            if (*p == '>') {
+                p++;
+                line->append = 1;
+            }
+            while (*p == ' ') p++;
+            if (*p == '\0' || is_operator(*p)) {
+                print_string("Error: Missing file name after >\n");
+                return -1;
+            }
+            line->redirect = out;
+        } else if (line->argc[line->stages - 1] < MAX_ARGS) {
+            int stage = line->stages - 1;
+            line->argv[stage][line->argc[stage]++] = out;
+        }
+        while (*p && *p != ' ' && !is_operator(*p)) {
+            if (out >= out_end) {
+                print_string("Error: Command too long\n");
+                return -1;
+            }
+            *out++ = *p++;
+        }
+        *out++ = '\0';
+    }
+
+    if (line->argc[line->stages - 1] == 0) {
+        if (line->stages == 1 && line->redirect == NULL) {
+            return 0;
+        }
+        print_string(line->stages > 1 ? "Error: Missing command after |\n"
+                                      : "Error: Missing command before >\n");
+        return -1;
+    }
+    return line->stages;
 }
 
-// Helper function to parse command string into argc/argv
-static int parse_command(const char* command, char* argv[]) {
-    int argc = 0;
-    static char cmd_copy[MAX_CONTENT];
-    
-    // Make a copy of the command
-    int i;
-    for(i = 0; command[i] != '\0' && i < MAX_CONTENT - 1; i++) {
-        cmd_copy[i] = command[i];
+// Command table: see command_table.h
+struct command {
+    const char* name;
+    void (*handler)(int argc, char* argv[]);
+    enum command_category category;
+    const char* help;
+};
+
+#define COMMAND_ENTRY(name, handler, category, help) { name, handler, category, help },
+static const struct command commands[] = { COMMAND_LIST(COMMAND_ENTRY) };
+#define COMMAND_COUNT ((int)(sizeof(commands) / sizeof(commands[0])))
+
+struct category_info {
+    const char* name;                   // As typed after 'help'
+    const char* title;
+    const char* summary;
+};
+
+static const struct category_info categories[CATEGORY_COUNT] = {
+    [CATEGORY_FILESYSTEM] = { "filesystem", "File System Commands", "File management commands" },
+    [CATEGORY_PROCESS] = { "process", "Process Management Commands", "Process management commands" },
+    [CATEGORY_SYSTEM] = { "system", "System Commands", "System commands" },
+    [CATEGORY_MATH] = { "math", "Math/Calculator Commands", "Calculator and math commands" },
+    [CATEGORY_DATE] = { "date", "Date/Time Commands", "Date, time, and clock commands" },
+    [CATEGORY_SCRIPT] = { "script", "Script Commands", "Scripts, loops and variables" },
+};
+
+#define HELP_NAME_WIDTH 8
+
+// One hash and one compare: the generated slot table maps each hash to the
+// only command that can have it
+static const struct command* find_command(const char* name) {
+    uint8_t slot = command_slots[command_hash(name, COMMAND_HASH_SEED) & (COMMAND_HASH_SLOTS - 1)];
+    if (slot == 0) {
+        return NULL;
     }
-    cmd_copy[i] = '\0';
-    
-    char* token = cmd_copy;
-    
-    // Skip leading spaces
-    while (*token == ' ') token++;
-    
-    // Parse arguments
-    while (*token && argc < MAX_ARGS) {
-        argv[argc++] = token;
-        
-        // Find end of argument
-        while (*token && *token != ' ') token++;
-        
-        // Replace space with null terminator
-        if (*token) *token++ = '\0';
-        
-        // Skip spaces between arguments
-        while (*token == ' ') token++;
+    const struct command* cmd = &commands[slot - 1];
+    return strcmp(cmd->name, name) == 0 ? cmd : NULL;
+}
+
+int complete_command(const char* prefix, const char* matches[], int max_matches) {
+    int length = strlen(prefix);
+    int count = 0;
+    for (int i = 0; i < COMMAND_COUNT; i++) {
+        if (strncmp(commands[i].name, prefix, length) == 0) {
+            if (count < max_matches) {
+                matches[count] = commands[i].name;
+            }
+            count++;
+        }
     }
-    
-    return argc;
+    return count;
+}
+
+static void print_padded(const char* text, int width) {
+    print_string(text);
+    for (int i = strlen(text); i < width; i++) {
+        print_char(' ');
+    }
+}
+
+static void print_command_help(const struct command* cmd) {
+    print_padded(cmd->name, HELP_NAME_WIDTH + 2);
+    print_string("- ");
+    print_string(cmd->help);
+    print_string("\n");
 }
 
 // Built-in commands
 void cmd_help(int argc, char* argv[]) {
     if (argc == 1) {
         print_string("\n=== Help Categories ===\n\n");
-        print_string("filesystem  - File management commands\n");
-        print_string("process     - Process management commands\n");
-        print_string("system      - System commands\n");
-        print_string("math        - Calculator and math commands\n");
-        print_string("date/time   - Date, time, and clock commands\n");
-        print_string("history     - Show command history\n");
+        for (int i = 0; i < CATEGORY_COUNT; i++) {
+            print_padded(categories[i].name, HELP_NAME_WIDTH + 2);
+            print_string("- ");
+            print_string(categories[i].summary);
+            print_string("\n");
+        }
         print_string("Type 'help <category>' to see commands in that category.\n");
         return;
     }
-    if (strcmp(argv[1], "filesystem") == 0) {
-        print_string("\nFile System Commands:\n");
-        print_string("ls        - List all files in system\n");
-        print_string("create    - Create a new file (create filename)\n");
-        print_string("write     - Write text to file (write filename text)\n");
-        print_string("read      - Read file contents (read filename)\n");
-        print_string("delete    - Delete a file (delete filename)\n");
-        print_string("search    - Search for a file by name (search filename)\n");
-    } else if (strcmp(argv[1], "process") == 0) {
-        print_string("\nProcess Management Commands:\n");
-        print_string("ps        - Show all running processes\n");
-        print_string("run       - Start a new process (run processname)\n");
-        print_string("kill      - Stop a process (kill pid)\n");
-        print_string("demo      - Run process scheduling demo\n");
-    } else if (strcmp(argv[1], "system") == 0) {
-        print_string("\nSystem Commands:\n");
-        print_string("clear     - Clear screen\n");
-        print_string("echo      - Echo the arguments\n");
-        print_string("info      - Show system information\n");
-        print_string("version   - Show OS version\n");
-        print_string("shutdown  - Shutdown the system\n");
-        print_string("reboot    - Reboot the system\n");
-        print_string("font      - Change text color (font red/green/yellow/blue/magenta/cyan/white)\n");
-        print_string("            Supported colors: red, green, yellow, blue, magenta, cyan, white\n");
-    } else if (strcmp(argv[1], "math") == 0) {
-        print_string("\nMath/Calculator Commands:\n");
-        print_string("calculator - Enter calculator mode (type expressions like 2+3, type 'exit' to quit)\n");
-    } else if (strcmp(argv[1], "date") == 0 || strcmp(argv[1], "time") == 0) {
-        print_string("\nDate/Time Commands:\n");
-        print_string("date       - Show current date\n");
-        print_string("time       - Show current time\n");
+    for (int i = 0; i < CATEGORY_COUNT; i++) {
+        if (strcmp(argv[1], categories[i].name) == 0) {
+            print_string("\n");
+            print_string(categories[i].title);
+            print_string(":\n");
+            for (int j = 0; j < COMMAND_COUNT; j++) {
+                if ((int)commands[j].category == i) {
+                    print_command_help(&commands[j]);
+                }
+            }
+            return;
+        }
+    }
+    const struct command* cmd = find_command(argv[1]);
+    if (cmd != NULL) {
+        print_command_help(cmd);
     } else {
         print_string("Unknown help category. Type 'help' to see available categories.\n");
     }
 }
 
-void cmd_clear(void) {
+void cmd_clear(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
     clear_screen();
 }
 
-void cmd_echo(const char* text) {
-    if (text == NULL) {
-        print_string("Usage: echo [text]\n");
-        return;
+void cmd_echo(int argc, char* argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (i > 1) print_char(' ');
+        print_string(argv[i]);
     }
-    print_string(text);
     print_string("\n");
 }
 
-void cmd_info(void) {
+void cmd_info(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
     print_string("\nAGRAN OS System Information\n");
     print_string("==========================\n");
     print_string("OS Name: AGRAN OS\n");
@@ -136,21 +245,70 @@ void cmd_info(void) {
     print_string("==========================\n");
 }
 
-void cmd_version(void) {
+void cmd_version(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
     print_string("AGRAN OS version 1.0\n");
 }
 
-void cmd_shutdown(void) {
+void cmd_shutdown(int argc, char* argv[]) {
+    // The status is the exit code seen by a host running us under QEMU
+    int status = argc > 1 ? string_to_int(argv[1]) : 0;
     print_string("\nShutting down AGRAN OS...\n");
+    sync_fs();
     print_string("It is now safe to turn off your computer.\n");
-    shutdown();
+    shutdown(status);
 }
 
-void cmd_reboot(void) {
+void cmd_reboot(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
     print_string("\nRebooting AGRAN OS...\n");
+    sync_fs();
     reboot();
 }
 
+void cmd_lsblk(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    list_block_devices();
+}
+
+void cmd_lspci(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    list_pci_devices();
+}
+
+void cmd_cpus(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    smp_display();
+}
+
+void cmd_lockstat(int argc, char* argv[]) {
+    if (argc == 1) {
+        lockstat_display();
+    } else if (argc == 2 && strcmp(argv[1], "on") == 0) {
+        lockstat_enabled = 1;
+        print_string("Lock statistics on\n");
+    } else if (argc == 2 && strcmp(argv[1], "off") == 0) {
+        lockstat_enabled = 0;
+        lockstat_display();
+    } else if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        lockstat_reset();
+        print_string("Lock statistics cleared\n");
+    } else {
+        print_string("Usage: lockstat [on|off|reset]\n");
+    }
+}
+
+void cmd_timers(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    timer_display();
+}
+
 // File system commands
 void cmd_ls(int argc, char* argv[]) {
     (void)argc;
@@ -195,6 +353,66 @@ void cmd_delete(int argc, char* argv[]) {
     delete_file(argv[1]);
 }
 
+void cmd_sync(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    if (sync_fs() == 0) {
+        print_string("Cache synced.\n");
+    }
+}
+
+void cmd_cachestat(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    bcache_print_stats();
+}
+
+void cmd_fsinfo(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    agranfs_print_info();
+}
+
+void cmd_dfstat(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    print_fs_usage();
+}
+
+void cmd_compress(int argc, char* argv[]) {
+    int freed;
+    if (argc < 2) {
+        freed = compress_cold_files();
+    } else {
+        freed = compress_file(argv[1]);
+        if (freed == FS_CORRUPT_ENTRY) {
+            print_string("Error: Checksum mismatch in the file table entry for ");
+            print_string(argv[1]);
+            print_string(" (see fsck)\n");
+            return;
+        }
+        if (freed < 0) {
+            print_string("Error: File not found\n");
+            return;
+        }
+    }
+    print_string("Freed ");
+    print_int(freed * STORE_CHUNK_SIZE);
+    print_string(" bytes\n");
+}
+
+void cmd_zstat(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    print_fs_compression();
+}
+
+void cmd_fsck(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    fsck_fs();
+}
+
 // Process commands
 void cmd_ps(int argc, char* argv[]) {
     (void)argc;
@@ -202,7 +420,7 @@ void cmd_ps(int argc, char* argv[]) {
     display_processes();
 }
 
-void cmd_run(int argc, char* const argv[]) {
+void cmd_run(int argc, char* argv[]) {
     if (argc < 2) {
         print_string("Error: Please provide a process name\n");
         print_string("Usage: run <process_name>\n");
@@ -224,7 +442,7 @@ void cmd_run(int argc, char* const argv[]) {
     }
 }
 
-void cmd_kill(int argc, char* const argv[]) {
+void cmd_kill(int argc, char* argv[]) {
     if (argc < 2) {
         print_string("Usage: kill <pid>\n");
         return;
@@ -243,6 +461,8 @@ void cmd_kill(int argc, char* const argv[]) {
 }
 
 // Demo commands
+#define DEMO_STEP_MS 10
+
 void cmd_demo(int argc, char* argv[]) {
     (void)argc;
     (void)argv;
@@ -257,8 +477,8 @@ void cmd_demo(int argc, char* argv[]) {
     print_string("\nRunning processes for demo...\n");
     for (int i = 0; i < 6; i++) {
         schedule();
-        // Add a small delay between schedules
-        for (volatile int j = 0; j < 1000000; j++) {}
+        // Give the other CPUs a scheduler tick between rounds
+        timer_sleep_ms(DEMO_STEP_MS);
     }
     
     // Clean up any remaining processes
@@ -271,6 +491,62 @@ void cmd_demo(int argc, char* argv[]) {
     print_string("\nDemo completed.\n");
 }
 
+#define LOCKDEMO_DEFAULT_PROCESSES 4
+#define LOCKDEMO_BURST 3
+#define LOCKDEMO_ROUNDS 200             // Scheduling cycles, or waits with SMP
+#define LOCKDEMO_WAIT_MS 10
+
+// Every process needs the same mutex for its whole run, so they take turns
+// whatever the CPU count; with lockstat on the waits show up under lockdemo
+void cmd_lockdemo(int argc, char* argv[]) {
+    static struct mutex demo_mutex;
+    static int initialized = 0;
+    int count = argc > 1 ? string_to_int(argv[1]) : LOCKDEMO_DEFAULT_PROCESSES;
+    if (count < 1 || count > MAX_PROCESSES) {
+        print_string("Error: Processes must be 1 to ");
+        print_int(MAX_PROCESSES);
+        print_string("\n");
+        return;
+    }
+    if (!initialized) {
+        mutex_init(&demo_mutex, "lockdemo");
+        initialized = 1;
+    }
+
+    print_string("\n=== Lock Demo ===\n");
+    int pids[MAX_PROCESSES];
+    int started = 0;
+    for (int i = 0; i < count; i++) {
+        char name[16] = "Locker";
+        int_to_string(i + 1, name + strlen(name));
+        int pid = create_process_with_lock(name, LOCKDEMO_BURST, &demo_mutex);
+        if (pid < 0) {
+            print_string("Error: No free process slots\n");
+            break;
+        }
+        pids[started++] = pid;
+    }
+
+    // The boot CPU only runs its queue when told to; the others run theirs
+    // from their timers, so just wait for them
+    for (int round = 0; round < LOCKDEMO_ROUNDS; round++) {
+        int alive = 0;
+        for (int i = 0; i < started; i++) {
+            alive += is_process_alive(pids[i]);
+        }
+        if (alive == 0) break;
+        if (smp_cpu_count() == 1) {
+            schedule();
+        } else {
+            timer_sleep_ms(LOCKDEMO_WAIT_MS);
+        }
+    }
+    for (int i = 0; i < started; i++) {
+        kill_process(pids[i]);
+    }
+    print_string("\nLock demo completed (lockstat shows the waits)\n");
+}
+
 void cmd_filedemo(int argc, char* argv[]) {
     (void)argc;
     (void)argv;
@@ -305,71 +581,369 @@ void cmd_calculator(int argc, char* argv[]) {
     calculator_command(args_str);
 }
 
-void cmd_date(void) {
-    int day = bcd_to_bin(read_cmos(0x07));
-    int month = bcd_to_bin(read_cmos(0x08));
-    int year = bcd_to_bin(read_cmos(0x09));
+// The wall clock, or -1 with an error printed
+static int read_wall_clock(struct date_time* now) {
+    uint32_t seconds = clock_realtime();
+    if (seconds == 0) {
+        print_string("Error: The real-time clock could not be read\n");
+        return -1;
+    }
+    seconds_to_date(seconds, now);
+    return 0;
+}
+
+static void print_two_digits(int value) {
+    if (value < 10) print_char('0');
+    print_int(value);
+}
+
+void cmd_date(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    struct date_time now;
+    if (read_wall_clock(&now) < 0) {
+        return;
+    }
     print_string("Date: ");
-    print_int(day); print_string("/");
-    print_int(month); print_string("/");
-    print_int(2000 + year); print_string("\n");
+    print_string(weekday_name(now.weekday));
+    print_char(' ');
+    print_int(now.day); print_string("/");
+    print_int(now.month); print_string("/");
+    print_int(now.year); print_string("\n");
+}
+
+// Run the rest of the line as a command and report how long it took
+static void time_command(int argc, char* argv[]) {
+    char line[MAX_COMMAND_LENGTH];
+    int length = 0;
+    for (int i = 0; i < argc; i++) {
+        int size = strlen(argv[i]);
+        if (length + size + 2 > MAX_COMMAND_LENGTH) {
+            print_string("Error: Command too long\n");
+            return;
+        }
+        if (i > 0) line[length++] = ' ';
+        memcpy(line + length, argv[i], size);
+        length += size;
+    }
+    line[length] = '\0';
+
+    uint64_t start = rdtsc();
+    execute_command(line);
+    uint64_t cycles = rdtsc() - start;
+    print_string("time: ");
+    print_uint64(cycles);
+    print_string(" cycles");
+    if (clock_tsc_khz() > 0) {
+        print_string(", ");
+        print_uint64(clock_cycles_to_us(cycles));
+        print_string(" us");
+    }
+    print_char('\n');
 }
 
-void cmd_time(void) {
-    int hour = bcd_to_bin(read_cmos(0x04));
-    int min  = bcd_to_bin(read_cmos(0x02));
-    int sec  = bcd_to_bin(read_cmos(0x00));
+void cmd_time(int argc, char* argv[]) {
+    if (argc > 1) {
+        time_command(argc - 1, argv + 1);
+        return;
+    }
+    struct date_time now;
+    if (read_wall_clock(&now) < 0) {
+        return;
+    }
     print_string("Time: ");
-    print_int(hour); print_string(":");
-    if (min < 10) print_string("0");
-    print_int(min); print_string(":");
-    if (sec < 10) print_string("0");
-    print_int(sec); print_string("\n");
+    print_int(now.hour); print_string(":");
+    print_two_digits(now.minute); print_string(":");
+    print_two_digits(now.second); print_string("\n");
+}
+
+void cmd_uptime(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    if (clock_tsc_khz() == 0) {
+        print_string("Error: No TSC to keep time with\n");
+        return;
+    }
+    uint32_t seconds = (uint32_t)udiv64_32(clock_monotonic_ns(), 1000000000u);
+    print_string("Up ");
+    if (seconds >= 86400) {
+        print_int(seconds / 86400);
+        print_string(seconds >= 2 * 86400 ? " days, " : " day, ");
+    }
+    print_int(seconds / 3600 % 24); print_string(":");
+    print_two_digits(seconds / 60 % 60); print_string(":");
+    print_two_digits(seconds % 60); print_string("\n");
+}
+
+// Pipeline plumbing. Stages run one after another: each stage's output
+// fills the pipe, and the next stage starts with it drained into its input
+// buffer. Output of the last stage goes to the caller's sink, or to the
+// redirect buffer when it is sent to a file.
+//
+// Commands can run commands (source), so each nesting level has its own
+// context, and the sinks write to whichever context is current.
+#define MAX_NESTING 4
+
+struct command_context {
+    char expanded[MAX_CONTENT];         // The line after variable expansion
+    struct pipeline line;
+    struct pipe pipe;
+    char input[PIPE_SIZE + 1];
+    int input_size;                     // -1 when the stage has no piped input
+    char redirect_buffer[MAX_CONTENT];
+    int redirect_size;
+    int redirect_dropped;
+};
+
+static struct command_context contexts[MAX_NESTING];
+static int nesting = 0;
+static struct command_context* sink_context = NULL;
+static struct command_context* input_context = NULL;
+
+static void pipe_sink(char c) {
+    pipe_write(&sink_context->pipe, &c, 1);
+}
+
+static void redirect_sink(char c) {
+    if (sink_context->redirect_size < MAX_CONTENT - 1) {
+        sink_context->redirect_buffer[sink_context->redirect_size++] = c;
+    } else {
+        sink_context->redirect_dropped++;
+    }
+}
+
+int get_command_input(const char** data, int* size) {
+    if (input_context == NULL || input_context->input_size < 0) {
+        return 0;
+    }
+    *data = input_context->input;
+    *size = input_context->input_size;
+    return 1;
+}
+
+// Write the last stage's output to the file, creating it if needed
+static void finish_redirect(struct command_context* ctx) {
+    static char contents[MAX_CONTENT];
+    const char* name = ctx->line.redirect;
+    int size = 0;
+    if (!search_file(name)) {
+        create_file(name);
+    } else if (ctx->line.append) {
+        if (read_file(name, contents) < 0) return;
+        size = strlen(contents);
+    }
+    for (int i = 0; i < ctx->redirect_size; i++) {
+        if (size < MAX_CONTENT - 1) {
+            contents[size++] = ctx->redirect_buffer[i];
+        } else {
+            ctx->redirect_dropped++;
+        }
+    }
+    contents[size] = '\0';
+    if (write_file(name, contents) == 0 && ctx->redirect_dropped > 0) {
+        print_string("Error: File full, ");
+        print_int(ctx->redirect_dropped);
+        print_string(" bytes not written\n");
+    }
+}
+
+static void run_pipeline(struct command_context* ctx) {
+    struct pipeline* line = &ctx->line;
+
+    // Look every stage up first so errors reach the screen, not a pipe
+    const struct command* stage_commands[MAX_STAGES];
+    for (int stage = 0; stage < line->stages; stage++) {
+        stage_commands[stage] = find_command(line->argv[stage][0]);
+        if (stage_commands[stage] == NULL) {
+            print_string("Unknown command: ");
+            print_string(line->argv[stage][0]);
+            print_string("\nType 'help' for available commands\n");
+            return;
+        }
+    }
+
+    output_sink_t caller_sink = set_output_sink(NULL);
+    struct command_context* caller_sink_context = sink_context;
+    struct command_context* caller_input_context = input_context;
+    uint32_t pipe_dropped = 0;
+    pipe_init(&ctx->pipe);
+    ctx->input_size = -1;
+    ctx->redirect_size = 0;
+    ctx->redirect_dropped = 0;
+    input_context = ctx;
+    for (int stage = 0; stage < line->stages; stage++) {
+        if (stage > 0) {
+            ctx->input_size = pipe_read(&ctx->pipe, ctx->input, PIPE_SIZE);
+            ctx->input[ctx->input_size] = '\0';
+            pipe_dropped += ctx->pipe.dropped;
+            pipe_init(&ctx->pipe);
+        }
+        if (stage < line->stages - 1) {
+            sink_context = ctx;
+            set_output_sink(pipe_sink);
+        } else if (line->redirect) {
+            sink_context = ctx;
+            set_output_sink(redirect_sink);
+        } else {
+            sink_context = caller_sink_context;
+            set_output_sink(caller_sink);
+        }
+        TRACE(TRACE_COMMAND_BEGIN, stage_commands[stage] - commands, line->argc[stage]);
+        stage_commands[stage]->handler(line->argc[stage], line->argv[stage]);
+        TRACE(TRACE_COMMAND_END, 0, 0);
+    }
+    input_context = caller_input_context;
+    sink_context = caller_sink_context;
+    set_output_sink(caller_sink);
+
+    if (line->redirect) {
+        finish_redirect(ctx);
+    }
+    if (pipe_dropped > 0) {
+        print_string("Error: Pipe full, ");
+        print_int(pipe_dropped);
+        print_string(" bytes dropped\n");
+    }
 }
 
 // Command execution
 void execute_command(const char* command) {
-    char* argv[MAX_ARGS];
-    int argc = parse_command(command, argv);
-    
-    if (argc == 0) return;
-    
-    // System commands
-    if (strcmp(argv[0], "help") == 0) cmd_help(argc, argv);
-    else if (strcmp(argv[0], "clear") == 0) cmd_clear();
-    else if (strcmp(argv[0], "echo") == 0) cmd_echo(argc > 1 ? argv[1] : NULL);
-    else if (strcmp(argv[0], "info") == 0) cmd_info();
-    else if (strcmp(argv[0], "version") == 0) cmd_version();
-    else if (strcmp(argv[0], "shutdown") == 0) cmd_shutdown();
-    else if (strcmp(argv[0], "reboot") == 0) cmd_reboot();
-    
-    // File system commands
-    else if (strcmp(argv[0], "ls") == 0) cmd_ls(argc, argv);
-    else if (strcmp(argv[0], "create") == 0) cmd_create(argc, argv);
-    else if (strcmp(argv[0], "write") == 0) cmd_write(argc, argv);
-    else if (strcmp(argv[0], "read") == 0) cmd_read(argc, argv);
-    else if (strcmp(argv[0], "delete") == 0) cmd_delete(argc, argv);
-    else if (strcmp(argv[0], "search") == 0) cmd_search(argc, argv);
-    
-    // Process commands
-    else if (strcmp(argv[0], "ps") == 0) cmd_ps(argc, argv);
-    else if (strcmp(argv[0], "run") == 0) cmd_run(argc, argv);
-    else if (strcmp(argv[0], "kill") == 0) cmd_kill(argc, argv);
-    else if (strcmp(argv[0], "demo") == 0) cmd_demo(argc, argv);
-    else if (strcmp(argv[0], "calculator") == 0) cmd_calculator(argc, argv);
-    else if (strcmp(argv[0], "date") == 0) cmd_date();
-    else if (strcmp(argv[0], "time") == 0) cmd_time();
-    else if (strcmp(argv[0], "history") == 0) cmd_history();
-    else if (strcmp(argv[0], "font") == 0) cmd_font(argc, argv);
-    
-    else {
-        print_string("Unknown command: ");
-        print_string(argv[0]);
-        print_string("\nType 'help' for available commands\n");
+    if (nesting == MAX_NESTING) {
+        print_string("Error: Commands nested too deeply\n");
+        return;
+    }
+    struct command_context* ctx = &contexts[nesting++];
+    if (expand_variables(command, ctx->expanded, sizeof(ctx->expanded)) < 0) {
+        print_string("Error: Command too long\n");
+    } else if (parse_command(ctx->expanded, &ctx->line) > 0) {
+        run_pipeline(ctx);
+    }
+    nesting--;
+}
+
+void cmd_prof(int argc, char* argv[]) {
+    if (argc == 2 && strcmp(argv[1], "start") == 0) {
+        if (profile_start() < 0) {
+            print_string("Error: Profiler is already running\n");
+            return;
+        }
+        print_string("Profiling at ");
+        print_int(PROFILE_HZ);
+        print_string(" Hz\n");
+    } else if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        if (profile_stop() < 0) {
+            print_string("Error: Profiler is not running\n");
+        }
+    } else if (argc >= 2 && argc <= 3 && strcmp(argv[1], "report") == 0) {
+        int top = argc == 3 ? string_to_int(argv[2]) : PROFILE_DEFAULT_TOP;
+        profile_report(top > 0 ? top : PROFILE_DEFAULT_TOP);
+    } else {
+        print_string("Usage: prof start|stop|report [n]\n");
+    }
+}
+
+void cmd_trace(int argc, char* argv[]) {
+    if (argc == 1) {
+        trace_status();
+    } else if (argc == 2 && strcmp(argv[1], "start") == 0) {
+        trace_start();
+        print_string("Tracing started\n");
+    } else if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        trace_stop();
+        trace_status();
+    } else if (argc == 2 && strcmp(argv[1], "dump") == 0) {
+        trace_dump();
+    } else {
+        print_string("Usage: trace [start|stop|dump]\n");
     }
 }
 
-void cmd_history(void) {
+void cmd_kbench(int argc, char* argv[]) {
+    int reps = KBENCH_DEFAULT_REPS;
+    int first = 1;
+    if (argc > 1 && strcmp(argv[1], "-l") == 0) {
+        list_benchmarks();
+        return;
+    }
+    if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+        reps = string_to_int(argv[2]);
+        first = 3;
+    }
+    if (reps < 1 || reps > KBENCH_MAX_REPS) {
+        print_string("Error: Rounds must be 1 to ");
+        print_int(KBENCH_MAX_REPS);
+        print_string("\n");
+        return;
+    }
+    run_benchmarks(reps, argc - first, argv + first);
+}
+
+void cmd_ipcbench(int argc, char* argv[]) {
+    int messages = argc > 1 ? string_to_int(argv[1]) : IPCBENCH_DEFAULT_MESSAGES;
+    if (messages < 1 || messages > IPCBENCH_MAX_MESSAGES) {
+        print_string("Error: Messages must be 1 to ");
+        print_int(IPCBENCH_MAX_MESSAGES);
+        print_string("\n");
+        return;
+    }
+    run_ipc_benchmark(messages);
+}
+
+// Script commands
+void cmd_source(int argc, char* argv[]) {
+    int timing = argc > 1 && strcmp(argv[1], "-t") == 0;
+    if (argc < 2 + timing) {
+        print_string("Usage: source [-t] <file> [args]\n");
+        return;
+    }
+    // The script sees its name as $0 and the rest as $1..$9
+    run_script(argv[1 + timing], argc - 1 - timing, argv + 1 + timing, timing);
+}
+
+void cmd_set(int argc, char* argv[]) {
+    if (argc < 2) {
+        list_variables();
+        return;
+    }
+    char value[VARIABLE_VALUE_LENGTH] = {0};
+    int length = 0;
+    for (int i = 2; i < argc; i++) {
+        for (const char* c = argv[i]; *c && length < VARIABLE_VALUE_LENGTH - 2; c++) {
+            value[length++] = *c;
+        }
+        if (i < argc - 1) value[length++] = ' ';
+    }
+    set_variable(argv[1], value);
+}
+
+void cmd_unset(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_string("Usage: unset <name>\n");
+        return;
+    }
+    if (unset_variable(argv[1]) < 0) {
+        print_string("Error: No such variable\n");
+    }
+}
+
+#define SLEEP_MAX_MS 3600000
+
+void cmd_sleep(int argc, char* argv[]) {
+    if (argc != 2) {
+        print_string("Usage: sleep <ms>\n");
+        return;
+    }
+    int ms = string_to_int(argv[1]);
+    if (ms < 0 || ms > SLEEP_MAX_MS) {
+        print_string("Error: Sleep between 0 and 3600000 ms\n");
+        return;
+    }
+    timer_sleep_ms(ms);
+}
+
+void cmd_history(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
     int count = get_history_count();
     print_string("Command History:\n");
     for (int i = 0; i < count && i < HISTORY_SIZE; i++) {
@@ -394,6 +968,103 @@ void cmd_search(int argc, char* argv[]) {
     }
 }
 
+// Print every line containing the pattern, as "name:line" when a name is
+// given. Only the matcher is timed, not the (much slower) output.
+static int grep_lines(const struct search_pattern* pattern, const char* name,
+                      const char* data, int size, uint64_t* cycles) {
+    const char* end = data + size;
+    const char* pos = data;
+    int matches = 0;
+    while (pos < end) {
+        uint64_t start = rdtsc();
+        const char* hit = search_find(pattern, pos, end - pos);
+        *cycles += rdtsc() - start;
+        if (hit == NULL) break;
+
+        const char* line = hit;
+        while (line > pos && line[-1] != '\n') line--;
+        const char* line_end = search_memchr(hit, '\n', end - hit);
+        if (line_end == NULL) line_end = end;
+        if (name) {
+            print_string(name);
+            print_char(':');
+        }
+        for (const char* c = line; c < line_end; c++) {
+            print_char(*c);
+        }
+        print_char('\n');
+        matches++;
+        pos = line_end + 1;
+    }
+    return matches;
+}
+
+static int grep_file(const struct search_pattern* pattern, const char* name,
+                     uint32_t* scanned, uint64_t* cycles) {
+    const char* data;
+    int size;
+    if (get_file_data(name, &data, &size) < 0) {
+        print_string("grep: ");
+        print_string(name);
+        print_string(": No such file\n");
+        return 0;
+    }
+    *scanned += size;
+    return grep_lines(pattern, name, data, size, cycles);
+}
+
+void cmd_grep(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_string("Usage: grep <pattern> [files]\n");
+        return;
+    }
+    static struct search_pattern pattern;
+    if (search_compile(&pattern, argv[1]) < 0) {
+        print_string("Error: Pattern must be 1 to ");
+        print_int(SEARCH_MAX_PATTERN - 1);
+        print_string(" characters\n");
+        return;
+    }
+
+    // As a pipeline stage with no files, filter the input down to the
+    // matching lines and nothing else
+    int matches = 0;
+    uint32_t scanned = 0;
+    uint64_t cycles = 0;
+    const char* input;
+    int input_size;
+    if (argc == 2 && get_command_input(&input, &input_size)) {
+        grep_lines(&pattern, NULL, input, input_size, &cycles);
+        return;
+    }
+    if (argc > 2) {
+        for (int i = 2; i < argc; i++) {
+            matches += grep_file(&pattern, argv[i], &scanned, &cycles);
+        }
+    } else {
+        char name[MAX_FILENAME];
+        for (int i = 0; i < MAX_FILES; i++) {
+            if (get_file_name(i, name) == 0) {
+                matches += grep_file(&pattern, name, &scanned, &cycles);
+            }
+        }
+    }
+
+    print_int(matches);
+    print_string(" matching lines, ");
+    print_int(scanned);
+    print_string(" bytes scanned");
+    uint32_t rate = clock_kb_per_sec(scanned, cycles);
+    if (rate > 0) {
+        print_string(" in ");
+        print_int((int)clock_cycles_to_us(cycles));
+        print_string(" us (");
+        print_int(rate);
+        print_string(" KB/s)");
+    }
+    print_char('\n');
+}
+
 void cmd_font(int argc, char* argv[]) {
     if (argc < 2) {
         print_string("Usage: font <color>\n");
@@ -7,40 +7,67 @@ void cmd_create(int argc, char* argv[]);
 void cmd_write(int argc, char* argv[]);
 void cmd_read(int argc, char* argv[]);
 void cmd_delete(int argc, char* argv[]);
+void cmd_sync(int argc, char* argv[]);
+void cmd_cachestat(int argc, char* argv[]);
+void cmd_fsinfo(int argc, char* argv[]);
+void cmd_dfstat(int argc, char* argv[]);
+void cmd_compress(int argc, char* argv[]);
+void cmd_zstat(int argc, char* argv[]);
+void cmd_fsck(int argc, char* argv[]);
 
 // System commands
 void cmd_help(int argc, char* argv[]);
-void cmd_clear(void);
-void cmd_echo(const char* text);
-void cmd_info(void);
-void cmd_version(void);
-void cmd_shutdown(void);
-void cmd_reboot(void);
+void cmd_clear(int argc, char* argv[]);
+void cmd_echo(int argc, char* argv[]);
+void cmd_info(int argc, char* argv[]);
+void cmd_version(int argc, char* argv[]);
+void cmd_shutdown(int argc, char* argv[]);
+void cmd_reboot(int argc, char* argv[]);
+void cmd_lsblk(int argc, char* argv[]);
+void cmd_lspci(int argc, char* argv[]);
+void cmd_cpus(int argc, char* argv[]);
+void cmd_lockstat(int argc, char* argv[]);
+void cmd_timers(int argc, char* argv[]);
+void cmd_prof(int argc, char* argv[]);
+void cmd_trace(int argc, char* argv[]);
+void cmd_kbench(int argc, char* argv[]);
+void cmd_ipcbench(int argc, char* argv[]);
 
 // Process commands
 void cmd_ps(int argc, char* argv[]);
-void cmd_run(int argc, char* const argv[]);
-void cmd_kill(int argc, char* const argv[]);
+void cmd_run(int argc, char* argv[]);
+void cmd_kill(int argc, char* argv[]);
 
 // Demo commands
 void cmd_demo(int argc, char* argv[]);
+void cmd_lockdemo(int argc, char* argv[]);
 void cmd_filedemo(int argc, char* argv[]);
 
 // Math/Calculator command
 void cmd_calculator(int argc, char* argv[]);
 
 // Date and time commands
-void cmd_date(void);
-void cmd_time(void);
+void cmd_date(int argc, char* argv[]);
+void cmd_time(int argc, char* argv[]);
+void cmd_uptime(int argc, char* argv[]);
 
 // Command execution
 void execute_command(const char* command);
+int complete_command(const char* prefix, const char* matches[], int max_matches);  // Total matches
+int get_command_input(const char** data, int* size);  // 1 when piped input is available
 
 // History command
-void cmd_history(void);
+void cmd_history(int argc, char* argv[]);
 
-// Search command
+// Search commands
 void cmd_search(int argc, char* argv[]);
+void cmd_grep(int argc, char* argv[]);
+
+// Script commands
+void cmd_source(int argc, char* argv[]);
+void cmd_set(int argc, char* argv[]);
+void cmd_unset(int argc, char* argv[]);
+void cmd_sleep(int argc, char* argv[]);
 
 // Font command
 void cmd_font(int argc, char* argv[]);
@@ -0,0 +1,501 @@
+#include "../include/kernel.h"
+#include "kbench.h"
+#include "../fs/fs.h"
+#include "../process/process.h"
+#include "../kernel/clock.h"
+#include "../kernel/ipc.h"
+#include "../kernel/page.h"
+#include "../kernel/smp.h"
+#include "../drivers/serial.h"
+#include <stddef.h>
+
+struct benchmark {
+    const char* name;
+    int ops;                            // Operations per timed round
+    int (*setup)(void);                 // Optional; -1 skips the benchmark
+    void (*run)(int ops);
+    void (*teardown)(void);             // Optional
+    int uses_screen;                    // Output really goes to VGA
+};
+
+struct kbench_result {
+    uint32_t min;
+    uint32_t median;
+    uint32_t p99;
+};
+
+#define BENCH_FILE "kbench.tmp"
+#define BENCH_LOOKUP_FILES 16
+#define BENCH_PROCESSES 4
+#define BENCH_BUFFER_SIZE 4096
+
+static uint32_t samples[KBENCH_MAX_REPS];
+static char buffer_a[BENCH_BUFFER_SIZE];
+static char buffer_b[BENCH_BUFFER_SIZE];
+static char read_buffer[MAX_CONTENT];
+static int bench_pids[BENCH_PROCESSES];
+static volatile int result_sink;        // Keeps results of pure functions live
+
+static const char bench_text[] =
+    "The quick brown fox jumps over the lazy dog. 0123456789 "
+    "The quick brown fox jumps over the lazy dog. 0123456789 ";
+
+static void null_sink(char c) {
+    (void)c;
+}
+
+static void lookup_name(int i, char* name) {
+    strcpy(name, "kbench");
+    int_to_string(i, name + 6);
+}
+
+// File system
+static int setup_create(void) {
+    create_file(BENCH_FILE);
+    int created = search_file(BENCH_FILE);
+    delete_file(BENCH_FILE);
+    return created ? 0 : -1;
+}
+
+static void bench_file_create(int ops) {
+    for (int i = 0; i < ops; i++) {
+        create_file(BENCH_FILE);
+        delete_file(BENCH_FILE);
+    }
+}
+
+static int setup_lookup(void) {
+    char name[16];
+    for (int i = 0; i < BENCH_LOOKUP_FILES; i++) {
+        lookup_name(i, name);
+        create_file(name);
+    }
+    return search_file(name) ? 0 : -1;
+}
+
+static void bench_file_lookup(int ops) {
+    for (int i = 0; i < ops; i++) {
+        result_sink = search_file("kbench15");
+    }
+}
+
+static void teardown_lookup(void) {
+    char name[16];
+    for (int i = 0; i < BENCH_LOOKUP_FILES; i++) {
+        lookup_name(i, name);
+        delete_file(name);
+    }
+}
+
+static int setup_file(void) {
+    create_file(BENCH_FILE);
+    if (!search_file(BENCH_FILE)) {
+        return -1;
+    }
+    return write_file(BENCH_FILE, bench_text);
+}
+
+static void bench_file_write(int ops) {
+    for (int i = 0; i < ops; i++) {
+        write_file(BENCH_FILE, bench_text);
+    }
+}
+
+static void bench_file_read(int ops) {
+    for (int i = 0; i < ops; i++) {
+        read_file(BENCH_FILE, read_buffer);
+    }
+}
+
+static void teardown_file(void) {
+    delete_file(BENCH_FILE);
+}
+
+// Scheduler: processes with bursts long enough to never finish, on this
+// CPU's queue, which is the one schedule() below works on
+static int setup_schedule(void) {
+    char name[16];
+    for (int i = 0; i < BENCH_PROCESSES; i++) {
+        bench_pids[i] = -1;
+    }
+    for (int i = 0; i < BENCH_PROCESSES; i++) {
+        lookup_name(i, name);
+        bench_pids[i] = create_process_on_cpu(name, 1 << 30, cpu_id());
+        if (bench_pids[i] < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void bench_schedule(int ops) {
+    for (int i = 0; i < ops; i++) {
+        schedule();
+    }
+}
+
+static void teardown_schedule(void) {
+    for (int i = 0; i < BENCH_PROCESSES; i++) {
+        if (bench_pids[i] >= 0) {
+            kill_process(bench_pids[i]);
+        }
+    }
+}
+
+// Screen
+static void bench_print_string(int ops) {
+    for (int i = 0; i < ops; i++) {
+        print_string(bench_text);
+        print_char('\n');
+    }
+}
+
+// String primitives
+static int setup_strings(void) {
+    memset(buffer_a, 'a', BENCH_BUFFER_SIZE);
+    memset(buffer_b, 'a', BENCH_BUFFER_SIZE);
+    buffer_a[255] = '\0';
+    buffer_b[255] = '\0';
+    return 0;
+}
+
+static void bench_strlen(int ops) {
+    for (int i = 0; i < ops; i++) {
+        result_sink = strlen(buffer_a);
+    }
+}
+
+static void bench_strcmp(int ops) {
+    for (int i = 0; i < ops; i++) {
+        result_sink = strcmp(buffer_a, buffer_b);
+    }
+}
+
+static void bench_memcpy(int ops) {
+    for (int i = 0; i < ops; i++) {
+        memcpy(buffer_b, buffer_a, BENCH_BUFFER_SIZE);
+    }
+}
+
+static void bench_memset(int ops) {
+    for (int i = 0; i < ops; i++) {
+        memset(buffer_b, i, BENCH_BUFFER_SIZE);
+    }
+}
+
+static const struct benchmark benchmarks[] = {
+    { "file_create", 8, setup_create, bench_file_create, NULL, 0 },
+    { "file_lookup", 64, setup_lookup, bench_file_lookup, teardown_lookup, 0 },
+    { "file_write", 8, setup_file, bench_file_write, teardown_file, 0 },
+    { "file_read", 16, setup_file, bench_file_read, teardown_file, 0 },
+    { "schedule", 64, setup_schedule, bench_schedule, teardown_schedule, 0 },
+    { "print_string", 4, NULL, bench_print_string, NULL, 1 },
+    { "strlen_256", 16, setup_strings, bench_strlen, NULL, 0 },
+    { "strcmp_256", 16, setup_strings, bench_strcmp, NULL, 0 },
+    { "memcpy_4k", 16, setup_strings, bench_memcpy, NULL, 0 },
+    { "memset_4k", 16, setup_strings, bench_memset, NULL, 0 },
+};
+
+#define BENCHMARK_COUNT ((int)(sizeof(benchmarks) / sizeof(benchmarks[0])))
+
+static void sort_samples(int count) {
+    for (int i = 1; i < count; i++) {
+        uint32_t value = samples[i];
+        int j = i - 1;
+        while (j >= 0 && samples[j] > value) {
+            samples[j + 1] = samples[j];
+            j--;
+        }
+        samples[j + 1] = value;
+    }
+}
+
+static int run_benchmark(const struct benchmark* bench, int reps, struct kbench_result* result) {
+    // Commands print as a side effect; only print_string should reach VGA
+    output_sink_t previous = set_output_sink(bench->uses_screen ? NULL : null_sink);
+    if (bench->setup && bench->setup() < 0) {
+        if (bench->teardown) bench->teardown();
+        set_output_sink(previous);
+        return -1;
+    }
+    for (int i = 0; i < KBENCH_WARMUP; i++) {
+        bench->run(bench->ops);
+    }
+    for (int i = 0; i < reps; i++) {
+        uint64_t start = rdtsc();
+        bench->run(bench->ops);
+        samples[i] = (uint32_t)udiv64_32(rdtsc() - start, bench->ops);
+    }
+    if (bench->teardown) {
+        bench->teardown();
+    }
+    set_output_sink(previous);
+
+    sort_samples(reps);
+    result->min = samples[0];
+    result->median = samples[reps / 2];
+    result->p99 = samples[(reps * 99) / 100];
+    return 0;
+}
+
+static uint32_t cycles_to_ns(uint32_t cycles) {
+    uint32_t khz = clock_tsc_khz();
+    return khz ? (uint32_t)udiv64_32((uint64_t)cycles * 1000000, khz) : 0;
+}
+
+#define NAME_WIDTH 14
+#define COLUMN_WIDTH 10
+
+static void print_right(const char* text) {
+    for (int i = strlen(text); i < COLUMN_WIDTH; i++) {
+        print_char(' ');
+    }
+    print_string(text);
+}
+
+static void print_column(uint32_t value) {
+    char str[12];
+    int_to_string((int)value, str);
+    print_right(str);
+}
+
+static void print_name(const char* name) {
+    print_string(name);
+    for (int i = strlen(name); i < NAME_WIDTH; i++) {
+        print_char(' ');
+    }
+}
+
+static int is_selected(const char* name, int count, char* names[]) {
+    if (count == 0) {
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (strcmp(names[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+void list_benchmarks(void) {
+    for (int i = 0; i < BENCHMARK_COUNT; i++) {
+        print_string(benchmarks[i].name);
+        print_char('\n');
+    }
+}
+
+static int is_benchmark(const char* name) {
+    for (int i = 0; i < BENCHMARK_COUNT; i++) {
+        if (strcmp(benchmarks[i].name, name) == 0) return 1;
+    }
+    return 0;
+}
+
+int run_benchmarks(int reps, int count, char* names[]) {
+    for (int i = 0; i < count; i++) {
+        if (!is_benchmark(names[i])) {
+            print_string("Error: No such benchmark: ");
+            print_string(names[i]);
+            print_string(" (kbench -l lists them)\n");
+            return -1;
+        }
+    }
+
+    serial_write_string("# kbench tsc_khz=");
+    serial_write_int(clock_tsc_khz());
+    serial_write_string(" warmup=");
+    serial_write_int(KBENCH_WARMUP);
+    serial_write_string(" reps=");
+    serial_write_int(reps);
+    serial_write_string("\nbenchmark,ops,min_cycles,median_cycles,p99_cycles,median_ns\n");
+    print_string("Cycles per operation, ");
+    print_int(reps);
+    print_string(" rounds\n");
+    print_name("benchmark");
+    print_right("min");
+    print_right("median");
+    print_right("p99");
+    print_right("median ns");
+    print_char('\n');
+
+    int ran = 0;
+    for (int i = 0; i < BENCHMARK_COUNT; i++) {
+        const struct benchmark* bench = &benchmarks[i];
+        if (!is_selected(bench->name, count, names)) continue;
+        struct kbench_result result;
+        if (run_benchmark(bench, reps, &result) < 0) {
+            print_name(bench->name);
+            print_string("skipped (setup failed)\n");
+            continue;
+        }
+        ran++;
+        print_name(bench->name);
+        print_column(result.min);
+        print_column(result.median);
+        print_column(result.p99);
+        print_column(cycles_to_ns(result.median));
+        print_char('\n');
+
+        serial_write_string(bench->name);
+        serial_write_char(',');
+        serial_write_int(bench->ops);
+        serial_write_char(',');
+        serial_write_int(result.min);
+        serial_write_char(',');
+        serial_write_int(result.median);
+        serial_write_char(',');
+        serial_write_int(result.p99);
+        serial_write_char(',');
+        serial_write_int(cycles_to_ns(result.median));
+        serial_write_char('\n');
+    }
+    serial_write_string("# kbench end\n");
+    return ran;
+}
+
+// IPC: a client and a server on two ports, both played by this CPU, so
+// this is the cost of the IPC path itself without any cross-CPU wakeup
+#define IPC_SMALL_SIZE 32
+
+enum ipc_payload { IPC_PAYLOAD_INLINE, IPC_PAYLOAD_COPY, IPC_PAYLOAD_PAGE };
+
+static const struct {
+    const char* name;
+    enum ipc_payload payload;
+} ipc_cases[] = {
+    { "32 B inline", IPC_PAYLOAD_INLINE },
+    { "4 KB copied", IPC_PAYLOAD_COPY },    // Copied into a page and out again
+    { "4 KB page", IPC_PAYLOAD_PAGE },      // Built in the page and read in place
+};
+
+#define IPC_CASE_COUNT ((int)(sizeof(ipc_cases) / sizeof(ipc_cases[0])))
+
+static int ipc_send_payload(int port, enum ipc_payload payload, uint32_t tag) {
+    struct ipc_message msg;
+    msg.sender = IPC_KERNEL;
+    msg.tag = tag;
+    if (payload == IPC_PAYLOAD_INLINE) {
+        msg.page = PAGE_NONE;
+        msg.size = IPC_SMALL_SIZE;
+        memcpy(msg.data, bench_text, IPC_SMALL_SIZE);
+    } else {
+        msg.page = page_alloc(PAGE_OWNER_KERNEL);
+        if (msg.page == PAGE_NONE) {
+            return -1;
+        }
+        msg.size = PAGE_SIZE;
+        uint32_t* data = page_address(msg.page);
+        if (payload == IPC_PAYLOAD_COPY) {
+            memcpy(data, buffer_a, PAGE_SIZE);
+        } else {
+            data[0] = tag;
+        }
+    }
+    int result = ipc_send(port, &msg, 0);
+    if (result < 0 && msg.page != PAGE_NONE) {
+        page_free(msg.page, PAGE_OWNER_KERNEL);
+    }
+    return result;
+}
+
+static int ipc_receive_payload(int port, enum ipc_payload payload) {
+    struct ipc_message msg;
+    if (ipc_receive(port, &msg, IPC_KERNEL, 0) < 0) {
+        return -1;
+    }
+    if (payload == IPC_PAYLOAD_INLINE) {
+        result_sink = msg.data[0];
+        return 0;
+    }
+    uint32_t* data = page_address(msg.page);
+    if (payload == IPC_PAYLOAD_COPY) {
+        memcpy(buffer_b, data, msg.size);
+    } else {
+        result_sink = data[0];
+    }
+    return page_free(msg.page, IPC_KERNEL);
+}
+
+// Messages a second through one port, sent and received a queue at a time
+static uint64_t ipc_throughput(int port, enum ipc_payload payload, int messages) {
+    uint64_t start = rdtsc();
+    for (int sent = 0; sent < messages; sent += IPC_QUEUE_SIZE) {
+        int batch = messages - sent < IPC_QUEUE_SIZE ? messages - sent : IPC_QUEUE_SIZE;
+        for (int i = 0; i < batch; i++) {
+            if (ipc_send_payload(port, payload, sent + i) < 0) return 0;
+        }
+        for (int i = 0; i < batch; i++) {
+            if (ipc_receive_payload(port, payload) < 0) return 0;
+        }
+    }
+    return rdtsc() - start;
+}
+
+// Request on one port, reply on the other
+static uint64_t ipc_round_trips(int request, int reply, enum ipc_payload payload, int trips) {
+    uint64_t start = rdtsc();
+    for (int i = 0; i < trips; i++) {
+        if (ipc_send_payload(request, payload, i) < 0 ||
+            ipc_receive_payload(request, payload) < 0 ||
+            ipc_send_payload(reply, payload, i) < 0 ||
+            ipc_receive_payload(reply, payload) < 0) {
+            return 0;
+        }
+    }
+    return rdtsc() - start;
+}
+
+int run_ipc_benchmark(int messages) {
+    if (clock_tsc_khz() == 0) {
+        print_string("Error: No TSC to time with\n");
+        return -1;
+    }
+    int request = ipc_port_create();
+    int reply = ipc_port_create();
+    if (request < 0 || reply < 0) {
+        print_string("Error: No free IPC ports\n");
+        ipc_port_destroy(request);
+        return -1;
+    }
+    memset(buffer_a, 'a', BENCH_BUFFER_SIZE);
+
+    serial_write_string("# ipcbench tsc_khz=");
+    serial_write_int(clock_tsc_khz());
+    serial_write_string(" messages=");
+    serial_write_int(messages);
+    serial_write_string("\nmessage,msgs_per_sec,round_trip_ns\n");
+    print_int(messages);
+    print_string(" messages each, this CPU on both ends\n");
+    print_name("message");
+    print_right("msgs/s");
+    print_right("rtt ns");
+    print_char('\n');
+
+    int result = 0;
+    for (int c = 0; c < IPC_CASE_COUNT; c++) {
+        uint64_t one_way = ipc_throughput(request, ipc_cases[c].payload, messages);
+        uint64_t trips = ipc_round_trips(request, reply, ipc_cases[c].payload, messages);
+        print_name(ipc_cases[c].name);
+        if (one_way == 0 || trips == 0) {
+            print_string("failed\n");
+            result = -1;
+            break;
+        }
+        uint32_t us = (uint32_t)clock_cycles_to_us(one_way);
+        uint32_t rate = us ? (uint32_t)udiv64_32((uint64_t)messages * 1000000, us) : 0;
+        uint32_t rtt = (uint32_t)udiv64_32(trips, messages);
+        print_column(rate);
+        print_column(cycles_to_ns(rtt));
+        print_char('\n');
+
+        serial_write_string(ipc_cases[c].name);
+        serial_write_char(',');
+        serial_write_int(rate);
+        serial_write_char(',');
+        serial_write_int(cycles_to_ns(rtt));
+        serial_write_char('\n');
+    }
+    serial_write_string("# ipcbench end\n");
+    ipc_port_destroy(request);
+    ipc_port_destroy(reply);
+    return result;
+}
@@ -0,0 +1,20 @@
+#ifndef KBENCH_H
+#define KBENCH_H
+
+// In-kernel microbenchmarks. Each one runs KBENCH_WARMUP untimed rounds and
+// then `reps` timed rounds of a fixed number of operations; the results are
+// cycles per operation (min/median/p99) on the screen, and as CSV on COM1.
+#define KBENCH_WARMUP 10
+#define KBENCH_DEFAULT_REPS 100
+#define KBENCH_MAX_REPS 1000
+
+void list_benchmarks(void);
+int run_benchmarks(int reps, int count, char* names[]);   // -1 for an unknown name
+
+// Messages per second and round-trip time through IPC ports, small and
+// page-sized payloads; CSV on COM1 too
+#define IPCBENCH_DEFAULT_MESSAGES 10000
+#define IPCBENCH_MAX_MESSAGES 1000000
+int run_ipc_benchmark(int messages);
+
+#endif
@@ -1,27 +1,175 @@
 #include "math_commands.h"
+#include "calc.h"
 #include "../include/kernel.h"
+#include "../kernel/clock.h"
 
-// Dummy implementations of print_string and print_int for illustration.
-// These should be replaced with the actual implementations.
-void print_string(const char* str);
-void print_int(int num);
+#define BENCH_MAX_RUNS 100000000
 
-// Simple calculator command: usage example: calculator add 2 3
+static void print_error(int result) {
+    print_string("Error: ");
+    print_string(calc_run_error(result));
+    print_string("!\n");
+}
+
+// Compile (or find in the cache) and run one line, printing the value or
+// what went wrong. A line whose value overflows 32 bits runs again in
+// bignums. The value is kept in `ans` for the next line.
+static void evaluate_line(const char* line) {
+    const char* error;
+    const struct calc_program* program = calc_compile(line, &error);
+    if (program == NULL) {
+        print_string("Error: Invalid expression (");
+        print_string(error);
+        print_string(")\n");
+        return;
+    }
+    int32_t value;
+    const struct bignum* big = NULL;
+    int result = calc_run(program, &value);
+    if (result == CALC_OVERFLOW) {
+        result = calc_run_big(program, &big);
+    }
+    const char* text = big ? calc_decimal(big) : NULL;
+    if (result == 0 && big && text == NULL) {
+        result = CALC_TOO_BIG;
+    }
+    if (result < 0) {
+        print_error(result);
+        return;
+    }
+    if (program->target >= 0) {
+        print_string(calc_variable_name(program->target));
+        print_string(" = ");
+    }
+    if (big) {
+        print_string(text);
+        print_string("\n");
+        calc_set_variable_big(calc_variable("ans"), big);
+    } else {
+        print_int(value);
+        print_string("\n");
+        calc_set_variable(calc_variable("ans"), value);
+    }
+}
+
+// The next space-separated word of *args, copied into `word`
+static int next_word(const char** args, char* word, int size) {
+    const char* p = *args;
+    while (*p == ' ') p++;
+    int length = 0;
+    while (*p && *p != ' ') {
+        if (length < size - 1) word[length++] = *p;
+        p++;
+    }
+    word[length] = '\0';
+    *args = p;
+    return length;
+}
+
+// -bench name from to expression: run the compiled expression with the
+// variable set to each value in turn
+static void bench_command(const char* args) {
+    char name[CALC_NAME_LENGTH], from_text[16], to_text[16];
+    if (!next_word(&args, name, sizeof(name)) || !next_word(&args, from_text, sizeof(from_text)) ||
+        !next_word(&args, to_text, sizeof(to_text))) {
+        print_string("Usage: calculator -bench <variable> <from> <to> <expression>\n");
+        return;
+    }
+    while (*args == ' ') args++;
+    int from = string_to_int(from_text);
+    int to = string_to_int(to_text);
+    if (to < from || (int64_t)to - from >= BENCH_MAX_RUNS) {
+        print_string("Error: The range must run upwards, over at most 100000000 values\n");
+        return;
+    }
+    int slot = calc_variable(name);
+    if (slot < 0) {
+        print_string("Error: Too many variables\n");
+        return;
+    }
+    calc_set_variable(slot, from);
+    const char* error;
+    const struct calc_program* program = calc_compile(args, &error);
+    if (program == NULL) {
+        print_string("Error: Invalid expression (");
+        print_string(error);
+        print_string(")\n");
+        return;
+    }
+
+    uint32_t runs = (uint32_t)(to - from) + 1;
+    uint32_t checksum = 0;
+    uint32_t promoted = 0;
+    int32_t value;
+    uint64_t start = clock_monotonic_ns();
+    for (int64_t i = from; i <= to; i++) {
+        calc_set_variable(slot, (int32_t)i);
+        int result = calc_run(program, &value);
+        if (result == CALC_OVERFLOW) {
+            // The low 32 bits of a bignum result go into the sum
+            const struct bignum* big;
+            result = calc_run_big(program, &big);
+            if (result == 0) {
+                uint32_t low = big->length ? big->limbs[0] : 0;
+                value = (int32_t)(big->negative ? 0u - low : low);
+            }
+            promoted++;
+        }
+        if (result < 0) {
+            print_string("Error: ");
+            print_string(calc_run_error(result));
+            print_string(" at ");
+            print_string(name);
+            print_string(" = ");
+            print_int((int)i);
+            print_string("\n");
+            return;
+        }
+        checksum += (uint32_t)value;
+    }
+    uint64_t elapsed = clock_monotonic_ns() - start;
+
+    uint32_t hits, misses;
+    calc_cache_stats(&hits, &misses);
+    print_int(runs);
+    print_string(" runs in ");
+    print_int((int)udiv64_32(elapsed, 1000));
+    print_string(" us, ");
+    print_int((int)udiv64_32(elapsed, runs));
+    print_string(" ns each (");
+    print_int(program->length);
+    print_string(" bytes of bytecode");
+    if (promoted) {
+        print_string(", ");
+        print_int(promoted);
+        print_string(" in bignums");
+    }
+    print_string(")\nSum of results: ");
+    print_int((int)checksum);
+    print_string("\nCompile cache: ");
+    print_int(hits);
+    print_string(" hits, ");
+    print_int(misses);
+    print_string(" misses\n");
+}
+
+// calculator [expression | -bench ...], or an interactive session
 void calculator_command(const char* args) {
-    char input[64];
+    char input[CALC_MAX_SOURCE];
+    if (args && strncmp(args, "-bench", 6) == 0 && (args[6] == ' ' || args[6] == '\0')) {
+        bench_command(args + 6);
+        return;
+    }
     if (args && args[0]) {
-        // If arguments are provided, treat as one-shot calculation
-        strncpy(input, args, sizeof(input)-1);
-        input[sizeof(input)-1] = '\0';
-        goto single_eval;
+        evaluate_line(args);
+        return;
     }
-    print_string("Calculator mode. Type expressions like 2+3 or 'exit' to quit.\n");
+    print_string("Calculator mode. Type expressions like (2+3)*4 or x = 5, or 'exit' to quit.\n");
     while (1) {
         print_string("> ");
         int pos = 0;
         char c = 0;
-        // Read input from getchar()
-        while ((c = getchar()) != '\n' && pos < (int)sizeof(input)-1) {
+        while ((c = getchar()) != '\n' && pos < (int)sizeof(input) - 1) {
             if (c == '\b' && pos > 0) {
                 pos--;
                 print_string("\b \b");
@@ -33,39 +181,9 @@ void calculator_command(const char* args) {
         input[pos] = '\0';
         print_string("\n");
         if (strcmp(input, "exit") == 0) break;
-    single_eval:
-        // Manual parsing for a op b (e.g., 2+3, 10 - 4)
-        int a = 0, b = 0, res = 0;
-        char op = 0;
-        int i = 0, sign = 1;
-        // Skip leading spaces
-        while (input[i] == ' ') i++;
-        if (input[i] == '-') { sign = -1; i++; }
-        while (input[i] >= '0' && input[i] <= '9') {
-            a = a * 10 + (input[i++] - '0');
-        }
-        a *= sign;
-        // Skip spaces
-        while (input[i] == ' ') i++;
-        op = input[i++];
-        // Skip spaces
-        while (input[i] == ' ') i++;
-        sign = 1;
-        if (input[i] == '-') { sign = -1; i++; }
-        while (input[i] >= '0' && input[i] <= '9') {
-            b = b * 10 + (input[i++] - '0');
+        if (pos > 0) {
+            evaluate_line(input);
         }
-        b *= sign;
-        if (op == '+') res = a + b;
-        else if (op == '-') res = a - b;
-        else if (op == '*') res = a * b;
-        else if (op == '/') {
-            if (b == 0) { print_string("Error: Division by zero!\n"); goto next; }
-            res = a / b;
-        } else { print_string("Invalid expression. Use format: 2+3 or 10 - 4\n"); goto next; }
-        print_int(res); print_string("\n");
-    next:
-        if (args && args[0]) break;
     }
     print_string("Exiting calculator.\n");
 }
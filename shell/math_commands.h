@@ -1,14 +1,7 @@
 #ifndef MATH_COMMANDS_H
 #define MATH_COMMANDS_H
 
-// Calculator command handler
-typedef enum {
-    CALC_ADD,
-    CALC_SUB,
-    CALC_MUL,
-    CALC_DIV
-} calc_op_t;
-
+// Calculator command handler (the expression language is in calc.h)
 void calculator_command(const char* args);
 
 #endif // MATH_COMMANDS_H
@@ -0,0 +1,346 @@
+#include "../include/kernel.h"
+#include "script.h"
+#include "commands.h"
+#include "shell.h"
+#include "../fs/fs.h"
+#include "../kernel/clock.h"
+#include <stddef.h>
+
+struct variable {
+    char name[VARIABLE_NAME_LENGTH];
+    char value[VARIABLE_VALUE_LENGTH];
+    int is_used;
+};
+
+struct loop {
+    int start;                          // Offset of the first line of the body
+    int count;
+    int iteration;
+    char var[VARIABLE_NAME_LENGTH];     // Empty when the loop has no variable
+};
+
+// A running script. The text is copied because the commands it runs reuse
+// the file system's buffers.
+struct script_frame {
+    char text[SCRIPT_MAX_SIZE + 1];
+    int argc;
+    char** argv;
+};
+
+static struct variable variables[MAX_VARIABLES];
+static struct script_frame frames[SCRIPT_MAX_DEPTH];
+static int depth = 0;
+
+static int is_name_char(char c, int first) {
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_') {
+        return 1;
+    }
+    return !first && c >= '0' && c <= '9';
+}
+
+static int is_valid_name(const char* name) {
+    int length = strlen(name);
+    if (length == 0 || length >= VARIABLE_NAME_LENGTH) {
+        return 0;
+    }
+    for (int i = 0; i < length; i++) {
+        if (!is_name_char(name[i], i == 0)) return 0;
+    }
+    return 1;
+}
+
+static struct variable* find_variable(const char* name, int length) {
+    for (int i = 0; i < MAX_VARIABLES; i++) {
+        if (variables[i].is_used && strncmp(variables[i].name, name, length) == 0 &&
+            variables[i].name[length] == '\0') {
+            return &variables[i];
+        }
+    }
+    return NULL;
+}
+
+int set_variable(const char* name, const char* value) {
+    if (!is_valid_name(name)) {
+        print_string("Error: Invalid variable name\n");
+        return -1;
+    }
+    struct variable* var = find_variable(name, strlen(name));
+    for (int i = 0; var == NULL && i < MAX_VARIABLES; i++) {
+        if (!variables[i].is_used) {
+            var = &variables[i];
+            strcpy(var->name, name);
+            var->is_used = 1;
+        }
+    }
+    if (var == NULL) {
+        print_string("Error: No free variables\n");
+        return -1;
+    }
+    strncpy(var->value, value, VARIABLE_VALUE_LENGTH - 1);
+    var->value[VARIABLE_VALUE_LENGTH - 1] = '\0';
+    return 0;
+}
+
+int unset_variable(const char* name) {
+    struct variable* var = find_variable(name, strlen(name));
+    if (var == NULL) {
+        return -1;
+    }
+    var->is_used = 0;
+    return 0;
+}
+
+void list_variables(void) {
+    for (int i = 0; i < MAX_VARIABLES; i++) {
+        if (variables[i].is_used) {
+            print_string(variables[i].name);
+            print_char('=');
+            print_string(variables[i].value);
+            print_char('\n');
+        }
+    }
+}
+
+// Value of $name; positional parameters come from the innermost script
+static const char* lookup(const char* name, int length, char* number) {
+    if (length == 1 && name[0] == '#') {
+        int count = depth > 0 ? frames[depth - 1].argc - 1 : 0;
+        int_to_string(count, number);
+        return number;
+    }
+    if (length == 1 && name[0] >= '0' && name[0] <= '9') {
+        int index = name[0] - '0';
+        if (depth > 0 && index < frames[depth - 1].argc) {
+            return frames[depth - 1].argv[index];
+        }
+        return "";
+    }
+    struct variable* var = find_variable(name, length);
+    return var ? var->value : "";
+}
+
+int expand_variables(const char* line, char* out, int size) {
+    int length = 0;
+    while (*line) {
+        const char* value = NULL;
+        char number[12];
+        if (line[0] == '\\' && line[1] == '$') {
+            line++;                     // \$ is a literal '$'
+        } else if (*line == '$') {
+            const char* name = line + 1;
+            int name_length = 0;
+            int braced = *name == '{';
+            if (braced) {
+                name++;
+                while (name[name_length] && name[name_length] != '}') name_length++;
+                if (name[name_length] != '}') name_length = 0;
+            } else if (*name == '#' || (*name >= '0' && *name <= '9')) {
+                name_length = 1;
+            } else {
+                while (is_name_char(name[name_length], name_length == 0)) name_length++;
+            }
+            // A '$' that starts no name is kept as it is
+            if (name_length > 0) {
+                value = lookup(name, name_length, number);
+                line = name + name_length + braced;
+            }
+        }
+        if (value) {
+            while (*value) {
+                if (length >= size - 1) return -1;
+                out[length++] = *value++;
+            }
+        } else {
+            if (length >= size - 1) return -1;
+            out[length++] = *line++;
+        }
+    }
+    out[length] = '\0';
+    return length;
+}
+
+// Copy the line starting at `pos` into `line` without its line ending.
+// Returns the offset of the next line, or -1 if the line does not fit.
+static int next_line(const char* text, int size, int pos, char* line) {
+    int length = 0;
+    while (pos < size && text[pos] != '\n') {
+        if (text[pos] != '\r') {
+            if (length >= MAX_COMMAND_LENGTH - 1) return -1;
+            line[length++] = text[pos];
+        }
+        pos++;
+    }
+    line[length] = '\0';
+    return pos + 1;
+}
+
+static int is_keyword(const char* line, const char* word) {
+    int length = strlen(word);
+    return strncmp(line, word, length) == 0 && (line[length] == ' ' || line[length] == '\0');
+}
+
+// Copy the next space-separated word of `p` into `word`
+static const char* next_word(const char* p, char* word, int size) {
+    while (*p == ' ') p++;
+    int length = 0;
+    while (*p && *p != ' ') {
+        if (length < size - 1) word[length++] = *p;
+        p++;
+    }
+    word[length] = '\0';
+    return p;
+}
+
+// Parse "repeat <count> [var]" into a loop; returns the count, -1 on error
+static int parse_repeat(const char* line, struct loop* loop) {
+    char expanded[MAX_COMMAND_LENGTH];
+    char word[VARIABLE_NAME_LENGTH];
+    if (expand_variables(line, expanded, sizeof(expanded)) < 0) {
+        return -1;
+    }
+    const char* p = next_word(expanded, word, sizeof(word));   // "repeat"
+    p = next_word(p, word, sizeof(word));
+    if (word[0] == '\0') {
+        return -1;
+    }
+    for (int i = 0; word[i]; i++) {
+        if (word[i] < '0' || word[i] > '9') return -1;
+    }
+    loop->count = string_to_int(word);
+    loop->iteration = 1;
+    next_word(p, loop->var, sizeof(loop->var));
+    if (loop->var[0] && !is_valid_name(loop->var)) {
+        return -1;
+    }
+    return loop->count;
+}
+
+static void set_loop_variable(const struct loop* loop) {
+    if (loop->var[0]) {
+        char number[12];
+        int_to_string(loop->iteration, number);
+        set_variable(loop->var, number);
+    }
+}
+
+static void print_us(uint64_t cycles) {
+    print_int((int)clock_cycles_to_us(cycles));
+    print_string(" us");
+}
+
+int run_script(const char* name, int argc, char* argv[], int timing) {
+    if (depth == SCRIPT_MAX_DEPTH) {
+        print_string("Error: Scripts nested too deeply\n");
+        return -1;
+    }
+    const char* data;
+    int size;
+    if (get_file_data(name, &data, &size) < 0) {
+        print_string("Error: File not found\n");
+        return -1;
+    }
+    if (size > SCRIPT_MAX_SIZE) {
+        print_string("Error: Script is larger than ");
+        print_int(SCRIPT_MAX_SIZE);
+        print_string(" bytes\n");
+        return -1;
+    }
+    struct script_frame* frame = &frames[depth++];
+    memcpy(frame->text, data, size);
+    frame->text[size] = '\0';
+    frame->argc = argc;
+    frame->argv = argv;
+
+    struct loop loops[SCRIPT_MAX_LOOPS];
+    int loop_count = 0;
+    int skipping = 0;                   // Nesting inside a loop run zero times
+    int lines = 0;
+    uint64_t total_cycles = 0;
+    int result = 0;
+    char line[MAX_COMMAND_LENGTH];
+    int pos = 0;
+    while (pos < size) {
+        pos = next_line(frame->text, size, pos, line);
+        if (pos < 0) {
+            print_string("Error: Script line too long\n");
+            result = -1;
+            break;
+        }
+        const char* command = line;
+        while (*command == ' ') command++;
+        if (*command == '\0' || *command == '#') continue;
+
+        if (is_keyword(command, "repeat")) {
+            if (skipping) {
+                skipping++;
+            } else if (loop_count == SCRIPT_MAX_LOOPS) {
+                print_string("Error: Loops nested too deeply\n");
+                result = -1;
+                break;
+            } else {
+                struct loop* loop = &loops[loop_count];
+                int count = parse_repeat(command, loop);
+                if (count < 0) {
+                    print_string("Usage: repeat <count> [variable]\n");
+                    result = -1;
+                    break;
+                }
+                if (count == 0) {
+                    skipping = 1;
+                } else {
+                    loop->start = pos;
+                    set_loop_variable(loop);
+                    loop_count++;
+                }
+            }
+            continue;
+        }
+        if (is_keyword(command, "end")) {
+            if (skipping) {
+                skipping--;
+            } else if (loop_count == 0) {
+                print_string("Error: 'end' without 'repeat'\n");
+                result = -1;
+                break;
+            } else {
+                struct loop* loop = &loops[loop_count - 1];
+                if (loop->iteration < loop->count) {
+                    loop->iteration++;
+                    set_loop_variable(loop);
+                    pos = loop->start;
+                } else {
+                    loop_count--;
+                }
+            }
+            continue;
+        }
+        if (skipping) continue;
+
+        uint64_t start = rdtsc();
+        execute_command(command);
+        uint64_t cycles = rdtsc() - start;
+        total_cycles += cycles;
+        lines++;
+        if (timing) {
+            print_char('[');
+            print_us(cycles);
+            print_string("] ");
+            print_string(command);
+            print_char('\n');
+        }
+    }
+    if (result == 0 && (loop_count > 0 || skipping)) {
+        print_string("Error: 'repeat' without 'end'\n");
+        result = -1;
+    }
+    if (timing) {
+        print_string(name);
+        print_string(": ");
+        print_int(lines);
+        print_string(" commands in ");
+        print_us(total_cycles);
+        print_char('\n');
+    }
+    depth--;
+    return result;
+}
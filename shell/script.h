@@ -0,0 +1,28 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+// Shell scripts: files of command lines run through execute_command.
+//
+//   # comment
+//   set name value...      Variables, used as $name or ${name}
+//   repeat <count> [var]   Run the lines up to the matching 'end' count
+//   ...                    times, setting var to 1..count
+//   end
+//
+// Inside a script $0 is its name, $1..$9 its arguments and $# their count.
+// Variables are expanded in every command line; \$ stands for a plain '$'.
+#define SCRIPT_MAX_SIZE 4096
+#define SCRIPT_MAX_DEPTH 3
+#define SCRIPT_MAX_LOOPS 4
+#define MAX_VARIABLES 32
+#define VARIABLE_NAME_LENGTH 16
+#define VARIABLE_VALUE_LENGTH 64
+#define AUTORUN_SCRIPT "autorun.sh"
+
+int set_variable(const char* name, const char* value);
+int unset_variable(const char* name);
+void list_variables(void);
+int expand_variables(const char* line, char* out, int size);    // -1 if it does not fit
+int run_script(const char* name, int argc, char* argv[], int timing);
+
+#endif
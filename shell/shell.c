@@ -3,6 +3,10 @@
 #include "../include/kernel.h"
 #include "shell.h"
 #include "commands.h"
+#include "script.h"
+#include "../fs/fs.h"
+#include "../kernel/clock.h"
+#include "../drivers/serial.h"
 #include <stddef.h>
 
 // Prototype for int_to_string implemented in kernel.c
@@ -33,6 +37,68 @@ void redraw_input() {
     update_cursor();
 }
 
+#define MAX_COMPLETIONS 64
+
+// Tab completes the command name (the first word) from the command table: a
+// unique match is filled in, otherwise the shared prefix is, and a second
+// tab with nothing left to add lists the candidates
+static void complete_input(void) {
+    for (int i = 0; i < pos; i++) {
+        if (input[i] == ' ') return;
+    }
+    const char* matches[MAX_COMPLETIONS];
+    int count = complete_command(input, matches, MAX_COMPLETIONS);
+    if (count == 0) return;
+    if (count > MAX_COMPLETIONS) count = MAX_COMPLETIONS;
+
+    int length = pos;
+    while (matches[0][length] != '\0') {
+        int i;
+        for (i = 1; i < count && matches[i][length] == matches[0][length]; i++) {
+        }
+        if (i < count) break;
+        length++;
+    }
+    if (length == pos && count > 1) {
+        print_string("\n");
+        for (int i = 0; i < count; i++) {
+            print_string(matches[i]);
+            print_string("  ");
+        }
+        print_string("\n");
+        redraw_input();
+        return;
+    }
+    while (pos < length && pos < MAX_COMMAND_LENGTH - 2) {
+        input[pos] = matches[0][pos];
+        print_char(input[pos++]);
+    }
+    if (count == 1) {
+        input[pos++] = ' ';
+        print_char(' ');
+    }
+}
+
+// Timings for scripted runs (tools/qemu_bench.sh) go to COM1 as
+//   # ready us=<microseconds since reset>
+//   # command us=<microseconds> <command line>
+static void report_ready(void) {
+    serial_write_string("# ready us=");
+    serial_write_int((int)clock_cycles_to_us(rdtsc()));
+    serial_write_char('\n');
+}
+
+static void report_command(const char* line, uint64_t cycles) {
+    if (line[0] == '\0') {
+        return;
+    }
+    serial_write_string("# command us=");
+    serial_write_int((int)clock_cycles_to_us(cycles));
+    serial_write_char(' ');
+    serial_write_string(line);
+    serial_write_char('\n');
+}
+
 // Handle keyboard input
 void handle_input(char c) {
     // Arrow key handling (assuming get_arrow_key returns special codes)
@@ -76,7 +142,9 @@ void handle_input(char c) {
     if (c == '\n') {
         print_string("\n");
         input[pos] = '\0';
+        uint64_t start = rdtsc();
         execute_command(input);
+        report_command(input, rdtsc() - start);
         // Store in history if not empty
         if (pos > 0) {
             strncpy(history[history_count % HISTORY_SIZE], input, MAX_COMMAND_LENGTH - 1);
@@ -91,6 +159,9 @@ void handle_input(char c) {
         redraw_input();
         return;
     }
+    else if (c == '\t') {
+        complete_input();
+    }
     else if (c == '\b') {
         if (pos > 0) {
             pos--;
@@ -113,8 +184,15 @@ void init_shell(void) {
     }
     print_string("Welcome to AGRAN OS v0.1\n");
     print_string("Type 'help' for a list of commands\n\n");
+    if (search_file(AUTORUN_SCRIPT)) {
+        static char autorun_name[] = AUTORUN_SCRIPT;
+        char* argv[] = { autorun_name };
+        print_string("Running " AUTORUN_SCRIPT "\n");
+        run_script(AUTORUN_SCRIPT, 1, argv, 0);
+    }
     print_string("$ ");
     pos = 0;
+    report_ready();
 }
 
 // Run the shell
@@ -0,0 +1,260 @@
+// Host microbenchmarks for fs, process and math_commands (make host-test).
+//
+//   host_bench [filter]
+//
+// Like Google Benchmark, each benchmark is run with a growing iteration
+// count until one run takes at least MIN_TIME, and the time per iteration
+// of that run is reported. Only benchmarks whose name contains `filter` run.
+
+#include <stdio.h>
+#include <time.h>
+#include "shim.h"
+#include "../../fs/fs.h"
+#include "../../kernel/bignum.h"
+#include "../../kernel/crc32c.h"
+#include "../../kernel/ipc.h"
+#include "../../kernel/page.h"
+#include "../../kernel/wheel.h"
+#include "../../process/process.h"
+#include "../../shell/math_commands.h"
+#include "../../shell/calc.h"
+
+#define MIN_TIME 0.1                    // Seconds
+#define MAX_ITERATIONS 1000000000L
+
+struct benchmark {
+    const char* name;
+    void (*setup)(void);                // Optional
+    void (*run)(long iterations);
+};
+
+static volatile int result_sink;        // Keeps results of pure calls live
+static char read_buffer[MAX_CONTENT];
+
+static const char bench_text[] =
+    "The quick brown fox jumps over the lazy dog. 0123456789 "
+    "The quick brown fox jumps over the lazy dog. 0123456789 ";
+
+static void null_sink(char c) {
+    (void)c;
+}
+
+static double seconds(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// File system
+static void setup_fs(void) {
+    init_fs();
+}
+
+static void bench_file_create(long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        create_file("bench");
+        delete_file("bench");
+    }
+}
+
+static void setup_lookup(void) {
+    char name[16];
+    init_fs();
+    for (int i = 0; i < 16; i++) {
+        snprintf(name, sizeof(name), "bench%d", i);
+        create_file(name);
+    }
+}
+
+static void bench_file_lookup(long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        result_sink = search_file("bench15");
+    }
+}
+
+static void setup_file(void) {
+    init_fs();
+    create_file("bench");
+    write_file("bench", bench_text);
+}
+
+static void bench_file_write(long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        write_file("bench", bench_text);
+    }
+}
+
+static void bench_file_read(long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        read_file("bench", read_buffer);
+    }
+}
+
+// Processes
+static void bench_queue_push_pop(long iterations) {
+    static Process process;
+    Queue queue;
+    queue_init(&queue);
+    for (long i = 0; i < iterations; i++) {
+        queue_push(&queue, &process);
+        result_sink = queue_pop(&queue) != NULL;
+    }
+}
+
+static void setup_schedule(void) {
+    init_scheduler();
+    for (int i = 0; i < 4; i++) {
+        create_process("bench", 1 << 30);
+    }
+}
+
+static void bench_schedule(long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        schedule();
+    }
+}
+
+// IPC: send and receive one message on a port
+static int bench_port = -1;
+
+static void setup_ipc(void) {
+    init_pages();
+    if (bench_port < 0) {
+        bench_port = ipc_port_create();
+    }
+}
+
+static void bench_ipc_inline(long iterations) {
+    struct ipc_message msg;
+    msg.sender = IPC_KERNEL;
+    msg.page = PAGE_NONE;
+    msg.size = 32;
+    memcpy(msg.data, bench_text, 32);
+    for (long i = 0; i < iterations; i++) {
+        msg.tag = i;
+        ipc_send(bench_port, &msg, 0);
+        ipc_receive(bench_port, &msg, IPC_KERNEL, 0);
+    }
+}
+
+static void bench_ipc_page(long iterations) {
+    struct ipc_message msg;
+    msg.sender = IPC_KERNEL;
+    msg.size = PAGE_SIZE;
+    for (long i = 0; i < iterations; i++) {
+        msg.page = page_alloc(IPC_KERNEL);
+        ipc_send(bench_port, &msg, 0);
+        ipc_receive(bench_port, &msg, IPC_KERNEL, 0);
+        page_free(msg.page, IPC_KERNEL);
+    }
+}
+
+// Timer wheel: adding and cancelling a timer with thousands pending
+#define BENCH_PENDING_TIMERS 4096
+
+static struct wheel bench_wheel;
+static struct wheel_entry bench_timers[BENCH_PENDING_TIMERS];
+
+static void setup_wheel(void) {
+    wheel_init(&bench_wheel, 0);
+    for (int i = 0; i < BENCH_PENDING_TIMERS; i++) {
+        bench_timers[i].expires = (uint64_t)i * 997 % 1000000;
+        wheel_add(&bench_wheel, &bench_timers[i]);
+    }
+}
+
+static void bench_wheel_add_cancel(long iterations) {
+    struct wheel_entry entry;
+    for (long i = 0; i < iterations; i++) {
+        entry.expires = i & 0xFFFFF;
+        wheel_add(&bench_wheel, &entry);
+        wheel_remove(&bench_wheel, &entry);
+    }
+}
+
+// Calculator
+static void bench_calculator(long iterations) {
+    for (long i = 0; i < iterations; i++) {
+        calculator_command("1234 * -56");
+    }
+}
+
+// 1000! through the product tree, then in decimal
+static uint32_t bench_limbs[65536];
+
+static void bench_factorial(long iterations) {
+    struct bignum_arena arena;
+    bignum_arena_init(&arena, bench_limbs, sizeof(bench_limbs) / sizeof(bench_limbs[0]));
+    for (long i = 0; i < iterations; i++) {
+        struct bignum r;
+        char* text;
+        bignum_factorial(&arena, &r, 1000);
+        bignum_to_decimal(&arena, &r, &text);
+        bignum_arena_release(&arena, 0);
+    }
+}
+
+// The compiled expression alone, as calculator -bench runs it
+static void bench_calc_run(long iterations) {
+    const char* error;
+    int slot = calc_variable("x");
+    calc_set_variable(slot, 0);
+    const struct calc_program* program = calc_compile("x * x + 3 * x - 7", &error);
+    int32_t value;
+    for (long i = 0; i < iterations; i++) {
+        calc_set_variable(slot, (int32_t)i);
+        calc_run(program, &value);
+    }
+}
+
+static const struct benchmark benchmarks[] = {
+    { "BM_FileCreate", setup_fs, bench_file_create },
+    { "BM_FileLookup", setup_lookup, bench_file_lookup },
+    { "BM_FileWrite", setup_file, bench_file_write },
+    { "BM_FileRead", setup_file, bench_file_read },
+    { "BM_QueuePushPop", NULL, bench_queue_push_pop },
+    { "BM_Schedule", setup_schedule, bench_schedule },
+    { "BM_IpcInline", setup_ipc, bench_ipc_inline },
+    { "BM_IpcPage", setup_ipc, bench_ipc_page },
+    { "BM_WheelAddCancel", setup_wheel, bench_wheel_add_cancel },
+    { "BM_Calculator", NULL, bench_calculator },
+    { "BM_CalcRun", NULL, bench_calc_run },
+    { "BM_Factorial1000", NULL, bench_factorial },
+};
+
+#define BENCHMARK_COUNT ((int)(sizeof(benchmarks) / sizeof(benchmarks[0])))
+
+static void run_benchmark(const struct benchmark* bench) {
+    long iterations = 1;
+    double wall, cpu;
+    for (;;) {
+        if (bench->setup) bench->setup();
+        double wall_start = seconds(CLOCK_MONOTONIC);
+        double cpu_start = seconds(CLOCK_PROCESS_CPUTIME_ID);
+        bench->run(iterations);
+        wall = seconds(CLOCK_MONOTONIC) - wall_start;
+        cpu = seconds(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+        if (wall >= MIN_TIME || iterations >= MAX_ITERATIONS) break;
+        // Aim past MIN_TIME, growing at most tenfold per round
+        double scale = wall > 0 ? 1.4 * MIN_TIME / wall : 10;
+        if (scale > 10) scale = 10;
+        if (scale < 2) scale = 2;
+        iterations = (long)(iterations * scale);
+    }
+    printf("%-24s %10.1f ns %10.1f ns %12ld\n", bench->name,
+           wall * 1e9 / iterations, cpu * 1e9 / iterations, iterations);
+}
+
+int main(int argc, char* argv[]) {
+    const char* filter = argc > 1 ? argv[1] : "";
+    init_crc32c();
+    set_output_sink(null_sink);         // Commands print as a side effect
+    printf("%-24s %13s %13s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+    printf("-------------------------------------------------------------------\n");
+    for (int i = 0; i < BENCHMARK_COUNT; i++) {
+        if (strstr(benchmarks[i].name, filter)) {
+            run_benchmark(&benchmarks[i]);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <string.h>
+
+// Minimal unit test support: a failed CHECK reports itself and ends the
+// current test; RUN_TEST runs one and counts the result.
+void test_failed(const char* file, int line, const char* expression);
+void run_test(const char* name, void (*test)(void));
+
+#define RUN_TEST(test) run_test(#test, test)
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        test_failed(__FILE__, __LINE__, #condition); \
+        return; \
+    } \
+} while (0)
+
+#define CHECK_CONTAINS(haystack, needle) CHECK(strstr((haystack), (needle)) != NULL)
+
+// Each test file registers its tests here
+void run_fs_tests(void);
+void run_process_tests(void);
+void run_math_tests(void);
+void run_bignum_tests(void);
+void run_lock_tests(void);
+void run_ipc_tests(void);
+void run_wheel_tests(void);
+void run_calendar_tests(void);
+
+#endif
@@ -0,0 +1,181 @@
+// Host implementations of what fs, process and math_commands need from the
+// rest of the kernel. There is no disk, initrd or screen: file systems are
+// never mounted, and output goes to a buffer.
+
+#include <stdio.h>
+#include <time.h>
+#include "shim.h"
+#include "../../fs/agranfs.h"
+#include "../../fs/initrd.h"
+#include "../../drivers/block.h"
+#include "../../kernel/clock.h"
+#include "../../kernel/cpu.h"
+#include "../../kernel/trace.h"
+
+#define OUTPUT_SIZE 65536
+
+static char output[OUTPUT_SIZE];
+static size_t output_length = 0;
+static output_sink_t sink = NULL;
+static const char* input = "";
+static uint32_t tsc_khz = 0;
+
+void shim_reset_output(void) {
+    output_length = 0;
+    output[0] = '\0';
+}
+
+const char* shim_output(void) {
+    return output;
+}
+
+void shim_set_input(const char* keys) {
+    input = keys;
+}
+
+output_sink_t set_output_sink(output_sink_t new_sink) {
+    output_sink_t previous = sink;
+    sink = new_sink;
+    return previous;
+}
+
+void print_char(char c) {
+    if (sink) {
+        sink(c);
+        return;
+    }
+    // Output past the end of the buffer is dropped (benchmarks print a lot)
+    if (output_length < OUTPUT_SIZE - 1) {
+        output[output_length++] = c;
+        output[output_length] = '\0';
+    }
+}
+
+void print_string(const char* str) {
+    while (*str) print_char(*str++);
+}
+
+void print_int(int num) {
+    char str[16];
+    snprintf(str, sizeof(str), "%d", num);
+    print_string(str);
+}
+
+void print_uint64(uint64_t num) {
+    char str[24];
+    snprintf(str, sizeof(str), "%llu", (unsigned long long)num);
+    print_string(str);
+}
+
+void print_hex(uint32_t num) {
+    char str[16];
+    snprintf(str, sizeof(str), "0x%X", num);
+    print_string(str);
+}
+
+// Tracepoints in fs and process stay off
+int trace_enabled = 0;
+
+void trace_write(int event, uint32_t arg0, uint32_t arg1) {
+    (void)event;
+    (void)arg0;
+    (void)arg1;
+}
+
+void clear_screen(void) {
+}
+
+void set_text_color(uint8_t color) {
+    (void)color;
+}
+
+char shim_getchar(void) {
+    static const char* fallback = "exit\n";
+    if (*input == '\0') {
+        input = fallback;
+    }
+    return *input++;
+}
+
+void int_to_string(int num, char* str) {
+    sprintf(str, "%d", num);
+}
+
+int string_to_int(const char* str) {
+    int sign = 1;
+    int result = 0;
+    if (*str == '-') {
+        sign = -1;
+        str++;
+    }
+    for (; *str; str++) {
+        if (*str >= '0' && *str <= '9') result = result * 10 + (*str - '0');
+    }
+    return sign * result;
+}
+
+// No disk: the file system runs RAM-only
+int agranfs_mount(struct block_device* dev) { (void)dev; return -1; }
+int agranfs_is_mounted(void) { return 0; }
+int agranfs_dir_entry(int index, char* name, int* inode, uint32_t* size) {
+    (void)index; (void)name; (void)inode; (void)size;
+    return -1;
+}
+int agranfs_create(const char* name) { (void)name; return -1; }
+int agranfs_remove(int inode) { (void)inode; return 0; }
+int agranfs_read(int inode, char* buffer, uint32_t max_size) {
+    (void)inode; (void)buffer; (void)max_size;
+    return -1;
+}
+int agranfs_write(int inode, const char* data, uint32_t size) {
+    (void)inode; (void)data; (void)size;
+    return 0;
+}
+int agranfs_sync(void) { return 0; }
+struct block_device* get_boot_block_device(void) { return NULL; }
+int initrd_entry(int index, const char** name, const char** data, uint32_t* size) {
+    (void)index; (void)name; (void)data; (void)size;
+    return -1;
+}
+
+int cpu_has(uint64_t feature) {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, &eax, &ebx, &ecx, &edx);
+    uint64_t features = ((uint64_t)ecx << 32) | edx;
+    return (features & feature) == feature;
+}
+
+// The TSC rate is measured against the host's monotonic clock on first use
+uint32_t clock_tsc_khz(void) {
+    if (tsc_khz == 0) {
+        struct timespec start, now;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        uint64_t cycles = rdtsc();
+        long elapsed_ns;
+        do {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            elapsed_ns = (now.tv_sec - start.tv_sec) * 1000000000L + (now.tv_nsec - start.tv_nsec);
+        } while (elapsed_ns < 10000000);
+        tsc_khz = (uint32_t)((rdtsc() - cycles) * 1000000 / elapsed_ns);
+    }
+    return tsc_khz;
+}
+
+uint64_t clock_cycles_to_us(uint64_t cycles) {
+    uint32_t khz = clock_tsc_khz();
+    return khz >= 1000 ? cycles / (khz / 1000) : 0;
+}
+
+uint32_t clock_kb_per_sec(uint32_t bytes, uint64_t cycles) {
+    return cycles ? (uint32_t)((uint64_t)bytes * clock_tsc_khz() / cycles) : 0;
+}
+
+uint64_t clock_monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+uint64_t udiv64_32(uint64_t dividend, uint32_t divisor) {
+    return dividend / divisor;
+}
@@ -0,0 +1,45 @@
+#ifndef KERNEL_H
+#define KERNEL_H
+
+// Stand-in for include/kernel.h when kernel sources are compiled for the
+// host (make host-test). It is force-included ahead of every source, takes
+// over the KERNEL_H guard so the real header drops out, and maps the
+// kernel's libc-like functions onto the host's.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Screen output is captured into a buffer that tests can inspect
+void print_char(char c);
+void print_string(const char* str);
+void print_int(int num);
+void print_uint64(uint64_t num);
+void print_hex(uint32_t num);
+void clear_screen(void);
+void set_text_color(uint8_t color);
+typedef void (*output_sink_t)(char c);
+output_sink_t set_output_sink(output_sink_t sink);
+
+// Keyboard input comes from a string queued by the test; stdio.h is
+// included first so its getchar is declared before the rename
+#define getchar shim_getchar
+char shim_getchar(void);
+
+// One CPU, and interrupts are not ours to mask: take over the SMP_H and
+// INTERRUPTS_H guards too, so the real locks build on the host
+#define SMP_H
+#define MAX_CPUS 1
+static inline int cpu_id(void) { return 0; }
+static inline int smp_cpu_count(void) { return 1; }
+static inline void smp_wake(int cpu) { (void)cpu; }
+
+#define INTERRUPTS_H
+static inline uint32_t interrupts_save(void) { return 0; }
+static inline void interrupts_restore(uint32_t flags) { (void)flags; }
+
+void int_to_string(int num, char* str);
+int string_to_int(const char* str);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef SHIM_H
+#define SHIM_H
+
+// Test-side controls for the host shim (kernel_shim.c)
+void shim_reset_output(void);
+const char* shim_output(void);          // Everything printed since the reset
+void shim_set_input(const char* keys);  // Served by getchar(), then "exit\n"
+
+#endif
@@ -0,0 +1,164 @@
+#include "check.h"
+#include "../../kernel/bignum.h"
+
+#define ARENA_LIMBS (1 << 20)
+#define GUARD_LIMBS 1024
+
+static uint32_t buffer[ARENA_LIMBS + GUARD_LIMBS];
+static struct bignum_arena arena;
+static uint32_t seed = 12345;
+
+static uint32_t next_random(void) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) | (seed << 16);
+}
+
+static struct bignum random_bignum(uint32_t limbs) {
+    struct bignum r = { arena.limbs + arena.used, limbs, 0 };
+    arena.used += limbs;
+    for (uint32_t i = 0; i < limbs; i++) r.limbs[i] = next_random();
+    r.limbs[limbs - 1] |= 1;
+    return r;
+}
+
+static struct bignum small(int32_t value) {
+    struct bignum r;
+    bignum_from_int(&arena, &r, value);
+    return r;
+}
+
+static const char* decimal(const struct bignum* a) {
+    char* text;
+    return bignum_to_decimal(&arena, a, &text) == 0 ? text : "(no memory)";
+}
+
+// Nine digits at a time with single-limb arithmetic, to check the split against
+static struct bignum from_decimal(const char* digits) {
+    struct bignum r = small(0), chunk_base = small(1000000000);
+    size_t length = strlen(digits);
+    for (size_t i = 0; i < length; i += 9) {
+        int32_t chunk = 0, base = 1;
+        for (size_t j = i; j < i + 9 && j < length; j++) {
+            chunk = chunk * 10 + (digits[j] - '0');
+            base *= 10;
+        }
+        struct bignum piece = small(chunk), scale = base == 1000000000 ? chunk_base : small(base);
+        bignum_mul(&arena, &r, &r, &scale);
+        bignum_add(&arena, &r, &r, &piece);
+    }
+    return r;
+}
+
+static void test_bignum_known_values(void) {
+    bignum_arena_init(&arena, buffer, ARENA_LIMBS);
+    struct bignum r, two = small(2);
+    CHECK(bignum_factorial(&arena, &r, 30) == 0);
+    CHECK(strcmp(decimal(&r), "265252859812191058636308480000000") == 0);
+    CHECK(bignum_pow(&arena, &r, &two, 100) == 0);
+    CHECK(strcmp(decimal(&r), "1267650600228229401496703205376") == 0);
+    struct bignum minus_three = small(-3);
+    CHECK(bignum_pow(&arena, &r, &minus_three, 41) == 0);
+    CHECK(strcmp(decimal(&r), "-36472996377170786403") == 0);
+    // The result in place of a negative base keeps its sign
+    struct bignum minus_one = small(-1);
+    CHECK(bignum_pow(&arena, &minus_one, &minus_one, 3) == 0);
+    CHECK(strcmp(decimal(&minus_one), "-1") == 0);
+    CHECK(bignum_pow(&arena, &minus_three, &minus_three, 3) == 0);
+    CHECK(strcmp(decimal(&minus_three), "-27") == 0);
+    CHECK(bignum_factorial(&arena, &r, 1000) == 0);
+    const char* text = decimal(&r);
+    CHECK(strlen(text) == 2568);
+    CHECK(strncmp(text, "402387260077093773543702433923003985719374864210", 48) == 0);
+    CHECK(strspn(text + 2568 - 249, "0") == 249);
+
+    // Truncating division, as C's
+    struct bignum seven = small(-7), q, m;
+    CHECK(bignum_divmod(&arena, &q, &m, &seven, &two) == 0);
+    CHECK(strcmp(decimal(&q), "-3") == 0 && strcmp(decimal(&m), "-1") == 0);
+    struct bignum zero = small(0);
+    CHECK(bignum_divmod(&arena, &q, &m, &seven, &zero) == BIGNUM_DIVIDE_BY_ZERO);
+    int32_t value;
+    CHECK(bignum_to_int(&q, &value) == 0 && value == -3);
+    struct bignum limit = small(-2147483647 - 1);
+    CHECK(bignum_to_int(&limit, &value) == 0 && value == -2147483647 - 1);
+    bignum_sub(&arena, &limit, &limit, &two);
+    CHECK(bignum_to_int(&limit, &value) < 0);
+}
+
+// Products and quotients on both sides of the Karatsuba and
+// Burnikel-Ziegler thresholds undo each other
+static void test_bignum_mul_div_round_trip(void) {
+    static const uint32_t sizes[][2] = {
+        { 3, 2 }, { 31, 31 }, { 40, 33 }, { 100, 100 }, { 300, 47 }, { 256, 130 }, { 1000, 700 }, { 2000, 999 },
+    };
+    bignum_arena_init(&arena, buffer, ARENA_LIMBS);
+    for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        uint32_t mark = arena.used;
+        struct bignum a = random_bignum(sizes[i][0]);
+        struct bignum b = random_bignum(sizes[i][1]);
+        struct bignum c = random_bignum(sizes[i][1] - 1);
+        struct bignum product, q, r;
+        CHECK(bignum_mul(&arena, &product, &a, &b) == 0);
+        CHECK(bignum_add(&arena, &product, &product, &c) == 0);
+        CHECK(bignum_divmod(&arena, &q, &r, &product, &b) == 0);
+        CHECK(bignum_compare(&q, &a) == 0);
+        CHECK(bignum_compare(&r, &c) == 0);
+        // (a + b)^2 = a^2 + 2ab + b^2 through the squaring path
+        struct bignum sum, square, expected, ab;
+        bignum_add(&arena, &sum, &a, &b);
+        bignum_mul(&arena, &square, &sum, &sum);
+        bignum_mul(&arena, &expected, &a, &a);
+        bignum_mul(&arena, &ab, &a, &b);
+        bignum_add(&arena, &expected, &expected, &ab);
+        bignum_add(&arena, &expected, &expected, &ab);
+        bignum_mul(&arena, &ab, &b, &b);
+        bignum_add(&arena, &expected, &expected, &ab);
+        CHECK(bignum_compare(&square, &expected) == 0);
+        bignum_arena_release(&arena, mark);
+    }
+}
+
+static void test_bignum_decimal_split(void) {
+    static char digits[4000];
+    bignum_arena_init(&arena, buffer, ARENA_LIMBS);
+    for (int i = 0; i < (int)sizeof(digits) - 1; i++) {
+        digits[i] = '0' + next_random() % 10;
+    }
+    digits[0] = '7';
+    digits[1000] = digits[1001] = digits[1002] = '0';   // Zeros across a split
+    struct bignum a = from_decimal(digits);
+    CHECK(strcmp(decimal(&a), digits) == 0);
+    // 10^k - 1 and 10^k, where the powers are exactly hit
+    memset(digits, '9', 1800);
+    digits[1800] = '\0';
+    a = from_decimal(digits);
+    CHECK(strcmp(decimal(&a), digits) == 0);
+    struct bignum one = small(1);
+    bignum_add(&arena, &a, &a, &one);
+    const char* text = decimal(&a);
+    CHECK(text[0] == '1' && strlen(text) == 1801 && strspn(text + 1, "0") == 1800);
+}
+
+// Running out is reported, and never takes more than the arena has
+static void test_bignum_arena_limit(void) {
+    bignum_arena_init(&arena, buffer, 20000);
+    for (uint32_t i = 0; i < GUARD_LIMBS; i++) buffer[20000 + i] = 0xDEADBEEF;
+    struct bignum r;
+    uint32_t n = 100;
+    while (bignum_factorial(&arena, &r, n) == 0) {
+        char* text;
+        if (bignum_to_decimal(&arena, &r, &text) < 0) break;
+        bignum_arena_release(&arena, 0);
+        n *= 2;
+    }
+    CHECK(n > 100);
+    CHECK(arena.peak <= arena.size);
+    for (uint32_t i = 0; i < GUARD_LIMBS; i++) CHECK(buffer[20000 + i] == 0xDEADBEEF);
+}
+
+void run_bignum_tests(void) {
+    RUN_TEST(test_bignum_known_values);
+    RUN_TEST(test_bignum_mul_div_round_trip);
+    RUN_TEST(test_bignum_decimal_split);
+    RUN_TEST(test_bignum_arena_limit);
+}
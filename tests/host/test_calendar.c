@@ -0,0 +1,42 @@
+#include "check.h"
+#include "../../kernel/calendar.h"
+
+static int same_date(const struct date_time* a, int year, int month, int day,
+                     int hour, int minute, int second) {
+    return a->year == year && a->month == month && a->day == day &&
+           a->hour == hour && a->minute == minute && a->second == second;
+}
+
+static void test_calendar_known_dates(void) {
+    struct date_time date;
+    seconds_to_date(0, &date);
+    CHECK(same_date(&date, 1970, 1, 1, 0, 0, 0) && date.weekday == 4);
+    seconds_to_date(1792326896, &date);
+    CHECK(same_date(&date, 2026, 10, 18, 12, 34, 56) && date.weekday == 0);
+    CHECK(strcmp(weekday_name(date.weekday), "Sun") == 0);
+    seconds_to_date(951782400, &date);  // A leap day in a century leap year
+    CHECK(same_date(&date, 2000, 2, 29, 0, 0, 0));
+    seconds_to_date(4107542400u, &date);    // 2100 is not a leap year
+    CHECK(same_date(&date, 2100, 3, 1, 0, 0, 0));
+    seconds_to_date(4107542400u - 1, &date);
+    CHECK(same_date(&date, 2100, 2, 28, 23, 59, 59));
+}
+
+// Every day from 1970 to 2105 converts there and back
+static void test_calendar_round_trip(void) {
+    struct date_time date;
+    int previous_day = 0;
+    for (uint32_t day = 0; day < 49000; day++) {
+        uint32_t seconds = day * 86400 + 3661;
+        seconds_to_date(seconds, &date);
+        CHECK(date.hour == 1 && date.minute == 1 && date.second == 1);
+        CHECK(date.day == previous_day + 1 || date.day == 1);
+        CHECK(date_to_seconds(&date) == seconds);
+        previous_day = date.day;
+    }
+}
+
+void run_calendar_tests(void) {
+    RUN_TEST(test_calendar_known_dates);
+    RUN_TEST(test_calendar_round_trip);
+}
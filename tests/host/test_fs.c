@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include "check.h"
+#include "shim.h"
+#include "../../fs/fs.h"
+#include "../../kernel/crc32c.h"
+
+static char buffer[MAX_CONTENT];
+
+static void reset(void) {
+    init_crc32c();
+    init_fs();
+    shim_reset_output();
+}
+
+static void test_write_read_round_trip(void) {
+    reset();
+    create_file("notes");
+    CHECK(search_file("notes"));
+    CHECK(write_file("notes", "hello, host") == 0);
+    CHECK(read_file("notes", buffer) == 0);
+    CHECK(strcmp(buffer, "hello, host") == 0);
+}
+
+static void test_create_duplicate(void) {
+    reset();
+    create_file("a");
+    shim_reset_output();
+    create_file("a");
+    CHECK_CONTAINS(shim_output(), "already exists");
+}
+
+static void test_delete(void) {
+    reset();
+    create_file("gone");
+    write_file("gone", "data");
+    delete_file("gone");
+    CHECK(!search_file("gone"));
+    CHECK(read_file("gone", buffer) < 0);
+    CHECK_CONTAINS(shim_output(), "File not found");
+}
+
+static void test_table_full(void) {
+    reset();
+    char name[16];
+    for (int i = 0; i < MAX_FILES; i++) {
+        snprintf(name, sizeof(name), "f%d", i);
+        create_file(name);
+    }
+    CHECK(search_file("f63"));
+    shim_reset_output();
+    create_file("one_more");
+    CHECK(!search_file("one_more"));
+    CHECK_CONTAINS(shim_output(), "No free file slots");
+}
+
+static void test_write_truncates(void) {
+    reset();
+    static char big[MAX_CONTENT * 2];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    create_file("big");
+    CHECK(write_file("big", big) == 0);
+    CHECK(read_file("big", buffer) == 0);
+    CHECK(strlen(buffer) == MAX_CONTENT - 1);
+}
+
+static void test_identical_files_share_blocks(void) {
+    reset();
+    const char* text = "The same text in two files shares its blocks in the store.";
+    create_file("one");
+    create_file("two");
+    write_file("one", text);
+    write_file("two", text);
+    struct store_stats stats;
+    store_get_stats(&stats);
+    CHECK(stats.shared_blocks >= 1);
+    CHECK(stats.dedup_hits >= 1);
+    CHECK(read_file("two", buffer) == 0);
+    CHECK(strcmp(buffer, text) == 0);
+}
+
+static void test_compress_round_trip(void) {
+    reset();
+    static char text[MAX_CONTENT];
+    for (int i = 0; i < MAX_CONTENT - 1; i++) {
+        text[i] = "abcabcabd"[i % 9];
+    }
+    text[MAX_CONTENT - 1] = '\0';
+    create_file("z");
+    write_file("z", text);
+    CHECK(compress_file("z") > 0);
+    CHECK(read_file("z", buffer) == 0);
+    CHECK(strcmp(buffer, text) == 0);
+}
+
+static void test_fsck_clean(void) {
+    reset();
+    create_file("a");
+    write_file("a", "checked");
+    CHECK(fsck_fs() == 0);
+}
+
+static void test_fsck_finds_corrupt_entry(void) {
+    reset();
+    create_file("a");
+    write_file("a", "checked");
+    files[0].size ^= 1;                 // Behind the checksum's back
+    CHECK(fsck_fs() > 0);
+}
+
+// Changing a corrupt entry would drop blocks it may not own and then
+// reseal it, hiding the damage from fsck
+static void test_corrupt_entry_is_not_changed(void) {
+    reset();
+    create_file("a");
+    write_file("a", "checked");
+    files[0].blocks[1] = files[0].blocks[0];
+    shim_reset_output();
+    CHECK(write_file("a", "new") < 0);
+    CHECK(compress_file("a") == FS_CORRUPT_ENTRY);
+    CHECK(compress_file("missing") == -1);
+    delete_file("a");
+    CHECK(search_file("a"));
+    CHECK_CONTAINS(shim_output(), "File table entry corrupted");
+    CHECK(fsck_fs() > 0);
+}
+
+// A block that fails its checksum fails the read instead of reading as zeros
+static void test_read_fails_on_corrupt_block(void) {
+    reset();
+    const char* data;
+    int size;
+    create_file("a");
+    write_file("a", "this block goes bad");
+    store_corrupt(files[0].blocks[0], 3, 0);
+    CHECK(read_file("a", buffer) < 0);
+    CHECK(get_file_data("a", &data, &size) < 0);
+    CHECK_CONTAINS(shim_output(), "Checksum mismatch");
+}
+
+// Compressed data that passes its checksum but does not decode is an
+// error every time, not zeros from the cache
+static void test_undecodable_block_is_corrupt(void) {
+    reset();
+    static char text[MAX_CONTENT];
+    memset(text, 'q', STORE_BLOCK_SIZE);
+    text[STORE_BLOCK_SIZE] = '\0';
+    create_file("z");
+    write_file("z", text);
+    CHECK(compress_file("z") > 0);
+    store_corrupt(files[0].blocks[0], 7, 1);
+    CHECK(read_file("z", buffer) < 0);
+    CHECK(read_file("z", buffer) < 0);
+    struct store_stats stats;
+    store_get_stats(&stats);
+    CHECK(stats.checksum_errors == 2);
+    CHECK_CONTAINS(shim_output(), "Corrupt compressed block");
+}
+
+// A corrupt block is passed over when chunks run short, rather than
+// picked again on every pass
+static void test_reclaim_skips_corrupt_block(void) {
+    reset();
+    static char text[MAX_CONTENT];
+    char name[16];
+    create_file("bad");
+    write_file("bad", "this block goes bad");
+    store_corrupt(files[0].blocks[0], 5, 0);
+    for (int i = 0; i < MAX_FILES - 1; i++) {
+        snprintf(name, sizeof(name), "f%d", i);
+        for (int j = 0; j < MAX_CONTENT - 1; j++) {
+            text[j] = 'a' + (i + j / 32) % 26;
+        }
+        for (int j = 0; j < MAX_CONTENT - 1; j += STORE_BLOCK_SIZE) {
+            text[j] = '0' + i / 10;         // Every block different
+            text[j + 1] = '0' + i % 10;
+        }
+        create_file(name);
+        CHECK(write_file(name, text) == 0);
+    }
+    struct store_stats stats;
+    store_get_stats(&stats);
+    CHECK(stats.compressed_blocks > 0);
+    CHECK(stats.used_chunks <= STORE_CHUNKS);
+    CHECK(store_scrub(&stats.used_blocks, &stats.used_chunks) == 1);
+}
+
+void run_fs_tests(void) {
+    RUN_TEST(test_write_read_round_trip);
+    RUN_TEST(test_create_duplicate);
+    RUN_TEST(test_delete);
+    RUN_TEST(test_table_full);
+    RUN_TEST(test_write_truncates);
+    RUN_TEST(test_identical_files_share_blocks);
+    RUN_TEST(test_compress_round_trip);
+    RUN_TEST(test_fsck_clean);
+    RUN_TEST(test_fsck_finds_corrupt_entry);
+    RUN_TEST(test_corrupt_entry_is_not_changed);
+    RUN_TEST(test_read_fails_on_corrupt_block);
+    RUN_TEST(test_undecodable_block_is_corrupt);
+    RUN_TEST(test_reclaim_skips_corrupt_block);
+}
@@ -0,0 +1,78 @@
+#include "check.h"
+#include "../../kernel/ipc.h"
+#include "../../kernel/page.h"
+
+static void inline_message(struct ipc_message* msg, uint32_t tag, const char* text) {
+    msg->sender = IPC_KERNEL;
+    msg->tag = tag;
+    msg->page = PAGE_NONE;
+    msg->size = strlen(text) + 1;
+    memcpy(msg->data, text, msg->size);
+}
+
+static void test_ipc_fifo_and_bounds(void) {
+    int port = ipc_port_create();
+    CHECK(port >= 0);
+    struct ipc_message msg;
+    for (int i = 0; i < IPC_QUEUE_SIZE; i++) {
+        inline_message(&msg, i, "hello");
+        CHECK(ipc_send(port, &msg, IPC_NONBLOCK) == 0);
+    }
+    CHECK(ipc_send(port, &msg, IPC_NONBLOCK) == IPC_AGAIN);
+    CHECK(ipc_queued(port) == IPC_QUEUE_SIZE);
+    for (int i = 0; i < IPC_QUEUE_SIZE; i++) {
+        CHECK(ipc_receive(port, &msg, IPC_KERNEL, IPC_NONBLOCK) == 0);
+        CHECK(msg.tag == (uint32_t)i && strcmp((char*)msg.data, "hello") == 0);
+    }
+    CHECK(ipc_receive(port, &msg, IPC_KERNEL, IPC_NONBLOCK) == IPC_AGAIN);
+    msg.size = IPC_INLINE_SIZE + 1;
+    CHECK(ipc_send(port, &msg, 0) == IPC_TOO_BIG);
+    ipc_port_destroy(port);
+    CHECK(ipc_send(port, &msg, 0) == IPC_NO_PORT);
+}
+
+static void test_ipc_page_changes_owner(void) {
+    init_pages();
+    int port = ipc_port_create();
+    struct ipc_message msg;
+    inline_message(&msg, 1, "");
+    msg.sender = 3;
+    msg.page = page_alloc(3);
+    msg.size = PAGE_SIZE;
+    CHECK(msg.page != PAGE_NONE);
+    char* data = page_address(msg.page);
+    strcpy(data, "in place");
+
+    msg.sender = 4;                     // Not its page to send
+    CHECK(ipc_send(port, &msg, 0) == IPC_NOT_OWNER);
+    msg.sender = 3;
+    CHECK(ipc_send(port, &msg, 0) == 0);
+    CHECK(page_owner(msg.page) == PAGE_OWNER_IN_TRANSIT);
+    CHECK(page_free(msg.page, 3) < 0);
+
+    struct ipc_message received;
+    CHECK(ipc_receive(port, &received, 5, 0) == 0);
+    CHECK(received.page == msg.page && page_owner(received.page) == 5);
+    CHECK(page_address(received.page) == data && strcmp(data, "in place") == 0);
+    CHECK(page_free(received.page, 5) == 0);
+    ipc_port_destroy(port);
+    CHECK(pages_free() == PAGE_POOL_PAGES);
+}
+
+static void test_ipc_destroy_frees_queued_pages(void) {
+    init_pages();
+    int port = ipc_port_create();
+    struct ipc_message msg;
+    inline_message(&msg, 1, "");
+    msg.page = page_alloc(IPC_KERNEL);
+    CHECK(ipc_send(port, &msg, 0) == 0);
+    CHECK(pages_free() == PAGE_POOL_PAGES - 1);
+    ipc_port_destroy(port);
+    CHECK(pages_free() == PAGE_POOL_PAGES);
+}
+
+void run_ipc_tests(void) {
+    RUN_TEST(test_ipc_fifo_and_bounds);
+    RUN_TEST(test_ipc_page_changes_owner);
+    RUN_TEST(test_ipc_destroy_frees_queued_pages);
+}
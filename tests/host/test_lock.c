@@ -0,0 +1,136 @@
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "check.h"
+#include "../../kernel/spinlock.h"
+#include "../../kernel/rwlock.h"
+#include "../../kernel/lockstat.h"
+#include "../../process/sync.h"
+
+// The lock code is built natively, so real threads can contend for it.
+// They yield between rounds: a ticket holder that gets descheduled on a
+// busy host stalls everyone queued behind it.
+
+#define THREADS 4
+#define ROUNDS 20000
+
+static spinlock_t counter_lock;
+static volatile int counter;
+
+static void* count_under_lock(void* arg) {
+    (void)arg;
+    for (int i = 0; i < ROUNDS; i++) {
+        spin_lock(&counter_lock);
+        counter = counter + 1;
+        spin_unlock(&counter_lock);
+        sched_yield();
+    }
+    return NULL;
+}
+
+static void test_spinlock_excludes(void) {
+    pthread_t threads[THREADS];
+    spin_lock_init(&counter_lock, NULL);
+    counter = 0;
+    for (int i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, count_under_lock, NULL);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    CHECK(counter == THREADS * ROUNDS);
+    CHECK(counter_lock.next == counter_lock.owner);
+}
+
+// Writers move both halves together; readers must never see them differ
+static rwlock_t pair_lock;
+static volatile int pair[2];
+static volatile int torn_reads;
+
+static void* read_pair(void* arg) {
+    (void)arg;
+    for (int i = 0; i < ROUNDS; i++) {
+        read_lock(&pair_lock);
+        if (pair[0] != pair[1]) torn_reads++;
+        read_unlock(&pair_lock);
+        sched_yield();
+    }
+    return NULL;
+}
+
+static void* write_pair(void* arg) {
+    (void)arg;
+    for (int i = 0; i < ROUNDS / 10; i++) {
+        write_lock(&pair_lock);
+        pair[0] = pair[0] + 1;
+        pair[1] = pair[1] + 1;
+        write_unlock(&pair_lock);
+        sched_yield();
+    }
+    return NULL;
+}
+
+static void test_rwlock_excludes_writers(void) {
+    pthread_t threads[THREADS];
+    rwlock_init(&pair_lock, NULL);
+    pair[0] = pair[1] = 0;
+    torn_reads = 0;
+    for (int i = 0; i < THREADS; i++) {
+        pthread_create(&threads[i], NULL, i < 2 ? write_pair : read_pair, NULL);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    CHECK(torn_reads == 0);
+    CHECK(pair[0] == 2 * (ROUNDS / 10));
+    CHECK(pair_lock.state == 0);
+}
+
+static void* take_and_release(void* arg) {
+    spinlock_t* lock = arg;
+    spin_lock(lock);
+    spin_unlock(lock);
+    return NULL;
+}
+
+static void test_lockstat_counts_waits(void) {
+    static struct lock_stats stats;
+    spinlock_t lock;
+    spin_lock_init(&lock, &stats);
+    lockstat_register(&stats, "test", -1, LOCK_SPIN);
+    lockstat_enabled = 1;
+    spin_lock(&lock);
+    pthread_t thread;
+    pthread_create(&thread, NULL, take_and_release, &lock);
+    struct timespec pause = { 0, 10000000 };
+    nanosleep(&pause, NULL);
+    spin_unlock(&lock);
+    pthread_join(thread, NULL);
+    lockstat_enabled = 0;
+    CHECK(stats.acquisitions == 2);
+    CHECK(stats.contended == 1);
+    CHECK(stats.wait_cycles > 0 && stats.max_wait_cycles == stats.wait_cycles);
+}
+
+static void test_semaphore_hands_off_in_order(void) {
+    static struct semaphore sem;
+    static Process a, b, c;
+    sem_init(&sem, 1, "test_sem", LOCK_SEMAPHORE);
+    a.state = b.state = c.state = READY;
+    CHECK(sem_down(&sem, &a) && a.holds_lock);
+    CHECK(!sem_down(&sem, &b) && b.state == WAITING);
+    CHECK(!sem_down(&sem, &c) && c.state == WAITING);
+    CHECK(sem_cancel(&sem, &b));
+    CHECK(!sem_cancel(&sem, &b));
+    CHECK(sem_up(&sem, 3) == &c);
+    CHECK(c.state == READY && c.holds_lock && c.cpu == 3);
+    CHECK(sem_up(&sem, 0) == NULL);
+    CHECK(sem.count == 1);
+}
+
+void run_lock_tests(void) {
+    RUN_TEST(test_spinlock_excludes);
+    RUN_TEST(test_rwlock_excludes_writers);
+    RUN_TEST(test_lockstat_counts_waits);
+    RUN_TEST(test_semaphore_hands_off_in_order);
+}
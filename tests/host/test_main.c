@@ -0,0 +1,42 @@
+// Host unit tests for fs, process, math_commands, the locks, IPC, the
+// timer wheel, the calendar and bignums (make host-test)
+
+#include <stdio.h>
+#include "check.h"
+#include "shim.h"
+
+static int tests_run = 0;
+static int tests_failed = 0;
+static int current_failed;
+
+void test_failed(const char* file, int line, const char* expression) {
+    printf("  FAILED %s:%d: %s\n", file, line, expression);
+    current_failed = 1;
+}
+
+void run_test(const char* name, void (*test)(void)) {
+    current_failed = 0;
+    shim_reset_output();
+    shim_set_input("");
+    test();
+    tests_run++;
+    if (current_failed) {
+        tests_failed++;
+        printf("[ FAIL ] %s\n", name);
+    } else {
+        printf("[  OK  ] %s\n", name);
+    }
+}
+
+int main(void) {
+    run_fs_tests();
+    run_process_tests();
+    run_math_tests();
+    run_bignum_tests();
+    run_lock_tests();
+    run_ipc_tests();
+    run_wheel_tests();
+    run_calendar_tests();
+    printf("%d tests, %d failed\n", tests_run, tests_failed);
+    return tests_failed ? 1 : 0;
+}
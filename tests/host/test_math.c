@@ -0,0 +1,154 @@
+#include "check.h"
+#include "shim.h"
+#include "../../shell/math_commands.h"
+#include "../../shell/calc.h"
+
+// The first line of output of a one-shot calculation
+static const char* evaluate(const char* expression) {
+    static char line[128];
+    shim_reset_output();
+    calculator_command(expression);
+    const char* out = shim_output();
+    size_t length = strcspn(out, "\n");
+    if (length >= sizeof(line)) length = sizeof(line) - 1;
+    memcpy(line, out, length);
+    line[length] = '\0';
+    return line;
+}
+
+static void test_basic_operators(void) {
+    CHECK(strcmp(evaluate("2+3"), "5") == 0);
+    CHECK(strcmp(evaluate("10 - 4"), "6") == 0);
+    CHECK(strcmp(evaluate("6*7"), "42") == 0);
+    CHECK(strcmp(evaluate("9/2"), "4") == 0);
+}
+
+static void test_negative_operands(void) {
+    CHECK(strcmp(evaluate("-3*4"), "-12") == 0);
+    CHECK(strcmp(evaluate("5 - -5"), "10") == 0);
+}
+
+static void test_division_by_zero(void) {
+    CHECK_CONTAINS(evaluate("7/0"), "Division by zero");
+}
+
+static void test_invalid_expressions(void) {
+    CHECK_CONTAINS(evaluate("2 $ 3"), "Invalid expression");
+    CHECK_CONTAINS(evaluate("(1 + 2"), "missing ')'");
+    CHECK_CONTAINS(evaluate("1 + 2)"), "Invalid expression");
+    CHECK_CONTAINS(evaluate("4 4"), "Invalid expression");
+    CHECK_CONTAINS(evaluate("0x100000000"), "over 32 bits");
+    CHECK_CONTAINS(evaluate("undefined_name + 1"), "unknown variable");
+    CHECK_CONTAINS(evaluate("1 << 32"), "Shift count");
+}
+
+static void test_precedence(void) {
+    CHECK(strcmp(evaluate("2 + 3 * 4"), "14") == 0);
+    CHECK(strcmp(evaluate("(2 + 3) * 4"), "20") == 0);
+    CHECK(strcmp(evaluate("10 - 4 - 3"), "3") == 0);
+    CHECK(strcmp(evaluate("100 / 10 / 5"), "2") == 0);
+    CHECK(strcmp(evaluate("-(2 + 3) * -2"), "10") == 0);
+    CHECK(strcmp(evaluate("17 % 5 + 1 << 2"), "12") == 0);
+    CHECK(strcmp(evaluate("1 | 6 & 3 ^ 8"), "11") == 0);
+    CHECK(strcmp(evaluate("~0x0F & 0xFF"), "240") == 0);
+    CHECK(strcmp(evaluate("2^3"), "1") == 0);
+    CHECK(strcmp(evaluate("0xFFFFFFFF"), "-1") == 0);
+    CHECK(strcmp(evaluate("-16 >> 2"), "-4") == 0);
+    CHECK(strcmp(evaluate("1 << 31"), "-2147483648") == 0);     // Shifts stay 32-bit
+    CHECK(strcmp(evaluate("-2**2"), "-4") == 0);
+    CHECK(strcmp(evaluate("2**3**2"), "512") == 0);
+    CHECK(strcmp(evaluate("3!!"), "720") == 0);
+    CHECK(strcmp(evaluate("2 * 3! ** 2"), "72") == 0);
+}
+
+static void test_variables(void) {
+    CHECK(strcmp(evaluate("width = 6"), "width = 6") == 0);
+    CHECK(strcmp(evaluate("height = width + 1"), "height = 7") == 0);
+    CHECK(strcmp(evaluate("width * height"), "42") == 0);
+    CHECK(strcmp(evaluate("ans + 1"), "43") == 0);
+    CHECK(strcmp(evaluate("width = width * 2"), "width = 12") == 0);
+    CHECK(strcmp(evaluate("width * height"), "84") == 0);
+}
+
+static void test_compiled_program(void) {
+    const char* error;
+    int slot = calc_variable("n");
+    calc_set_variable(slot, 3);
+    const struct calc_program* program = calc_compile("n * (2 + 3) - 1", &error);
+    CHECK(program != NULL);
+    // The constant part is folded, leaving load, constant, multiply, constant, subtract, end
+    CHECK(program->length == 9 && program->constant_count == 2);
+    uint32_t hits, misses, hits_after, misses_after;
+    calc_cache_stats(&hits, &misses);
+    CHECK(calc_compile("n * (2 + 3) - 1", &error) == program);
+    calc_cache_stats(&hits_after, &misses_after);
+    CHECK(hits_after == hits + 1 && misses_after == misses);
+    int32_t value;
+    for (int n = -5; n <= 5; n++) {
+        calc_set_variable(slot, n);
+        CHECK(calc_run(program, &value) == 0 && value == n * 5 - 1);
+    }
+    // A division by zero is left to the run, not folded away
+    program = calc_compile("1 / (n - n)", &error);
+    CHECK(program != NULL && calc_run(program, &value) == CALC_DIVIDE_BY_ZERO);
+}
+
+static void test_bignum_promotion(void) {
+    CHECK(strcmp(evaluate("2147483647 + 1"), "2147483648") == 0);
+    CHECK(strcmp(evaluate("(-2147483647 - 1) / -1"), "2147483648") == 0);
+    CHECK(strcmp(evaluate("-2147483648"), "-2147483648") == 0);
+    CHECK(strcmp(evaluate("86400 * 1000000000"), "86400000000000") == 0);
+    CHECK(strcmp(evaluate("2**100"), "1267650600228229401496703205376") == 0);
+    CHECK(strcmp(evaluate("30!"), "265252859812191058636308480000000") == 0);
+    CHECK(strcmp(evaluate("1000! / 998!"), "999000") == 0);
+    CHECK(strcmp(evaluate("12345678901234567890 % 97"), "3") == 0);
+    // Big values in variables, and back down to 32 bits
+    CHECK(strcmp(evaluate("big = 2**64 * 3"), "big = 55340232221128654848") == 0);
+    CHECK(strcmp(evaluate("ans % 1000003"), "52058") == 0);
+    CHECK(strcmp(evaluate("other = big / 3 - 2**64 + 5"), "other = 5") == 0);
+    CHECK(strcmp(evaluate("other * 2"), "10") == 0);
+    CHECK(strcmp(evaluate("big - big"), "0") == 0);
+    CHECK(strcmp(evaluate("x = -1"), "x = -1") == 0);
+    CHECK(strcmp(evaluate("x**3 + 2**40"), "1099511627775") == 0);
+    CHECK(strcmp(evaluate("x**3 * 3000000000"), "-3000000000") == 0);
+    shim_reset_output();
+    calculator_command("5000!");
+    CHECK(strlen(shim_output()) == 16326 + 1);
+    CHECK_CONTAINS(evaluate("big & 1"), "32-bit");
+    CHECK_CONTAINS(evaluate("2 ** -1"), "Negative exponent");
+    CHECK_CONTAINS(evaluate("(-3)!"), "negative");
+    CHECK_CONTAINS(evaluate("2 ** 100000000"), "too big");
+}
+
+static void test_bench(void) {
+    shim_reset_output();
+    calculator_command("-bench i 1 1000 i * i");
+    const char* out = shim_output();
+    CHECK_CONTAINS(out, "1000 runs");
+    CHECK_CONTAINS(out, "Sum of results: 333833500");
+    shim_reset_output();
+    calculator_command("-bench i 1 3 i ** 40");
+    CHECK_CONTAINS(shim_output(), "2 in bignums");
+}
+
+static void test_interactive_mode(void) {
+    shim_set_input("6/3\nexit\n");
+    calculator_command("");
+    const char* out = shim_output();
+    CHECK_CONTAINS(out, "Calculator mode");
+    CHECK_CONTAINS(out, "2\n");
+    CHECK_CONTAINS(out, "Exiting calculator.");
+}
+
+void run_math_tests(void) {
+    RUN_TEST(test_basic_operators);
+    RUN_TEST(test_negative_operands);
+    RUN_TEST(test_division_by_zero);
+    RUN_TEST(test_invalid_expressions);
+    RUN_TEST(test_precedence);
+    RUN_TEST(test_variables);
+    RUN_TEST(test_compiled_program);
+    RUN_TEST(test_bignum_promotion);
+    RUN_TEST(test_bench);
+    RUN_TEST(test_interactive_mode);
+}
@@ -0,0 +1,91 @@
+#include "check.h"
+#include "shim.h"
+#include "../../process/process.h"
+
+static void test_queue_fifo(void) {
+    static Process items[3];
+    Queue queue;
+    queue_init(&queue);
+    CHECK(queue_is_empty(&queue));
+    for (int i = 0; i < 3; i++) {
+        queue_push(&queue, &items[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        CHECK(queue_pop(&queue) == &items[i]);
+    }
+    CHECK(queue_is_empty(&queue));
+}
+
+static void test_queue_wraps_and_bounds(void) {
+    static Process items[MAX_PROCESSES + 1];
+    Queue queue;
+    queue_init(&queue);
+    // Cycle through the ring several times
+    for (int round = 0; round < 3 * MAX_PROCESSES; round++) {
+        queue_push(&queue, &items[round % MAX_PROCESSES]);
+        CHECK(queue_pop(&queue) == &items[round % MAX_PROCESSES]);
+    }
+    for (int i = 0; i <= MAX_PROCESSES; i++) {
+        queue_push(&queue, &items[i]);
+    }
+    CHECK(queue.size == MAX_PROCESSES);  // The extra push is refused
+}
+
+static void test_create_and_kill(void) {
+    init_scheduler();
+    int pid = create_process("worker", 3);
+    CHECK(pid >= 0);
+    CHECK(is_process_alive(pid));
+    kill_process(pid);
+    CHECK(!is_process_alive(pid));
+}
+
+static void test_create_on_cpu(void) {
+    init_scheduler();
+    CHECK(create_process_on_cpu("here", 1000, 0) >= 0);
+    CHECK(scheduler_load(0) == 1);
+    CHECK(create_process_on_cpu("nowhere", 1000, smp_cpu_count()) < 0);
+    CHECK(create_process_on_cpu("nowhere", 1000, -1) < 0);
+}
+
+static void test_process_table_full(void) {
+    init_scheduler();
+    // Bursts long enough that nothing finishes while the table fills
+    for (int i = 0; i < MAX_PROCESSES; i++) {
+        CHECK(create_process("p", 1000) >= 0);
+    }
+    CHECK(create_process("p", 1000) < 0);
+}
+
+static void test_runs_in_creation_order(void) {
+    init_scheduler();
+    create_process("A", 3);
+    create_process("B", 3);
+    for (int i = 0; i < 8; i++) {
+        schedule();
+    }
+    const char* out = shim_output();
+    const char* a = strstr(out, "Process terminated: A");
+    const char* b = strstr(out, "Running process: B");
+    CHECK(a != NULL && b != NULL && a < b);
+}
+
+static void test_process_terminates(void) {
+    init_scheduler();
+    int pid = create_process("short", 1);
+    for (int i = 0; i < 4; i++) {
+        schedule();
+    }
+    CHECK_CONTAINS(shim_output(), "Process terminated: short");
+    CHECK(!is_process_alive(pid));
+}
+
+void run_process_tests(void) {
+    RUN_TEST(test_queue_fifo);
+    RUN_TEST(test_queue_wraps_and_bounds);
+    RUN_TEST(test_create_and_kill);
+    RUN_TEST(test_create_on_cpu);
+    RUN_TEST(test_process_table_full);
+    RUN_TEST(test_runs_in_creation_order);
+    RUN_TEST(test_process_terminates);
+}
@@ -0,0 +1,88 @@
+#include "check.h"
+#include "../../kernel/wheel.h"
+
+#define START 1000                      // Not a multiple of WHEEL_SLOTS
+
+static struct wheel wheel;
+
+// Wake up only when wheel_next says to, as a tickless CPU would, and
+// check everything comes out on its own tick; the number of wakeups
+static int run_until_empty(uint64_t* last) {
+    int wakeups = 0;
+    while (wheel.count > 0) {
+        uint64_t now = wheel_next(&wheel);
+        if (now == WHEEL_NEVER) return -1;
+        wakeups++;
+        struct wheel_entry* entry;
+        while ((entry = wheel_expire(&wheel, now)) != NULL) {
+            if (entry->expires != now) return -1;
+            *last = now;
+        }
+    }
+    return wakeups;
+}
+
+static void test_wheel_expires_on_time(void) {
+    static const uint64_t deltas[] = { 0, 1, 63, 64, 65, 4095, 4096, 5000, 262143, 300000, 20000000 };
+    static struct wheel_entry entries[sizeof(deltas) / sizeof(deltas[0])];
+    int count = sizeof(deltas) / sizeof(deltas[0]);
+    wheel_init(&wheel, START);
+    CHECK(wheel_next(&wheel) == WHEEL_NEVER);
+    for (int i = count - 1; i >= 0; i--) {
+        entries[i].expires = START + deltas[i];
+        wheel_add(&wheel, &entries[i]);
+    }
+    CHECK(wheel.count == (uint32_t)count);
+    CHECK(wheel_next(&wheel) == START);
+    uint64_t last = 0;
+    int wakeups = run_until_empty(&last);
+    CHECK(wakeups >= count);
+    CHECK(last == START + 20000000);
+    // A handful of cascades on the way, not a wakeup per tick
+    CHECK(wakeups < count + 4 * WHEEL_LEVELS * WHEEL_SLOTS);
+    CHECK(wheel_next(&wheel) == WHEEL_NEVER);
+}
+
+static void test_wheel_remove(void) {
+    static struct wheel_entry entries[1000];
+    wheel_init(&wheel, START);
+    for (int i = 0; i < 1000; i++) {
+        entries[i].expires = START + i * 37;
+        wheel_add(&wheel, &entries[i]);
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        wheel_remove(&wheel, &entries[i]);
+    }
+    CHECK(wheel.count == 500);
+    int expired = 0;
+    struct wheel_entry* entry;
+    while ((entry = wheel_expire(&wheel, START + 1000 * 37)) != NULL) {
+        CHECK((entry - entries) % 2 == 1);
+        expired++;
+    }
+    CHECK(expired == 500);
+    CHECK(wheel.count == 0 && wheel_next(&wheel) == WHEEL_NEVER);
+}
+
+static void test_wheel_late_and_catch_up(void) {
+    static struct wheel_entry early, late, overdue;
+    wheel_init(&wheel, START);
+    early.expires = START + 10;
+    late.expires = START + 100000;
+    wheel_add(&wheel, &early);
+    wheel_add(&wheel, &late);
+    // Long after both were due, as after an interrupt came late
+    CHECK(wheel_expire(&wheel, START + 200000) == &early);
+    CHECK(wheel_expire(&wheel, START + 200000) == &late);
+    CHECK(wheel_expire(&wheel, START + 200000) == NULL);
+    overdue.expires = START;            // Already past: due at the next tick
+    wheel_add(&wheel, &overdue);
+    CHECK(wheel_next(&wheel) == START + 200001);
+    CHECK(wheel_expire(&wheel, START + 200001) == &overdue);
+}
+
+void run_wheel_tests(void) {
+    RUN_TEST(test_wheel_expires_on_time);
+    RUN_TEST(test_wheel_remove);
+    RUN_TEST(test_wheel_late_and_catch_up);
+}
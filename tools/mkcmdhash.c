@@ -0,0 +1,85 @@
+// Host-side tool: generate the shell's perfect hash over the command names
+// declared in shell/command_table.h.
+//
+//   mkcmdhash <header>
+//
+// Searches for a seed under which command_hash() sends every name to its own
+// slot, and writes the seed and the slot-to-command table as a C header.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../shell/command_table.h"
+
+#define COMMAND_NAME(name, handler, category, help) name,
+static const char* names[] = { COMMAND_LIST(COMMAND_NAME) };
+#define COUNT ((int)(sizeof(names) / sizeof(names[0])))
+
+#define MAX_SLOTS 256                   // Slots hold command index + 1 in a byte
+#define SEEDS_PER_SIZE 1000000
+
+// Find a seed that gives every name its own slot in a table of `slots`
+static int try_seeds(int slots, unsigned char* table, uint32_t* seed) {
+    for (uint32_t s = 0; s < SEEDS_PER_SIZE; s++) {
+        memset(table, 0, MAX_SLOTS);
+        int i;
+        for (i = 0; i < COUNT; i++) {
+            uint32_t slot = command_hash(names[i], s) & (slots - 1);
+            if (table[slot]) break;
+            table[slot] = i + 1;
+        }
+        if (i == COUNT) {
+            *seed = s;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: mkcmdhash <header>\n");
+        return 1;
+    }
+    for (int i = 0; i < COUNT; i++) {
+        for (int j = 0; j < i; j++) {
+            if (strcmp(names[i], names[j]) == 0) {
+                fprintf(stderr, "mkcmdhash: duplicate command: %s\n", names[i]);
+                return 1;
+            }
+        }
+    }
+
+    // Start at a load factor of at most one half and widen if no seed works
+    int slots = 1;
+    while (slots < 2 * COUNT) slots <<= 1;
+    static unsigned char table[MAX_SLOTS];
+    uint32_t seed = 0;
+    while (!try_seeds(slots, table, &seed)) {
+        slots <<= 1;
+        if (slots > MAX_SLOTS) {
+            fprintf(stderr, "mkcmdhash: no perfect hash for %d commands\n", COUNT);
+            return 1;
+        }
+    }
+
+    FILE* out = fopen(argv[1], "w");
+    if (out == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    fprintf(out, "// Generated by mkcmdhash from shell/command_table.h; do not edit.\n");
+    fprintf(out, "#define COMMAND_HASH_SEED 0x%08Xu\n", seed);
+    fprintf(out, "#define COMMAND_HASH_SLOTS %d\n\n", slots);
+    fprintf(out, "// Command index + 1 for each slot, 0 when empty\n");
+    fprintf(out, "static const uint8_t command_slots[COMMAND_HASH_SLOTS] = {");
+    for (int i = 0; i < slots; i++) {
+        fprintf(out, "%s%3d,", i % 16 ? " " : "\n    ", table[i]);
+    }
+    fprintf(out, "\n};\n");
+    if (fclose(out) != 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    return 0;
+}
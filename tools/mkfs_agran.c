@@ -0,0 +1,244 @@
+// Host-side tool: format an AGRAN file system inside a disk image and
+// preload files into it.
+//
+//   mkfs_agran [-l] <image> [file ...]
+//
+// The file system fills the image from AGRANFS_START_LBA to its end.
+// With -l the image is formatted log-structured (see fs/lfs.c).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../fs/agranfs.h"
+
+static struct agranfs_superblock sb;
+static struct agranfs_inode inodes[AGRANFS_INODES];
+static struct agranfs_dirent dirents[AGRANFS_INODES];
+static uint8_t bitmap[AGRANFS_MAX_BITMAP_BLOCKS * AGRANFS_BLOCK_SIZE];
+static uint32_t next_free_block;
+
+// Log-structured layout: the segment being filled and the checkpoint
+static uint8_t segment[AGRANFS_SEGMENT_BLOCKS * AGRANFS_BLOCK_SIZE];
+static uint32_t segment_index;
+static uint32_t segment_fill;
+static uint8_t checkpoint_raw[AGRANFS_CHECKPOINT_BLOCKS * AGRANFS_BLOCK_SIZE];
+static struct agranfs_checkpoint* cp = (struct agranfs_checkpoint*)checkpoint_raw;
+
+static void write_blocks(FILE* image, uint32_t block, const void* data, uint32_t count) {
+    long offset = (long)(AGRANFS_START_LBA + block) * AGRANFS_BLOCK_SIZE;
+    if (fseek(image, offset, SEEK_SET) != 0 ||
+        fwrite(data, AGRANFS_BLOCK_SIZE, count, image) != count) {
+        perror("mkfs_agran: write");
+        exit(1);
+    }
+}
+
+static void mark_used(uint32_t block) {
+    bitmap[block / 8] |= 1 << (block % 8);
+    sb.free_blocks--;
+}
+
+static const char* base_name(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// Read a file to preload; returns its size
+static size_t load_file(const char* path, uint8_t* data, size_t max) {
+    FILE* in = fopen(path, "rb");
+    if (in == NULL) {
+        perror(path);
+        exit(1);
+    }
+    memset(data, 0, max);
+    size_t size = fread(data, 1, max, in);
+    if (fgetc(in) != EOF) {
+        fprintf(stderr, "mkfs_agran: %s truncated to %zu bytes\n", path, max);
+    }
+    fclose(in);
+
+    const char* name = base_name(path);
+    if (strlen(name) >= AGRANFS_NAME_LEN) {
+        fprintf(stderr, "mkfs_agran: name too long: %s\n", name);
+        exit(1);
+    }
+    return size;
+}
+
+static void add_file(FILE* image, int inode, const char* path) {
+    uint8_t data[AGRANFS_DIRECT_BLOCKS * AGRANFS_BLOCK_SIZE];
+    size_t size = load_file(path, data, sizeof(data));
+
+    uint32_t blocks = (size + AGRANFS_BLOCK_SIZE - 1) / AGRANFS_BLOCK_SIZE;
+    if (next_free_block + blocks > sb.total_blocks) {
+        fprintf(stderr, "mkfs_agran: image full at %s\n", path);
+        exit(1);
+    }
+    inodes[inode].flags = AGRANFS_INODE_USED;
+    inodes[inode].size = size;
+    for (uint32_t i = 0; i < blocks; i++) {
+        inodes[inode].blocks[i] = next_free_block;
+        mark_used(next_free_block);
+        write_blocks(image, next_free_block, data + i * AGRANFS_BLOCK_SIZE, 1);
+        next_free_block++;
+    }
+    dirents[inode].inode = inode + 1;
+    strcpy(dirents[inode].name, base_name(path));
+}
+
+static void flush_segment(FILE* image) {
+    struct agranfs_segment_summary* summary = (struct agranfs_segment_summary*)segment;
+    summary->sequence = 1;
+    summary->blocks = segment_fill;
+    write_blocks(image, sb.segment_start + segment_index * AGRANFS_SEGMENT_BLOCKS, segment, segment_fill);
+    segment_index++;
+    segment_fill = 1;
+    memset(segment, 0, sizeof(segment));
+}
+
+static uint32_t append_block(FILE* image, const void* data, uint16_t inode, uint16_t index) {
+    if (segment_fill == AGRANFS_SEGMENT_BLOCKS) {
+        flush_segment(image);
+    }
+    if (segment_index >= sb.segment_count) {
+        fprintf(stderr, "mkfs_agran: image full\n");
+        exit(1);
+    }
+    struct agranfs_segment_summary* summary = (struct agranfs_segment_summary*)segment;
+    memcpy(segment + segment_fill * AGRANFS_BLOCK_SIZE, data, AGRANFS_BLOCK_SIZE);
+    summary->entries[segment_fill].inode = inode;
+    summary->entries[segment_fill].index = index;
+    return sb.segment_start + segment_index * AGRANFS_SEGMENT_BLOCKS + segment_fill++;
+}
+
+// Write files and then their packed inode records into the first segments
+static void format_log(FILE* image, int count, char* paths[]) {
+    static struct agranfs_log_inode records[AGRANFS_INODES];
+    uint8_t data[AGRANFS_DIRECT_BLOCKS * AGRANFS_BLOCK_SIZE];
+
+    sb.flags = AGRANFS_FLAG_LOG;
+    sb.checkpoint_start = 1;
+    sb.checkpoint_blocks = AGRANFS_CHECKPOINT_BLOCKS;
+    sb.segment_start = sb.checkpoint_start + sb.checkpoint_blocks;
+    sb.segment_blocks = AGRANFS_SEGMENT_BLOCKS;
+    sb.segment_count = (sb.total_blocks - sb.segment_start) / AGRANFS_SEGMENT_BLOCKS;
+    if (sb.segment_count > AGRANFS_MAX_SEGMENTS) sb.segment_count = AGRANFS_MAX_SEGMENTS;
+    if (sb.segment_count < 2) {
+        fprintf(stderr, "mkfs_agran: image too small for a log\n");
+        exit(1);
+    }
+    sb.free_blocks = sb.segment_count * AGRANFS_SEGMENT_BLOCKS;
+    segment_index = 0;
+    segment_fill = 1;
+
+    for (int i = 0; i < count; i++) {
+        size_t size = load_file(paths[i], data, sizeof(data));
+        uint32_t blocks = (size + AGRANFS_BLOCK_SIZE - 1) / AGRANFS_BLOCK_SIZE;
+        records[i].inode.flags = AGRANFS_INODE_USED;
+        records[i].inode.size = size;
+        for (uint32_t b = 0; b < blocks; b++) {
+            uint32_t block = append_block(image, data + b * AGRANFS_BLOCK_SIZE, i, b);
+            records[i].inode.blocks[b] = block;
+            cp->segment_live[(block - sb.segment_start) / AGRANFS_SEGMENT_BLOCKS]++;
+            sb.free_blocks--;
+        }
+        records[i].entry.inode = i + 1;
+        strcpy(records[i].entry.name, base_name(paths[i]));
+    }
+    for (int i = 0; i < count; i += AGRANFS_LOG_INODES_PER_BLOCK) {
+        uint8_t block_data[AGRANFS_BLOCK_SIZE];
+        int slots = count - i < (int)AGRANFS_LOG_INODES_PER_BLOCK ? count - i : (int)AGRANFS_LOG_INODES_PER_BLOCK;
+        memset(block_data, 0, sizeof(block_data));
+        memcpy(block_data, &records[i], slots * sizeof(struct agranfs_log_inode));
+        uint32_t block = append_block(image, block_data, AGRANFS_SUMMARY_INODE_BLOCK, 0);
+        for (int slot = 0; slot < slots; slot++) {
+            cp->imap[i + slot] = AGRANFS_IMAP_ENTRY(block, slot);
+        }
+        cp->segment_live[(block - sb.segment_start) / AGRANFS_SEGMENT_BLOCKS] += slots;
+        sb.free_blocks--;
+    }
+    cp->head_segment = segment_index;
+    if (segment_fill > 1) {
+        flush_segment(image);
+    }
+    cp->sequence = 1;
+    write_blocks(image, sb.checkpoint_start, checkpoint_raw, sb.checkpoint_blocks);
+}
+
+int main(int argc, char* argv[]) {
+    int log_layout = 0;
+    if (argc > 1 && strcmp(argv[1], "-l") == 0) {
+        log_layout = 1;
+        argv++;
+        argc--;
+    }
+    if (argc < 2) {
+        fprintf(stderr, "usage: mkfs_agran [-l] <image> [file ...]\n");
+        return 1;
+    }
+    if (argc - 2 > AGRANFS_INODES) {
+        fprintf(stderr, "mkfs_agran: at most %d files\n", AGRANFS_INODES);
+        return 1;
+    }
+
+    FILE* image = fopen(argv[1], "r+b");
+    if (image == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    fseek(image, 0, SEEK_END);
+    long image_blocks = ftell(image) / AGRANFS_BLOCK_SIZE;
+    long total = image_blocks - AGRANFS_START_LBA;
+    long max_blocks = (long)AGRANFS_MAX_BITMAP_BLOCKS * AGRANFS_BITS_PER_BLOCK;
+    if (total > max_blocks) total = max_blocks;
+
+    uint32_t bitmap_blocks = (total + AGRANFS_BITS_PER_BLOCK - 1) / AGRANFS_BITS_PER_BLOCK;
+    uint32_t inode_blocks = AGRANFS_INODES / AGRANFS_INODES_PER_BLOCK;
+    uint32_t dir_blocks = AGRANFS_INODES / AGRANFS_DIRENTS_PER_BLOCK;
+    uint32_t data_start = 1 + bitmap_blocks + inode_blocks + dir_blocks;
+    if (total <= (long)data_start) {
+        fprintf(stderr, "mkfs_agran: image too small (need more than %u blocks after LBA %d)\n",
+                data_start, AGRANFS_START_LBA);
+        return 1;
+    }
+
+    sb.magic = AGRANFS_MAGIC;
+    sb.version = AGRANFS_VERSION;
+    sb.block_size = AGRANFS_BLOCK_SIZE;
+    sb.total_blocks = total;
+    sb.free_blocks = total;
+    sb.inode_count = AGRANFS_INODES;
+    sb.bitmap_start = 1;
+    sb.bitmap_blocks = bitmap_blocks;
+    sb.inode_start = sb.bitmap_start + bitmap_blocks;
+    sb.inode_blocks = inode_blocks;
+    sb.dir_start = sb.inode_start + inode_blocks;
+    sb.dir_blocks = dir_blocks;
+    sb.data_start = data_start;
+
+    if (log_layout) {
+        format_log(image, argc - 2, argv + 2);
+        write_blocks(image, 0, &sb, 1);
+        fclose(image);
+        printf("mkfs_agran: log-structured, %u segments, %d files\n", sb.segment_count, argc - 2);
+        return 0;
+    }
+
+    for (uint32_t block = 0; block < data_start; block++) {
+        mark_used(block);
+    }
+    next_free_block = data_start;
+
+    for (int i = 2; i < argc; i++) {
+        add_file(image, i - 2, argv[i]);
+    }
+
+    write_blocks(image, sb.bitmap_start, bitmap, bitmap_blocks);
+    write_blocks(image, sb.inode_start, inodes, inode_blocks);
+    write_blocks(image, sb.dir_start, dirents, dir_blocks);
+    write_blocks(image, 0, &sb, 1);
+    fclose(image);
+
+    printf("mkfs_agran: %u blocks, %u free, %d files\n", sb.total_blocks, sb.free_blocks, argc - 2);
+    return 0;
+}
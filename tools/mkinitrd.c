@@ -0,0 +1,79 @@
+// Host-side tool: pack files into the initrd archive linked into the kernel.
+//
+//   mkinitrd <archive> [file ...]
+//
+// Only the base name of each file is kept.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../fs/initrd.h"
+
+static const char* base_name(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static void write_or_die(FILE* out, const void* data, size_t size) {
+    if (fwrite(data, 1, size, out) != size) {
+        perror("mkinitrd: write");
+        exit(1);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: mkinitrd <archive> [file ...]\n");
+        return 1;
+    }
+    int count = argc - 2;
+    struct initrd_header header = { INITRD_MAGIC, (uint32_t)count };
+    struct initrd_entry* entries = calloc(count ? count : 1, sizeof(struct initrd_entry));
+    char** contents = calloc(count ? count : 1, sizeof(char*));
+    uint32_t offset = sizeof(header) + count * sizeof(struct initrd_entry);
+
+    for (int i = 0; i < count; i++) {
+        const char* path = argv[i + 2];
+        const char* name = base_name(path);
+        if (strlen(name) >= INITRD_NAME_LEN) {
+            fprintf(stderr, "mkinitrd: name too long: %s\n", name);
+            return 1;
+        }
+        FILE* in = fopen(path, "rb");
+        if (in == NULL) {
+            perror(path);
+            return 1;
+        }
+        fseek(in, 0, SEEK_END);
+        long size = ftell(in);
+        fseek(in, 0, SEEK_SET);
+        contents[i] = malloc(size + 1);
+        if (fread(contents[i], 1, size, in) != (size_t)size) {
+            perror(path);
+            return 1;
+        }
+        fclose(in);
+
+        strcpy(entries[i].name, name);
+        entries[i].offset = offset;
+        entries[i].size = size;
+        offset += (size + 1 + 3) & ~3u;   // NUL terminator, 4-byte alignment
+    }
+
+    FILE* out = fopen(argv[1], "wb");
+    if (out == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    write_or_die(out, &header, sizeof(header));
+    write_or_die(out, entries, count * sizeof(struct initrd_entry));
+    for (int i = 0; i < count; i++) {
+        static const char padding[4];
+        write_or_die(out, contents[i], entries[i].size);
+        write_or_die(out, padding, ((entries[i].size + 1 + 3) & ~3u) - entries[i].size);
+    }
+    fclose(out);
+
+    printf("mkinitrd: %d files, %u bytes\n", count, offset);
+    return 0;
+}
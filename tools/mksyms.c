@@ -0,0 +1,100 @@
+// Host-side tool: turn `nm -n kernel.elf` into the kernel's symbol table.
+//
+//   nm -n kernel.elf | mksyms <ksymtab.c>
+//
+// Keeps code symbols (nm types t, T, w and W) below __text_end, sorted by
+// address with one name per address, and writes them as a C file: addresses with offsets
+// into a single block of names, so the table is two words per function
+// plus the names. Empty input gives an empty table, for the first link.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define MAX_SYMBOLS 8192
+#define MAX_NAME 128
+
+struct symbol {
+    uint32_t address;
+    char name[MAX_NAME];
+};
+
+static struct symbol symbols[MAX_SYMBOLS];
+
+static int by_address(const void* a, const void* b) {
+    const struct symbol* x = a;
+    const struct symbol* y = b;
+    if (x->address != y->address) return x->address < y->address ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: mksyms <output.c> < nm-output\n");
+        return 1;
+    }
+    int count = 0;
+    int have_end = 0;
+    uint32_t text_end = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), stdin)) {
+        unsigned long address;
+        char type;
+        char name[MAX_NAME];
+        if (sscanf(line, "%lx %c %127s", &address, &type, name) != 3) continue;
+        // linker.ld puts .rodata in the same output section as code, so
+        // its symbols have code types too; __text_end separates them
+        if (strcmp(name, "__text_end") == 0) {
+            text_end = (uint32_t)address;
+            have_end = 1;
+            continue;
+        }
+        if (type != 't' && type != 'T' && type != 'w' && type != 'W') continue;
+        if (count == MAX_SYMBOLS) {
+            fprintf(stderr, "mksyms: more than %d symbols\n", MAX_SYMBOLS);
+            return 1;
+        }
+        symbols[count].address = (uint32_t)address;
+        strcpy(symbols[count].name, name);
+        count++;
+    }
+    qsort(symbols, count, sizeof(symbols[0]), by_address);
+    while (have_end && count > 0 && symbols[count - 1].address >= text_end) {
+        count--;
+    }
+
+    FILE* out = fopen(argv[1], "w");
+    if (out == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    fprintf(out, "// Generated by mksyms from nm of the kernel; do not edit.\n");
+    fprintf(out, "#include \"kernel/ksyms.h\"\n\n");
+    fprintf(out, "const struct ksym ksyms[] = {\n");
+    int written = 0;
+    uint32_t offset = 0;
+    for (int i = 0; i < count; i++) {
+        if (i > 0 && symbols[i].address == symbols[i - 1].address) continue;
+        fprintf(out, "    { 0x%08X, %u },\n", symbols[i].address, offset);
+        offset += strlen(symbols[i].name) + 1;
+        written++;
+    }
+    if (written == 0) {
+        fprintf(out, "    { 0, 0 },\n");
+    }
+    fprintf(out, "};\n\nconst uint32_t ksym_count = %d;\n\n", written);
+    // One array rather than string literals, so the linker cannot merge the
+    // names into other strings and move them between the two links
+    fprintf(out, "const char ksym_names[] =");
+    for (int i = 0; i < count; i++) {
+        if (i > 0 && symbols[i].address == symbols[i - 1].address) continue;
+        fprintf(out, "\n    \"%s\\0\"", symbols[i].name);
+    }
+    fprintf(out, "%s;\n", written ? "" : " \"\"");
+    if (fclose(out) != 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+#!/usr/bin/env bash
+# Boot an AGRAN OS image headless under QEMU, type a command script at the
+# shell over COM1, and record boot and command timings as CSV.
+#
+#   qemu_bench.sh <image> <commands> <csv> [baseline.csv]
+#
+# Each line of <commands> is typed at the shell prompt (blank lines and
+# lines starting with '#' are skipped), then "shutdown 0". The guest exits
+# through QEMU's isa-debug-exit device; a timeout, or any other way out,
+# fails the run. The image is opened with -snapshot and never changes.
+#
+# CSV columns are kind,name,value,unit:
+#   boot,guest,<us>,us          Reset to the first prompt, by the guest TSC
+#   boot,host,<us>,us           QEMU start to the first prompt, by the host
+#   command,<line>,<us>,us      Each command line
+#   kbench,<name>,<ns>,ns       Median time per operation of kbench runs
+#
+# With a baseline CSV, rows slower than in the baseline by more than
+# BENCH_THRESHOLD percent and BENCH_NOISE units are regressions, and fail
+# the run. The serial log is kept next to the CSV as <csv>.log.
+#
+# The disk is on virtio-blk, the benchmark configuration; set BENCH_DRIVE
+# to another QEMU interface (ide) to time that driver instead.
+
+set -u
+export LC_ALL=C
+
+QEMU=${QEMU:-qemu-system-i386}
+BENCH_TIMEOUT=${BENCH_TIMEOUT:-300}     # Seconds
+BENCH_THRESHOLD=${BENCH_THRESHOLD:-25}  # Percent
+BENCH_NOISE=${BENCH_NOISE:-50}
+BENCH_DRIVE=${BENCH_DRIVE:-virtio}
+
+if [ $# -lt 3 ] || [ $# -gt 4 ]; then
+    echo "usage: $0 <image> <commands> <csv> [baseline.csv]" >&2
+    exit 2
+fi
+image=$1
+commands=$2
+csv=$3
+baseline=${4:-}
+log=$csv.log
+
+if ! command -v "$QEMU" > /dev/null; then
+    echo "qemu_bench: $QEMU not found" >&2
+    exit 2
+fi
+
+input=$(mktemp)
+trap 'rm -f "$input"' EXIT
+grep -v -e '^[[:space:]]*$' -e '^[[:space:]]*#' "$commands" > "$input"
+echo "shutdown 0" >> "$input"
+
+# QEMU only hands the UART a byte when its FIFO has room, so the whole
+# script can be queued on stdin up front. Serial lines are stamped with
+# host time as they arrive.
+start=$EPOCHREALTIME
+timeout "$BENCH_TIMEOUT" "$QEMU" -drive format=raw,file="$image",if="$BENCH_DRIVE" -snapshot -m 32M \
+    -display none -monitor none -serial stdio -no-reboot \
+    -device isa-debug-exit,iobase=0xf4,iosize=0x04 < "$input" |
+while IFS= read -r line; do
+    printf '%s %s\n' "$EPOCHREALTIME" "${line%$'\r'}"
+done > "$log"
+status=${PIPESTATUS[0]}
+
+if [ "$status" -eq 124 ]; then
+    echo "qemu_bench: timed out after ${BENCH_TIMEOUT}s (log: $log)" >&2
+    exit 1
+fi
+# isa-debug-exit makes QEMU exit with (status << 1) | 1
+if [ $((status & 1)) -eq 0 ]; then
+    echo "qemu_bench: guest did not exit through isa-debug-exit, QEMU status $status (log: $log)" >&2
+    exit 1
+fi
+guest_status=$((status >> 1))
+
+awk -v start="$start" '
+function quote(s) {
+    if (s ~ /[",]/) {
+        gsub(/"/, "\"\"", s)
+        s = "\"" s "\""
+    }
+    return s
+}
+BEGIN { print "kind,name,value,unit" }
+{
+    time = $1
+    sub(/^[^ ]* /, "")
+}
+/^# ready us=/ && !ready {
+    ready = 1
+    sub(/^# ready us=/, "")
+    print "boot,guest," $0 ",us"
+    printf "boot,host,%d,us\n", (time - start) * 1000000
+    next
+}
+/^# command us=/ {
+    sub(/^# command us=/, "")
+    us = $1
+    sub(/^[^ ]* ?/, "")
+    print "command," quote($0) "," us ",us"
+    next
+}
+/^# kbench tsc_khz=/ { kbench = 1; next }
+/^# kbench end/ { kbench = 0; next }
+kbench && !/^benchmark,/ {
+    split($0, field, ",")
+    print "kbench," field[1] "," field[6] ",ns"
+}
+' "$log" > "$csv"
+
+if ! grep -q '^boot,guest,' "$csv"; then
+    echo "qemu_bench: the shell prompt never came up (log: $log)" >&2
+    exit 1
+fi
+echo "qemu_bench: boot $(grep '^boot,guest,' "$csv" | cut -d, -f3) us," \
+    "$(grep -c '^command,' "$csv") commands, wrote $csv"
+if [ "$guest_status" -ne 0 ]; then
+    echo "qemu_bench: guest exited with status $guest_status" >&2
+    exit 1
+fi
+
+if [ -n "$baseline" ]; then
+    # Rows are keyed by everything before the value; a command that runs
+    # more than once is compared by its last run
+    awk -v threshold="$BENCH_THRESHOLD" -v noise="$BENCH_NOISE" '
+    function parse(line) {
+        unit = line
+        sub(/.*,/, "", unit)
+        key = line
+        sub(/,[^,]*$/, "", key)
+        value = key
+        sub(/.*,/, "", value)
+        sub(/,[^,]*$/, "", key)
+    }
+    FNR == 1 { next }
+    NR == FNR {
+        parse($0)
+        base[key] = value
+        next
+    }
+    {
+        parse($0)
+        if (!(key in base)) next
+        old = base[key] + 0
+        new = value + 0
+        change = old > 0 ? (new - old) * 100 / old : 0
+        mark = ""
+        if (new - old > noise && change > threshold) {
+            mark = "  REGRESSION"
+            regressions++
+        }
+        printf "%-44s %10d %10d %-2s %+6.1f%%%s\n", key, old, new, unit, change, mark
+    }
+    END {
+        if (regressions) {
+            printf "qemu_bench: %d regressions over %s%%\n", regressions, threshold
+            exit 1
+        }
+    }
+    ' "$baseline" "$csv" || exit 1
+fi
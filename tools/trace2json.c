@@ -0,0 +1,220 @@
+// Host-side tool: convert a 'trace dump' from the serial log into Chrome
+// trace-event JSON, for chrome://tracing or ui.perfetto.dev.
+//
+//   trace2json <serial log> <trace.json>
+//
+// The last complete dump in the log is converted. Kernel events appear per
+// CPU under "kernel"; sched_switch also drives a "processes" track showing
+// which process each CPU was running. Command spans are named after the
+// command, from shell/command_table.h.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../shell/command_table.h"
+
+#define COMMAND_NAME(name, handler, category, help) name,
+static const char* command_names[] = { COMMAND_LIST(COMMAND_NAME) };
+#define COMMAND_COUNT ((int)(sizeof(command_names) / sizeof(command_names[0])))
+
+#define MAX_EVENTS 256
+#define MAX_CPUS 64
+#define KERNEL_PID 0
+#define PROCESSES_PID 1
+
+struct record {
+    unsigned long long tsc;
+    int cpu;
+    int event;
+    unsigned int args[2];
+};
+
+struct event_info {
+    char name[64];
+    char phase;
+};
+
+static struct event_info events[MAX_EVENTS];
+static struct record* records = NULL;
+static size_t record_count = 0;
+static size_t record_capacity = 0;
+static unsigned long tsc_khz = 0;
+static int cpus = 1;
+
+// Parse the log, keeping the last dump that has an end marker
+static int read_log(FILE* in) {
+    char line[512];
+    int inside = 0;
+    int complete = 0;
+    struct record* current = NULL;     // The dump being read
+    size_t current_count = 0;
+    size_t current_capacity = 0;
+    unsigned long current_khz = 0;
+    int current_cpus = 1;
+
+    while (fgets(line, sizeof(line), in)) {
+        char* text = strstr(line, "# trace begin");
+        if (text) {
+            inside = 1;
+            current_count = 0;
+            current_khz = 0;
+            current_cpus = 1;
+            memset(events, 0, sizeof(events));
+            sscanf(text, "# trace begin tsc_khz=%lu cpus=%d", &current_khz, &current_cpus);
+            continue;
+        }
+        if (!inside) continue;
+        if (strstr(line, "# trace end")) {
+            inside = 0;
+            complete = 1;
+            // Keep this dump
+            struct record* swap = records;
+            size_t swap_capacity = record_capacity;
+            records = current;
+            record_capacity = current_capacity;
+            record_count = current_count;
+            current = swap;
+            current_capacity = swap_capacity;
+            tsc_khz = current_khz;
+            cpus = current_cpus;
+            continue;
+        }
+        int id;
+        char phase;
+        char name[64];
+        if (sscanf(line, "# event %d %c %63s", &id, &phase, name) == 3) {
+            if (id >= 0 && id < MAX_EVENTS) {
+                strcpy(events[id].name, name);
+                events[id].phase = phase;
+            }
+            continue;
+        }
+        struct record r;
+        if (sscanf(line, "%llx %d %d %x %x", &r.tsc, &r.cpu, &r.event, &r.args[0], &r.args[1]) == 5) {
+            if (current_count == current_capacity) {
+                current_capacity = current_capacity ? current_capacity * 2 : 4096;
+                current = realloc(current, current_capacity * sizeof(*current));
+                if (current == NULL) {
+                    fprintf(stderr, "trace2json: out of memory\n");
+                    exit(1);
+                }
+            }
+            current[current_count++] = r;
+        }
+    }
+    free(current);
+    return complete;
+}
+
+static double to_us(unsigned long long tsc) {
+    return (double)(tsc - records[0].tsc) * 1000.0 / tsc_khz;
+}
+
+static int first_event = 1;
+
+static void begin_event(FILE* out) {
+    fprintf(out, first_event ? "\n  " : ",\n  ");
+    first_event = 0;
+}
+
+static void write_metadata(FILE* out, int pid, int tid, const char* kind, const char* name) {
+    begin_event(out);
+    fprintf(out, "{\"name\":\"%s\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            kind, pid, tid, name);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: trace2json <serial log> <trace.json>\n");
+        return 1;
+    }
+    FILE* in = fopen(argv[1], "r");
+    if (in == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (!read_log(in)) {
+        fprintf(stderr, "trace2json: no complete 'trace dump' in %s\n", argv[1]);
+        return 1;
+    }
+    fclose(in);
+    if (tsc_khz == 0) {
+        fprintf(stderr, "trace2json: no TSC rate in the dump, timestamps are in cycles\n");
+        tsc_khz = 1000;
+    }
+    if (cpus < 1 || cpus > MAX_CPUS) cpus = 1;
+
+    FILE* out = fopen(argv[2], "w");
+    if (out == NULL) {
+        perror(argv[2]);
+        return 1;
+    }
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    write_metadata(out, KERNEL_PID, 0, "process_name", "kernel");
+    write_metadata(out, PROCESSES_PID, 0, "process_name", "processes");
+    for (int cpu = 0; cpu < cpus; cpu++) {
+        char thread[16];
+        snprintf(thread, sizeof(thread), "cpu %d", cpu);
+        write_metadata(out, KERNEL_PID, cpu, "thread_name", thread);
+        write_metadata(out, PROCESSES_PID, cpu, "thread_name", thread);
+    }
+
+    int running[MAX_CPUS];                 // Process shown running on each CPU, -1 for none
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) running[cpu] = -1;
+    for (size_t i = 0; i < record_count; i++) {
+        const struct record* r = &records[i];
+        if (r->event < 0 || r->event >= MAX_EVENTS || events[r->event].phase == 0) continue;
+        int cpu = r->cpu >= 0 && r->cpu < MAX_CPUS ? r->cpu : 0;
+        const struct event_info* info = &events[r->event];
+        double ts = to_us(r->tsc);
+        const char* name = info->name;
+        if (strcmp(name, "command") == 0 && info->phase == 'B' && r->args[0] < (unsigned)COMMAND_COUNT) {
+            name = command_names[r->args[0]];
+        }
+
+        begin_event(out);
+        fprintf(out, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d", name,
+                info->phase, ts, KERNEL_PID, cpu);
+        if (info->phase == 'i') {
+            fprintf(out, ",\"s\":\"t\"");
+        }
+        fprintf(out, ",\"args\":{\"arg0\":%d,\"arg1\":%d}}", (int)r->args[0], (int)r->args[1]);
+
+        // The processes track: one span per stretch a process runs. A kill
+        // can come from another CPU than the one running the process.
+        int pid = (int)r->args[0];
+        int ends = -1;                     // CPU whose span this record ends
+        if (strcmp(info->name, "sched_switch") == 0 && running[cpu] >= 0) {
+            ends = cpu;
+        } else if (strcmp(info->name, "process_exit") == 0 || strcmp(info->name, "process_kill") == 0) {
+            for (int c = 0; c < MAX_CPUS; c++) {
+                if (running[c] == pid) ends = c;
+            }
+        }
+        if (ends >= 0) {
+            begin_event(out);
+            fprintf(out, "{\"ph\":\"E\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d}", ts, PROCESSES_PID, ends);
+            running[ends] = -1;
+        }
+        if (strcmp(info->name, "sched_switch") == 0) {
+            running[cpu] = (int)r->args[1];
+            begin_event(out);
+            fprintf(out, "{\"name\":\"pid %d\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d}",
+                    running[cpu], ts, PROCESSES_PID, cpu);
+        }
+    }
+    double last = record_count ? to_us(records[record_count - 1].tsc) : 0;
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        if (running[cpu] >= 0) {
+            begin_event(out);
+            fprintf(out, "{\"ph\":\"E\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d}", last, PROCESSES_PID, cpu);
+        }
+    }
+    fprintf(out, "\n]}\n");
+    if (fclose(out) != 0) {
+        perror(argv[2]);
+        return 1;
+    }
+    fprintf(stderr, "trace2json: %zu records\n", record_count);
+    return 0;
+}